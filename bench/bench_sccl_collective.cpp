@@ -0,0 +1,121 @@
+/**
+ * Bus bandwidth of collectives, computed like nccl-tests so numbers are
+ * comparable between collectives and rank counts: algorithm bandwidth is the
+ * payload size over time, bus bandwidth scales it by how much data every rank
+ * has to move in an optimal algorithm.
+ * Rank `i` is created on device `i % device_count`, so with a single device
+ * all ranks are logical devices on it.
+ *
+ * Usage: bench_sccl_collective [rank count] [max size in bytes] [iterations]
+ */
+
+#include <sccl.h>
+
+#include "common.hpp"
+
+#include <functional>
+
+struct collective_t {
+    const char *name;
+    /* payload is all `rank_count` chunks instead of one chunk */
+    bool payload_is_total;
+    /* bus bandwidth factor for `rank_count` ranks */
+    double (*bus_factor)(double rank_count);
+    std::function<void(size_t chunk_size)> run;
+};
+
+int main(int argc, char **argv)
+{
+    size_t rank_count = argc > 1 ? strtoull(argv[1], NULL, 0) : 2;
+    size_t max_size =
+        argc > 2 ? strtoull(argv[2], NULL, 0) : 256 * 1024 * 1024;
+    size_t iterations = argc > 3 ? strtoull(argv[3], NULL, 0) : 5;
+    size_t min_size = 1024 * 1024;
+    if (rank_count < 2 || max_size < min_size) {
+        fprintf(stderr, "need at least 2 ranks and 1 MiB\n");
+        return EXIT_FAILURE;
+    }
+
+    sccl_instance_t instance;
+    CHECK_BENCH(sccl_create_instance(&instance));
+    uint32_t device_count;
+    CHECK_BENCH(sccl_get_device_count(instance, &device_count));
+
+    /* every buffer holds `rank_count` chunks of up to `max_size` bytes */
+    size_t buffer_size = rank_count * max_size;
+    std::vector<sccl_device_t> devices(rank_count);
+    std::vector<sccl_stream_t> streams(rank_count);
+    std::vector<sccl_buffer_t> src(rank_count);
+    std::vector<sccl_buffer_t> dst(rank_count);
+    for (size_t i = 0; i < rank_count; ++i) {
+        CHECK_BENCH(sccl_create_device(instance, &devices[i],
+                                       (uint32_t)(i % device_count)));
+        CHECK_BENCH(sccl_create_stream(devices[i], &streams[i]));
+        CHECK_BENCH(sccl_create_buffer(devices[i], &src[i],
+                                       sccl_buffer_type_device, buffer_size));
+        CHECK_BENCH(sccl_create_buffer(devices[i], &dst[i],
+                                       sccl_buffer_type_device, buffer_size));
+    }
+
+    size_t n = rank_count;
+    collective_t collectives[] = {
+        {"allreduce", false, [](double r) { return 2 * (r - 1) / r; },
+         [&](size_t size) {
+             CHECK_BENCH(sccl_allreduce(streams.data(), src.data(), n,
+                                        size / sizeof(int32_t),
+                                        sccl_dtype_int32, sccl_reduce_op_sum));
+         }},
+        {"broadcast", false, [](double) { return 1.0; },
+         [&](size_t size) {
+             CHECK_BENCH(
+                 sccl_broadcast(streams.data(), src.data(), n, 0, size));
+         }},
+        {"reduce_scatter", true, [](double r) { return (r - 1) / r; },
+         [&](size_t size) {
+             CHECK_BENCH(sccl_reduce_scatter(
+                 streams.data(), src.data(), dst.data(), n,
+                 size / sizeof(int32_t), sccl_dtype_int32, sccl_reduce_op_sum));
+         }},
+        {"all_gather", true, [](double r) { return (r - 1) / r; },
+         [&](size_t size) {
+             CHECK_BENCH(sccl_all_gather(streams.data(), src.data(),
+                                         dst.data(), n, size));
+         }},
+        {"scatter", true, [](double r) { return (r - 1) / r; },
+         [&](size_t size) {
+             CHECK_BENCH(sccl_scatter(streams.data(), src[0], dst.data(), n,
+                                      0, size));
+         }},
+        {"gather", true, [](double r) { return (r - 1) / r; },
+         [&](size_t size) {
+             CHECK_BENCH(sccl_gather(streams.data(), src.data(), dst[0], n,
+                                     0, size));
+         }},
+    };
+
+    printf("ranks: %zu, devices: %" PRIu32 ", iterations: %zu\n", rank_count,
+           device_count, iterations);
+    printf("%-16s %14s %12s %14s %14s\n", "collective", "size (B)",
+           "time (ms)", "algbw (GB/s)", "busbw (GB/s)");
+    for (const collective_t &collective : collectives) {
+        for (size_t size = min_size; size <= max_size; size *= 2) {
+            double seconds =
+                time_median(iterations, [&]() { collective.run(size); });
+            size_t payload = collective.payload_is_total ? n * size : size;
+            double algbw = payload / seconds * 1e-9;
+            double busbw = algbw * collective.bus_factor((double)n);
+            printf("%-16s %14zu %12.3f %14.2f %14.2f\n", collective.name,
+                   payload, seconds * 1e3, algbw, busbw);
+        }
+    }
+
+    for (size_t i = 0; i < rank_count; ++i) {
+        sccl_destroy_buffer(dst[i]);
+        sccl_destroy_buffer(src[i]);
+        sccl_destroy_stream(streams[i]);
+        sccl_destroy_device(devices[i]);
+    }
+    sccl_destroy_instance(instance);
+
+    return 0;
+}
@@ -0,0 +1,199 @@
+/**
+ * Google Benchmark suite of SCCL hot paths: buffer create and destroy,
+ * host map and unmap, copy bandwidth by buffer types, stream dispatch and
+ * join latency, shader creation and shader dispatch throughput.
+ *
+ * Usage: bench_sccl_core [google benchmark flags]
+ * JSON results: bench_sccl_core --benchmark_out=results.json
+ *                               --benchmark_out_format=json
+ * or build target `bench_sccl_core_json`.
+ */
+
+#include <sccl.h>
+
+#include "common.hpp"
+
+#include <benchmark/benchmark.h>
+
+/**
+ * Instance, device and stream shared by all benchmarks, created on first use
+ * and destroyed at exit.
+ */
+class bench_context
+{
+public:
+    static bench_context &get()
+    {
+        static bench_context context;
+        return context;
+    }
+
+    sccl_instance_t instance;
+    sccl_device_t device;
+    sccl_stream_t stream;
+    std::string noop_shader_source;
+
+private:
+    bench_context()
+    {
+        CHECK_BENCH(sccl_create_instance(&instance));
+        CHECK_BENCH(
+            sccl_create_device(instance, &device, get_environment_gpu_index()));
+        CHECK_BENCH(sccl_create_stream(device, &stream));
+        std::optional<std::string> source =
+            read_bench_shader("noop_shader.spv");
+        if (!source.has_value()) {
+            exit(EXIT_FAILURE);
+        }
+        noop_shader_source = source.value();
+    }
+
+    ~bench_context()
+    {
+        sccl_destroy_stream(stream);
+        sccl_destroy_device(device);
+        sccl_destroy_instance(instance);
+    }
+};
+
+static const char *buffer_type_name(sccl_buffer_type_t type)
+{
+    switch (type) {
+    case sccl_buffer_type_host:
+        return "host";
+    case sccl_buffer_type_device:
+        return "device";
+    case sccl_buffer_type_shared:
+        return "shared";
+    default:
+        return "other";
+    }
+}
+
+static sccl_shader_t create_noop_shader(const bench_context &context)
+{
+    sccl_shader_config_t shader_config = {};
+    shader_config.shader_source_code =
+        const_cast<char *>(context.noop_shader_source.data());
+    shader_config.shader_source_code_length =
+        context.noop_shader_source.size();
+    sccl_shader_t shader;
+    CHECK_BENCH(sccl_create_shader(context.device, &shader, &shader_config));
+    return shader;
+}
+
+/* args: buffer type, size */
+static void bm_buffer_create_destroy(benchmark::State &state)
+{
+    bench_context &context = bench_context::get();
+    sccl_buffer_type_t type = static_cast<sccl_buffer_type_t>(state.range(0));
+    size_t size = static_cast<size_t>(state.range(1));
+    for (auto _ : state) {
+        sccl_buffer_t buffer;
+        CHECK_BENCH(sccl_create_buffer(context.device, &buffer, type, size));
+        sccl_destroy_buffer(buffer);
+    }
+    state.SetLabel(buffer_type_name(type));
+}
+BENCHMARK(bm_buffer_create_destroy)
+    ->ArgsProduct({{sccl_buffer_type_host, sccl_buffer_type_device,
+                    sccl_buffer_type_shared},
+                   benchmark::CreateRange(4 << 10, 64 << 20, 16)});
+
+/* args: buffer type, size */
+static void bm_map_unmap(benchmark::State &state)
+{
+    bench_context &context = bench_context::get();
+    sccl_buffer_type_t type = static_cast<sccl_buffer_type_t>(state.range(0));
+    size_t size = static_cast<size_t>(state.range(1));
+    sccl_buffer_t buffer;
+    CHECK_BENCH(sccl_create_buffer(context.device, &buffer, type, size));
+    for (auto _ : state) {
+        void *data;
+        CHECK_BENCH(sccl_host_map_buffer(buffer, &data, 0, size));
+        benchmark::DoNotOptimize(data);
+        sccl_host_unmap_buffer(buffer);
+    }
+    sccl_destroy_buffer(buffer);
+    state.SetLabel(buffer_type_name(type));
+}
+BENCHMARK(bm_map_unmap)
+    ->ArgsProduct({{sccl_buffer_type_host, sccl_buffer_type_shared},
+                   benchmark::CreateRange(4 << 10, 64 << 20, 16)});
+
+/* args: source buffer type, destination buffer type, size */
+static void bm_copy_buffer(benchmark::State &state)
+{
+    bench_context &context = bench_context::get();
+    sccl_buffer_type_t src_type =
+        static_cast<sccl_buffer_type_t>(state.range(0));
+    sccl_buffer_type_t dst_type =
+        static_cast<sccl_buffer_type_t>(state.range(1));
+    size_t size = static_cast<size_t>(state.range(2));
+    sccl_buffer_t src, dst;
+    CHECK_BENCH(sccl_create_buffer(context.device, &src, src_type, size));
+    CHECK_BENCH(sccl_create_buffer(context.device, &dst, dst_type, size));
+    for (auto _ : state) {
+        CHECK_BENCH(sccl_copy_buffer(context.stream, src, 0, dst, 0, size));
+        CHECK_BENCH(sccl_dispatch_stream(context.stream));
+        CHECK_BENCH(sccl_join_stream(context.stream));
+    }
+    sccl_destroy_buffer(dst);
+    sccl_destroy_buffer(src);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(size));
+    state.SetLabel(std::string(buffer_type_name(src_type)) + "->" +
+                   buffer_type_name(dst_type));
+}
+BENCHMARK(bm_copy_buffer)
+    ->ArgsProduct({{sccl_buffer_type_host, sccl_buffer_type_device},
+                   {sccl_buffer_type_host, sccl_buffer_type_device},
+                   benchmark::CreateRange(4 << 10, 256 << 20, 16)})
+    ->UseRealTime();
+
+/* empty command buffer, submit and fence wait overhead */
+static void bm_dispatch_join(benchmark::State &state)
+{
+    bench_context &context = bench_context::get();
+    for (auto _ : state) {
+        CHECK_BENCH(sccl_dispatch_stream(context.stream));
+        CHECK_BENCH(sccl_join_stream(context.stream));
+    }
+}
+BENCHMARK(bm_dispatch_join)->UseRealTime();
+
+static void bm_create_shader(benchmark::State &state)
+{
+    bench_context &context = bench_context::get();
+    for (auto _ : state) {
+        sccl_shader_t shader = create_noop_shader(context);
+        sccl_destroy_shader(shader);
+    }
+}
+BENCHMARK(bm_create_shader);
+
+/* args: shader runs recorded per stream dispatch */
+static void bm_run_shader_throughput(benchmark::State &state)
+{
+    bench_context &context = bench_context::get();
+    sccl_shader_t shader = create_noop_shader(context);
+    size_t runs = static_cast<size_t>(state.range(0));
+    sccl_shader_run_params_t params = {};
+    params.group_count_x = 1;
+    params.group_count_y = 1;
+    params.group_count_z = 1;
+    for (auto _ : state) {
+        for (size_t i = 0; i < runs; ++i) {
+            CHECK_BENCH(sccl_run_shader(context.stream, shader, &params));
+        }
+        CHECK_BENCH(sccl_dispatch_stream(context.stream));
+        CHECK_BENCH(sccl_join_stream(context.stream));
+    }
+    sccl_destroy_shader(shader);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(runs));
+}
+BENCHMARK(bm_run_shader_throughput)
+    ->RangeMultiplier(8)
+    ->Range(1, 4096)
+    ->UseRealTime();
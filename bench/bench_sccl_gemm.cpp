@@ -0,0 +1,97 @@
+/**
+ * Throughput of `sccl_gemm` in GFLOP/s (2 * M * N * K per product) for
+ * square and skinny shapes, float32 and float16 if the device supports it.
+ * Matrices are left uninitialized, only time is measured.
+ *
+ * Usage: bench_sccl_gemm [iterations]
+ */
+
+#include <sccl.h>
+
+#include "common.hpp"
+
+struct shape_t {
+    size_t m, n, k;
+};
+
+static const shape_t shapes[] = {
+    {256, 256, 256},
+    {512, 512, 512},
+    {1024, 1024, 1024},
+    {2048, 2048, 2048},
+    {4096, 4096, 4096},
+    /* skinny */
+    {4096, 4096, 64},
+    {4096, 64, 4096},
+    {64, 4096, 4096},
+    {16384, 16, 1024},
+    {1, 4096, 4096},
+    {4096, 1, 4096},
+};
+
+static void bench_dtype(sccl_device_t device, sccl_stream_t stream,
+                        sccl_dtype_t dtype, const char *name, size_t element,
+                        size_t iterations)
+{
+    for (const shape_t &shape : shapes) {
+        sccl_buffer_t a, b, c;
+        CHECK_BENCH(sccl_create_buffer(device, &a, sccl_buffer_type_device,
+                                       shape.m * shape.k * element));
+        CHECK_BENCH(sccl_create_buffer(device, &b, sccl_buffer_type_device,
+                                       shape.k * shape.n * element));
+        CHECK_BENCH(sccl_create_buffer(device, &c, sccl_buffer_type_device,
+                                       shape.m * shape.n * element));
+
+        /* probe support before timing */
+        sccl_error_t error = sccl_gemm(stream, a, b, c, shape.m, shape.n,
+                                       shape.k, dtype, false, false, 1.0f,
+                                       0.0f);
+        CHECK_BENCH(sccl_dispatch_stream(stream));
+        CHECK_BENCH(sccl_join_stream(stream));
+        if (error == sccl_unsupported_error) {
+            printf("%-8s not supported by device\n", name);
+            sccl_destroy_buffer(c);
+            sccl_destroy_buffer(b);
+            sccl_destroy_buffer(a);
+            return;
+        }
+        CHECK_BENCH(error);
+
+        double seconds = time_stream_median(stream, iterations, [&]() {
+            CHECK_BENCH(sccl_gemm(stream, a, b, c, shape.m, shape.n, shape.k,
+                                  dtype, false, false, 1.0f, 0.0f));
+        });
+        double flops = 2.0 * shape.m * shape.n * shape.k;
+        printf("%-8s %6zu %6zu %6zu %12.3f %12.2f\n", name, shape.m, shape.n,
+               shape.k, seconds * 1e3, flops / seconds * 1e-9);
+
+        sccl_destroy_buffer(c);
+        sccl_destroy_buffer(b);
+        sccl_destroy_buffer(a);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t iterations = argc > 1 ? strtoull(argv[1], NULL, 0) : 10;
+
+    sccl_instance_t instance;
+    sccl_device_t device;
+    sccl_stream_t stream;
+    CHECK_BENCH(sccl_create_instance(&instance));
+    CHECK_BENCH(
+        sccl_create_device(instance, &device, get_environment_gpu_index()));
+    CHECK_BENCH(sccl_create_stream(device, &stream));
+
+    printf("iterations: %zu\n", iterations);
+    printf("%-8s %6s %6s %6s %12s %12s\n", "dtype", "M", "N", "K",
+           "time (ms)", "GFLOP/s");
+    bench_dtype(device, stream, sccl_dtype_float32, "float32", 4, iterations);
+    bench_dtype(device, stream, sccl_dtype_float16, "float16", 2, iterations);
+
+    sccl_destroy_stream(stream);
+    sccl_destroy_device(device);
+    sccl_destroy_instance(instance);
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+/**
+ * Throughput of `sccl_reduce` compared to the naive reduce shader from
+ * examples/shaders/compute_reduce_shader.comp, where every invocation loops
+ * over all ranks with strided loads.
+ *
+ * Usage: bench_sccl_reduce [element count] [iterations]
+ */
+
+#include <sccl.h>
+
+#include "common.hpp"
+
+static const uint32_t naive_local_size = 256;
+static const uint32_t naive_rank_size = 64 * 1024;
+
+/**
+ * Naive example reduces `ranks` arrays of `rank_size` elements into one array
+ * of `rank_size` elements. Reads as many bytes as `sccl_reduce` does for the
+ * same input.
+ */
+static double bench_naive(sccl_device_t device, sccl_stream_t stream,
+                          sccl_buffer_t src, size_t count, size_t iterations)
+{
+    std::string shader_source =
+        read_bench_shader("compute_reduce_shader.spv").value();
+
+    sccl_shader_buffer_layout_t buffer_layouts[3] = {};
+    buffer_layouts[0].position = {0, 0};
+    buffer_layouts[0].type = sccl_buffer_type_device_storage;
+    buffer_layouts[1].position = {1, 0};
+    buffer_layouts[1].type = sccl_buffer_type_device_storage;
+    buffer_layouts[2].position = {2, 0};
+    buffer_layouts[2].type = sccl_buffer_type_host_uniform;
+
+    /* workgroup size is set with specialization constants 0, 1 and 2 */
+    uint32_t local_size[3] = {naive_local_size, 1, 1};
+    sccl_shader_specialization_constant_t specialization_constants[3] = {};
+    for (uint32_t i = 0; i < 3; ++i) {
+        specialization_constants[i].constant_id = i;
+        specialization_constants[i].size = sizeof(uint32_t);
+        specialization_constants[i].data = &local_size[i];
+    }
+
+    sccl_shader_config_t shader_config = {};
+    shader_config.shader_source_code = shader_source.data();
+    shader_config.shader_source_code_length = shader_source.size();
+    shader_config.specialization_constants = specialization_constants;
+    shader_config.specialization_constants_count = 3;
+    shader_config.buffer_layouts = buffer_layouts;
+    shader_config.buffer_layouts_count = 3;
+
+    sccl_shader_t shader;
+    CHECK_BENCH(sccl_create_shader(device, &shader, &shader_config));
+
+    sccl_buffer_t dst, ubo;
+    CHECK_BENCH(sccl_create_buffer(device, &dst, sccl_buffer_type_device,
+                                   naive_rank_size * sizeof(int32_t)));
+    CHECK_BENCH(sccl_create_buffer(device, &ubo, sccl_buffer_type_host_uniform,
+                                   2 * sizeof(uint32_t)));
+    void *mapped;
+    CHECK_BENCH(sccl_host_map_buffer(ubo, &mapped, 0, 2 * sizeof(uint32_t)));
+    static_cast<uint32_t *>(mapped)[0] = count / naive_rank_size;
+    static_cast<uint32_t *>(mapped)[1] = naive_rank_size;
+    sccl_host_unmap_buffer(ubo);
+
+    sccl_shader_buffer_binding_t buffer_bindings[3] = {};
+    buffer_bindings[0] = {buffer_layouts[0].position, src};
+    buffer_bindings[1] = {buffer_layouts[1].position, dst};
+    buffer_bindings[2] = {buffer_layouts[2].position, ubo};
+
+    sccl_shader_run_params_t params = {};
+    params.group_count_x = naive_rank_size / naive_local_size;
+    params.group_count_y = 1;
+    params.group_count_z = 1;
+    params.buffer_bindings = buffer_bindings;
+    params.buffer_bindings_count = 3;
+
+    double seconds = time_stream_median(stream, iterations, [&]() {
+        CHECK_BENCH(sccl_run_shader(stream, shader, &params));
+    });
+
+    sccl_destroy_buffer(ubo);
+    sccl_destroy_buffer(dst);
+    sccl_destroy_shader(shader);
+
+    return seconds;
+}
+
+static double bench_sccl_reduce(sccl_device_t device, sccl_stream_t stream,
+                                sccl_buffer_t src, size_t count,
+                                size_t iterations, int32_t expected)
+{
+    sccl_buffer_t dst;
+    CHECK_BENCH(sccl_create_buffer(device, &dst, sccl_buffer_type_host,
+                                   sizeof(int32_t)));
+
+    double seconds = time_stream_median(stream, iterations, [&]() {
+        CHECK_BENCH(sccl_reduce(stream, src, dst, count, sccl_dtype_int32,
+                                sccl_reduce_op_sum));
+    });
+
+    void *mapped;
+    CHECK_BENCH(sccl_host_map_buffer(dst, &mapped, 0, sizeof(int32_t)));
+    int32_t result = *static_cast<int32_t *>(mapped);
+    sccl_host_unmap_buffer(dst);
+    if (result != expected) {
+        fprintf(stderr, "sccl_reduce result %" PRId32 ", expected %" PRId32
+                        "\n",
+                result, expected);
+        exit(EXIT_FAILURE);
+    }
+
+    sccl_destroy_buffer(dst);
+
+    return seconds;
+}
+
+int main(int argc, char **argv)
+{
+    size_t count = argc > 1 ? strtoull(argv[1], NULL, 0) : 64 * 1024 * 1024;
+    size_t iterations = argc > 2 ? strtoull(argv[2], NULL, 0) : 20;
+    /* naive shader needs whole ranks */
+    count = std::max<size_t>(count / naive_rank_size, 1) * naive_rank_size;
+    size_t size = count * sizeof(int32_t);
+
+    sccl_instance_t instance;
+    sccl_device_t device;
+    sccl_stream_t stream;
+    CHECK_BENCH(sccl_create_instance(&instance));
+    CHECK_BENCH(
+        sccl_create_device(instance, &device, get_environment_gpu_index()));
+    CHECK_BENCH(sccl_create_stream(device, &stream));
+
+    /* fill device input through host staging buffer */
+    sccl_buffer_t staging, src;
+    CHECK_BENCH(
+        sccl_create_buffer(device, &staging, sccl_buffer_type_host, size));
+    CHECK_BENCH(
+        sccl_create_buffer(device, &src, sccl_buffer_type_device, size));
+    void *mapped;
+    CHECK_BENCH(sccl_host_map_buffer(staging, &mapped, 0, size));
+    int32_t expected = 0;
+    for (size_t i = 0; i < count; ++i) {
+        int32_t value = (int32_t)(i % 3) - 1;
+        static_cast<int32_t *>(mapped)[i] = value;
+        expected += value;
+    }
+    sccl_host_unmap_buffer(staging);
+    CHECK_BENCH(sccl_copy_buffer(stream, staging, 0, src, 0, size));
+    CHECK_BENCH(sccl_dispatch_stream(stream));
+    CHECK_BENCH(sccl_join_stream(stream));
+    sccl_destroy_buffer(staging);
+
+    double naive_seconds = bench_naive(device, stream, src, count, iterations);
+    double reduce_seconds =
+        bench_sccl_reduce(device, stream, src, count, iterations, expected);
+
+    /* times include submit and join overhead, which is the same for both */
+    printf("elements: %zu (int32 sum), iterations: %zu\n", count, iterations);
+    printf("%-24s %12s %12s\n", "kernel", "time (ms)", "GB/s");
+    printf("%-24s %12.3f %12.2f\n", "naive example", naive_seconds * 1e3,
+           size / naive_seconds * 1e-9);
+    printf("%-24s %12.3f %12.2f\n", "sccl_reduce", reduce_seconds * 1e3,
+           size / reduce_seconds * 1e-9);
+    printf("speedup: %.2fx\n", naive_seconds / reduce_seconds);
+
+    sccl_destroy_buffer(src);
+    sccl_destroy_stream(stream);
+    sccl_destroy_device(device);
+    sccl_destroy_instance(instance);
+
+    return 0;
+}
@@ -0,0 +1,127 @@
+/**
+ * Throughput of `sccl_sort_keys` and `sccl_sort_pairs` compared to
+ * `std::sort` with parallel execution on the host. Without TBB, libstdc++
+ * runs the parallel host sort sequentially.
+ * Device times include the copy that restores the unsorted input before every
+ * sort, the copy alone is reported as well.
+ *
+ * Usage: bench_sccl_sort [key count] [iterations]
+ */
+
+#include <sccl.h>
+
+#include "common.hpp"
+
+#include <cstring>
+#include <execution>
+#include <random>
+
+static double bench_host(const std::vector<uint32_t> &keys, size_t iterations)
+{
+    std::vector<double> times;
+    for (size_t i = 0; i < iterations + 1; ++i) {
+        std::vector<uint32_t> sorted = keys;
+        auto start = std::chrono::steady_clock::now();
+        std::sort(std::execution::par_unseq, sorted.begin(), sorted.end());
+        auto end = std::chrono::steady_clock::now();
+        if (i > 0) {
+            times.push_back(std::chrono::duration<double>(end - start).count());
+        }
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+int main(int argc, char **argv)
+{
+    size_t count = argc > 1 ? strtoull(argv[1], NULL, 0) : 32 * 1024 * 1024;
+    size_t iterations = argc > 2 ? strtoull(argv[2], NULL, 0) : 10;
+    size_t size = count * sizeof(uint32_t);
+
+    std::vector<uint32_t> keys(count);
+    std::mt19937 rng(1);
+    for (uint32_t &key : keys) {
+        key = rng();
+    }
+
+    sccl_instance_t instance;
+    sccl_device_t device;
+    sccl_stream_t stream;
+    CHECK_BENCH(sccl_create_instance(&instance));
+    CHECK_BENCH(
+        sccl_create_device(instance, &device, get_environment_gpu_index()));
+    CHECK_BENCH(sccl_create_stream(device, &stream));
+
+    /* unsorted keys stay in `input`, every iteration sorts a copy */
+    sccl_buffer_t staging, input, key_buffer, value_buffer, temp;
+    CHECK_BENCH(
+        sccl_create_buffer(device, &staging, sccl_buffer_type_host, size));
+    CHECK_BENCH(
+        sccl_create_buffer(device, &input, sccl_buffer_type_device, size));
+    CHECK_BENCH(sccl_create_buffer(device, &key_buffer,
+                                   sccl_buffer_type_shared, size));
+    CHECK_BENCH(sccl_create_buffer(device, &value_buffer,
+                                   sccl_buffer_type_device, size));
+    size_t temp_size;
+    CHECK_BENCH(
+        sccl_get_sort_temp_size(count, sccl_dtype_uint32, true, &temp_size));
+    CHECK_BENCH(sccl_create_buffer(device, &temp, sccl_buffer_type_device,
+                                   temp_size));
+
+    void *mapped;
+    CHECK_BENCH(sccl_host_map_buffer(staging, &mapped, 0, size));
+    memcpy(mapped, keys.data(), size);
+    sccl_host_unmap_buffer(staging);
+    CHECK_BENCH(sccl_copy_buffer(stream, staging, 0, input, 0, size));
+    CHECK_BENCH(sccl_dispatch_stream(stream));
+    CHECK_BENCH(sccl_join_stream(stream));
+    sccl_destroy_buffer(staging);
+
+    double copy_seconds = time_stream_median(stream, iterations, [&]() {
+        CHECK_BENCH(sccl_copy_buffer(stream, input, 0, key_buffer, 0, size));
+    });
+    double keys_seconds = time_stream_median(stream, iterations, [&]() {
+        CHECK_BENCH(sccl_copy_buffer(stream, input, 0, key_buffer, 0, size));
+        CHECK_BENCH(sccl_sort_keys(stream, key_buffer, temp, count,
+                                   sccl_dtype_uint32));
+    });
+
+    /* check device result against the host sort */
+    std::vector<uint32_t> expected = keys;
+    std::sort(std::execution::par_unseq, expected.begin(), expected.end());
+    CHECK_BENCH(sccl_host_map_buffer(key_buffer, &mapped, 0, size));
+    bool sorted = memcmp(mapped, expected.data(), size) == 0;
+    sccl_host_unmap_buffer(key_buffer);
+    if (!sorted) {
+        fprintf(stderr, "sccl_sort_keys result differs from std::sort\n");
+        exit(EXIT_FAILURE);
+    }
+
+    double pairs_seconds = time_stream_median(stream, iterations, [&]() {
+        CHECK_BENCH(sccl_copy_buffer(stream, input, 0, key_buffer, 0, size));
+        CHECK_BENCH(sccl_sort_pairs(stream, key_buffer, value_buffer, temp,
+                                    count, sccl_dtype_uint32));
+    });
+    double host_seconds = bench_host(keys, iterations);
+
+    printf("keys: %zu (uint32), iterations: %zu\n", count, iterations);
+    printf("%-28s %12s %12s\n", "sort", "time (ms)", "Mkeys/s");
+    printf("%-28s %12.3f %12.2f\n", "std::sort (par_unseq)",
+           host_seconds * 1e3, count / host_seconds * 1e-6);
+    printf("%-28s %12.3f %12.2f\n", "sccl_sort_keys + copy",
+           keys_seconds * 1e3, count / keys_seconds * 1e-6);
+    printf("%-28s %12.3f %12.2f\n", "sccl_sort_pairs + copy",
+           pairs_seconds * 1e3, count / pairs_seconds * 1e-6);
+    printf("%-28s %12.3f\n", "copy only", copy_seconds * 1e3);
+    printf("speedup (keys): %.2fx\n", host_seconds / keys_seconds);
+
+    sccl_destroy_buffer(temp);
+    sccl_destroy_buffer(value_buffer);
+    sccl_destroy_buffer(key_buffer);
+    sccl_destroy_buffer(input);
+    sccl_destroy_stream(stream);
+    sccl_destroy_device(device);
+    sccl_destroy_instance(instance);
+
+    return 0;
+}
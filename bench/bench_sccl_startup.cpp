@@ -0,0 +1,159 @@
+/**
+ * Startup cost of creating many shader variants: one `sccl_create_shader`
+ * call per variant against a single `sccl_create_shaders` call, with a cold
+ * pipeline cache (new device) and a warm one (same device again). Drivers
+ * may keep their own cache on disk, so cold numbers after the first run can
+ * include driver cache hits.
+ *
+ * Usage: bench_sccl_startup [variant count] [iterations]
+ */
+
+#include <sccl.h>
+
+#include "common.hpp"
+
+/* local sizes cycled through by the variants */
+static const uint32_t local_sizes[] = {32, 64, 128, 256};
+
+struct variant_configs_t {
+    std::vector<uint32_t> values;
+    std::vector<sccl_shader_specialization_constant_t> constants;
+    std::vector<sccl_shader_config_t> configs;
+};
+
+static void make_variant_configs(std::string &source, size_t variant_count,
+                                 variant_configs_t &variants)
+{
+    static sccl_shader_buffer_layout_t buffer_layout = {
+        {0, 0}, sccl_buffer_type_device_storage};
+    static sccl_shader_push_constant_layout_t push_constant_layout = {
+        sizeof(uint32_t)};
+
+    variants.values.resize(2 * variant_count);
+    variants.constants.resize(2 * variant_count);
+    variants.configs.resize(variant_count);
+    for (size_t i = 0; i < variant_count; ++i) {
+        variants.values[2 * i] = local_sizes[i % std::size(local_sizes)];
+        variants.values[2 * i + 1] = (uint32_t)(i + 1);
+        for (uint32_t j = 0; j < 2; ++j) {
+            sccl_shader_specialization_constant_t &constant =
+                variants.constants[2 * i + j];
+            constant.constant_id = j;
+            constant.size = sizeof(uint32_t);
+            constant.data = &variants.values[2 * i + j];
+        }
+        sccl_shader_config_t &config = variants.configs[i];
+        config = {};
+        config.shader_source_code = source.data();
+        config.shader_source_code_length = source.size();
+        config.specialization_constants = &variants.constants[2 * i];
+        config.specialization_constants_count = 2;
+        config.buffer_layouts = &buffer_layout;
+        config.buffer_layouts_count = 1;
+        config.push_constant_layouts = &push_constant_layout;
+        config.push_constant_layouts_count = 1;
+    }
+}
+
+static double create_sequential(sccl_device_t device,
+                                 const variant_configs_t &variants,
+                                 std::vector<sccl_shader_t> &shaders)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < variants.configs.size(); ++i) {
+        CHECK_BENCH(
+            sccl_create_shader(device, &shaders[i], &variants.configs[i]));
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+static double create_parallel(sccl_device_t device,
+                              const variant_configs_t &variants,
+                              std::vector<sccl_shader_t> &shaders)
+{
+    auto start = std::chrono::steady_clock::now();
+    CHECK_BENCH(sccl_create_shaders(device, variants.configs.data(),
+                                    variants.configs.size(), shaders.data()));
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+static void destroy_shaders(std::vector<sccl_shader_t> &shaders)
+{
+    for (sccl_shader_t shader : shaders) {
+        sccl_destroy_shader(shader);
+    }
+}
+
+static double median(std::vector<double> &times)
+{
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+int main(int argc, char **argv)
+{
+    size_t variant_count = argc > 1 ? strtoull(argv[1], NULL, 0) : 64;
+    size_t iterations = argc > 2 ? strtoull(argv[2], NULL, 0) : 5;
+    if (variant_count == 0 || iterations == 0) {
+        fprintf(stderr, "need at least 1 variant and 1 iteration\n");
+        return EXIT_FAILURE;
+    }
+
+    std::optional<std::string> source = read_bench_shader("variant_shader.spv");
+    if (!source.has_value()) {
+        return EXIT_FAILURE;
+    }
+    variant_configs_t variants;
+    make_variant_configs(source.value(), variant_count, variants);
+
+    sccl_instance_t instance;
+    CHECK_BENCH(sccl_create_instance(&instance));
+    std::vector<sccl_shader_t> shaders(variant_count);
+    std::vector<double> sequential_cold, parallel_cold, sequential_warm,
+        parallel_warm;
+    for (size_t i = 0; i < iterations; ++i) {
+        /* new device for every cold run, so its pipeline cache is empty */
+        sccl_device_t device;
+        CHECK_BENCH(
+            sccl_create_device(instance, &device, get_environment_gpu_index()));
+        sequential_cold.push_back(
+            create_sequential(device, variants, shaders));
+        destroy_shaders(shaders);
+        sequential_warm.push_back(
+            create_sequential(device, variants, shaders));
+        destroy_shaders(shaders);
+        sccl_destroy_device(device);
+
+        CHECK_BENCH(
+            sccl_create_device(instance, &device, get_environment_gpu_index()));
+        parallel_cold.push_back(create_parallel(device, variants, shaders));
+        destroy_shaders(shaders);
+        parallel_warm.push_back(create_parallel(device, variants, shaders));
+        destroy_shaders(shaders);
+        sccl_destroy_device(device);
+    }
+    sccl_destroy_instance(instance);
+
+    printf("variants: %zu, iterations: %zu\n", variant_count, iterations);
+    printf("%-12s %-6s %14s %16s\n", "method", "cache", "total (ms)",
+           "per shader (us)");
+    struct {
+        const char *method;
+        const char *cache;
+        std::vector<double> *times;
+    } rows[] = {
+        {"sequential", "cold", &sequential_cold},
+        {"sequential", "warm", &sequential_warm},
+        {"parallel", "cold", &parallel_cold},
+        {"parallel", "warm", &parallel_warm},
+    };
+    for (auto &row : rows) {
+        double seconds = median(*row.times);
+        printf("%-12s %-6s %14.3f %16.3f\n", row.method, row.cache,
+               seconds * 1e3, seconds / variant_count * 1e6);
+    }
+
+    return 0;
+}
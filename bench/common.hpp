@@ -0,0 +1,107 @@
+#pragma once
+#ifndef BENCH_COMMON_HEADER
+#define BENCH_COMMON_HEADER
+
+#include <sccl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <inttypes.h>
+#include <optional>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+inline uint32_t get_environment_gpu_index()
+{
+    const char *str = getenv("SCCL_BENCH_GPU_INDEX");
+    if (str == NULL) {
+        return 0;
+    }
+    return static_cast<uint32_t>(std::atoi(str));
+}
+
+inline const char *get_environment_shaders_dir()
+{
+    const char *str = getenv("SCCL_BENCH_SHADERS_DIR");
+    if (str == NULL) {
+        return "shaders"; /* default relative path */
+    }
+    return str;
+}
+
+inline std::optional<std::string> read_bench_shader(const char *file_name)
+{
+    std::string path =
+        std::string(get_environment_shaders_dir()) + "/" + file_name;
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+        fprintf(stderr, "failed to open %s\n", path.c_str());
+        return std::nullopt;
+    }
+    fseek(file, 0, SEEK_END);
+    size_t size = ftell(file);
+    rewind(file);
+    std::string data(size, '\0');
+    size_t read_size = fread(data.data(), 1, size, file);
+    fclose(file);
+    if (read_size < size) {
+        return std::nullopt;
+    }
+    return data;
+}
+
+/* Abort benchmark on error, benchmarks have nothing to clean up */
+#define CHECK_BENCH(call)                                                      \
+    do {                                                                       \
+        sccl_error_t bench_error = (call);                                     \
+        if (bench_error != sccl_success) {                                     \
+            fprintf(stderr, "%s:%d: %s failed with %d\n", __FILE__, __LINE__, \
+                    #call, (int)bench_error);                                  \
+            exit(EXIT_FAILURE);                                                \
+        }                                                                      \
+    } while (0)
+
+/**
+ * Run `record` in stream and join `iterations` times after one warmup run,
+ * returns median wall time of dispatch and join in seconds.
+ */
+template <typename F>
+double time_stream_median(sccl_stream_t stream, size_t iterations, F record)
+{
+    std::vector<double> times;
+    for (size_t i = 0; i < iterations + 1; ++i) {
+        record();
+        auto start = std::chrono::steady_clock::now();
+        CHECK_BENCH(sccl_dispatch_stream(stream));
+        CHECK_BENCH(sccl_join_stream(stream));
+        auto end = std::chrono::steady_clock::now();
+        if (i > 0) {
+            times.push_back(std::chrono::duration<double>(end - start).count());
+        }
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+/**
+ * Call `run` `iterations` times after one warmup call, returns median wall
+ * time in seconds.
+ */
+template <typename F> double time_median(size_t iterations, F run)
+{
+    std::vector<double> times;
+    for (size_t i = 0; i < iterations + 1; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        auto end = std::chrono::steady_clock::now();
+        if (i > 0) {
+            times.push_back(std::chrono::duration<double>(end - start).count());
+        }
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+#endif // BENCH_COMMON_HEADER
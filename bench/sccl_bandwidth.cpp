@@ -0,0 +1,347 @@
+/**
+ * Sustained transfer bandwidth for every pair of buffer types and sizes from
+ * 4 B to `max size`, printed as a table and written as CSV.
+ *
+ * Methods:
+ *     copy    `sccl_copy_buffer` between buffers of every type pair
+ *     memcpy  host `memcpy` between heap memory and mapped host visible
+ *             buffers, in both directions
+ *     kernel  copy shader between storage buffers
+ *
+ * Bidirectional runs move `size` bytes each way at once: two copies recorded
+ * in the same stream, one host thread per direction, or one kernel copying
+ * both pairs. Copies in a stream are separated by barriers, so bidirectional
+ * `copy` shows the cost of the sequence rather than overlap.
+ * Small sizes record many transfers per stream dispatch so the result is
+ * throughput and not dispatch latency, see `bench_sccl_core` for latency.
+ *
+ * Usage: sccl_bandwidth [max size in bytes] [csv path] [iterations]
+ */
+
+#include <sccl.h>
+
+#include "common.hpp"
+
+#include <cstring>
+#include <thread>
+
+/* bytes moved per timed dispatch before the repetition count is capped */
+#define BANDWIDTH_BYTES_PER_DISPATCH (64 * 1024 * 1024)
+#define BANDWIDTH_MAX_REPETITIONS 1024
+/* must match `local_size_x` of bench/shaders/copy_shader.comp */
+#define BANDWIDTH_KERNEL_WORKGROUP_SIZE 256
+
+struct buffer_type_t {
+    sccl_buffer_type_t type;
+    const char *name;
+    bool host_visible;
+    bool storage;
+};
+
+static const buffer_type_t buffer_types[] = {
+    {sccl_buffer_type_host, "host", true, true},
+    {sccl_buffer_type_device, "device", false, true},
+    {sccl_buffer_type_shared, "shared", true, true},
+    {sccl_buffer_type_host_uniform, "host_uniform", true, false},
+    {sccl_buffer_type_device_uniform, "device_uniform", false, false},
+    {sccl_buffer_type_shared_uniform, "shared_uniform", true, false},
+};
+
+struct result_t {
+    const char *method;
+    const char *direction;
+    const char *src;
+    const char *dst;
+    size_t size;
+    size_t repetitions;
+    double seconds;
+};
+
+static FILE *csv_file;
+
+static void report(const result_t &result)
+{
+    /* bidirectional runs move `size` bytes in each direction */
+    size_t directions = strcmp(result.direction, "bi") == 0 ? 2 : 1;
+    double bytes = (double)result.size * result.repetitions * directions;
+    double gbps = bytes / result.seconds * 1e-9;
+    printf("%-7s %-4s %-15s %-15s %12zu %6zu %12.4f %10.3f\n", result.method,
+           result.direction, result.src, result.dst, result.size,
+           result.repetitions, result.seconds * 1e3, gbps);
+    fprintf(csv_file, "%s,%s,%s,%s,%zu,%zu,%.9f,%.6f\n", result.method,
+            result.direction, result.src, result.dst, result.size,
+            result.repetitions, result.seconds, gbps);
+}
+
+static size_t get_repetitions(size_t size)
+{
+    size_t repetitions = BANDWIDTH_BYTES_PER_DISPATCH / size;
+    return std::clamp<size_t>(repetitions, 1, BANDWIDTH_MAX_REPETITIONS);
+}
+
+/**
+ * Create buffer, returns false instead of aborting if the device can't hold
+ * it so the remaining sizes still run.
+ */
+static bool try_create_buffer(sccl_device_t device, sccl_buffer_t *buffer,
+                              sccl_buffer_type_t type, size_t size)
+{
+    return sccl_create_buffer(device, buffer, type, size) == sccl_success;
+}
+
+static void bench_copy(sccl_device_t device, sccl_stream_t stream,
+                       const buffer_type_t &src_type,
+                       const buffer_type_t &dst_type, size_t size,
+                       size_t iterations)
+{
+    sccl_buffer_t a, b, c, d;
+    if (!try_create_buffer(device, &a, src_type.type, size)) {
+        return;
+    }
+    if (!try_create_buffer(device, &b, dst_type.type, size)) {
+        sccl_destroy_buffer(a);
+        return;
+    }
+    size_t repetitions = get_repetitions(size);
+
+    double seconds = time_stream_median(stream, iterations, [&]() {
+        for (size_t i = 0; i < repetitions; ++i) {
+            CHECK_BENCH(sccl_copy_buffer(stream, a, 0, b, 0, size));
+        }
+    });
+    report({"copy", "uni", src_type.name, dst_type.name, size, repetitions,
+            seconds});
+
+    /* reverse pair so both types are read and written in each run */
+    if (try_create_buffer(device, &c, dst_type.type, size)) {
+        if (try_create_buffer(device, &d, src_type.type, size)) {
+            seconds = time_stream_median(stream, iterations, [&]() {
+                for (size_t i = 0; i < repetitions; ++i) {
+                    CHECK_BENCH(sccl_copy_buffer(stream, a, 0, b, 0, size));
+                    CHECK_BENCH(sccl_copy_buffer(stream, c, 0, d, 0, size));
+                }
+            });
+            report({"copy", "bi", src_type.name, dst_type.name, size,
+                    repetitions, seconds});
+            sccl_destroy_buffer(d);
+        }
+        sccl_destroy_buffer(c);
+    }
+
+    sccl_destroy_buffer(b);
+    sccl_destroy_buffer(a);
+}
+
+static void bench_memcpy(sccl_device_t device, const buffer_type_t &type,
+                         size_t size, size_t iterations)
+{
+    sccl_buffer_t write_buffer, read_buffer;
+    if (!try_create_buffer(device, &write_buffer, type.type, size)) {
+        return;
+    }
+    if (!try_create_buffer(device, &read_buffer, type.type, size)) {
+        sccl_destroy_buffer(write_buffer);
+        return;
+    }
+    void *write_mapped, *read_mapped;
+    CHECK_BENCH(sccl_host_map_buffer(write_buffer, &write_mapped, 0, size));
+    CHECK_BENCH(sccl_host_map_buffer(read_buffer, &read_mapped, 0, size));
+    std::vector<char> write_heap(size, 1);
+    std::vector<char> read_heap(size);
+    size_t repetitions = get_repetitions(size);
+
+    auto write = [&]() {
+        for (size_t i = 0; i < repetitions; ++i) {
+            memcpy(write_mapped, write_heap.data(), size);
+        }
+    };
+    auto read = [&]() {
+        for (size_t i = 0; i < repetitions; ++i) {
+            memcpy(read_heap.data(), read_mapped, size);
+        }
+    };
+
+    double seconds = time_median(iterations, write);
+    report({"memcpy", "uni", "heap", type.name, size, repetitions, seconds});
+    seconds = time_median(iterations, read);
+    report({"memcpy", "uni", type.name, "heap", size, repetitions, seconds});
+    seconds = time_median(iterations, [&]() {
+        std::thread reader(read);
+        write();
+        reader.join();
+    });
+    report({"memcpy", "bi", "heap", type.name, size, repetitions, seconds});
+
+    sccl_host_unmap_buffer(read_buffer);
+    sccl_host_unmap_buffer(write_buffer);
+    sccl_destroy_buffer(read_buffer);
+    sccl_destroy_buffer(write_buffer);
+}
+
+static sccl_shader_t create_copy_shader(sccl_device_t device)
+{
+    std::optional<std::string> source = read_bench_shader("copy_shader.spv");
+    if (!source.has_value()) {
+        exit(EXIT_FAILURE);
+    }
+
+    sccl_shader_buffer_layout_t buffer_layouts[4];
+    for (uint32_t i = 0; i < 4; ++i) {
+        buffer_layouts[i].position = {0, i};
+        buffer_layouts[i].type = sccl_buffer_type_device_storage;
+    }
+    sccl_shader_push_constant_layout_t push_constant_layout = {};
+    push_constant_layout.size = 2 * sizeof(uint32_t);
+
+    sccl_shader_config_t shader_config = {};
+    shader_config.shader_source_code = source->data();
+    shader_config.shader_source_code_length = source->size();
+    shader_config.buffer_layouts = buffer_layouts;
+    shader_config.buffer_layouts_count = 4;
+    shader_config.push_constant_layouts = &push_constant_layout;
+    shader_config.push_constant_layouts_count = 1;
+
+    sccl_shader_t shader;
+    CHECK_BENCH(sccl_create_shader(device, &shader, &shader_config));
+    return shader;
+}
+
+/**
+ * Record copy kernel from `src0` to `dst0`, and from `src1` to `dst1` if
+ * `bidirectional`.
+ */
+static void record_kernel_copy(sccl_stream_t stream, sccl_shader_t shader,
+                               sccl_buffer_t src0, sccl_buffer_t dst0,
+                               sccl_buffer_t src1, sccl_buffer_t dst1,
+                               size_t size, bool bidirectional)
+{
+    sccl_buffer_t buffers[4] = {src0, dst0, src1, dst1};
+    sccl_shader_buffer_binding_t buffer_bindings[4];
+    for (uint32_t i = 0; i < 4; ++i) {
+        buffer_bindings[i].position = {0, i};
+        buffer_bindings[i].buffer = buffers[i];
+    }
+    uint32_t push_constants[2] = {(uint32_t)(size / sizeof(uint32_t)),
+                                  bidirectional ? 1u : 0u};
+    sccl_shader_push_constant_binding push_constant_binding = {};
+    push_constant_binding.index = 0;
+    push_constant_binding.data = push_constants;
+
+    size_t group_count =
+        (push_constants[0] + BANDWIDTH_KERNEL_WORKGROUP_SIZE - 1) /
+        BANDWIDTH_KERNEL_WORKGROUP_SIZE;
+    sccl_shader_run_params_t params = {};
+    params.group_count_x = (uint32_t)std::min<size_t>(group_count, 65535);
+    params.group_count_y = 1;
+    params.group_count_z = 1;
+    params.buffer_bindings = buffer_bindings;
+    params.buffer_bindings_count = 4;
+    params.push_constant_bindings = &push_constant_binding;
+    params.push_constant_bindings_count = 1;
+    CHECK_BENCH(sccl_run_shader(stream, shader, &params));
+}
+
+static void bench_kernel(sccl_device_t device, sccl_stream_t stream,
+                         sccl_shader_t shader, const buffer_type_t &src_type,
+                         const buffer_type_t &dst_type, size_t size,
+                         size_t iterations)
+{
+    sccl_buffer_t a, b, c, d;
+    if (!try_create_buffer(device, &a, src_type.type, size)) {
+        return;
+    }
+    if (!try_create_buffer(device, &b, dst_type.type, size)) {
+        sccl_destroy_buffer(a);
+        return;
+    }
+    size_t repetitions = get_repetitions(size);
+
+    double seconds = time_stream_median(stream, iterations, [&]() {
+        for (size_t i = 0; i < repetitions; ++i) {
+            record_kernel_copy(stream, shader, a, b, a, b, size, false);
+        }
+    });
+    report({"kernel", "uni", src_type.name, dst_type.name, size, repetitions,
+            seconds});
+
+    if (try_create_buffer(device, &c, dst_type.type, size)) {
+        if (try_create_buffer(device, &d, src_type.type, size)) {
+            seconds = time_stream_median(stream, iterations, [&]() {
+                for (size_t i = 0; i < repetitions; ++i) {
+                    record_kernel_copy(stream, shader, a, b, c, d, size, true);
+                }
+            });
+            report({"kernel", "bi", src_type.name, dst_type.name, size,
+                    repetitions, seconds});
+            sccl_destroy_buffer(d);
+        }
+        sccl_destroy_buffer(c);
+    }
+
+    sccl_destroy_buffer(b);
+    sccl_destroy_buffer(a);
+}
+
+int main(int argc, char **argv)
+{
+    size_t max_size =
+        argc > 1 ? strtoull(argv[1], NULL, 0) : 1024 * 1024 * 1024;
+    const char *csv_path = argc > 2 ? argv[2] : "sccl_bandwidth.csv";
+    size_t iterations = argc > 3 ? strtoull(argv[3], NULL, 0) : 5;
+
+    csv_file = fopen(csv_path, "w");
+    if (csv_file == NULL) {
+        fprintf(stderr, "failed to open %s\n", csv_path);
+        return EXIT_FAILURE;
+    }
+    fprintf(csv_file, "method,direction,src,dst,size,repetitions,seconds,"
+                      "gbps\n");
+
+    sccl_instance_t instance;
+    sccl_device_t device;
+    sccl_stream_t stream;
+    CHECK_BENCH(sccl_create_instance(&instance));
+    CHECK_BENCH(
+        sccl_create_device(instance, &device, get_environment_gpu_index()));
+    CHECK_BENCH(sccl_create_stream(device, &stream));
+    sccl_shader_t copy_shader = create_copy_shader(device);
+
+    printf("iterations: %zu, csv: %s\n", iterations, csv_path);
+    printf("%-7s %-4s %-15s %-15s %12s %6s %12s %10s\n", "method", "dir",
+           "src", "dst", "size (B)", "reps", "time (ms)", "GB/s");
+    for (const buffer_type_t &src_type : buffer_types) {
+        for (const buffer_type_t &dst_type : buffer_types) {
+            for (size_t size = 4; size <= max_size; size *= 4) {
+                bench_copy(device, stream, src_type, dst_type, size,
+                           iterations);
+            }
+        }
+    }
+    for (const buffer_type_t &type : buffer_types) {
+        if (!type.host_visible) {
+            continue;
+        }
+        for (size_t size = 4; size <= max_size; size *= 4) {
+            bench_memcpy(device, type, size, iterations);
+        }
+    }
+    for (const buffer_type_t &src_type : buffer_types) {
+        for (const buffer_type_t &dst_type : buffer_types) {
+            if (!src_type.storage || !dst_type.storage) {
+                continue;
+            }
+            for (size_t size = 4; size <= max_size; size *= 4) {
+                bench_kernel(device, stream, copy_shader, src_type, dst_type,
+                             size, iterations);
+            }
+        }
+    }
+
+    sccl_destroy_shader(copy_shader);
+    sccl_destroy_stream(stream);
+    sccl_destroy_device(device);
+    sccl_destroy_instance(instance);
+    fclose(csv_file);
+
+    return 0;
+}
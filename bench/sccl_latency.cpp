@@ -0,0 +1,330 @@
+/**
+ * Round trip latency of empty dispatches: record a noop shader run, submit,
+ * wait for the fence and wake up the host thread. Every thread owns its
+ * streams and runs `dispatches` round trips, latencies of all threads are
+ * merged into one histogram per wait strategy and thread count.
+ *
+ * Wait strategies, see `sccl_stream_wait_policy_t`:
+ *     block      join the stream right after every dispatch
+ *     spin       poll the fence without yielding
+ *     yield      poll the fence and yield the thread
+ *     hybrid     spin, then yield, then block, adapted to recent waits
+ *     flag       spin on the completion flag written by the device instead of
+ *                the fence
+ *     pipelined  keep `BENCH_PIPELINE_DEPTH` blocking streams in flight and
+ *                join the oldest, latency includes queueing behind earlier
+ *                dispatches
+ *
+ * Thread counts are powers of two up to `max threads`. The table reports
+ * percentiles, the full percentile distribution of every run is written to
+ * `histogram path` in the HdrHistogram text format.
+ *
+ * Usage: sccl_latency [dispatches per thread] [max threads] [histogram path]
+ */
+
+#include <sccl.h>
+
+#include "common.hpp"
+
+#include <bit>
+#include <cmath>
+#include <functional>
+#include <thread>
+
+/* streams in flight for the `pipelined` strategy */
+#define BENCH_PIPELINE_DEPTH 4
+/* polling phases longer than any empty dispatch */
+#define BENCH_POLL_NS 1000000000
+
+/**
+ * Log linear histogram of nanosecond values like HdrHistogram: values below
+ * `2 * sub_bucket_half` are exact, larger values are recorded with
+ * `sub_bucket_half` buckets per power of two, so every value is within
+ * 1 / `sub_bucket_half` of its bucket.
+ */
+class latency_histogram
+{
+public:
+    static constexpr uint64_t sub_bucket_half = 64;
+    static constexpr uint64_t sub_bucket_count = 2 * sub_bucket_half;
+    static constexpr unsigned sub_bucket_bits = 7;
+    /* up to 2^40 ns, about 18 minutes */
+    static constexpr unsigned max_bits = 40;
+
+    latency_histogram()
+        : counts((max_bits - sub_bucket_bits + 2) * sub_bucket_half, 0)
+    {
+    }
+
+    void record(uint64_t value)
+    {
+        value = std::min<uint64_t>(value, (uint64_t(1) << max_bits) - 1);
+        ++counts[get_index(value)];
+        ++total;
+        max = std::max(max, value);
+    }
+
+    void merge(const latency_histogram &other)
+    {
+        for (size_t i = 0; i < counts.size(); ++i) {
+            counts[i] += other.counts[i];
+        }
+        total += other.total;
+        max = std::max(max, other.max);
+    }
+
+    /**
+     * Highest value equivalent to the smallest recorded value that at least
+     * `percentile` percent of values are less than or equal to.
+     */
+    uint64_t get_percentile(double percentile) const
+    {
+        uint64_t target = (uint64_t)std::ceil(percentile / 100.0 * total);
+        target = std::clamp<uint64_t>(target, 1, total);
+        uint64_t count = 0;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            count += counts[i];
+            if (count >= target) {
+                return std::min(get_highest_value(i), max);
+            }
+        }
+        return max;
+    }
+
+    /**
+     * Write percentile distribution with 5 steps per halving of the remaining
+     * values, like `HistogramLogProcessor` output. Values are microseconds.
+     */
+    void write_percentiles(FILE *file) const
+    {
+        fprintf(file, "%12s %14s %10s %14s\n\n", "Value", "Percentile",
+                "TotalCount", "1/(1-Percentile)");
+        const double ticks_per_half = 5.0;
+        double percentile = 0.0;
+        double half_end = 50.0;
+        double step = half_end / ticks_per_half;
+        while (true) {
+            uint64_t value = get_percentile(percentile);
+            uint64_t count = count_less_or_equal(value);
+            if (count == total) {
+                fprintf(file, "%12.3f %14.12f %10" PRIu64 "\n", value * 1e-3,
+                        1.0, count);
+                break;
+            }
+            fprintf(file, "%12.3f %14.12f %10" PRIu64 " %14.2f\n",
+                    value * 1e-3, percentile / 100.0, count,
+                    100.0 / (100.0 - percentile));
+            percentile += step;
+            /* halve the step every time half of the remainder is passed */
+            if (percentile >= half_end - 1e-9) {
+                percentile = half_end;
+                half_end = 100.0 - (100.0 - half_end) / 2.0;
+                step = (half_end - percentile) / ticks_per_half;
+            }
+        }
+        fprintf(file, "#[Max = %12.3f, Total count = %12" PRIu64 "]\n\n",
+                max * 1e-3, total);
+    }
+
+    uint64_t get_total() const { return total; }
+
+private:
+    static size_t get_index(uint64_t value)
+    {
+        unsigned width = std::bit_width(value);
+        unsigned bucket = width > sub_bucket_bits ? width - sub_bucket_bits : 0;
+        return bucket * sub_bucket_half + (value >> bucket);
+    }
+
+    static uint64_t get_highest_value(size_t index)
+    {
+        size_t bucket =
+            index < sub_bucket_count ? 0 : index / sub_bucket_half - 1;
+        uint64_t sub_bucket = index - bucket * sub_bucket_half;
+        return ((sub_bucket + 1) << bucket) - 1;
+    }
+
+    uint64_t count_less_or_equal(uint64_t value) const
+    {
+        uint64_t count = 0;
+        for (size_t i = 0; i <= get_index(value); ++i) {
+            count += counts[i];
+        }
+        return count;
+    }
+
+    std::vector<uint64_t> counts;
+    uint64_t total = 0;
+    uint64_t max = 0;
+};
+
+struct wait_strategy_t {
+    const char *name;
+    sccl_stream_wait_policy_t policy;
+    bool pipelined;
+};
+
+static uint64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static void record_noop(sccl_stream_t stream, sccl_shader_t shader)
+{
+    sccl_shader_run_params_t params = {};
+    params.group_count_x = 1;
+    params.group_count_y = 1;
+    params.group_count_z = 1;
+    CHECK_BENCH(sccl_run_shader(stream, shader, &params));
+}
+
+static void run_single(sccl_device_t device, sccl_shader_t shader,
+                       const sccl_stream_wait_policy_t &policy,
+                       size_t dispatches, latency_histogram &histogram)
+{
+    sccl_stream_t stream;
+    CHECK_BENCH(sccl_create_stream(device, &stream));
+    CHECK_BENCH(sccl_set_stream_wait_policy(stream, &policy));
+    for (size_t i = 0; i < dispatches; ++i) {
+        uint64_t start = now_ns();
+        record_noop(stream, shader);
+        CHECK_BENCH(sccl_dispatch_stream(stream));
+        CHECK_BENCH(sccl_join_stream(stream));
+        histogram.record(now_ns() - start);
+    }
+    sccl_destroy_stream(stream);
+}
+
+static void run_pipelined(sccl_device_t device, sccl_shader_t shader,
+                          const sccl_stream_wait_policy_t &policy,
+                          size_t dispatches, latency_histogram &histogram)
+{
+    sccl_stream_t streams[BENCH_PIPELINE_DEPTH];
+    uint64_t starts[BENCH_PIPELINE_DEPTH];
+    for (size_t i = 0; i < BENCH_PIPELINE_DEPTH; ++i) {
+        CHECK_BENCH(sccl_create_stream(device, &streams[i]));
+        CHECK_BENCH(sccl_set_stream_wait_policy(streams[i], &policy));
+    }
+    for (size_t i = 0; i < dispatches + BENCH_PIPELINE_DEPTH; ++i) {
+        size_t slot = i % BENCH_PIPELINE_DEPTH;
+        if (i >= BENCH_PIPELINE_DEPTH) {
+            CHECK_BENCH(sccl_join_stream(streams[slot]));
+            histogram.record(now_ns() - starts[slot]);
+        }
+        if (i < dispatches) {
+            starts[slot] = now_ns();
+            record_noop(streams[slot], shader);
+            CHECK_BENCH(sccl_dispatch_stream(streams[slot]));
+        }
+    }
+    for (size_t i = 0; i < BENCH_PIPELINE_DEPTH; ++i) {
+        sccl_destroy_stream(streams[i]);
+    }
+}
+
+static void run_strategy(sccl_device_t device, sccl_shader_t shader,
+                         const wait_strategy_t &strategy, size_t dispatches,
+                         latency_histogram &histogram)
+{
+    if (strategy.pipelined) {
+        run_pipelined(device, shader, strategy.policy, dispatches, histogram);
+    } else {
+        run_single(device, shader, strategy.policy, dispatches, histogram);
+    }
+}
+
+static const wait_strategy_t wait_strategies[] = {
+    {"block", {0, 0, false, false}, false},
+    {"spin", {BENCH_POLL_NS, 0, false, false}, false},
+    {"yield", {0, BENCH_POLL_NS, false, false}, false},
+    {"hybrid", {BENCH_POLL_NS / 2, BENCH_POLL_NS / 2, true, false}, false},
+    {"flag", {BENCH_POLL_NS, 0, false, true}, false},
+    {"pipelined", {0, 0, false, false}, true},
+};
+
+int main(int argc, char **argv)
+{
+    size_t dispatches = argc > 1 ? strtoull(argv[1], NULL, 0) : 1000000;
+    size_t max_threads = argc > 2 ? strtoull(argv[2], NULL, 0) : 4;
+    const char *histogram_path =
+        argc > 3 ? argv[3] : "sccl_latency_histogram.txt";
+    if (dispatches == 0 || max_threads == 0) {
+        fprintf(stderr, "need at least 1 dispatch and 1 thread\n");
+        return EXIT_FAILURE;
+    }
+
+    FILE *histogram_file = fopen(histogram_path, "w");
+    if (histogram_file == NULL) {
+        fprintf(stderr, "failed to open %s\n", histogram_path);
+        return EXIT_FAILURE;
+    }
+
+    sccl_instance_t instance;
+    sccl_device_t device;
+    CHECK_BENCH(sccl_create_instance(&instance));
+    CHECK_BENCH(
+        sccl_create_device(instance, &device, get_environment_gpu_index()));
+
+    std::optional<std::string> source = read_bench_shader("noop_shader.spv");
+    if (!source.has_value()) {
+        return EXIT_FAILURE;
+    }
+    sccl_shader_config_t shader_config = {};
+    shader_config.shader_source_code = source->data();
+    shader_config.shader_source_code_length = source->size();
+    sccl_shader_t shader;
+    CHECK_BENCH(sccl_create_shader(device, &shader, &shader_config));
+
+    /* warm up driver and shader before the first measurement */
+    latency_histogram warmup;
+    run_strategy(device, shader, wait_strategies[0], 1000, warmup);
+
+    printf("dispatches per thread: %zu, histograms: %s\n", dispatches,
+           histogram_path);
+    printf("%-12s %8s %12s %10s %10s %10s %10s %10s\n", "strategy", "threads",
+           "dispatch/s", "p50 (us)", "p99 (us)", "p99.9 (us)", "max (us)",
+           "count");
+    for (const wait_strategy_t &strategy : wait_strategies) {
+        for (size_t thread_count = 1; thread_count <= max_threads;
+             thread_count *= 2) {
+            std::vector<latency_histogram> histograms(thread_count);
+            std::vector<std::thread> threads;
+            uint64_t start = now_ns();
+            for (size_t i = 0; i < thread_count; ++i) {
+                threads.emplace_back(run_strategy, device, shader,
+                                     std::cref(strategy), dispatches,
+                                     std::ref(histograms[i]));
+            }
+            for (std::thread &thread : threads) {
+                thread.join();
+            }
+            double seconds = (now_ns() - start) * 1e-9;
+
+            latency_histogram histogram;
+            for (const latency_histogram &h : histograms) {
+                histogram.merge(h);
+            }
+            printf("%-12s %8zu %12.0f %10.2f %10.2f %10.2f %10.2f %10" PRIu64
+                   "\n",
+                   strategy.name, thread_count,
+                   histogram.get_total() / seconds,
+                   histogram.get_percentile(50.0) * 1e-3,
+                   histogram.get_percentile(99.0) * 1e-3,
+                   histogram.get_percentile(99.9) * 1e-3,
+                   histogram.get_percentile(100.0) * 1e-3,
+                   histogram.get_total());
+            fprintf(histogram_file, "# strategy %s, threads %zu\n",
+                    strategy.name, thread_count);
+            histogram.write_percentiles(histogram_file);
+        }
+    }
+
+    fclose(histogram_file);
+    sccl_destroy_shader(shader);
+    sccl_destroy_device(device);
+    sccl_destroy_instance(instance);
+
+    return 0;
+}
@@ -1,15 +1,42 @@
 cmake_minimum_required(VERSION 3.25)
 
+# compile_shader(target source output [glslc options...])
+# Extra arguments are passed to glslc, e.g. `-I<dir>` or `--target-env=...`.
+# If spirv-opt is found and `NO_SPIRV_OPT` is not set, the SPIR-V is
+# optimized with `spirv-opt -O` for the same target environment.
 macro(compile_shader target source output)
+    set(_compile_shader_args ${ARGN})
+    if (spirv_opt_executable AND NOT NO_SPIRV_OPT)
+        set(_compile_shader_opt_args -O)
+        foreach(_compile_shader_arg ${_compile_shader_args})
+            if (_compile_shader_arg MATCHES "^--target-env=")
+                list(APPEND _compile_shader_opt_args ${_compile_shader_arg})
+            endif()
+        endforeach()
+        set(_compile_shader_glslc_output ${output}.unopt)
+        set(_compile_shader_opt_command
+            COMMAND
+                ${spirv_opt_executable}
+                ${_compile_shader_opt_args}
+                -o ${output}
+                ${_compile_shader_glslc_output}
+        )
+    else()
+        set(_compile_shader_glslc_output ${output})
+        set(_compile_shader_opt_command)
+    endif()
+
     add_custom_command(
         OUTPUT ${output}
         DEPENDS ${source}
         DEPFILE ${output}.d
         COMMAND
             ${glslc_executable}
-            -MD -MF ${output}.d
-            -o ${output}
+            -MD -MF ${output}.d -MT ${output}
+            ${_compile_shader_args}
+            -o ${_compile_shader_glslc_output}
             ${source}
+        ${_compile_shader_opt_command}
     )
     add_custom_target(${target} DEPENDS ${output})
-endmacro()
\ No newline at end of file
+endmacro()
@@ -0,0 +1,21 @@
+cmake_minimum_required(VERSION 3.25)
+
+# add_shader_bundle(target output [name spirv...])
+# Pack SPIR-V files into `output`, a C source fragment with an index by name
+# and the compressed code of every shader, see `src/sccl/bundle.c`.
+function(add_shader_bundle target output)
+    set(args ${ARGN})
+    set(inputs)
+    set(depends)
+    while (args)
+        list(POP_FRONT args name spirv)
+        list(APPEND inputs ${name}=${spirv})
+        list(APPEND depends ${spirv})
+    endwhile()
+    add_custom_command(
+        OUTPUT ${output}
+        DEPENDS sccl_shader_bundle ${depends}
+        COMMAND sccl_shader_bundle ${output} ${inputs}
+    )
+    add_custom_target(${target} DEPENDS ${output})
+endfunction()
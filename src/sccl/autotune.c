@@ -0,0 +1,412 @@
+
+#include "alloc.h"
+#include "device.h"
+#include "environment_variables.h"
+#include "error.h"
+#include "sccl.h"
+#include "stream.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#define AUTOTUNE_DEFAULT_ITERATIONS 10
+/* queries of the start and end timestamps */
+#define AUTOTUNE_QUERY_COUNT 2
+
+/* key of a tuned result in the cache file */
+typedef struct {
+    uint64_t shader_hash;
+    uint8_t device_uuid[VK_UUID_SIZE];
+    uint32_t size_bucket;
+} autotune_key_t;
+
+/* FNV-1a */
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t size)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static bool is_tuned_constant(const sccl_autotune_config_t *config,
+                              uint32_t constant_id)
+{
+    for (size_t i = 0; i < config->constant_ids_count; ++i) {
+        if (config->constant_ids[i] == constant_id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Hash SPIR-V, specialization constants that are not tuned and ids of tuned
+ * constants, candidate values are not part of the key so a cached result
+ * can be looked up in a changed candidate set.
+ */
+static uint64_t hash_shader(const sccl_autotune_config_t *config)
+{
+    const sccl_shader_config_t *shader_config = config->shader_config;
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hash = hash_bytes(hash, shader_config->shader_source_code,
+                      shader_config->shader_source_code_length);
+    for (size_t i = 0; i < shader_config->specialization_constants_count;
+         ++i) {
+        const sccl_shader_specialization_constant_t *constant =
+            &shader_config->specialization_constants[i];
+        if (is_tuned_constant(config, constant->constant_id)) {
+            continue;
+        }
+        hash = hash_bytes(hash, &constant->constant_id,
+                          sizeof(constant->constant_id));
+        hash = hash_bytes(hash, constant->data, constant->size);
+    }
+    hash = hash_bytes(hash, config->constant_ids,
+                      config->constant_ids_count * sizeof(uint32_t));
+    return hash;
+}
+
+static uint32_t get_size_bucket(size_t problem_size)
+{
+    uint32_t bucket = 0;
+    while (problem_size > 1) {
+        problem_size >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+static void get_device_uuid(VkPhysicalDevice physical_device,
+                            uint8_t uuid[VK_UUID_SIZE])
+{
+    VkPhysicalDeviceIDProperties id_properties = {0};
+    id_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties = {0};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &id_properties;
+    vkGetPhysicalDeviceProperties2(physical_device, &properties);
+    memcpy(uuid, id_properties.deviceUUID, VK_UUID_SIZE);
+}
+
+static void format_uuid(const uint8_t uuid[VK_UUID_SIZE],
+                        char str[2 * VK_UUID_SIZE + 1])
+{
+    for (size_t i = 0; i < VK_UUID_SIZE; ++i) {
+        snprintf(&str[2 * i], 3, "%02x", uuid[i]);
+    }
+}
+
+static const char *get_cache_path(const sccl_autotune_config_t *config)
+{
+    if (config->cache_path != NULL) {
+        return config->cache_path;
+    }
+    return get_autotune_cache_path();
+}
+
+/**
+ * Find candidate with the values of the last entry of `key` in cache file.
+ * Cache file lines are
+ * `<shader hash> <device uuid> <size bucket> <values count> <values...>`.
+ */
+static bool find_cached_candidate(const sccl_autotune_config_t *config,
+                                  const autotune_key_t *key, size_t *index)
+{
+    const char *path = get_cache_path(config);
+    if (path == NULL) {
+        return false;
+    }
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return false;
+    }
+
+    char uuid[2 * VK_UUID_SIZE + 1];
+    format_uuid(key->device_uuid, uuid);
+
+    bool found = false;
+    uint64_t hash;
+    char line_uuid[2 * VK_UUID_SIZE + 1];
+    uint32_t bucket;
+    size_t values_count;
+    while (fscanf(file, "%" SCNx64 " %32s %" SCNu32 " %zu", &hash, line_uuid,
+                  &bucket, &values_count) == 4) {
+        uint32_t values[SCCL_AUTOTUNE_MAX_CONSTANTS];
+        if (values_count > SCCL_AUTOTUNE_MAX_CONSTANTS) {
+            break;
+        }
+        bool complete = true;
+        for (size_t i = 0; i < values_count; ++i) {
+            complete &= fscanf(file, "%" SCNu32, &values[i]) == 1;
+        }
+        if (!complete) {
+            break;
+        }
+        if (hash != key->shader_hash || strcmp(line_uuid, uuid) != 0 ||
+            bucket != key->size_bucket ||
+            values_count != config->constant_ids_count) {
+            continue;
+        }
+
+        /* later entries override earlier ones */
+        found = false;
+        for (size_t i = 0; i < config->candidates_count; ++i) {
+            const uint32_t *candidate =
+                &config->candidates[i * config->constant_ids_count];
+            if (memcmp(candidate, values, values_count * sizeof(uint32_t)) ==
+                0) {
+                *index = i;
+                found = true;
+                break;
+            }
+        }
+    }
+
+    fclose(file);
+    return found;
+}
+
+static void store_cached_candidate(const sccl_autotune_config_t *config,
+                                   const autotune_key_t *key, size_t index)
+{
+    const char *path = get_cache_path(config);
+    if (path == NULL) {
+        return;
+    }
+    FILE *file = fopen(path, "a");
+    if (file == NULL) {
+        return;
+    }
+
+    char uuid[2 * VK_UUID_SIZE + 1];
+    format_uuid(key->device_uuid, uuid);
+    fprintf(file, "%016" PRIx64 " %s %" PRIu32 " %zu", key->shader_hash, uuid,
+            key->size_bucket, config->constant_ids_count);
+    const uint32_t *candidate =
+        &config->candidates[index * config->constant_ids_count];
+    for (size_t i = 0; i < config->constant_ids_count; ++i) {
+        fprintf(file, " %" PRIu32, candidate[i]);
+    }
+    fprintf(file, "\n");
+
+    fclose(file);
+}
+
+/**
+ * Check that the queue of device writes timestamps, returns the number of
+ * valid bits in `valid_bits`.
+ */
+static bool timestamps_supported(const sccl_device_t device,
+                                 uint32_t *valid_bits)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device->physical_device, &properties);
+
+    uint32_t queue_family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties2(device->physical_device,
+                                              &queue_family_count, NULL);
+    VkQueueFamilyProperties2 *queue_family_properties;
+    if (sccl_calloc((void **)&queue_family_properties, queue_family_count,
+                    sizeof(VkQueueFamilyProperties2)) != sccl_success) {
+        return false;
+    }
+    for (uint32_t i = 0; i < queue_family_count; ++i) {
+        queue_family_properties[i].sType =
+            VK_STRUCTURE_TYPE_QUEUE_FAMILY_PROPERTIES_2;
+    }
+    vkGetPhysicalDeviceQueueFamilyProperties2(
+        device->physical_device, &queue_family_count, queue_family_properties);
+    *valid_bits = queue_family_properties[device->queue_family_index]
+                      .queueFamilyProperties.timestampValidBits;
+    sccl_free(queue_family_properties);
+
+    return *valid_bits > 0 && properties.limits.timestampPeriod > 0.0f;
+}
+
+static sccl_error_t
+create_candidate_shader(const sccl_stream_t stream,
+                        const sccl_autotune_config_t *config,
+                        const uint32_t *values, sccl_shader_t *shader)
+{
+    const sccl_shader_config_t *base = config->shader_config;
+
+    /* constants that are not tuned are passed on, tuned constants get the
+     * values of the candidate */
+    sccl_shader_specialization_constant_t *constants;
+    CHECK_SCCL_ERROR_RET(sccl_calloc(
+        (void **)&constants,
+        base->specialization_constants_count + config->constant_ids_count,
+        sizeof(sccl_shader_specialization_constant_t)));
+    uint32_t constant_values[SCCL_AUTOTUNE_MAX_CONSTANTS];
+    size_t constants_count = 0;
+    for (size_t i = 0; i < base->specialization_constants_count; ++i) {
+        if (!is_tuned_constant(config,
+                               base->specialization_constants[i].constant_id)) {
+            constants[constants_count++] = base->specialization_constants[i];
+        }
+    }
+    for (size_t i = 0; i < config->constant_ids_count; ++i) {
+        constant_values[i] = values[i];
+        constants[constants_count].constant_id = config->constant_ids[i];
+        constants[constants_count].size = sizeof(uint32_t);
+        constants[constants_count].data = &constant_values[i];
+        ++constants_count;
+    }
+
+    sccl_shader_config_t shader_config = *base;
+    shader_config.specialization_constants = constants;
+    shader_config.specialization_constants_count = constants_count;
+    sccl_error_t error =
+        sccl_create_shader(stream->device, shader, &shader_config);
+
+    sccl_free(constants);
+    return error;
+}
+
+/**
+ * Record one run of candidate, on error the partly recorded commands are
+ * dispatched and joined so the stream is left empty.
+ */
+static sccl_error_t record_candidate(const sccl_stream_t stream,
+                                     const sccl_autotune_config_t *config,
+                                     const sccl_shader_t shader,
+                                     const uint32_t *values)
+{
+    sccl_error_t error =
+        config->record(stream, shader, values, config->user_data);
+    if (error != sccl_success) {
+        if (sccl_dispatch_stream(stream) == sccl_success) {
+            sccl_join_stream(stream);
+        }
+    }
+    return error;
+}
+
+/**
+ * Run `config->record` once untimed, then `iterations` times between two
+ * timestamps, returns elapsed ticks in `ticks`.
+ */
+static sccl_error_t time_candidate(const sccl_stream_t stream,
+                                   const sccl_autotune_config_t *config,
+                                   VkQueryPool query_pool, uint32_t valid_bits,
+                                   const sccl_shader_t shader,
+                                   const uint32_t *values, uint64_t *ticks)
+{
+    size_t iterations = config->iterations > 0 ? config->iterations
+                                               : AUTOTUNE_DEFAULT_ITERATIONS;
+
+    /* warm up caches and clocks */
+    CHECK_SCCL_ERROR_RET(record_candidate(stream, config, shader, values));
+    CHECK_SCCL_ERROR_RET(sccl_dispatch_stream(stream));
+    CHECK_SCCL_ERROR_RET(sccl_join_stream(stream));
+
+    vkCmdResetQueryPool(stream->command_buffer, query_pool, 0,
+                        AUTOTUNE_QUERY_COUNT);
+    vkCmdWriteTimestamp(stream->command_buffer,
+                        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool, 0);
+    for (size_t i = 0; i < iterations; ++i) {
+        CHECK_SCCL_ERROR_RET(
+            record_candidate(stream, config, shader, values));
+    }
+    vkCmdWriteTimestamp(stream->command_buffer,
+                        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool, 1);
+    CHECK_SCCL_ERROR_RET(sccl_dispatch_stream(stream));
+    CHECK_SCCL_ERROR_RET(sccl_join_stream(stream));
+
+    uint64_t timestamps[AUTOTUNE_QUERY_COUNT];
+    CHECK_VKRESULT_RET(vkGetQueryPoolResults(
+        stream->device->device, query_pool, 0, AUTOTUNE_QUERY_COUNT,
+        sizeof(timestamps), timestamps, sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+
+    uint64_t mask = valid_bits >= 64 ? UINT64_MAX : (1ull << valid_bits) - 1;
+    *ticks = (timestamps[1] - timestamps[0]) & mask;
+
+    return sccl_success;
+}
+
+static bool validate_config(const sccl_autotune_config_t *config)
+{
+    return config->shader_config != NULL && config->record != NULL &&
+           config->constant_ids != NULL && config->constant_ids_count > 0 &&
+           config->constant_ids_count <= SCCL_AUTOTUNE_MAX_CONSTANTS &&
+           config->candidates != NULL && config->candidates_count > 0;
+}
+
+sccl_error_t sccl_autotune(const sccl_stream_t stream,
+                           const sccl_autotune_config_t *config,
+                           size_t *best_candidate)
+{
+    CHECK_SCCL_NULL_RET(stream);
+    CHECK_SCCL_NULL_RET(config);
+    CHECK_SCCL_NULL_RET(best_candidate);
+    if (!validate_config(config)) {
+        return sccl_invalid_argument;
+    }
+
+    sccl_device_t device = stream->device;
+    autotune_key_t key = {0};
+    key.shader_hash = hash_shader(config);
+    get_device_uuid(device->physical_device, key.device_uuid);
+    key.size_bucket = get_size_bucket(config->problem_size);
+
+    if (find_cached_candidate(config, &key, best_candidate)) {
+        return sccl_success;
+    }
+
+    uint32_t valid_bits;
+    if (!timestamps_supported(device, &valid_bits)) {
+        return sccl_unsupported_error;
+    }
+
+    VkQueryPoolCreateInfo query_pool_create_info = {0};
+    query_pool_create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    query_pool_create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    query_pool_create_info.queryCount = AUTOTUNE_QUERY_COUNT;
+    VkQueryPool query_pool;
+    CHECK_VKRESULT_RET(vkCreateQueryPool(
+        device->device, &query_pool_create_info, NULL, &query_pool));
+
+    /* candidates the device can't create a pipeline for are skipped, the
+     * error is returned if no candidate is left */
+    sccl_error_t error = sccl_success;
+    sccl_error_t create_error = sccl_success;
+    bool found = false;
+    uint64_t best_ticks = UINT64_MAX;
+    for (size_t i = 0; i < config->candidates_count; ++i) {
+        const uint32_t *values =
+            &config->candidates[i * config->constant_ids_count];
+        sccl_shader_t shader;
+        create_error = create_candidate_shader(stream, config, values, &shader);
+        if (create_error != sccl_success) {
+            continue;
+        }
+
+        uint64_t ticks;
+        error = time_candidate(stream, config, query_pool, valid_bits, shader,
+                               values, &ticks);
+        sccl_destroy_shader(shader);
+        if (error != sccl_success) {
+            break;
+        }
+        if (ticks < best_ticks || !found) {
+            best_ticks = ticks;
+            *best_candidate = i;
+            found = true;
+        }
+    }
+
+    vkDestroyQueryPool(device->device, query_pool, NULL);
+
+    CHECK_SCCL_ERROR_RET(error);
+    if (!found) {
+        return create_error;
+    }
+
+    store_cached_candidate(config, &key, *best_candidate);
+    return sccl_success;
+}
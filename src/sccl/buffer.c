@@ -3,39 +3,14 @@
 #include "alloc.h"
 #include "device.h"
 #include "error.h"
+#include "memory.h"
+#include "stream.h"
+#include <pthread.h>
 
-static sccl_error_t find_memory_type(VkPhysicalDevice physical_device,
-                                     uint32_t type_filter,
-                                     VkMemoryPropertyFlags properties,
-                                     uint32_t *output_index)
+static sccl_error_t create_vk_buffer(const sccl_device_t device,
+                                     sccl_buffer_type_t type, size_t size,
+                                     VkBuffer *buffer)
 {
-    VkPhysicalDeviceMemoryProperties mem_properties;
-    vkGetPhysicalDeviceMemoryProperties(physical_device, &mem_properties);
-
-    for (uint32_t i = 0; i < mem_properties.memoryTypeCount; i++) {
-        if ((type_filter & (1 << i)) &&
-            (mem_properties.memoryTypes[i].propertyFlags & properties) ==
-                properties) {
-            *output_index = i;
-            return sccl_success;
-        }
-    }
-
-    return sccl_unsupported_error;
-}
-
-sccl_error_t sccl_create_buffer(const sccl_device_t device,
-                                sccl_buffer_t *buffer, sccl_buffer_type_t type,
-                                size_t size)
-{
-
-    struct sccl_buffer *buffer_internal;
-    CHECK_SCCL_ERROR_RET(
-        sccl_calloc((void **)&buffer_internal, 1, sizeof(struct sccl_buffer)));
-
-    buffer_internal->type = type;
-    buffer_internal->device = device->device;
-
     /* determine buffer usage flags */
     VkBufferUsageFlags buffer_usage_flags = 0;
     /* check if buffer is storage or uniform */
@@ -43,7 +18,9 @@ sccl_error_t sccl_create_buffer(const sccl_device_t device,
     case sccl_buffer_type_host_storage:
     case sccl_buffer_type_device_storage:
     case sccl_buffer_type_shared_storage:
-        buffer_usage_flags |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        /* storage buffers can hold arguments of indirect dispatches */
+        buffer_usage_flags |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                              VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
         break;
     case sccl_buffer_type_host_uniform:
     case sccl_buffer_type_device_uniform:
@@ -62,54 +39,206 @@ sccl_error_t sccl_create_buffer(const sccl_device_t device,
     buffer_info.size = size;
     buffer_info.usage = buffer_usage_flags;
     buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    CHECK_VKRESULT_RET(vkCreateBuffer(buffer_internal->device, &buffer_info,
-                                      NULL, &buffer_internal->buffer));
+    CHECK_VKRESULT_RET(vkCreateBuffer(device->device, &buffer_info, NULL,
+                                      buffer));
+
+    return sccl_success;
+}
 
-    /* get memory requirements */
+/**
+ * Allocate memory for `buffer` and bind it, `keep` is never evicted.
+ */
+static sccl_error_t
+allocate_memory_locked(const sccl_device_t device, VkBuffer buffer,
+                       memory_class_t memory_class, const sccl_buffer_t keep,
+                       VkDeviceMemory *device_memory,
+                       uint32_t *memory_type_index,
+                       VkDeviceSize *allocation_size, bool *device_local)
+{
     VkMemoryRequirements mem_requirements = {0};
-    vkGetBufferMemoryRequirements(buffer_internal->device,
-                                  buffer_internal->buffer, &mem_requirements);
+    vkGetBufferMemoryRequirements(device->device, buffer, &mem_requirements);
 
-    /* determine memory property flags */
-    VkMemoryPropertyFlags memory_property_flags;
-    switch (type) {
+    CHECK_SCCL_ERROR_RET(memory_allocate_locked(
+        device, &mem_requirements, memory_class, keep, device_memory,
+        memory_type_index, device_local));
+
+    VkResult res =
+        vkBindBufferMemory(device->device, buffer, *device_memory, 0);
+    if (res != VK_SUCCESS) {
+        memory_free_locked(device, *device_memory, mem_requirements.size,
+                           *device_local);
+        return sccl_unhandled_vulkan_error;
+    }
+
+    *allocation_size = mem_requirements.size;
+
+    return sccl_success;
+}
+
+/**
+ * Copy buffer contents to new memory of `memory_class` and swap it in.
+ * Waits for the copy to finish.
+ */
+static sccl_error_t migrate_buffer_locked(sccl_buffer_t buffer,
+                                          memory_class_t memory_class)
+{
+    sccl_device_t device = buffer->device;
+    assert(buffer->pending_use_count == 0);
+
+    VkBuffer new_buffer;
+    CHECK_SCCL_ERROR_RET(
+        create_vk_buffer(device, buffer->type, buffer->size, &new_buffer));
+
+    VkDeviceMemory new_device_memory;
+    uint32_t new_memory_type_index;
+    VkDeviceSize new_allocation_size;
+    bool new_device_local;
+    sccl_error_t error = allocate_memory_locked(
+        device, new_buffer, memory_class, buffer, &new_device_memory,
+        &new_memory_type_index, &new_allocation_size, &new_device_local);
+    if (error != sccl_success) {
+        vkDestroyBuffer(device->device, new_buffer, NULL);
+        return error;
+    }
+
+    VkBufferCopy buffer_copy = {0};
+    buffer_copy.size = buffer->size;
+    vkCmdCopyBuffer(device->transfer_stream->command_buffer, buffer->buffer,
+                    new_buffer, 1, &buffer_copy);
+    error = stream_flush_locked(device->transfer_stream);
+    if (error != sccl_success) {
+        memory_free_locked(device, new_device_memory, new_allocation_size,
+                           new_device_local);
+        vkDestroyBuffer(device->device, new_buffer, NULL);
+        return error;
+    }
+
+    vkDestroyBuffer(device->device, buffer->buffer, NULL);
+    memory_free_locked(device, buffer->device_memory, buffer->allocation_size,
+                       buffer->device_local);
+
+    buffer->buffer = new_buffer;
+    buffer->device_memory = new_device_memory;
+    buffer->memory_type_index = new_memory_type_index;
+    buffer->allocation_size = new_allocation_size;
+    buffer->device_local = new_device_local;
+
+    if (buffer->descriptor_index != SCCL_DESCRIPTOR_TABLE_INVALID_INDEX) {
+        descriptor_table_update_buffer(device->device,
+                                       &device->descriptor_table,
+                                       buffer->descriptor_index, new_buffer);
+    }
+
+    return sccl_success;
+}
+
+bool buffer_is_storage(const sccl_buffer_t buffer)
+{
+    switch (buffer->type) {
     case sccl_buffer_type_host_storage:
-    case sccl_buffer_type_host_uniform:
-        memory_property_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-        break;
     case sccl_buffer_type_device_storage:
-    case sccl_buffer_type_device_uniform:
-        memory_property_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-        break;
     case sccl_buffer_type_shared_storage:
-    case sccl_buffer_type_shared_uniform:
-        memory_property_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
-                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-        break;
+        return true;
     default:
-        return sccl_invalid_argument;
+        return false;
     }
+}
 
-    /* find memory type */
-    uint32_t memory_type_index;
-    CHECK_SCCL_ERROR_RET(find_memory_type(
-        device->physical_device, mem_requirements.memoryTypeBits,
-        memory_property_flags, &memory_type_index));
+sccl_error_t buffer_spill_locked(sccl_buffer_t buffer)
+{
+    assert(!buffer->spilled);
+    CHECK_SCCL_ERROR_RET(migrate_buffer_locked(buffer, memory_class_spill));
+    buffer->spilled = true;
+    return sccl_success;
+}
 
-    /* allocate memory */
-    VkMemoryAllocateInfo alloc_info = {0};
-    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    alloc_info.allocationSize = mem_requirements.size;
-    alloc_info.memoryTypeIndex = memory_type_index;
-    CHECK_VKRESULT_RET(vkAllocateMemory(device->device, &alloc_info, NULL,
-                                        &buffer_internal->device_memory));
+sccl_error_t buffer_restore_locked(sccl_buffer_t buffer)
+{
+    assert(buffer->spilled);
+    CHECK_SCCL_ERROR_RET(migrate_buffer_locked(buffer, buffer->memory_class));
+    buffer->spilled = false;
+    return sccl_success;
+}
 
-    /* bind */
-    CHECK_VKRESULT_RET(vkBindBufferMemory(buffer_internal->device,
-                                          buffer_internal->buffer,
-                                          buffer_internal->device_memory, 0));
+static sccl_error_t create_buffer_locked(const sccl_device_t device,
+                                         struct sccl_buffer *buffer)
+{
+    CHECK_SCCL_ERROR_RET(
+        create_vk_buffer(device, buffer->type, buffer->size, &buffer->buffer));
+
+    sccl_error_t error = allocate_memory_locked(
+        device, buffer->buffer, buffer->memory_class, SCCL_NULL,
+        &buffer->device_memory, &buffer->memory_type_index,
+        &buffer->allocation_size, &buffer->device_local);
+    if (error != sccl_success) {
+        vkDestroyBuffer(device->device, buffer->buffer, NULL);
+        return error;
+    }
+
+    /* add storage buffers to descriptor table, if the table is full the buffer
+     * can still be used with non-bindless shaders */
+    if (buffer_is_storage(buffer) &&
+        device->descriptor_table.supported) {
+        error = descriptor_table_add_buffer(device->device,
+                                            &device->descriptor_table,
+                                            buffer->buffer,
+                                            &buffer->descriptor_index);
+        if (error != sccl_success && error != sccl_out_of_resources_error) {
+            memory_free_locked(device, buffer->device_memory,
+                               buffer->allocation_size, buffer->device_local);
+            vkDestroyBuffer(device->device, buffer->buffer, NULL);
+            return error;
+        }
+    }
+
+    error = memory_add_buffer_locked(device, buffer);
+    if (error != sccl_success) {
+        if (buffer->descriptor_index != SCCL_DESCRIPTOR_TABLE_INVALID_INDEX) {
+            descriptor_table_remove_buffer(&device->descriptor_table,
+                                           buffer->descriptor_index);
+        }
+        memory_free_locked(device, buffer->device_memory,
+                           buffer->allocation_size, buffer->device_local);
+        vkDestroyBuffer(device->device, buffer->buffer, NULL);
+        return error;
+    }
+
+    return sccl_success;
+}
+
+sccl_error_t sccl_create_buffer(const sccl_device_t device,
+                                sccl_buffer_t *buffer, sccl_buffer_type_t type,
+                                size_t size)
+{
+    return sccl_create_buffer_with_usage(device, buffer, type, size,
+                                         sccl_memory_usage_default);
+}
+
+sccl_error_t sccl_create_buffer_with_usage(const sccl_device_t device,
+                                           sccl_buffer_t *buffer,
+                                           sccl_buffer_type_t type, size_t size,
+                                           sccl_memory_usage_t usage)
+{
+    memory_class_t memory_class;
+    CHECK_SCCL_ERROR_RET(memory_get_class(type, usage, &memory_class));
+
+    struct sccl_buffer *buffer_internal;
+    CHECK_SCCL_ERROR_RET(
+        sccl_calloc((void **)&buffer_internal, 1, sizeof(struct sccl_buffer)));
+
+    buffer_internal->type = type;
+    buffer_internal->device = device;
+    buffer_internal->size = size;
+    buffer_internal->memory_class = memory_class;
+    buffer_internal->descriptor_index = SCCL_DESCRIPTOR_TABLE_INVALID_INDEX;
+
+    pthread_mutex_lock(&device->mutex);
+    sccl_error_t error = create_buffer_locked(device, buffer_internal);
+    pthread_mutex_unlock(&device->mutex);
+    if (error != sccl_success) {
+        sccl_free(buffer_internal);
+        return error;
+    }
 
     /* set public handle */
     *buffer = (sccl_buffer_t)buffer_internal;
@@ -117,13 +246,78 @@ sccl_error_t sccl_create_buffer(const sccl_device_t device,
     return sccl_success;
 }
 
-void sccl_destroy_buffer(sccl_buffer_t buffer)
+static void destroy_buffer_now_locked(sccl_buffer_t buffer)
 {
-    vkFreeMemory(buffer->device, buffer->device_memory, NULL);
-    vkDestroyBuffer(buffer->device, buffer->buffer, NULL);
+    sccl_device_t device = buffer->device;
+    assert(buffer->pending_use_count == 0);
+
+    memory_remove_buffer_locked(device, buffer);
+    if (buffer->descriptor_index != SCCL_DESCRIPTOR_TABLE_INVALID_INDEX) {
+        descriptor_table_remove_buffer(&device->descriptor_table,
+                                       buffer->descriptor_index);
+    }
+    memory_free_locked(device, buffer->device_memory, buffer->allocation_size,
+                       buffer->device_local);
+    vkDestroyBuffer(device->device, buffer->buffer, NULL);
     sccl_free(buffer);
 }
 
+/**
+ * True if buffer can be accessed by work that is not joined yet. Buffers in the
+ * descriptor table can be accessed by any bindless shader.
+ */
+static bool is_buffer_in_use_locked(const sccl_buffer_t buffer,
+                                    uint64_t bindless_ticket)
+{
+    const memory_manager_t *manager = &buffer->device->memory_manager;
+    return buffer->pending_use_count > 0 ||
+           (buffer->descriptor_index != SCCL_DESCRIPTOR_TABLE_INVALID_INDEX &&
+            !memory_bindless_retired_locked(manager, bindless_ticket));
+}
+
+void buffer_destroy_locked(sccl_buffer_t buffer)
+{
+    memory_manager_t *manager = &buffer->device->memory_manager;
+    assert(!buffer->destroy_pending);
+
+    if (is_buffer_in_use_locked(buffer, manager->next_bindless_ticket)) {
+        buffer->destroy_pending = true;
+        buffer->destroy_bindless_ticket = manager->next_bindless_ticket;
+        ++manager->deferred_buffers_count;
+        return;
+    }
+
+    destroy_buffer_now_locked(buffer);
+}
+
+void buffer_destroy_deferred_locked(sccl_device_t device)
+{
+    memory_manager_t *manager = &device->memory_manager;
+    if (manager->deferred_buffers_count == 0) {
+        return;
+    }
+
+    /* iterate backwards, destroying a buffer moves the last buffer into its
+     * slot */
+    for (size_t i = vector_get_size(&manager->buffers); i-- > 0;) {
+        sccl_buffer_t buffer =
+            *(sccl_buffer_t *)vector_get_element(&manager->buffers, i);
+        if (buffer->destroy_pending &&
+            !is_buffer_in_use_locked(buffer, buffer->destroy_bindless_ticket)) {
+            --manager->deferred_buffers_count;
+            destroy_buffer_now_locked(buffer);
+        }
+    }
+}
+
+void sccl_destroy_buffer(sccl_buffer_t buffer)
+{
+    sccl_device_t device = buffer->device;
+    pthread_mutex_lock(&device->mutex);
+    buffer_destroy_locked(buffer);
+    pthread_mutex_unlock(&device->mutex);
+}
+
 sccl_error_t sccl_host_map_buffer(const sccl_buffer_t buffer, void **data,
                                   size_t offset, size_t size)
 {
@@ -131,13 +325,42 @@ sccl_error_t sccl_host_map_buffer(const sccl_buffer_t buffer, void **data,
         return sccl_invalid_argument;
     }
 
-    CHECK_VKRESULT_RET(vkMapMemory(buffer->device, buffer->device_memory,
-                                   offset, size, 0, data));
+    CHECK_VKRESULT_RET(vkMapMemory(buffer->device->device,
+                                   buffer->device_memory, offset, size, 0,
+                                   data));
 
     return sccl_success;
 }
 
 void sccl_host_unmap_buffer(const sccl_buffer_t buffer)
 {
-    vkUnmapMemory(buffer->device, buffer->device_memory);
+    vkUnmapMemory(buffer->device->device, buffer->device_memory);
+}
+
+sccl_error_t sccl_get_buffer_descriptor_index(const sccl_buffer_t buffer,
+                                              uint32_t *index)
+{
+    if (!buffer->device->descriptor_table.supported ||
+        !buffer_is_storage(buffer)) {
+        return sccl_unsupported_error;
+    }
+    if (buffer->descriptor_index == SCCL_DESCRIPTOR_TABLE_INVALID_INDEX) {
+        /* table was full when buffer was created */
+        return sccl_out_of_resources_error;
+    }
+
+    *index = buffer->descriptor_index;
+
+    return sccl_success;
+}
+
+sccl_error_t sccl_get_buffer_memory_type_info(const sccl_buffer_t buffer,
+                                              sccl_memory_type_info_t *info)
+{
+    sccl_device_t device = buffer->device;
+    pthread_mutex_lock(&device->mutex);
+    memory_get_type_info(&device->memory_manager, buffer->memory_type_index,
+                         info);
+    pthread_mutex_unlock(&device->mutex);
+    return sccl_success;
 }
@@ -2,14 +2,74 @@
 #ifndef BUFFER_HEADER
 #define BUFFER_HEADER
 
+#include "memory.h"
 #include "sccl.h"
+#include <stdbool.h>
 #include <vulkan/vulkan.h>
 
 struct sccl_buffer {
-    VkDevice device;
+    sccl_device_t device;
     sccl_buffer_type_t type;
+    size_t size;
     VkBuffer buffer;
+    /* memory class selected from type and usage */
+    memory_class_t memory_class;
     VkDeviceMemory device_memory;
+    uint32_t memory_type_index;
+    /* size of `device_memory` */
+    VkDeviceSize allocation_size;
+    /* true if `device_memory` is allocated from a device local heap */
+    bool device_local;
+    /* true if buffer is moved to host memory to free device memory */
+    bool spilled;
+    /* `SCCL_DESCRIPTOR_TABLE_INVALID_INDEX` if buffer is not in table */
+    uint32_t descriptor_index;
+    /* number of times buffer is recorded in streams that are not joined yet,
+     * buffer memory can only be migrated when this is 0 */
+    uint32_t pending_use_count;
+    /* `memory_manager_t::use_tick` when buffer was last recorded */
+    uint64_t last_use;
+    /* index in `memory_manager_t::buffers` */
+    size_t memory_manager_index;
+    /* stream and stream epoch buffer was last tracked in, used to only track
+     * a buffer once per stream dispatch */
+    sccl_stream_t tracked_stream;
+    uint64_t tracked_epoch;
+    /* `sccl_destroy_buffer` is called while buffer may be in use, buffer is
+     * destroyed when `pending_use_count` reaches 0 and all bindless work
+     * issued before `destroy_bindless_ticket` is joined */
+    bool destroy_pending;
+    uint64_t destroy_bindless_ticket;
 };
 
-#endif // BUFFER_HEADER
\ No newline at end of file
+/**
+ * Check if buffer is one of the storage buffer types.
+ */
+bool buffer_is_storage(const sccl_buffer_t buffer);
+
+/**
+ * Move buffer memory to host memory.
+ * Buffer must not be used by any stream that is not joined.
+ * Returns `sccl_out_of_resources_error` if host memory is in a device local
+ * heap, since nothing would be freed.
+ */
+sccl_error_t buffer_spill_locked(sccl_buffer_t buffer);
+
+/**
+ * Move spilled buffer back to device memory, may spill other buffers.
+ * Buffer must not be used by any stream that is not joined.
+ */
+sccl_error_t buffer_restore_locked(sccl_buffer_t buffer);
+
+/**
+ * Destroy buffer while device mutex is held, destruction is deferred if the
+ * buffer can be used by work that is not joined yet.
+ */
+void buffer_destroy_locked(sccl_buffer_t buffer);
+
+/**
+ * Destroy deferred buffers that are no longer in use.
+ */
+void buffer_destroy_deferred_locked(sccl_device_t device);
+
+#endif // BUFFER_HEADER
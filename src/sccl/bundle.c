@@ -0,0 +1,133 @@
+
+#include "bundle.h"
+#include "alloc.h"
+#include "error.h"
+#include "sccl.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* see `src/shader_bundle/shader_bundle.c` for the compressed format */
+#define BUNDLE_MIN_MATCH 4
+
+typedef struct {
+    const char *name;
+    uint32_t offset;
+    uint32_t compressed_size;
+    uint32_t size;
+} bundle_entry_t;
+
+/* index and compressed SPIR-V of the built-in kernels, generated at build
+ * time, entries are sorted by name */
+#include "shader_bundle.inc"
+
+static int compare_bundle_entry_name(const void *key, const void *entry)
+{
+    return strcmp((const char *)key, ((const bundle_entry_t *)entry)->name);
+}
+
+static bool read_varint(const uint8_t **in, const uint8_t *end,
+                        size_t *value)
+{
+    *value = 0;
+    for (unsigned shift = 0; *in < end && shift < 64; shift += 7) {
+        uint8_t byte = *(*in)++;
+        *value |= (size_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Unpack one bundle entry into `out` of `entry->size` bytes.
+ */
+static sccl_error_t bundle_decompress(const bundle_entry_t *entry,
+                                      uint8_t *out)
+{
+    const uint8_t *in = &bundle_data[entry->offset];
+    const uint8_t *in_end = in + entry->compressed_size;
+    size_t size = 0;
+    while (true) {
+        size_t literals_count;
+        if (!read_varint(&in, in_end, &literals_count) ||
+            literals_count > (size_t)(in_end - in) ||
+            literals_count > entry->size - size) {
+            return sccl_internal_error;
+        }
+        memcpy(&out[size], in, literals_count);
+        in += literals_count;
+        size += literals_count;
+        if (in == in_end) {
+            break;
+        }
+
+        size_t length, offset;
+        if (!read_varint(&in, in_end, &length) ||
+            !read_varint(&in, in_end, &offset)) {
+            return sccl_internal_error;
+        }
+        length += BUNDLE_MIN_MATCH;
+        if (offset == 0 || offset > size || length > entry->size - size) {
+            return sccl_internal_error;
+        }
+        /* byte by byte, matches may overlap their own output */
+        for (size_t i = 0; i < length; ++i) {
+            out[size + i] = out[size - offset + i];
+        }
+        size += length;
+    }
+
+    return size == entry->size ? sccl_success : sccl_internal_error;
+}
+
+sccl_error_t bundle_get_code(const char *name, uint32_t **code,
+                             size_t *code_size)
+{
+    const bundle_entry_t *entry =
+        bsearch(name, bundle_entries,
+                sizeof(bundle_entries) / sizeof(bundle_entries[0]),
+                sizeof(bundle_entry_t), compare_bundle_entry_name);
+    if (entry == NULL) {
+        return sccl_invalid_argument;
+    }
+
+    /* words, so the code is aligned for `VkShaderModuleCreateInfo::pCode` */
+    CHECK_SCCL_ERROR_RET(sccl_calloc((void **)code,
+                                     entry->size / sizeof(uint32_t) + 1,
+                                     sizeof(uint32_t)));
+    sccl_error_t error = bundle_decompress(entry, (uint8_t *)*code);
+    if (error != sccl_success) {
+        sccl_free(*code);
+        return error;
+    }
+    *code_size = entry->size;
+    return sccl_success;
+}
+
+sccl_error_t sccl_create_shader_from_bundle(const sccl_device_t device,
+                                           const char *name,
+                                           sccl_shader_t *shader,
+                                           const sccl_shader_config_t *config)
+{
+    CHECK_SCCL_NULL_RET(name);
+    CHECK_SCCL_NULL_RET(config);
+    if (config->shader_source_code != NULL ||
+        config->shader_source_code_length != 0) {
+        return sccl_invalid_argument;
+    }
+
+    uint32_t *code;
+    size_t code_size;
+    CHECK_SCCL_ERROR_RET(bundle_get_code(name, &code, &code_size));
+    sccl_shader_config_t bundle_config = *config;
+    bundle_config.shader_source_code = (char *)code;
+    bundle_config.shader_source_code_length = code_size;
+    sccl_error_t error = sccl_create_shader(device, shader, &bundle_config);
+    sccl_free(code);
+
+    return error;
+}
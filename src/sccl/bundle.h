@@ -0,0 +1,17 @@
+#pragma once
+#ifndef BUNDLE_HEADER
+#define BUNDLE_HEADER
+
+#include "sccl.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Unpack SPIR-V of built-in kernel `name` from the shader bundle. `code` is
+ * allocated with `sccl_calloc` and must be freed by the caller, `code_size`
+ * is in bytes. Returns `sccl_invalid_argument` if there is no such kernel.
+ */
+sccl_error_t bundle_get_code(const char *name, uint32_t **code,
+                             size_t *code_size);
+
+#endif // BUNDLE_HEADER
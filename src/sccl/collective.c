@@ -0,0 +1,867 @@
+#include "alloc.h"
+#include "buffer.h"
+#include "device.h"
+#include "error.h"
+#include "reduce.h"
+#include "sccl.h"
+#include "stream.h"
+#include "vector.h"
+
+#include <pthread.h>
+#include <string.h>
+
+/**
+ * Collectives are run as a sequence of rounds. In a round every rank sends at
+ * most one slice to another rank and receives at most one slice, through a
+ * host staging buffer on each side. A round has three stages: the sender's
+ * device copies the slice into its staging buffer, the host copies it to the
+ * receiver's staging buffer and the receiver's device copies or reduces it
+ * into the receive buffer. Rounds are pipelined over these stages, while the
+ * host copies round `r` the devices send round `r + 1` and receive round
+ * `r - 1`. Sends run on a transfer stream per rank, taken from the idle
+ * collective streams of its device, and receives on the rank's stream.
+ * Staging buffers hold two slots so consecutive rounds don't share slices.
+ * Streams are only joined when they are reused or their slice is
+ * needed, never all at once.
+ *
+ * Since a receive completes two rounds after its send, ranks may only forward
+ * data received at least `COLLECTIVE_PIPELINE_DEPTH` rounds earlier.
+ */
+
+#define COLLECTIVE_PIPELINE_DEPTH 3
+
+/* `rank_t` round of nothing pending */
+#define NO_ROUND SIZE_MAX
+
+typedef struct {
+    /* stream of the caller, runs receives */
+    sccl_stream_t stream;
+    /* runs sends, on the same device as `stream` */
+    sccl_stream_t transfer_stream;
+    /* round of dispatched and not yet joined sends and receives, or
+     * `NO_ROUND` */
+    size_t send_round;
+    size_t receive_round;
+    /* buffer slices are sent from and received into */
+    sccl_buffer_t send_buffer;
+    sccl_buffer_t receive_buffer;
+    /* host staging buffer of two slots, one per round parity, each with a
+     * send and a receive slice, see `get_staging_slice` */
+    sccl_buffer_t staging;
+    char *staging_data;
+} rank_t;
+
+/* offsets and count are in elements */
+typedef struct {
+    size_t sender;
+    size_t send_offset;
+    size_t receiver;
+    size_t receive_offset;
+    size_t count;
+    /* reduce slice into receive buffer instead of copying it */
+    bool reduce;
+} transfer_t;
+
+typedef struct collective collective_t;
+
+/**
+ * Write transfers of round to `transfers`, returns number of transfers.
+ */
+typedef size_t (*get_round_t)(const collective_t *collective, size_t round,
+                              transfer_t *transfers);
+
+/**
+ * Run one pipeline stage of a transfer of round.
+ */
+typedef sccl_error_t (*stage_t)(const collective_t *collective, size_t round,
+                                const transfer_t *transfer);
+
+struct collective {
+    rank_t *ranks;
+    size_t rank_count;
+    /* elements split into one chunk per rank */
+    size_t count;
+    sccl_dtype_t dtype;
+    sccl_reduce_op_t op;
+    /* 1 for collectives that only move bytes */
+    size_t element_size;
+    /* elements in a staging slice */
+    size_t slice_count;
+    /* slices in the largest chunk, or in all elements for broadcast */
+    size_t slices;
+    size_t root;
+    /* ring collectives, see `get_ring_round` */
+    size_t ring_offset;
+    /* rounds per ring step, at least `COLLECTIVE_PIPELINE_DEPTH` so ranks
+     * can forward the slices they received in the previous step */
+    size_t step_rounds;
+    size_t reduce_steps;
+    size_t gather_steps;
+    get_round_t get_round;
+    size_t round_count;
+};
+
+/**
+ * Elements are split into one chunk per rank, chunk sizes differ by at most
+ * one element.
+ */
+static size_t chunk_begin(const collective_t *collective, size_t chunk)
+{
+    return collective->count * chunk / collective->rank_count;
+}
+
+/**
+ * Get range of slice `slice` in elements [`begin`, `end`), range is empty if
+ * there are fewer slices.
+ */
+static void get_slice(const collective_t *collective, size_t begin, size_t end,
+                      size_t slice, size_t *slice_begin, size_t *count)
+{
+    *slice_begin = begin + slice * collective->slice_count;
+    if (*slice_begin >= end) {
+        *slice_begin = end;
+        *count = 0;
+        return;
+    }
+    *count = end - *slice_begin;
+    if (*count > collective->slice_count) {
+        *count = collective->slice_count;
+    }
+}
+
+static size_t div_round_up(size_t a, size_t b) { return (a + b - 1) / b; }
+
+static sccl_error_t dispatch_and_join_streams(const sccl_stream_t *streams,
+                                              size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        CHECK_SCCL_ERROR_RET(sccl_dispatch_stream(streams[i]));
+    }
+    for (size_t i = 0; i < count; ++i) {
+        CHECK_SCCL_ERROR_RET(sccl_join_stream(streams[i]));
+    }
+    return sccl_success;
+}
+
+/**
+ * Get index of staging slice of a round, in units of `slice_count` elements.
+ */
+static size_t get_staging_slice(size_t round, bool receive)
+{
+    return 2 * (round % 2) + (receive ? 1 : 0);
+}
+
+static sccl_error_t dispatch_and_join_ranks(const collective_t *collective)
+{
+    /* dispatch everything before joining so devices run concurrently */
+    for (size_t i = 0; i < collective->rank_count; ++i) {
+        CHECK_SCCL_ERROR_RET(
+            sccl_dispatch_stream(collective->ranks[i].stream));
+    }
+    for (size_t i = 0; i < collective->rank_count; ++i) {
+        CHECK_SCCL_ERROR_RET(sccl_join_stream(collective->ranks[i].stream));
+    }
+    return sccl_success;
+}
+
+static sccl_error_t join_sends(rank_t *rank)
+{
+    if (rank->send_round == NO_ROUND) {
+        return sccl_success;
+    }
+    rank->send_round = NO_ROUND;
+    return sccl_join_stream(rank->transfer_stream);
+}
+
+static sccl_error_t join_receives(rank_t *rank)
+{
+    if (rank->receive_round == NO_ROUND) {
+        return sccl_success;
+    }
+    rank->receive_round = NO_ROUND;
+    return sccl_join_stream(rank->stream);
+}
+
+/**
+ * Copy slice from send buffer to the send slice of the staging buffer and
+ * dispatch it.
+ */
+static sccl_error_t dispatch_send(const collective_t *collective, size_t round,
+                                  const transfer_t *transfer)
+{
+    rank_t *rank = &collective->ranks[transfer->sender];
+    /* slice may have been received `COLLECTIVE_PIPELINE_DEPTH` rounds ago */
+    CHECK_SCCL_ERROR_RET(join_receives(rank));
+    CHECK_SCCL_ERROR_RET(join_sends(rank));
+
+    size_t element_size = collective->element_size;
+    size_t staging_offset = get_staging_slice(round, false) *
+                            collective->slice_count * element_size;
+    CHECK_SCCL_ERROR_RET(sccl_copy_buffer(
+        rank->transfer_stream, rank->send_buffer,
+        transfer->send_offset * element_size, rank->staging, staging_offset,
+        transfer->count * element_size));
+    CHECK_SCCL_ERROR_RET(sccl_dispatch_stream(rank->transfer_stream));
+    rank->send_round = round;
+    return sccl_success;
+}
+
+/**
+ * Reduce or copy the receive slice of the staging buffer into the receive
+ * buffer and dispatch it.
+ */
+static sccl_error_t dispatch_receive(const collective_t *collective,
+                                     size_t round, const transfer_t *transfer)
+{
+    rank_t *rank = &collective->ranks[transfer->receiver];
+    CHECK_SCCL_ERROR_RET(join_receives(rank));
+
+    size_t staging_offset =
+        get_staging_slice(round, true) * collective->slice_count;
+    if (transfer->reduce) {
+        CHECK_SCCL_ERROR_RET(reduce_record_combine(
+            rank->stream, rank->staging, staging_offset, rank->receive_buffer,
+            transfer->receive_offset, transfer->count, collective->dtype,
+            collective->op));
+    } else {
+        size_t element_size = collective->element_size;
+        CHECK_SCCL_ERROR_RET(sccl_copy_buffer(
+            rank->stream, rank->staging, staging_offset * element_size,
+            rank->receive_buffer, transfer->receive_offset * element_size,
+            transfer->count * element_size));
+    }
+    CHECK_SCCL_ERROR_RET(sccl_dispatch_stream(rank->stream));
+    rank->receive_round = round;
+    return sccl_success;
+}
+
+/**
+ * Copy slice from the sender's to the receiver's staging buffer once the
+ * send is done and no pending receive reads the receive slot.
+ */
+static sccl_error_t copy_staging(const collective_t *collective, size_t round,
+                                 const transfer_t *transfer)
+{
+    rank_t *sender = &collective->ranks[transfer->sender];
+    rank_t *receiver = &collective->ranks[transfer->receiver];
+    if (sender->send_round == round) {
+        CHECK_SCCL_ERROR_RET(join_sends(sender));
+    }
+    if (receiver->receive_round != NO_ROUND &&
+        receiver->receive_round % 2 == round % 2) {
+        CHECK_SCCL_ERROR_RET(join_receives(receiver));
+    }
+
+    size_t slice_size = collective->slice_count * collective->element_size;
+    memcpy(receiver->staging_data +
+               get_staging_slice(round, true) * slice_size,
+           sender->staging_data + get_staging_slice(round, false) * slice_size,
+           transfer->count * collective->element_size);
+    return sccl_success;
+}
+
+/**
+ * Run `stage` for the transfers of `round`, empty slices are skipped.
+ */
+static sccl_error_t run_stage(const collective_t *collective, stage_t stage,
+                              size_t round, const transfer_t *transfers,
+                              size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        if (transfers[i].count > 0) {
+            CHECK_SCCL_ERROR_RET(stage(collective, round, &transfers[i]));
+        }
+    }
+    return sccl_success;
+}
+
+/**
+ * Run rounds of collective, iteration `i` sends round `i`, copies round
+ * `i - 1` on the host and receives round `i - 2`. Transfers of the last
+ * `COLLECTIVE_PIPELINE_DEPTH` rounds are kept in a ring.
+ */
+static sccl_error_t run_rounds(const collective_t *collective)
+{
+    size_t rank_count = collective->rank_count;
+    transfer_t *transfers;
+    CHECK_SCCL_ERROR_RET(sccl_calloc((void **)&transfers,
+                                     COLLECTIVE_PIPELINE_DEPTH * rank_count,
+                                     sizeof(transfer_t)));
+    size_t counts[COLLECTIVE_PIPELINE_DEPTH] = {0};
+
+    sccl_error_t error = sccl_success;
+    for (size_t i = 0;
+         i < collective->round_count + 2 && error == sccl_success; ++i) {
+        size_t current = i % COLLECTIVE_PIPELINE_DEPTH;
+        size_t received = (i + 1) % COLLECTIVE_PIPELINE_DEPTH;
+        size_t copied = (i + 2) % COLLECTIVE_PIPELINE_DEPTH;
+        counts[current] = 0;
+        if (i < collective->round_count) {
+            counts[current] = collective->get_round(
+                collective, i, &transfers[current * rank_count]);
+        }
+
+        /* device work is dispatched before the host copy so they overlap */
+        error = run_stage(collective, dispatch_send, i,
+                          &transfers[current * rank_count], counts[current]);
+        if (error == sccl_success && i >= 2) {
+            error = run_stage(collective, dispatch_receive, i - 2,
+                              &transfers[received * rank_count],
+                              counts[received]);
+        }
+        if (error == sccl_success && i >= 1) {
+            error = run_stage(collective, copy_staging, i - 1,
+                              &transfers[copied * rank_count],
+                              counts[copied]);
+        }
+    }
+
+    /* join everything still in flight, also on error so the staging buffers
+     * can be freed */
+    for (size_t i = 0; i < rank_count; ++i) {
+        sccl_error_t join_error = join_sends(&collective->ranks[i]);
+        if (error == sccl_success) {
+            error = join_error;
+        }
+        join_error = join_receives(&collective->ranks[i]);
+        if (error == sccl_success) {
+            error = join_error;
+        }
+    }
+
+    sccl_free(transfers);
+    return error;
+}
+
+/**
+ * Ring collectives run `reduce_steps` steps of reduce-scatter followed by
+ * `gather_steps` steps of all-gather, `step_rounds` rounds per step with one
+ * slice each, rounds past the last slice of a step are empty.
+ * In reduce-scatter step `s` rank `i` sends its partial result of chunk
+ * `i + ring_offset - s` to rank `i + 1`, which reduces it into its own. After
+ * `rank_count - 1` steps rank `i` holds reduced chunk `i + ring_offset + 1`.
+ * In all-gather step `s` rank `i` sends chunk `i + ring_offset + 1 - s`.
+ */
+static size_t get_ring_round(const collective_t *collective, size_t round,
+                             transfer_t *transfers)
+{
+    size_t rank_count = collective->rank_count;
+    size_t step = round / collective->step_rounds;
+    size_t slice = round % collective->step_rounds;
+    bool reduce = step < collective->reduce_steps;
+    if (!reduce) {
+        step -= collective->reduce_steps;
+    }
+
+    for (size_t i = 0; i < rank_count; ++i) {
+        size_t chunk = (i + collective->ring_offset + (reduce ? 0 : 1) +
+                        rank_count - step) %
+                       rank_count;
+        size_t begin, count;
+        get_slice(collective, chunk_begin(collective, chunk),
+                  chunk_begin(collective, chunk + 1), slice, &begin, &count);
+        transfers[i].sender = i;
+        transfers[i].send_offset = begin;
+        transfers[i].receiver = (i + 1) % rank_count;
+        transfers[i].receive_offset = begin;
+        transfers[i].count = count;
+        transfers[i].reduce = reduce;
+    }
+    return rank_count;
+}
+
+/**
+ * Broadcast along the chain `root`, `root + 1`, ... Hop `d` forwards slice
+ * `round - d * COLLECTIVE_PIPELINE_DEPTH`, so slices are in flight on all
+ * hops at once.
+ */
+static size_t get_broadcast_round(const collective_t *collective,
+                                  size_t round, transfer_t *transfers)
+{
+    size_t rank_count = collective->rank_count;
+    size_t transfers_count = 0;
+    for (size_t hop = 0; hop + 1 < rank_count; ++hop) {
+        size_t delay = hop * COLLECTIVE_PIPELINE_DEPTH;
+        if (round < delay || round - delay >= collective->slices) {
+            continue;
+        }
+        size_t begin, count;
+        get_slice(collective, 0, collective->count, round - delay, &begin,
+                  &count);
+        transfer_t *transfer = &transfers[transfers_count++];
+        transfer->sender = (collective->root + hop) % rank_count;
+        transfer->send_offset = begin;
+        transfer->receiver = (collective->root + hop + 1) % rank_count;
+        transfer->receive_offset = begin;
+        transfer->count = count;
+        transfer->reduce = false;
+    }
+    return transfers_count;
+}
+
+/**
+ * Get non-root rank and slice of round for scatter and gather, the root
+ * exchanges one slice with one rank per round.
+ */
+static void get_root_round_slice(const collective_t *collective,
+                                 size_t round, size_t *rank,
+                                 size_t *chunk_offset, size_t *count)
+{
+    *rank = (collective->root + 1 + round / collective->slices) %
+            collective->rank_count;
+    size_t chunk_size = chunk_begin(collective, 1);
+    get_slice(collective, 0, chunk_size, round % collective->slices,
+              chunk_offset, count);
+}
+
+static size_t get_scatter_round(const collective_t *collective, size_t round,
+                                transfer_t *transfers)
+{
+    size_t rank, offset, count;
+    get_root_round_slice(collective, round, &rank, &offset, &count);
+    transfers[0].sender = collective->root;
+    transfers[0].send_offset = chunk_begin(collective, rank) + offset;
+    transfers[0].receiver = rank;
+    transfers[0].receive_offset = offset;
+    transfers[0].count = count;
+    transfers[0].reduce = false;
+    return 1;
+}
+
+static size_t get_gather_round(const collective_t *collective, size_t round,
+                               transfer_t *transfers)
+{
+    size_t rank, offset, count;
+    get_root_round_slice(collective, round, &rank, &offset, &count);
+    transfers[0].sender = rank;
+    transfers[0].send_offset = offset;
+    transfers[0].receiver = collective->root;
+    transfers[0].receive_offset = chunk_begin(collective, rank) + offset;
+    transfers[0].count = count;
+    transfers[0].reduce = false;
+    return 1;
+}
+
+static sccl_error_t validate_buffer(const sccl_stream_t stream,
+                                    const sccl_buffer_t buffer, size_t size)
+{
+    CHECK_SCCL_NULL_RET(buffer);
+    if (buffer->device != stream->device || !buffer_is_storage(buffer) ||
+        buffer->size < size) {
+        return sccl_invalid_argument;
+    }
+    return sccl_success;
+}
+
+/**
+ * Check that every rank has a stream and, if `buffers` is not NULL, a large
+ * enough storage buffer on the same device.
+ */
+static sccl_error_t validate_ranks(const sccl_stream_t *streams,
+                                   const sccl_buffer_t *buffers,
+                                   size_t rank_count, size_t size)
+{
+    CHECK_SCCL_NULL_RET(streams);
+    if (rank_count == 0) {
+        return sccl_invalid_argument;
+    }
+    for (size_t i = 0; i < rank_count; ++i) {
+        CHECK_SCCL_NULL_RET(streams[i]);
+        if (buffers != NULL) {
+            CHECK_SCCL_ERROR_RET(validate_buffer(streams[i], buffers[i], size));
+        }
+    }
+    return sccl_success;
+}
+
+/**
+ * Validate arguments of reducing collectives and get element size.
+ */
+static sccl_error_t validate_reduce(const sccl_stream_t *streams,
+                                    size_t rank_count, size_t count,
+                                    sccl_dtype_t dtype, sccl_reduce_op_t op,
+                                    size_t *element_size)
+{
+    *element_size = reduce_dtype_size(dtype);
+    /* element offsets are passed to the combine kernel as 32-bit */
+    if (*element_size == 0 || (uint32_t)op >= REDUCE_OP_COUNT ||
+        count > UINT32_MAX) {
+        return sccl_invalid_argument;
+    }
+    CHECK_SCCL_ERROR_RET(validate_ranks(streams, NULL, rank_count, 0));
+    for (size_t i = 0; i < rank_count; ++i) {
+        if (!reduce_is_combine_supported(&streams[i]->device->reduce_kernels,
+                                         dtype)) {
+            return sccl_unsupported_error;
+        }
+    }
+    return sccl_success;
+}
+
+/**
+ * Initialize collective over `count` elements of `element_size` bytes.
+ * Ranks are allocated and get their streams, buffers are set by the caller.
+ */
+static sccl_error_t init_collective(const sccl_stream_t *streams,
+                                    size_t rank_count, size_t count,
+                                    size_t element_size,
+                                    collective_t *collective)
+{
+    memset(collective, 0, sizeof(collective_t));
+    collective->rank_count = rank_count;
+    collective->count = count;
+    collective->element_size = element_size;
+    collective->slice_count = SCCL_COLLECTIVE_SLICE_SIZE / element_size;
+    collective->slices =
+        div_round_up(div_round_up(count, rank_count), collective->slice_count);
+    if (collective->slices == 0) {
+        collective->slices = 1;
+    }
+    collective->step_rounds = collective->slices > COLLECTIVE_PIPELINE_DEPTH
+                                  ? collective->slices
+                                  : COLLECTIVE_PIPELINE_DEPTH;
+
+    CHECK_SCCL_ERROR_RET(sccl_calloc((void **)&collective->ranks, rank_count,
+                                     sizeof(rank_t)));
+    for (size_t i = 0; i < rank_count; ++i) {
+        collective->ranks[i].stream = streams[i];
+        collective->ranks[i].send_round = NO_ROUND;
+        collective->ranks[i].receive_round = NO_ROUND;
+    }
+    return sccl_success;
+}
+
+/**
+ * Take an idle collective stream of `device`, or create one if there is none.
+ */
+static sccl_error_t acquire_transfer_stream(const sccl_device_t device,
+                                            sccl_stream_t *stream)
+{
+    pthread_mutex_lock(&device->mutex);
+    size_t idle_count = vector_get_size(&device->collective_streams);
+    if (idle_count > 0) {
+        *stream = *(sccl_stream_t *)vector_get_element(
+            &device->collective_streams, idle_count - 1);
+        vector_swap_remove_element(&device->collective_streams,
+                                   idle_count - 1);
+    }
+    pthread_mutex_unlock(&device->mutex);
+    if (idle_count > 0) {
+        return sccl_success;
+    }
+    return sccl_create_stream(device, stream);
+}
+
+/**
+ * Return a joined stream to the idle collective streams of its device,
+ * streams that may still have work after an error are destroyed instead.
+ */
+static void release_transfer_stream(sccl_stream_t stream, bool joined)
+{
+    sccl_device_t device = stream->device;
+    sccl_error_t error = sccl_internal_error;
+    if (joined) {
+        pthread_mutex_lock(&device->mutex);
+        error = vector_add_element(&device->collective_streams, &stream);
+        pthread_mutex_unlock(&device->mutex);
+    }
+    if (error != sccl_success) {
+        sccl_destroy_stream(stream);
+    }
+}
+
+/**
+ * Get transfer streams and allocate and map staging buffers of all ranks,
+ * staging buffers hold two slots of a send and a receive slice.
+ */
+static sccl_error_t create_staging(const collective_t *collective)
+{
+    size_t staging_size =
+        4 * collective->slice_count * collective->element_size;
+    for (size_t i = 0; i < collective->rank_count; ++i) {
+        rank_t *rank = &collective->ranks[i];
+        CHECK_SCCL_ERROR_RET(acquire_transfer_stream(rank->stream->device,
+                                                     &rank->transfer_stream));
+        CHECK_SCCL_ERROR_RET(sccl_alloc_async(rank->stream, &rank->staging,
+                                              sccl_buffer_type_host_storage,
+                                              staging_size));
+        CHECK_SCCL_ERROR_RET(sccl_host_map_buffer(
+            rank->staging, (void **)&rank->staging_data, 0, staging_size));
+    }
+    return sccl_success;
+}
+
+/**
+ * Release transfer streams and staging buffers, `joined` is true if every
+ * stream was joined.
+ */
+static void destroy_collective(collective_t *collective, bool joined)
+{
+    for (size_t i = 0; i < collective->rank_count; ++i) {
+        rank_t *rank = &collective->ranks[i];
+        if (rank->transfer_stream != SCCL_NULL) {
+            release_transfer_stream(rank->transfer_stream, joined);
+        }
+        if (rank->staging == SCCL_NULL) {
+            continue;
+        }
+        if (rank->staging_data != NULL) {
+            sccl_host_unmap_buffer(rank->staging);
+        }
+        /* stream is joined, so the buffer can be reused right away */
+        if (sccl_free_async(rank->stream, rank->staging) != sccl_success) {
+            sccl_destroy_buffer(rank->staging);
+        }
+    }
+    sccl_free(collective->ranks);
+}
+
+/**
+ * Run collective with `round_count` rounds from `get_round`, then destroy it.
+ * A single rank only runs work recorded before the collective.
+ */
+static sccl_error_t run_collective(collective_t *collective,
+                                   get_round_t get_round, size_t round_count)
+{
+    collective->get_round = get_round;
+    collective->round_count = collective->rank_count > 1 ? round_count : 0;
+
+    sccl_error_t error = sccl_success;
+    if (collective->round_count > 0) {
+        error = create_staging(collective);
+    }
+    /* sends on transfer streams read what was recorded before the
+     * collective */
+    if (error == sccl_success) {
+        error = dispatch_and_join_ranks(collective);
+    }
+    if (error == sccl_success && collective->round_count > 0) {
+        error = run_rounds(collective);
+    }
+
+    destroy_collective(collective, error == sccl_success);
+    return error;
+}
+
+sccl_error_t sccl_allreduce(const sccl_stream_t *streams,
+                            const sccl_buffer_t *buffers, size_t rank_count,
+                            size_t count, sccl_dtype_t dtype,
+                            sccl_reduce_op_t op)
+{
+    size_t element_size;
+    CHECK_SCCL_ERROR_RET(
+        validate_reduce(streams, rank_count, count, dtype, op, &element_size));
+    CHECK_SCCL_ERROR_RET(
+        validate_ranks(streams, buffers, rank_count, count * element_size));
+
+    collective_t collective;
+    CHECK_SCCL_ERROR_RET(init_collective(streams, rank_count, count,
+                                         element_size, &collective));
+    collective.dtype = dtype;
+    collective.op = op;
+    for (size_t i = 0; i < rank_count; ++i) {
+        collective.ranks[i].send_buffer = buffers[i];
+        collective.ranks[i].receive_buffer = buffers[i];
+    }
+    collective.reduce_steps = rank_count - 1;
+    collective.gather_steps = rank_count - 1;
+
+    return run_collective(&collective, get_ring_round,
+                          2 * (rank_count - 1) * collective.step_rounds);
+}
+
+sccl_error_t sccl_broadcast(const sccl_stream_t *streams,
+                            const sccl_buffer_t *buffers, size_t rank_count,
+                            size_t root, size_t size)
+{
+    CHECK_SCCL_ERROR_RET(validate_ranks(streams, buffers, rank_count, size));
+    if (root >= rank_count) {
+        return sccl_invalid_argument;
+    }
+
+    collective_t collective;
+    CHECK_SCCL_ERROR_RET(
+        init_collective(streams, rank_count, size, 1, &collective));
+    for (size_t i = 0; i < rank_count; ++i) {
+        collective.ranks[i].send_buffer = buffers[i];
+        collective.ranks[i].receive_buffer = buffers[i];
+    }
+    collective.root = root;
+    /* whole buffer is one chunk */
+    collective.slices = div_round_up(size, collective.slice_count);
+
+    size_t round_count =
+        collective.slices > 0
+            ? collective.slices + (rank_count - 2) * COLLECTIVE_PIPELINE_DEPTH
+            : 0;
+    return run_collective(&collective, get_broadcast_round, round_count);
+}
+
+sccl_error_t sccl_scatter(const sccl_stream_t *streams,
+                          const sccl_buffer_t src,
+                          const sccl_buffer_t *dst_buffers, size_t rank_count,
+                          size_t root, size_t size)
+{
+    CHECK_SCCL_ERROR_RET(
+        validate_ranks(streams, dst_buffers, rank_count, size));
+    if (root >= rank_count) {
+        return sccl_invalid_argument;
+    }
+    CHECK_SCCL_ERROR_RET(
+        validate_buffer(streams[root], src, rank_count * size));
+
+    /* chunk of root is copied on its device */
+    if (size > 0) {
+        CHECK_SCCL_ERROR_RET(sccl_copy_buffer(
+            streams[root], src, root * size, dst_buffers[root], 0, size));
+    }
+
+    collective_t collective;
+    CHECK_SCCL_ERROR_RET(init_collective(streams, rank_count,
+                                         rank_count * size, 1, &collective));
+    for (size_t i = 0; i < rank_count; ++i) {
+        collective.ranks[i].receive_buffer = dst_buffers[i];
+    }
+    collective.ranks[root].send_buffer = src;
+    collective.root = root;
+
+    return run_collective(&collective, get_scatter_round,
+                          (rank_count - 1) * collective.slices);
+}
+
+sccl_error_t sccl_gather(const sccl_stream_t *streams,
+                         const sccl_buffer_t *src_buffers,
+                         const sccl_buffer_t dst, size_t rank_count,
+                         size_t root, size_t size)
+{
+    CHECK_SCCL_ERROR_RET(
+        validate_ranks(streams, src_buffers, rank_count, size));
+    if (root >= rank_count) {
+        return sccl_invalid_argument;
+    }
+    CHECK_SCCL_ERROR_RET(
+        validate_buffer(streams[root], dst, rank_count * size));
+
+    if (size > 0) {
+        CHECK_SCCL_ERROR_RET(sccl_copy_buffer(
+            streams[root], src_buffers[root], 0, dst, root * size, size));
+    }
+
+    collective_t collective;
+    CHECK_SCCL_ERROR_RET(init_collective(streams, rank_count,
+                                         rank_count * size, 1, &collective));
+    for (size_t i = 0; i < rank_count; ++i) {
+        collective.ranks[i].send_buffer = src_buffers[i];
+    }
+    collective.ranks[root].receive_buffer = dst;
+    collective.root = root;
+
+    return run_collective(&collective, get_gather_round,
+                          (rank_count - 1) * collective.slices);
+}
+
+sccl_error_t sccl_reduce_scatter(const sccl_stream_t *streams,
+                                 const sccl_buffer_t *src_buffers,
+                                 const sccl_buffer_t *dst_buffers,
+                                 size_t rank_count, size_t count,
+                                 sccl_dtype_t dtype, sccl_reduce_op_t op)
+{
+    size_t element_size;
+    CHECK_SCCL_ERROR_RET(validate_reduce(streams, rank_count,
+                                         rank_count * count, dtype, op,
+                                         &element_size));
+    size_t size = count * element_size;
+    CHECK_SCCL_ERROR_RET(
+        validate_ranks(streams, src_buffers, rank_count, rank_count * size));
+    CHECK_SCCL_ERROR_RET(
+        validate_ranks(streams, dst_buffers, rank_count, size));
+    if (size == 0) {
+        return dispatch_and_join_streams(streams, rank_count);
+    }
+
+    /* partial results are reduced in scratch buffers so `src_buffers` are
+     * left as is */
+    sccl_buffer_t *scratch;
+    CHECK_SCCL_ERROR_RET(
+        sccl_calloc((void **)&scratch, rank_count, sizeof(sccl_buffer_t)));
+    sccl_error_t error = sccl_success;
+    for (size_t i = 0; i < rank_count && error == sccl_success; ++i) {
+        error = sccl_alloc_async(streams[i], &scratch[i],
+                                 sccl_buffer_type_device_storage,
+                                 rank_count * size);
+        if (error == sccl_success) {
+            error = sccl_copy_buffer(streams[i], src_buffers[i], 0,
+                                     scratch[i], 0, rank_count * size);
+        }
+    }
+
+    collective_t collective;
+    if (error == sccl_success) {
+        error = init_collective(streams, rank_count, rank_count * count,
+                                element_size, &collective);
+    }
+    if (error == sccl_success) {
+        collective.dtype = dtype;
+        collective.op = op;
+        for (size_t i = 0; i < rank_count; ++i) {
+            collective.ranks[i].send_buffer = scratch[i];
+            collective.ranks[i].receive_buffer = scratch[i];
+        }
+        /* rank i ends up with chunk i */
+        collective.ring_offset = rank_count - 1;
+        collective.reduce_steps = rank_count - 1;
+
+        error = run_collective(&collective, get_ring_round,
+                               (rank_count - 1) * collective.step_rounds);
+    }
+
+    for (size_t i = 0; i < rank_count && error == sccl_success; ++i) {
+        error = sccl_copy_buffer(streams[i], scratch[i], i * size,
+                                 dst_buffers[i], 0, size);
+    }
+    /* freed in stream order on every path, commands recorded before still
+     * read them */
+    for (size_t i = 0; i < rank_count; ++i) {
+        if (scratch[i] == SCCL_NULL) {
+            continue;
+        }
+        sccl_error_t free_error = sccl_free_async(streams[i], scratch[i]);
+        if (error == sccl_success) {
+            error = free_error;
+        }
+    }
+    sccl_free(scratch);
+    CHECK_SCCL_ERROR_RET(error);
+
+    return dispatch_and_join_streams(streams, rank_count);
+}
+
+sccl_error_t sccl_all_gather(const sccl_stream_t *streams,
+                             const sccl_buffer_t *src_buffers,
+                             const sccl_buffer_t *dst_buffers,
+                             size_t rank_count, size_t size)
+{
+    CHECK_SCCL_ERROR_RET(
+        validate_ranks(streams, src_buffers, rank_count, size));
+    CHECK_SCCL_ERROR_RET(
+        validate_ranks(streams, dst_buffers, rank_count, rank_count * size));
+
+    /* rank i starts with chunk i */
+    for (size_t i = 0; i < rank_count && size > 0; ++i) {
+        CHECK_SCCL_ERROR_RET(sccl_copy_buffer(
+            streams[i], src_buffers[i], 0, dst_buffers[i], i * size, size));
+    }
+
+    collective_t collective;
+    CHECK_SCCL_ERROR_RET(init_collective(streams, rank_count,
+                                         rank_count * size, 1, &collective));
+    for (size_t i = 0; i < rank_count; ++i) {
+        collective.ranks[i].send_buffer = dst_buffers[i];
+        collective.ranks[i].receive_buffer = dst_buffers[i];
+    }
+    collective.ring_offset = rank_count - 1;
+    collective.gather_steps = rank_count - 1;
+
+    return run_collective(&collective, get_ring_round,
+                          (rank_count - 1) * collective.step_rounds);
+}
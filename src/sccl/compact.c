@@ -0,0 +1,226 @@
+#include "compact.h"
+#include "buffer.h"
+#include "device.h"
+#include "error.h"
+#include "kernel.h"
+#include "reduce.h"
+#include "sccl.h"
+#include "stream.h"
+
+#include <string.h>
+
+/* shader bundle names, indexed by `sccl_dtype_t` */
+static const char *const predicate_names[] = {
+    "compact_predicate_int32",
+    "compact_predicate_uint32",
+    "compact_predicate_float32",
+    "compact_predicate_float16",
+    "compact_predicate_int64",
+};
+
+/* shader bundle names, indexed by `get_element_size_index` */
+static const char *const scatter_names[] = {
+    "compact_scatter_bits16",
+    "compact_scatter_bits32",
+    "compact_scatter_bits64",
+};
+
+typedef struct {
+    uint32_t count;
+    uint32_t padding;
+    uint32_t value[2];
+} predicate_push_constants_t;
+
+void compact_kernels_destroy(compact_kernels_t *kernels)
+{
+    for (size_t i = 0; i < REDUCE_DTYPE_COUNT; ++i) {
+        for (size_t j = 0; j < COMPACT_COMPARE_OP_COUNT; ++j) {
+            if (kernels->predicate_shaders[i][j] != SCCL_NULL) {
+                sccl_destroy_shader(kernels->predicate_shaders[i][j]);
+                kernels->predicate_shaders[i][j] = SCCL_NULL;
+            }
+        }
+    }
+    for (size_t i = 0; i < COMPACT_ELEMENT_SIZE_COUNT; ++i) {
+        if (kernels->scatter_shaders[i] != SCCL_NULL) {
+            sccl_destroy_shader(kernels->scatter_shaders[i]);
+            kernels->scatter_shaders[i] = SCCL_NULL;
+        }
+    }
+}
+
+static size_t get_element_size_index(size_t element_size)
+{
+    switch (element_size) {
+    case 2:
+        return 0;
+    case 4:
+        return 1;
+    default:
+        return 2;
+    }
+}
+
+static uint32_t get_group_count(size_t count)
+{
+    size_t group_count =
+        (count + COMPACT_WORKGROUP_SIZE - 1) / COMPACT_WORKGROUP_SIZE;
+    if (group_count > COMPACT_MAX_GROUP_COUNT) {
+        return COMPACT_MAX_GROUP_COUNT;
+    }
+    return (uint32_t)group_count;
+}
+
+static sccl_error_t validate_buffer(const sccl_stream_t stream,
+                                    const sccl_buffer_t buffer, size_t size)
+{
+    CHECK_SCCL_NULL_RET(buffer);
+    if (buffer->device != stream->device || !buffer_is_storage(buffer) ||
+        buffer->size < size) {
+        return sccl_invalid_argument;
+    }
+    return sccl_success;
+}
+
+/**
+ * Record the select of `select_elements` with `positions` as temporary buffer
+ * of `count` words.
+ */
+static sccl_error_t
+record_select(const sccl_stream_t stream, const sccl_buffer_t src,
+              const sccl_buffer_t predicate_src, sccl_dtype_t predicate_dtype,
+              sccl_compare_op_t compare_op, const uint32_t value[2],
+              const sccl_buffer_t dst, const sccl_buffer_t selected_count,
+              size_t count, sccl_dtype_t dtype, const sccl_buffer_t positions)
+{
+    sccl_device_t device = stream->device;
+    size_t element_size = reduce_dtype_size(dtype);
+
+    /* flags become the inclusive count of selected elements in place */
+    sccl_shader_t predicate_shader;
+    CHECK_SCCL_ERROR_RET(kernel_get_shader(
+        device,
+        &device->compact_kernels
+             .predicate_shaders[predicate_dtype][compare_op],
+        predicate_names[predicate_dtype], compare_op, 2,
+        sizeof(predicate_push_constants_t), &predicate_shader));
+    predicate_push_constants_t predicate_push_constants = {
+        .count = (uint32_t)count, .value = {value[0], value[1]}};
+    sccl_buffer_t predicate_buffers[] = {predicate_src, positions};
+    CHECK_SCCL_ERROR_RET(kernel_run(stream, predicate_shader,
+                                    predicate_buffers, 2,
+                                    &predicate_push_constants,
+                                    get_group_count(count), 1));
+
+    CHECK_SCCL_ERROR_RET(sccl_scan(stream, positions, positions, count,
+                                   sccl_dtype_uint32, sccl_reduce_op_sum));
+
+    size_t size_index = get_element_size_index(element_size);
+    sccl_shader_t scatter_shader;
+    CHECK_SCCL_ERROR_RET(kernel_get_shader(
+        device, &device->compact_kernels.scatter_shaders[size_index],
+        scatter_names[size_index], 0, 4, sizeof(uint32_t),
+        &scatter_shader));
+    uint32_t scatter_count = (uint32_t)count;
+    sccl_buffer_t scatter_buffers[] = {src, positions, dst, selected_count};
+    return kernel_run(stream, scatter_shader, scatter_buffers, 4,
+                      &scatter_count, get_group_count(count), 1);
+}
+
+/**
+ * Select elements of `src` where `predicate_src[i] compare_op value` holds,
+ * `predicate_src` holds elements of `predicate_dtype`.
+ */
+static sccl_error_t
+select_elements(const sccl_stream_t stream, const sccl_buffer_t src,
+                const sccl_buffer_t predicate_src,
+                sccl_dtype_t predicate_dtype, sccl_compare_op_t compare_op,
+                const uint32_t value[2], const sccl_buffer_t dst,
+                const sccl_buffer_t selected_count, size_t count,
+                sccl_dtype_t dtype)
+{
+    if (count == 0) {
+        return stream_record_fill(stream, selected_count, 0,
+                                  sizeof(uint32_t), 0);
+    }
+
+    sccl_buffer_t positions;
+    CHECK_SCCL_ERROR_RET(sccl_alloc_async(stream, &positions,
+                                          sccl_buffer_type_device_storage,
+                                          count * sizeof(uint32_t)));
+    sccl_error_t error =
+        record_select(stream, src, predicate_src, predicate_dtype,
+                      compare_op, value, dst, selected_count, count, dtype,
+                      positions);
+
+    /* freed on error too, in stream order after anything recorded */
+    sccl_error_t free_error = sccl_free_async(stream, positions);
+    return error != sccl_success ? error : free_error;
+}
+
+/**
+ * Validate arguments shared by `sccl_compact` and `sccl_select_if`.
+ */
+static sccl_error_t validate_select(const sccl_stream_t stream,
+                                    const sccl_buffer_t src,
+                                    const sccl_buffer_t dst,
+                                    const sccl_buffer_t selected_count,
+                                    size_t count, sccl_dtype_t dtype)
+{
+    CHECK_SCCL_NULL_RET(stream);
+    size_t element_size = reduce_dtype_size(dtype);
+    if (element_size == 0 || count > SCCL_SCAN_MAX_COUNT) {
+        return sccl_invalid_argument;
+    }
+    CHECK_SCCL_ERROR_RET(validate_buffer(stream, src, count * element_size));
+    CHECK_SCCL_ERROR_RET(validate_buffer(stream, dst, count * element_size));
+    CHECK_SCCL_ERROR_RET(
+        validate_buffer(stream, selected_count, sizeof(uint32_t)));
+
+    /* selection is counted with `sccl_scan` */
+    const reduce_kernels_t *kernels = &stream->device->reduce_kernels;
+    if (!reduce_is_dtype_supported(kernels, sccl_dtype_uint32) ||
+        (dtype == sccl_dtype_float16 && !kernels->float16_supported)) {
+        return sccl_unsupported_error;
+    }
+    return sccl_success;
+}
+
+sccl_error_t sccl_compact(const sccl_stream_t stream, const sccl_buffer_t src,
+                          const sccl_buffer_t flags, const sccl_buffer_t dst,
+                          const sccl_buffer_t selected_count, size_t count,
+                          sccl_dtype_t dtype)
+{
+    CHECK_SCCL_ERROR_RET(
+        validate_select(stream, src, dst, selected_count, count, dtype));
+    CHECK_SCCL_ERROR_RET(
+        validate_buffer(stream, flags, count * sizeof(uint32_t)));
+
+    uint32_t zero[2] = {0, 0};
+    return select_elements(stream, src, flags, sccl_dtype_uint32,
+                           sccl_compare_op_not_equal, zero, dst,
+                           selected_count, count, dtype);
+}
+
+sccl_error_t sccl_select_if(const sccl_stream_t stream,
+                            const sccl_buffer_t src, const sccl_buffer_t dst,
+                            const sccl_buffer_t selected_count, size_t count,
+                            sccl_dtype_t dtype, sccl_compare_op_t compare_op,
+                            const void *value)
+{
+    CHECK_SCCL_ERROR_RET(
+        validate_select(stream, src, dst, selected_count, count, dtype));
+    CHECK_SCCL_NULL_RET(value);
+    if ((uint32_t)compare_op >= COMPACT_COMPARE_OP_COUNT) {
+        return sccl_invalid_argument;
+    }
+
+    /* float16 is compared as float32 */
+    uint32_t value_bits[2] = {0, 0};
+    size_t value_size =
+        dtype == sccl_dtype_float16 ? sizeof(float) : reduce_dtype_size(dtype);
+    memcpy(value_bits, value, value_size);
+
+    return select_elements(stream, src, src, dtype, compare_op, value_bits,
+                           dst, selected_count, count, dtype);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#ifndef COMPACT_HEADER
+#define COMPACT_HEADER
+
+#include "reduce.h"
+#include "sccl.h"
+
+/* must match `WORKGROUP_SIZE` in shaders/compact.comp */
+#define COMPACT_WORKGROUP_SIZE 256
+#define COMPACT_MAX_GROUP_COUNT 65535
+#define COMPACT_COMPARE_OP_COUNT 6
+/* 16, 32 and 64-bit elements */
+#define COMPACT_ELEMENT_SIZE_COUNT 3
+
+/**
+ * Built-in stream compaction kernels of a device. Predicate kernels are
+ * indexed by `sccl_dtype_t` and `sccl_compare_op_t`, scatter kernels by
+ * element size. Shaders are created the first time they are used.
+ */
+typedef struct {
+    sccl_shader_t predicate_shaders[REDUCE_DTYPE_COUNT]
+                                   [COMPACT_COMPARE_OP_COUNT];
+    sccl_shader_t scatter_shaders[COMPACT_ELEMENT_SIZE_COUNT];
+} compact_kernels_t;
+
+/**
+ * Destroy created shaders, streams that used them must be joined.
+ */
+void compact_kernels_destroy(compact_kernels_t *kernels);
+
+#endif // COMPACT_HEADER
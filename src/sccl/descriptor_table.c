@@ -0,0 +1,220 @@
+#include "descriptor_table.h"
+#include "alloc.h"
+#include "error.h"
+
+#include <string.h>
+
+static uint32_t min_uint32(uint32_t a, uint32_t b) { return a < b ? a : b; }
+
+bool descriptor_table_is_supported(
+    const VkPhysicalDeviceVulkan12Features *features)
+{
+    return features->descriptorIndexing && features->runtimeDescriptorArray &&
+           features->descriptorBindingPartiallyBound &&
+           features->descriptorBindingStorageBufferUpdateAfterBind &&
+           features->descriptorBindingUpdateUnusedWhilePending &&
+           features->shaderStorageBufferArrayNonUniformIndexing;
+}
+
+void descriptor_table_enable_features(
+    VkPhysicalDeviceVulkan12Features *features)
+{
+    features->descriptorIndexing = true;
+    features->runtimeDescriptorArray = true;
+    features->descriptorBindingPartiallyBound = true;
+    features->descriptorBindingStorageBufferUpdateAfterBind = true;
+    features->descriptorBindingUpdateUnusedWhilePending = true;
+    features->shaderStorageBufferArrayNonUniformIndexing = true;
+}
+
+static uint32_t query_capacity(VkPhysicalDevice physical_device)
+{
+    VkPhysicalDeviceDescriptorIndexingProperties limits = {0};
+    limits.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties = {0};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &limits;
+    vkGetPhysicalDeviceProperties2(physical_device, &properties);
+
+    uint32_t capacity = SCCL_DESCRIPTOR_TABLE_MAX_CAPACITY;
+    capacity = min_uint32(
+        capacity, limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers);
+    capacity = min_uint32(capacity,
+                          limits.maxDescriptorSetUpdateAfterBindStorageBuffers);
+    capacity =
+        min_uint32(capacity, limits.maxUpdateAfterBindDescriptorsInAllPools);
+    return capacity;
+}
+
+sccl_error_t descriptor_table_create(VkPhysicalDevice physical_device,
+                                     VkDevice device, bool supported,
+                                     descriptor_table_t *table)
+{
+    memset(table, 0, sizeof(descriptor_table_t));
+    if (!supported) {
+        return sccl_success;
+    }
+
+    table->capacity = query_capacity(physical_device);
+    if (table->capacity == 0) {
+        return sccl_success;
+    }
+
+    CHECK_SCCL_ERROR_RET(sccl_calloc((void **)&table->free_slots,
+                                     table->capacity, sizeof(uint32_t)));
+
+    /* create descriptor set layout */
+    VkDescriptorSetLayoutBinding descriptor_set_layout_binding = {0};
+    descriptor_set_layout_binding.binding = 0;
+    descriptor_set_layout_binding.descriptorType =
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptor_set_layout_binding.descriptorCount = table->capacity;
+    descriptor_set_layout_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    /* slots are written and freed while streams using other slots are still
+     * pending */
+    VkDescriptorBindingFlags descriptor_binding_flags =
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+        VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+        VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+    VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_create_info = {0};
+    binding_flags_create_info.sType =
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    binding_flags_create_info.bindingCount = 1;
+    binding_flags_create_info.pBindingFlags = &descriptor_binding_flags;
+
+    VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info = {0};
+    descriptor_set_layout_create_info.sType =
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    descriptor_set_layout_create_info.pNext = &binding_flags_create_info;
+    descriptor_set_layout_create_info.flags =
+        VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    descriptor_set_layout_create_info.bindingCount = 1;
+    descriptor_set_layout_create_info.pBindings =
+        &descriptor_set_layout_binding;
+    CHECK_VKRESULT_RET(vkCreateDescriptorSetLayout(
+        device, &descriptor_set_layout_create_info, NULL,
+        &table->descriptor_set_layout));
+
+    /* create descriptor pool */
+    VkDescriptorPoolSize descriptor_pool_size = {0};
+    descriptor_pool_size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptor_pool_size.descriptorCount = table->capacity;
+
+    VkDescriptorPoolCreateInfo descriptor_pool_create_info = {0};
+    descriptor_pool_create_info.sType =
+        VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descriptor_pool_create_info.flags =
+        VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    descriptor_pool_create_info.maxSets = 1;
+    descriptor_pool_create_info.poolSizeCount = 1;
+    descriptor_pool_create_info.pPoolSizes = &descriptor_pool_size;
+    CHECK_VKRESULT_RET(vkCreateDescriptorPool(
+        device, &descriptor_pool_create_info, NULL, &table->descriptor_pool));
+
+    /* allocate the single descriptor set */
+    VkDescriptorSetAllocateInfo descriptor_set_allocate_info = {0};
+    descriptor_set_allocate_info.sType =
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    descriptor_set_allocate_info.descriptorPool = table->descriptor_pool;
+    descriptor_set_allocate_info.descriptorSetCount = 1;
+    descriptor_set_allocate_info.pSetLayouts = &table->descriptor_set_layout;
+    CHECK_VKRESULT_RET(vkAllocateDescriptorSets(
+        device, &descriptor_set_allocate_info, &table->descriptor_set));
+
+    /* create pipeline layout shared by all bindless shaders */
+    VkPushConstantRange push_constant_range = {0};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push_constant_range.offset = 0;
+    push_constant_range.size = SCCL_DESCRIPTOR_TABLE_PUSH_CONSTANT_SIZE;
+
+    VkPipelineLayoutCreateInfo pipeline_layout_create_info = {0};
+    pipeline_layout_create_info.sType =
+        VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_create_info.setLayoutCount = 1;
+    pipeline_layout_create_info.pSetLayouts = &table->descriptor_set_layout;
+    pipeline_layout_create_info.pushConstantRangeCount = 1;
+    pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+    CHECK_VKRESULT_RET(vkCreatePipelineLayout(
+        device, &pipeline_layout_create_info, NULL, &table->pipeline_layout));
+
+    table->supported = true;
+
+    return sccl_success;
+}
+
+void descriptor_table_destroy(VkDevice device, descriptor_table_t *table)
+{
+    if (!table->supported) {
+        return;
+    }
+    vkDestroyPipelineLayout(device, table->pipeline_layout, NULL);
+    /* descriptor set is freed with pool */
+    vkDestroyDescriptorPool(device, table->descriptor_pool, NULL);
+    vkDestroyDescriptorSetLayout(device, table->descriptor_set_layout, NULL);
+    sccl_free(table->free_slots);
+}
+
+static void write_descriptor(VkDevice device, const descriptor_table_t *table,
+                             uint32_t slot, VkBuffer buffer)
+{
+    /* write descriptor, allowed while table is bound since binding is update
+     * after bind */
+    VkDescriptorBufferInfo descriptor_buffer_info = {0};
+    descriptor_buffer_info.buffer = buffer;
+    descriptor_buffer_info.offset = 0;
+    descriptor_buffer_info.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet write_descriptor_set = {0};
+    write_descriptor_set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write_descriptor_set.dstSet = table->descriptor_set;
+    write_descriptor_set.dstBinding = 0;
+    write_descriptor_set.dstArrayElement = slot;
+    write_descriptor_set.descriptorCount = 1;
+    write_descriptor_set.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write_descriptor_set.pBufferInfo = &descriptor_buffer_info;
+    vkUpdateDescriptorSets(device, 1, &write_descriptor_set, 0, NULL);
+}
+
+sccl_error_t descriptor_table_add_buffer(VkDevice device,
+                                         descriptor_table_t *table,
+                                         VkBuffer buffer, uint32_t *index)
+{
+    if (!table->supported) {
+        return sccl_unsupported_error;
+    }
+
+    /* find free slot */
+    uint32_t slot;
+    if (table->next_slot < table->capacity) {
+        slot = table->next_slot++;
+    } else if (table->free_slots_count > 0) {
+        slot = table->free_slots[--table->free_slots_count];
+    } else {
+        return sccl_out_of_resources_error;
+    }
+
+    write_descriptor(device, table, slot, buffer);
+
+    *index = slot;
+
+    return sccl_success;
+}
+
+void descriptor_table_remove_buffer(descriptor_table_t *table, uint32_t index)
+{
+    assert(table->supported);
+    assert(index < table->next_slot);
+    assert(table->free_slots_count < table->capacity);
+    table->free_slots[table->free_slots_count++] = index;
+}
+
+void descriptor_table_update_buffer(VkDevice device,
+                                    const descriptor_table_t *table,
+                                    uint32_t index, VkBuffer buffer)
+{
+    assert(table->supported);
+    assert(index < table->next_slot);
+    write_descriptor(device, table, index, buffer);
+}
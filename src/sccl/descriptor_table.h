@@ -0,0 +1,80 @@
+#pragma once
+#ifndef DESCRIPTOR_TABLE_HEADER
+#define DESCRIPTOR_TABLE_HEADER
+
+#include "sccl.h"
+#include <stdbool.h>
+#include <vulkan/vulkan.h>
+
+/* upper bound on descriptor table size, actual capacity is also limited by
+ * device limits */
+#define SCCL_DESCRIPTOR_TABLE_MAX_CAPACITY 65536
+
+/**
+ * Device wide bindless descriptor table.
+ * Every storage buffer created on the device is written into a single
+ * update-after-bind, partially bound descriptor array at set 0, binding 0.
+ * All bindless shaders share the same pipeline layout, so the table is
+ * bound once per command buffer.
+ */
+typedef struct {
+    bool supported;
+    uint32_t capacity;
+    VkDescriptorSetLayout descriptor_set_layout;
+    VkDescriptorPool descriptor_pool;
+    VkDescriptorSet descriptor_set;
+    VkPipelineLayout pipeline_layout;
+    /* slots are handed out from `next_slot` until capacity is reached, after
+     * that from the stack of freed slots */
+    uint32_t next_slot;
+    uint32_t *free_slots;
+    uint32_t free_slots_count;
+} descriptor_table_t;
+
+/**
+ * Check if physical device supports the descriptor indexing features required
+ * by the descriptor table.
+ */
+bool descriptor_table_is_supported(
+    const VkPhysicalDeviceVulkan12Features *features);
+
+/**
+ * Enable the descriptor indexing features required by the descriptor table.
+ */
+void descriptor_table_enable_features(
+    VkPhysicalDeviceVulkan12Features *features);
+
+/**
+ * Create descriptor table.
+ * If `supported` is false the table is zero initialized and marked as
+ * unsupported.
+ */
+sccl_error_t descriptor_table_create(VkPhysicalDevice physical_device,
+                                     VkDevice device, bool supported,
+                                     descriptor_table_t *table);
+
+void descriptor_table_destroy(VkDevice device, descriptor_table_t *table);
+
+/**
+ * Write buffer into a free slot of the table.
+ * Returns `sccl_out_of_resources_error` if table is full.
+ */
+sccl_error_t descriptor_table_add_buffer(VkDevice device,
+                                         descriptor_table_t *table,
+                                         VkBuffer buffer, uint32_t *index);
+
+/**
+ * Return slot to table, the descriptor is left as is since the binding is
+ * partially bound.
+ */
+void descriptor_table_remove_buffer(descriptor_table_t *table, uint32_t index);
+
+/**
+ * Point existing slot at a different VkBuffer, used when buffer memory is
+ * migrated.
+ */
+void descriptor_table_update_buffer(VkDevice device,
+                                    const descriptor_table_t *table,
+                                    uint32_t index, VkBuffer buffer);
+
+#endif // DESCRIPTOR_TABLE_HEADER
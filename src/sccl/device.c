@@ -1,9 +1,11 @@
 
 #include "device.h"
 #include "alloc.h"
+#include "buffer.h"
 #include "error.h"
 #include "instance.h"
 #include <stdbool.h>
+#include <string.h>
 
 static sccl_error_t
 get_physical_device_at_index(const sccl_instance_t instance,
@@ -64,6 +66,71 @@ static sccl_error_t find_queue_family_index(VkPhysicalDevice physical_device,
     return sccl_success;
 }
 
+/**
+ * Query Vulkan 1.1 and 1.2 features of physical device.
+ * If device does not support Vulkan 1.2, `features_11` and `features_12` are
+ * zero initialized (including `sType`).
+ */
+static void
+query_vulkan_features(VkPhysicalDevice physical_device,
+                      VkPhysicalDeviceVulkan11Features *features_11,
+                      VkPhysicalDeviceVulkan12Features *features_12)
+{
+    memset(features_11, 0, sizeof(VkPhysicalDeviceVulkan11Features));
+    memset(features_12, 0, sizeof(VkPhysicalDeviceVulkan12Features));
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    if (properties.apiVersion < VK_API_VERSION_1_2) {
+        return;
+    }
+
+    features_11->sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
+    features_11->pNext = features_12;
+    features_12->sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 physical_device_features = {0};
+    physical_device_features.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    physical_device_features.pNext = features_11;
+    vkGetPhysicalDeviceFeatures2(physical_device, &physical_device_features);
+}
+
+sccl_error_t device_is_extension_supported(VkPhysicalDevice physical_device,
+                                           const char *extension_name,
+                                           bool *supported)
+{
+    uint32_t extension_count;
+    CHECK_VKRESULT_RET(vkEnumerateDeviceExtensionProperties(
+        physical_device, NULL, &extension_count, NULL));
+
+    *supported = false;
+    if (extension_count == 0) {
+        return sccl_success;
+    }
+
+    VkExtensionProperties *extension_properties;
+    CHECK_SCCL_ERROR_RET(sccl_calloc((void **)&extension_properties,
+                                     extension_count,
+                                     sizeof(VkExtensionProperties)));
+    VkResult res = vkEnumerateDeviceExtensionProperties(
+        physical_device, NULL, &extension_count, extension_properties);
+    if (res != VK_SUCCESS && res != VK_INCOMPLETE) {
+        sccl_free(extension_properties);
+        return sccl_unhandled_vulkan_error;
+    }
+
+    for (uint32_t i = 0; i < extension_count; ++i) {
+        if (strcmp(extension_properties[i].extensionName, extension_name) ==
+            0) {
+            *supported = true;
+            break;
+        }
+    }
+    sccl_free(extension_properties);
+
+    return sccl_success;
+}
+
 sccl_error_t sccl_create_device(const sccl_instance_t instance,
                                 sccl_device_t *device, uint32_t device_index)
 {
@@ -89,18 +156,113 @@ sccl_error_t sccl_create_device(const sccl_instance_t instance,
     queue_create_info.queueCount = 1;
     queue_create_info.pQueuePriorities = &queue_priority;
 
-    VkPhysicalDeviceFeatures physical_device_features = {0};
-    physical_device_features.shaderInt64 = true;
+    /* query supported features */
+    VkPhysicalDeviceVulkan11Features supported_vulkan_11_features = {0};
+    VkPhysicalDeviceVulkan12Features supported_vulkan_12_features = {0};
+    query_vulkan_features(physical_device, &supported_vulkan_11_features,
+                          &supported_vulkan_12_features);
+    bool descriptor_table_supported =
+        descriptor_table_is_supported(&supported_vulkan_12_features);
+    reduce_kernels_init(physical_device, &supported_vulkan_11_features,
+                        &supported_vulkan_12_features,
+                        &device_internal->reduce_kernels);
+    scan_kernels_init(physical_device, &device_internal->scan_kernels);
+    sort_kernels_init(physical_device, &device_internal->sort_kernels);
+    gemm_kernels_init(physical_device, &device_internal->gemm_kernels);
+    dispatch_kernels_init(physical_device, &device_internal->dispatch_kernels);
+
+    CHECK_SCCL_ERROR_RET(memory_manager_init(physical_device,
+                                             &device_internal->memory_manager));
+
+    /* pipeline creation feedback is core since Vulkan 1.3 */
+    bool feedback_extension_supported;
+    CHECK_SCCL_ERROR_RET(device_is_extension_supported(
+        physical_device, VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME,
+        &feedback_extension_supported));
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    device_internal->pipeline_creation_feedback_supported =
+        feedback_extension_supported ||
+        properties.apiVersion >= VK_API_VERSION_1_3;
+
+    /* enable features */
+    VkPhysicalDeviceVulkan12Features vulkan_12_features = {0};
+    vulkan_12_features.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceVulkan11Features vulkan_11_features = {0};
+    vulkan_11_features.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
+    vulkan_11_features.pNext = &vulkan_12_features;
+    if (descriptor_table_supported) {
+        descriptor_table_enable_features(&vulkan_12_features);
+    }
+    reduce_kernels_enable_features(&device_internal->reduce_kernels,
+                                   &vulkan_11_features, &vulkan_12_features);
+
+    VkPhysicalDeviceFeatures2 physical_device_features = {0};
+    physical_device_features.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    physical_device_features.features.shaderInt64 = true;
+    if (supported_vulkan_12_features.sType ==
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES) {
+        physical_device_features.pNext = &vulkan_11_features;
+    }
 
     VkDeviceCreateInfo device_create_info = {0};
     device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_create_info.pNext = &physical_device_features;
     device_create_info.queueCreateInfoCount = 1;
     device_create_info.pQueueCreateInfos = &queue_create_info;
-    device_create_info.pEnabledFeatures = &physical_device_features;
+
+    /* enable extensions */
+    const char *enabled_extensions[2];
+    uint32_t enabled_extensions_count = 0;
+    if (device_internal->memory_manager.budget_extension_supported) {
+        enabled_extensions[enabled_extensions_count++] =
+            VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
+    }
+    if (feedback_extension_supported) {
+        enabled_extensions[enabled_extensions_count++] =
+            VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME;
+    }
+    device_create_info.enabledExtensionCount = enabled_extensions_count;
+    device_create_info.ppEnabledExtensionNames = enabled_extensions;
 
     CHECK_VKRESULT_RET(vkCreateDevice(physical_device, &device_create_info,
                                       NULL, &device_internal->device));
 
+    /* create bindless descriptor table */
+    CHECK_SCCL_ERROR_RET(descriptor_table_create(
+        physical_device, device_internal->device, descriptor_table_supported,
+        &device_internal->descriptor_table));
+
+    CHECK_SCCL_ERROR_RET(shader_cache_init(&device_internal->shader_cache));
+
+    CHECK_SCCL_ERROR_RET(
+        shader_compile_pool_init(&device_internal->shader_compile_pool));
+
+    VkPipelineCacheCreateInfo pipeline_cache_create_info = {0};
+    pipeline_cache_create_info.sType =
+        VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    CHECK_VKRESULT_RET(vkCreatePipelineCache(
+        device_internal->device, &pipeline_cache_create_info, NULL,
+        &device_internal->pipeline_cache));
+
+    if (pthread_mutex_init(&device_internal->mutex, NULL) != 0) {
+        return sccl_system_error;
+    }
+    if (pthread_mutex_init(&device_internal->kernel_mutex, NULL) != 0) {
+        return sccl_system_error;
+    }
+
+    CHECK_SCCL_ERROR_RET(memory_pool_init(&device_internal->memory_pool));
+
+    CHECK_SCCL_ERROR_RET(sccl_create_stream(device_internal,
+                                            &device_internal->transfer_stream));
+
+    CHECK_SCCL_ERROR_RET(vector_init(&device_internal->collective_streams,
+                                     sizeof(sccl_stream_t)));
+
     /* set public handle */
     *device = (sccl_device_t)device_internal;
 
@@ -109,6 +271,46 @@ sccl_error_t sccl_create_device(const sccl_instance_t instance,
 
 void sccl_destroy_device(sccl_device_t device)
 {
+    reduce_kernels_destroy(&device->reduce_kernels);
+    scan_kernels_destroy(&device->scan_kernels);
+    sort_kernels_destroy(&device->sort_kernels);
+    compact_kernels_destroy(&device->compact_kernels);
+    gemm_kernels_destroy(&device->gemm_kernels);
+    dispatch_kernels_destroy(&device->dispatch_kernels);
+    worker_kernels_destroy(&device->worker_kernels);
+
+    /* collectives return their streams joined */
+    for (size_t i = 0; i < vector_get_size(&device->collective_streams);
+         ++i) {
+        sccl_destroy_stream(
+            *(sccl_stream_t *)vector_get_element(&device->collective_streams,
+                                                 i));
+    }
+    vector_destroy(&device->collective_streams);
+
+    pthread_mutex_lock(&device->mutex);
+    memory_pool_destroy_locked(&device->memory_pool);
+    /* all streams are destroyed, so every deferred buffer is idle */
+    buffer_destroy_deferred_locked(device);
+    pthread_mutex_unlock(&device->mutex);
+
+    sccl_destroy_stream(device->transfer_stream);
+
+    pthread_mutex_destroy(&device->kernel_mutex);
+    pthread_mutex_destroy(&device->mutex);
+
+    memory_manager_destroy(&device->memory_manager);
+
+    descriptor_table_destroy(device->device, &device->descriptor_table);
+
+    /* every shader is destroyed, so no job is queued */
+    shader_compile_pool_destroy(&device->shader_compile_pool);
+
+    vkDestroyPipelineCache(device->device, device->pipeline_cache, NULL);
+
+    /* every shader is destroyed, this only frees the cache itself */
+    shader_cache_destroy(device->device, &device->shader_cache);
+
     vkDestroyDevice(device->device, NULL);
 
     sccl_free(device);
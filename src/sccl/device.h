@@ -2,6 +2,20 @@
 #ifndef DEVICE_HEADER
 #define DEVICE_HEADER
 
+#include "descriptor_table.h"
+#include "memory.h"
+#include "memory_pool.h"
+#include "compact.h"
+#include "dispatch.h"
+#include "gemm.h"
+#include "reduce.h"
+#include "scan.h"
+#include "shader.h"
+#include "shader_cache.h"
+#include "sort.h"
+#include "vector.h"
+#include "worker.h"
+#include <pthread.h>
 #include <vulkan/vulkan.h>
 
 /* always select queue at index 0 */
@@ -11,6 +25,42 @@ struct sccl_device {
     VkPhysicalDevice physical_device;
     VkDevice device;
     uint32_t queue_family_index;
+    descriptor_table_t descriptor_table;
+    /* shared by all pipelines created on the device, internally synchronized
+     * so shaders can be created from several threads */
+    VkPipelineCache pipeline_cache;
+    /* `VK_EXT_pipeline_creation_feedback` or Vulkan 1.3 */
+    bool pipeline_creation_feedback_supported;
+    /* shader modules and layouts shared by identical shaders */
+    shader_cache_t shader_cache;
+    /* threads compiling `sccl_create_shader_async` pipelines */
+    shader_compile_pool_t shader_compile_pool;
+    /* protects queue submission and device wide state like memory_manager */
+    pthread_mutex_t mutex;
+    memory_manager_t memory_manager;
+    memory_pool_t memory_pool;
+    /* internal stream used to migrate buffer memory */
+    sccl_stream_t transfer_stream;
+    /* idle `sccl_stream_t` of collective sends, created on first use and
+     * reused by later collectives, one per rank on the device */
+    vector_t collective_streams;
+    /* held while a built-in kernel shader is created on first use, separate
+     * from `mutex` so the compile doesn't block streams */
+    pthread_mutex_t kernel_mutex;
+    reduce_kernels_t reduce_kernels;
+    scan_kernels_t scan_kernels;
+    sort_kernels_t sort_kernels;
+    compact_kernels_t compact_kernels;
+    gemm_kernels_t gemm_kernels;
+    dispatch_kernels_t dispatch_kernels;
+    worker_kernels_t worker_kernels;
 };
 
+/**
+ * Check if physical device supports device extension `extension_name`.
+ */
+sccl_error_t device_is_extension_supported(VkPhysicalDevice physical_device,
+                                           const char *extension_name,
+                                           bool *supported);
+
 #endif // DEVICE_HEADER
\ No newline at end of file
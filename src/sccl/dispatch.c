@@ -0,0 +1,130 @@
+
+#include "dispatch.h"
+#include "buffer.h"
+#include "device.h"
+#include "error.h"
+#include "kernel.h"
+#include "sccl.h"
+#include "stream.h"
+
+#include <string.h>
+
+typedef struct {
+    uint32_t count_index;
+    uint32_t args_index;
+    uint32_t elements_per_group;
+} group_counts_push_constants_t;
+
+void dispatch_kernels_init(VkPhysicalDevice physical_device,
+                           dispatch_kernels_t *kernels)
+{
+    memset(kernels, 0, sizeof(dispatch_kernels_t));
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    for (size_t i = 0; i < 3; ++i) {
+        kernels->max_group_count[i] =
+            properties.limits.maxComputeWorkGroupCount[i];
+    }
+}
+
+void dispatch_kernels_destroy(dispatch_kernels_t *kernels)
+{
+    if (kernels->group_counts_shader != SCCL_NULL) {
+        sccl_destroy_shader(kernels->group_counts_shader);
+        kernels->group_counts_shader = SCCL_NULL;
+    }
+}
+
+/**
+ * Check that `size` bytes at `offset` of `buffer` are in a storage buffer of
+ * the stream device and can be indexed as 32-bit words by a kernel.
+ */
+static bool validate_words(const sccl_stream_t stream,
+                           const sccl_buffer_t buffer, size_t offset,
+                           size_t size)
+{
+    return buffer->device == stream->device && buffer_is_storage(buffer) &&
+           offset % sizeof(uint32_t) == 0 && offset <= buffer->size &&
+           buffer->size - offset >= size &&
+           offset / sizeof(uint32_t) <= UINT32_MAX - 2;
+}
+
+sccl_error_t sccl_write_group_counts(const sccl_stream_t stream,
+                                     const sccl_buffer_t count_buffer,
+                                     size_t count_offset,
+                                     const sccl_buffer_t args_buffer,
+                                     size_t args_offset,
+                                     uint32_t elements_per_group)
+{
+    CHECK_SCCL_NULL_RET(stream);
+    CHECK_SCCL_NULL_RET(count_buffer);
+    CHECK_SCCL_NULL_RET(args_buffer);
+    if (elements_per_group == 0 ||
+        !validate_words(stream, count_buffer, count_offset,
+                        sizeof(uint32_t)) ||
+        !validate_words(stream, args_buffer, args_offset,
+                        SCCL_INDIRECT_ARGS_SIZE)) {
+        return sccl_invalid_argument;
+    }
+
+    sccl_device_t device = stream->device;
+    sccl_shader_t shader;
+    CHECK_SCCL_ERROR_RET(kernel_get_shader_with_constants(
+        device, &device->dispatch_kernels.group_counts_shader,
+        "group_counts", NULL, 0, 2,
+        sizeof(group_counts_push_constants_t), &shader));
+
+    group_counts_push_constants_t push_constants = {
+        .count_index = (uint32_t)(count_offset / sizeof(uint32_t)),
+        .args_index = (uint32_t)(args_offset / sizeof(uint32_t)),
+        .elements_per_group = elements_per_group,
+    };
+    const sccl_buffer_t buffers[] = {count_buffer, args_buffer};
+    return kernel_run(stream, shader, buffers, 2, &push_constants, 1, 1);
+}
+
+/* ceil(a / b) without overflow of a + b - 1 */
+static uint64_t divide_round_up(uint64_t a, uint64_t b)
+{
+    return a / b + (a % b != 0 ? 1 : 0);
+}
+
+sccl_error_t sccl_get_group_counts(const sccl_device_t device, size_t count,
+                                   uint32_t local_size,
+                                   sccl_shader_run_params_t *params)
+{
+    CHECK_SCCL_NULL_RET(device);
+    CHECK_SCCL_NULL_RET(params);
+    if (local_size == 0 || count > UINT32_MAX) {
+        return sccl_invalid_argument;
+    }
+
+    /* linear index of every invocation in a needed workgroup must fit in 32
+     * bits, shaders skip padding workgroups before computing it */
+    const uint32_t *max = device->dispatch_kernels.max_group_count;
+    uint64_t group_count = divide_round_up(count, local_size);
+    if (group_count * local_size > (uint64_t)UINT32_MAX + 1) {
+        return sccl_invalid_argument;
+    }
+    if (group_count == 0) {
+        params->group_count_x = 0;
+        params->group_count_y = 1;
+        params->group_count_z = 1;
+        return sccl_success;
+    }
+
+    /* use as few z layers as possible, then as few y rows, and spread the
+     * workgroups evenly over x, fewer than y * z workgroups are padding */
+    uint64_t z = divide_round_up(group_count, (uint64_t)max[0] * max[1]);
+    if (z > max[2]) {
+        return sccl_invalid_argument;
+    }
+    uint64_t y = divide_round_up(group_count, max[0] * z);
+    uint64_t x = divide_round_up(group_count, y * z);
+
+    params->group_count_x = (uint32_t)x;
+    params->group_count_y = (uint32_t)y;
+    params->group_count_z = (uint32_t)z;
+    return sccl_success;
+}
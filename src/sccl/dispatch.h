@@ -0,0 +1,30 @@
+#pragma once
+#ifndef DISPATCH_HEADER
+#define DISPATCH_HEADER
+
+#include "sccl.h"
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+
+/**
+ * Dispatch limits and built-in kernels of a device that size other
+ * dispatches. Shaders are created the first time they are used.
+ */
+typedef struct {
+    /* `maxComputeWorkGroupCount` of physical device */
+    uint32_t max_group_count[3];
+    sccl_shader_t group_counts_shader;
+} dispatch_kernels_t;
+
+/**
+ * Read dispatch limits of physical device.
+ */
+void dispatch_kernels_init(VkPhysicalDevice physical_device,
+                           dispatch_kernels_t *kernels);
+
+/**
+ * Destroy created shaders, streams that used them must be joined.
+ */
+void dispatch_kernels_destroy(dispatch_kernels_t *kernels);
+
+#endif // DISPATCH_HEADER
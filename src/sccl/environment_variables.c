@@ -24,3 +24,24 @@ bool is_assert_on_validation_error_set()
     const char *str = getenv(SCCL_ASSERT_ON_VALIDATION_ERROR);
     return parse_input(str);
 }
+
+bool is_disable_decoupled_lookback_set()
+{
+    const char *str = getenv(SCCL_DISABLE_DECOUPLED_LOOKBACK);
+    return parse_input(str);
+}
+
+bool is_force_decoupled_lookback_set()
+{
+    const char *str = getenv(SCCL_FORCE_DECOUPLED_LOOKBACK);
+    return parse_input(str);
+}
+
+const char *get_autotune_cache_path()
+{
+    const char *str = getenv(SCCL_AUTOTUNE_CACHE);
+    if (str == NULL || str[0] == '\0') {
+        return NULL;
+    }
+    return str;
+}
@@ -8,4 +8,11 @@ bool is_enable_validation_layers_set();
 
 bool is_assert_on_validation_error_set();
 
+bool is_disable_decoupled_lookback_set();
+
+bool is_force_decoupled_lookback_set();
+
+/* returns NULL if not set */
+const char *get_autotune_cache_path();
+
 #endif // ENVIRONMENT_VARIABLES_HEADER
\ No newline at end of file
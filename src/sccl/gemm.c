@@ -0,0 +1,145 @@
+#include "gemm.h"
+#include "buffer.h"
+#include "device.h"
+#include "error.h"
+#include "kernel.h"
+#include "reduce.h"
+#include "sccl.h"
+#include "stream.h"
+
+#include <string.h>
+
+/* shader bundle names, indexed like `gemm_kernels_t::shaders` */
+static const char *const gemm_names[] = {
+    "gemm_float32",
+    "gemm_float16",
+};
+
+typedef struct {
+    uint32_t m;
+    uint32_t n;
+    uint32_t k;
+    float alpha;
+    float beta;
+} gemm_push_constants_t;
+
+void gemm_kernels_init(VkPhysicalDevice physical_device,
+                       gemm_kernels_t *kernels)
+{
+    memset(kernels, 0, sizeof(gemm_kernels_t));
+
+    VkPhysicalDeviceSubgroupProperties subgroup_properties = {0};
+    subgroup_properties.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties = {0};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &subgroup_properties;
+    vkGetPhysicalDeviceProperties2(physical_device, &properties);
+    const VkPhysicalDeviceLimits *limits = &properties.properties.limits;
+
+    /* 64x64 tiles keep 8 or more wide subgroups busy with 256 invocations,
+     * narrow subgroups (mobile GPUs) get 32x32 tiles with 64 invocations
+     * which also fits the smallest limits Vulkan allows */
+    kernels->tile_m = 64;
+    kernels->tile_n = 64;
+    kernels->tile_k = 16;
+    uint32_t workgroup_size = (kernels->tile_m / GEMM_THREAD_M) *
+                              (kernels->tile_n / GEMM_THREAD_N);
+    size_t shared_size = (size_t)(kernels->tile_m + kernels->tile_n) *
+                         kernels->tile_k * sizeof(float);
+    if (subgroup_properties.subgroupSize < 32 ||
+        limits->maxComputeWorkGroupInvocations < workgroup_size ||
+        limits->maxComputeWorkGroupSize[0] < workgroup_size ||
+        limits->maxComputeSharedMemorySize < shared_size) {
+        kernels->tile_m = 32;
+        kernels->tile_n = 32;
+    }
+}
+
+void gemm_kernels_destroy(gemm_kernels_t *kernels)
+{
+    for (size_t i = 0; i < 2; ++i) {
+        for (size_t j = 0; j < 2; ++j) {
+            for (size_t k = 0; k < 2; ++k) {
+                if (kernels->shaders[i][j][k] != SCCL_NULL) {
+                    sccl_destroy_shader(kernels->shaders[i][j][k]);
+                    kernels->shaders[i][j][k] = SCCL_NULL;
+                }
+            }
+        }
+    }
+}
+
+static sccl_error_t validate_matrix(const sccl_stream_t stream,
+                                    const sccl_buffer_t buffer, size_t rows,
+                                    size_t cols, size_t element_size)
+{
+    CHECK_SCCL_NULL_RET(buffer);
+    /* elements are indexed with 32 bits in the kernel */
+    if (rows * cols > UINT32_MAX) {
+        return sccl_invalid_argument;
+    }
+    if (buffer->device != stream->device || !buffer_is_storage(buffer) ||
+        buffer->size < rows * cols * element_size) {
+        return sccl_invalid_argument;
+    }
+    return sccl_success;
+}
+
+sccl_error_t sccl_gemm(const sccl_stream_t stream, const sccl_buffer_t a,
+                       const sccl_buffer_t b, const sccl_buffer_t c, size_t m,
+                       size_t n, size_t k, sccl_dtype_t dtype, bool trans_a,
+                       bool trans_b, float alpha, float beta)
+{
+    CHECK_SCCL_NULL_RET(stream);
+    if (dtype != sccl_dtype_float32 && dtype != sccl_dtype_float16) {
+        return sccl_invalid_argument;
+    }
+    size_t element_size = reduce_dtype_size(dtype);
+    if (m > UINT32_MAX || n > UINT32_MAX || k > UINT32_MAX) {
+        return sccl_invalid_argument;
+    }
+    CHECK_SCCL_ERROR_RET(validate_matrix(stream, a, m, k, element_size));
+    CHECK_SCCL_ERROR_RET(validate_matrix(stream, b, k, n, element_size));
+    CHECK_SCCL_ERROR_RET(validate_matrix(stream, c, m, n, element_size));
+
+    sccl_device_t device = stream->device;
+    const gemm_kernels_t *kernels = &device->gemm_kernels;
+    size_t group_count_x = (n + kernels->tile_n - 1) / kernels->tile_n;
+    size_t group_count_y = (m + kernels->tile_m - 1) / kernels->tile_m;
+    if (group_count_x > KERNEL_MAX_GROUP_COUNT_X ||
+        group_count_y > KERNEL_MAX_GROUP_COUNT_X) {
+        return sccl_invalid_argument;
+    }
+    if (dtype == sccl_dtype_float16 &&
+        !device->reduce_kernels.float16_supported) {
+        return sccl_unsupported_error;
+    }
+    if (m == 0 || n == 0) {
+        return sccl_success;
+    }
+
+    size_t type_index = dtype == sccl_dtype_float16 ? 1 : 0;
+    uint32_t workgroup_size = (kernels->tile_m / GEMM_THREAD_M) *
+                              (kernels->tile_n / GEMM_THREAD_N);
+    /* must match specialization constant ids in shaders/gemm.comp */
+    uint32_t constants[] = {trans_a,         trans_b,         kernels->tile_m,
+                            kernels->tile_n, kernels->tile_k, workgroup_size};
+    sccl_shader_t shader;
+    CHECK_SCCL_ERROR_RET(kernel_get_shader_with_constants(
+        device, &device->gemm_kernels.shaders[type_index][trans_a][trans_b],
+        gemm_names[type_index], constants,
+        sizeof(constants) / sizeof(constants[0]), 3,
+        sizeof(gemm_push_constants_t), &shader));
+
+    gemm_push_constants_t push_constants = {
+        .m = (uint32_t)m,
+        .n = (uint32_t)n,
+        .k = (uint32_t)k,
+        .alpha = alpha,
+        .beta = beta,
+    };
+    sccl_buffer_t buffers[] = {a, b, c};
+    return kernel_run(stream, shader, buffers, 3, &push_constants,
+                      (uint32_t)group_count_x, (uint32_t)group_count_y);
+}
@@ -0,0 +1,38 @@
+#pragma once
+#ifndef GEMM_HEADER
+#define GEMM_HEADER
+
+#include "sccl.h"
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+
+/* must match `THREAD_M` and `THREAD_N` in shaders/gemm.comp */
+#define GEMM_THREAD_M 4
+#define GEMM_THREAD_N 4
+
+/**
+ * Built-in matrix multiply kernels of a device, indexed by element type
+ * (float32, float16), `trans_a` and `trans_b`. Shaders are created the first
+ * time they are used.
+ */
+typedef struct {
+    /* tile of C computed by a workgroup and depth of the staged tiles of A
+     * and B, selected for the device in `gemm_kernels_init` */
+    uint32_t tile_m;
+    uint32_t tile_n;
+    uint32_t tile_k;
+    sccl_shader_t shaders[2][2][2];
+} gemm_kernels_t;
+
+/**
+ * Select tile sizes from subgroup size and compute limits of physical device.
+ */
+void gemm_kernels_init(VkPhysicalDevice physical_device,
+                       gemm_kernels_t *kernels);
+
+/**
+ * Destroy created shaders, streams that used them must be joined.
+ */
+void gemm_kernels_destroy(gemm_kernels_t *kernels);
+
+#endif // GEMM_HEADER
@@ -0,0 +1,26 @@
+#ifndef SCCL_DESCRIPTOR_TABLE_GLSL
+#define SCCL_DESCRIPTOR_TABLE_GLSL
+
+/**
+ * GLSL side of the SCCL device descriptor table, used by shaders created with
+ * `sccl_shader_config_t::bindless` set.
+ * Include before any other declarations.
+ */
+
+#extension GL_EXT_nonuniform_qualifier : require
+
+/**
+ * Declare a view of the descriptor table as an array of buffers with element
+ * type `type`. Views with different element types can be declared in the same
+ * shader, they all alias set 0, binding 0.
+ * Index with values from `sccl_get_buffer_descriptor_index` passed through
+ * push constants, wrap the index in `nonuniformEXT` if it is not uniform.
+ *
+ * Example:
+ *     SCCL_DESCRIPTOR_TABLE(uint, uint_buffers);
+ *     uint value = uint_buffers[pc.src].data[i];
+ */
+#define SCCL_DESCRIPTOR_TABLE(type, name)                                      \
+    layout(set = 0, binding = 0) buffer name##_block { type data[]; } name[]
+
+#endif // SCCL_DESCRIPTOR_TABLE_GLSL
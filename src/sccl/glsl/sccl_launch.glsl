@@ -0,0 +1,62 @@
+#ifndef SCCL_LAUNCH_GLSL
+#define SCCL_LAUNCH_GLSL
+
+/**
+ * GLSL side of `sccl_get_group_counts`, reconstructs the linear index of an
+ * invocation in a 1-D launch spread over x, y and z workgroups.
+ * Include after the `local_size` layout declaration.
+ */
+
+/**
+ * Linear index of the workgroup, x varies fastest.
+ */
+uint sccl_linear_workgroup_index()
+{
+    return gl_WorkGroupID.x +
+           gl_NumWorkGroups.x *
+               (gl_WorkGroupID.y + gl_NumWorkGroups.y * gl_WorkGroupID.z);
+}
+
+/**
+ * Linear index of the invocation, consecutive within a workgroup.
+ */
+uint sccl_linear_index()
+{
+    const uint local_size =
+        gl_WorkGroupSize.x * gl_WorkGroupSize.y * gl_WorkGroupSize.z;
+    return sccl_linear_workgroup_index() * local_size +
+           gl_LocalInvocationIndex;
+}
+
+/**
+ * True if the invocation is one of the first `count`. Padding workgroups are
+ * rejected before the linear index is computed, it could overflow for them.
+ */
+bool sccl_linear_index_in_bounds(uint count)
+{
+    const uint local_size =
+        gl_WorkGroupSize.x * gl_WorkGroupSize.y * gl_WorkGroupSize.z;
+    uint group_count = count / local_size + (count % local_size != 0 ? 1 : 0);
+    return sccl_linear_workgroup_index() < group_count &&
+           sccl_linear_index() < count;
+}
+
+/**
+ * Declare `name` as the linear index of the invocation and return from the
+ * calling function if it's not below `count`. Padding invocations return
+ * early, so subgroup and barrier operations must not follow.
+ *
+ * Example:
+ *     void main()
+ *     {
+ *         SCCL_LINEAR_INDEX_OR_RETURN(i, pc.count);
+ *         dst[i] = src[i] * 2;
+ *     }
+ */
+#define SCCL_LINEAR_INDEX_OR_RETURN(name, count)                               \
+    if (!sccl_linear_index_in_bounds(count)) {                                 \
+        return;                                                                \
+    }                                                                          \
+    const uint name = sccl_linear_index()
+
+#endif // SCCL_LAUNCH_GLSL
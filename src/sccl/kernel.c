@@ -0,0 +1,166 @@
+#include "kernel.h"
+#include "alloc.h"
+#include "bundle.h"
+#include "device.h"
+#include "error.h"
+#include "sccl.h"
+
+#include <pthread.h>
+
+/* largest `buffers_count` and `constants_count` of the built-in kernels */
+#define KERNEL_MAX_BUFFERS 5
+#define KERNEL_MAX_CONSTANTS 8
+
+static sccl_error_t create_kernel_shader(const sccl_device_t device,
+                                         const char *name,
+                                         const uint32_t *constants,
+                                         size_t constants_count,
+                                         size_t buffers_count,
+                                         size_t push_constants_size,
+                                         sccl_shader_t *shader)
+{
+    if (buffers_count > KERNEL_MAX_BUFFERS ||
+        constants_count > KERNEL_MAX_CONSTANTS) {
+        return sccl_invalid_argument;
+    }
+
+    sccl_shader_specialization_constant_t
+        specialization_constants[KERNEL_MAX_CONSTANTS];
+    for (size_t i = 0; i < constants_count; ++i) {
+        specialization_constants[i].constant_id = (uint32_t)i;
+        specialization_constants[i].size = sizeof(uint32_t);
+        specialization_constants[i].data = (void *)&constants[i];
+    }
+    sccl_shader_push_constant_layout_t push_constant_layout = {
+        .size = push_constants_size};
+    sccl_shader_buffer_layout_t buffer_layouts[KERNEL_MAX_BUFFERS];
+    for (size_t i = 0; i < buffers_count; ++i) {
+        buffer_layouts[i].position.set = 0;
+        buffer_layouts[i].position.binding = (uint32_t)i;
+        buffer_layouts[i].type = sccl_buffer_type_device_storage;
+    }
+
+    uint32_t *code;
+    size_t code_size;
+    CHECK_SCCL_ERROR_RET(bundle_get_code(name, &code, &code_size));
+
+    sccl_shader_config_t config = {0};
+    config.shader_source_code = (char *)code;
+    config.shader_source_code_length = code_size;
+    config.specialization_constants = specialization_constants;
+    config.specialization_constants_count = constants_count;
+    config.push_constant_layouts = &push_constant_layout;
+    config.push_constant_layouts_count = 1;
+    config.buffer_layouts = buffer_layouts;
+    config.buffer_layouts_count = buffers_count;
+
+    sccl_error_t error = sccl_create_shader(device, shader, &config);
+    sccl_free(code);
+    return error;
+}
+
+static sccl_error_t create_bindless_kernel_shader(const sccl_device_t device,
+                                                  const char *name,
+                                                  size_t push_constants_size,
+                                                  sccl_shader_t *shader)
+{
+    uint32_t *code;
+    size_t code_size;
+    CHECK_SCCL_ERROR_RET(bundle_get_code(name, &code, &code_size));
+
+    sccl_shader_push_constant_layout_t push_constant_layout = {
+        .size = push_constants_size};
+    sccl_shader_config_t config = {0};
+    config.shader_source_code = (char *)code;
+    config.shader_source_code_length = code_size;
+    config.push_constant_layouts = &push_constant_layout;
+    config.push_constant_layouts_count = 1;
+    config.bindless = true;
+
+    sccl_error_t error = sccl_create_shader(device, shader, &config);
+    sccl_free(code);
+    return error;
+}
+
+sccl_error_t kernel_get_shader(const sccl_device_t device,
+                               sccl_shader_t *cached, const char *name,
+                               uint32_t constant, size_t buffers_count,
+                               size_t push_constants_size,
+                               sccl_shader_t *shader)
+{
+    return kernel_get_shader_with_constants(device, cached, name, &constant,
+                                            1, buffers_count,
+                                            push_constants_size, shader);
+}
+
+sccl_error_t kernel_get_shader_with_constants(
+    const sccl_device_t device, sccl_shader_t *cached, const char *name,
+    const uint32_t *constants, size_t constants_count, size_t buffers_count,
+    size_t push_constants_size, sccl_shader_t *shader)
+{
+    sccl_error_t error = sccl_success;
+    pthread_mutex_lock(&device->kernel_mutex);
+    if (*cached == SCCL_NULL) {
+        error = create_kernel_shader(device, name, constants, constants_count,
+                                     buffers_count, push_constants_size,
+                                     cached);
+    }
+    *shader = *cached;
+    pthread_mutex_unlock(&device->kernel_mutex);
+    return error;
+}
+
+sccl_error_t kernel_get_bindless_shader(const sccl_device_t device,
+                                        sccl_shader_t *cached, const char *name,
+                                        size_t push_constants_size,
+                                        sccl_shader_t *shader)
+{
+    sccl_error_t error = sccl_success;
+    pthread_mutex_lock(&device->kernel_mutex);
+    if (*cached == SCCL_NULL) {
+        error = create_bindless_kernel_shader(device, name,
+                                              push_constants_size, cached);
+    }
+    *shader = *cached;
+    pthread_mutex_unlock(&device->kernel_mutex);
+    return error;
+}
+
+void kernel_get_group_counts(uint32_t group_count, uint32_t *group_count_x,
+                             uint32_t *group_count_y)
+{
+    *group_count_x = group_count < KERNEL_MAX_GROUP_COUNT_X
+                         ? group_count
+                         : KERNEL_MAX_GROUP_COUNT_X;
+    *group_count_y = (group_count + *group_count_x - 1) / *group_count_x;
+}
+
+sccl_error_t kernel_run(const sccl_stream_t stream, const sccl_shader_t shader,
+                        const sccl_buffer_t *buffers, size_t buffers_count,
+                        const void *push_constants, uint32_t group_count_x,
+                        uint32_t group_count_y)
+{
+    if (buffers_count > KERNEL_MAX_BUFFERS) {
+        return sccl_invalid_argument;
+    }
+
+    sccl_shader_buffer_binding_t buffer_bindings[KERNEL_MAX_BUFFERS];
+    for (size_t i = 0; i < buffers_count; ++i) {
+        buffer_bindings[i].position.set = 0;
+        buffer_bindings[i].position.binding = (uint32_t)i;
+        buffer_bindings[i].buffer = buffers[i];
+    }
+    sccl_shader_push_constant_binding push_constant_binding = {
+        .index = 0, .data = (void *)push_constants};
+
+    sccl_shader_run_params_t params = {0};
+    params.group_count_x = group_count_x;
+    params.group_count_y = group_count_y;
+    params.group_count_z = 1;
+    params.buffer_bindings = buffer_bindings;
+    params.buffer_bindings_count = buffers_count;
+    params.push_constant_bindings = &push_constant_binding;
+    params.push_constant_bindings_count = 1;
+
+    return sccl_run_shader(stream, shader, &params);
+}
@@ -0,0 +1,60 @@
+#pragma once
+#ifndef KERNEL_HEADER
+#define KERNEL_HEADER
+
+#include "sccl.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/* largest x dimension of a dispatch every device supports */
+#define KERNEL_MAX_GROUP_COUNT_X 65535
+
+/**
+ * Get built-in kernel shader from `cached`, creating it on first use from
+ * kernel `name` of the shader bundle. Kernels take `constant` as
+ * specialization constant 0 (the operation of reducing kernels),
+ * `buffers_count` storage buffers at set 0, bindings 0 to `buffers_count - 1`
+ * and one push constant range of `push_constants_size` bytes.
+ */
+sccl_error_t kernel_get_shader(const sccl_device_t device,
+                               sccl_shader_t *cached, const char *name,
+                               uint32_t constant, size_t buffers_count,
+                               size_t push_constants_size,
+                               sccl_shader_t *shader);
+
+/**
+ * Same as `kernel_get_shader`, but with `constants_count` 32-bit
+ * specialization constants with ids 0 to `constants_count - 1`.
+ */
+sccl_error_t kernel_get_shader_with_constants(
+    const sccl_device_t device, sccl_shader_t *cached, const char *name,
+    const uint32_t *constants, size_t constants_count, size_t buffers_count,
+    size_t push_constants_size, sccl_shader_t *shader);
+
+/**
+ * Same as `kernel_get_shader`, but for a bindless kernel without
+ * specialization constants that accesses buffers through the device
+ * descriptor table.
+ */
+sccl_error_t kernel_get_bindless_shader(const sccl_device_t device,
+                                        sccl_shader_t *cached, const char *name,
+                                        size_t push_constants_size,
+                                        sccl_shader_t *shader);
+
+/**
+ * Split `group_count` workgroups over x and y. Kernels compute the linear
+ * workgroup index as `x + y * gl_NumWorkGroups.x` and exit if it's past the
+ * work, `group_count` must be at least 1.
+ */
+void kernel_get_group_counts(uint32_t group_count, uint32_t *group_count_x,
+                             uint32_t *group_count_y);
+
+/**
+ * Record run of built-in kernel with `buffers` bound in order.
+ */
+sccl_error_t kernel_run(const sccl_stream_t stream, const sccl_shader_t shader,
+                        const sccl_buffer_t *buffers, size_t buffers_count,
+                        const void *push_constants, uint32_t group_count_x,
+                        uint32_t group_count_y);
+
+#endif // KERNEL_HEADER
@@ -0,0 +1,622 @@
+#include "memory.h"
+#include "alloc.h"
+#include "buffer.h"
+#include "device.h"
+#include "error.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+static bool is_heap_device_local(const memory_manager_t *manager,
+                                 uint32_t heap_index)
+{
+    return manager->memory_properties.memoryHeaps[heap_index].flags &
+           VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+}
+
+typedef struct {
+    VkMemoryPropertyFlags required;
+    VkMemoryPropertyFlags preferred;
+    VkMemoryPropertyFlags avoided;
+    bool host_heap_only;
+} memory_class_requirements_t;
+
+/* memory types with these flags are never used */
+#define MEMORY_PROPERTY_UNSUPPORTED_FLAGS                                      \
+    (VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT |                                 \
+     VK_MEMORY_PROPERTY_PROTECTED_BIT |                                        \
+     VK_MEMORY_PROPERTY_DEVICE_COHERENT_BIT_AMD |                              \
+     VK_MEMORY_PROPERTY_DEVICE_UNCACHED_BIT_AMD)
+
+#define MEMORY_PROPERTY_HOST_FLAGS                                             \
+    (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+
+static memory_class_requirements_t
+get_class_requirements(memory_class_t memory_class, bool large_bar)
+{
+    memory_class_requirements_t requirements = {0};
+    switch (memory_class) {
+    case memory_class_device:
+        /* keep host visible device memory free for upload and shared buffers */
+        requirements.required = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        requirements.avoided = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                               VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+        break;
+    case memory_class_host:
+        requirements.required = MEMORY_PROPERTY_HOST_FLAGS;
+        requirements.avoided = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        break;
+    case memory_class_host_upload:
+        /* host writes are sequential, write combined device memory is fastest
+         * if the whole heap is visible */
+        requirements.required = MEMORY_PROPERTY_HOST_FLAGS;
+        requirements.preferred =
+            large_bar ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT : 0;
+        requirements.avoided = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+        break;
+    case memory_class_host_readback:
+        /* host reads from uncached memory are slow */
+        requirements.required = MEMORY_PROPERTY_HOST_FLAGS;
+        requirements.preferred = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+        requirements.avoided = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        break;
+    case memory_class_shared:
+        /* small BAR heaps are left to the heap size tie break, so larger host
+         * heaps win */
+        requirements.required = MEMORY_PROPERTY_HOST_FLAGS;
+        requirements.preferred =
+            large_bar ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT : 0;
+        break;
+    case memory_class_spill:
+        requirements.required = MEMORY_PROPERTY_HOST_FLAGS;
+        requirements.host_heap_only = true;
+        break;
+    default:
+        assert(false);
+        break;
+    }
+    return requirements;
+}
+
+static int count_bits(uint32_t bits)
+{
+    int count = 0;
+    for (; bits != 0; bits &= bits - 1) {
+        ++count;
+    }
+    return count;
+}
+
+/**
+ * Score memory type for class, higher is better. Returns false if the memory
+ * type can't be used.
+ */
+static bool score_memory_type(const memory_manager_t *manager,
+                              const memory_class_requirements_t *requirements,
+                              uint32_t memory_type_index, int *score)
+{
+    const VkMemoryType *memory_type =
+        &manager->memory_properties.memoryTypes[memory_type_index];
+    VkMemoryPropertyFlags flags = memory_type->propertyFlags;
+
+    if ((flags & requirements->required) != requirements->required ||
+        (flags & MEMORY_PROPERTY_UNSUPPORTED_FLAGS) != 0) {
+        return false;
+    }
+    if (requirements->host_heap_only &&
+        is_heap_device_local(manager, memory_type->heapIndex)) {
+        return false;
+    }
+
+    /* preferred and avoided flags weigh more than extra flags, extra flags
+     * make exact matches win ties */
+    VkMemoryPropertyFlags extra =
+        flags & ~(requirements->required | requirements->preferred);
+    *score = 4 * count_bits(flags & requirements->preferred) -
+             4 * count_bits(flags & requirements->avoided) -
+             count_bits(extra);
+    return true;
+}
+
+static VkDeviceSize get_heap_size(const memory_manager_t *manager,
+                                  uint32_t memory_type_index)
+{
+    uint32_t heap_index =
+        manager->memory_properties.memoryTypes[memory_type_index].heapIndex;
+    return manager->memory_properties.memoryHeaps[heap_index].size;
+}
+
+static bool detect_large_bar(const memory_manager_t *manager)
+{
+    const VkPhysicalDeviceMemoryProperties *mem_properties =
+        &manager->memory_properties;
+    for (uint32_t i = 0; i < mem_properties->memoryTypeCount; ++i) {
+        VkMemoryPropertyFlags flags =
+            mem_properties->memoryTypes[i].propertyFlags;
+        VkMemoryPropertyFlags bar_flags =
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | MEMORY_PROPERTY_HOST_FLAGS;
+        if ((flags & bar_flags) == bar_flags &&
+            (flags & MEMORY_PROPERTY_UNSUPPORTED_FLAGS) == 0 &&
+            get_heap_size(manager, i) > MEMORY_SMALL_BAR_HEAP_SIZE) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Rank usable memory types of class by score, ties are broken by heap size
+ * and then memory type index.
+ */
+static void rank_memory_types(memory_manager_t *manager,
+                              memory_class_t memory_class)
+{
+    memory_class_requirements_t requirements =
+        get_class_requirements(memory_class, manager->large_bar);
+    uint32_t *ranked = manager->ranked_memory_types[memory_class];
+    int scores[VK_MAX_MEMORY_TYPES];
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < manager->memory_properties.memoryTypeCount; ++i) {
+        int score;
+        if (!score_memory_type(manager, &requirements, i, &score)) {
+            continue;
+        }
+        /* insertion sort, there are at most 32 memory types */
+        uint32_t position = count;
+        while (position > 0 &&
+               (scores[position - 1] < score ||
+                (scores[position - 1] == score &&
+                 get_heap_size(manager, ranked[position - 1]) <
+                     get_heap_size(manager, i)))) {
+            scores[position] = scores[position - 1];
+            ranked[position] = ranked[position - 1];
+            --position;
+        }
+        scores[position] = score;
+        ranked[position] = i;
+        ++count;
+    }
+
+    manager->ranked_memory_types_count[memory_class] = count;
+}
+
+sccl_error_t memory_manager_init(VkPhysicalDevice physical_device,
+                                 memory_manager_t *manager)
+{
+    memset(manager, 0, sizeof(memory_manager_t));
+
+    CHECK_SCCL_ERROR_RET(
+        device_is_extension_supported(physical_device,
+                                      VK_EXT_MEMORY_BUDGET_EXTENSION_NAME,
+                                      &manager->budget_extension_supported));
+
+    vkGetPhysicalDeviceMemoryProperties(physical_device,
+                                        &manager->memory_properties);
+
+    manager->large_bar = detect_large_bar(manager);
+    for (int i = 0; i < memory_class_count; ++i) {
+        rank_memory_types(manager, (memory_class_t)i);
+    }
+
+    manager->overcommit_policy = sccl_memory_overcommit_policy_fail;
+    manager->budget = SIZE_MAX;
+    manager->next_bindless_ticket = 1;
+
+    CHECK_SCCL_ERROR_RET(
+        vector_init(&manager->bindless_tickets, sizeof(uint64_t)));
+    return vector_init(&manager->buffers, sizeof(sccl_buffer_t));
+}
+
+void memory_manager_destroy(memory_manager_t *manager)
+{
+    vector_destroy(&manager->buffers);
+    vector_destroy(&manager->bindless_tickets);
+}
+
+/**
+ * Get bytes the driver reports as still available in heap for this process.
+ * Returns SIZE_MAX if `VK_EXT_memory_budget` is not supported.
+ */
+static size_t query_heap_available(sccl_device_t device, uint32_t heap_index)
+{
+    if (!device->memory_manager.budget_extension_supported) {
+        return SIZE_MAX;
+    }
+
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties = {0};
+    budget_properties.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    VkPhysicalDeviceMemoryProperties2 memory_properties = {0};
+    memory_properties.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    memory_properties.pNext = &budget_properties;
+    vkGetPhysicalDeviceMemoryProperties2(device->physical_device,
+                                         &memory_properties);
+
+    VkDeviceSize budget = budget_properties.heapBudget[heap_index];
+    VkDeviceSize usage = budget_properties.heapUsage[heap_index];
+    return usage < budget ? budget - usage : 0;
+}
+
+static bool fits_budget(sccl_device_t device, uint32_t heap_index,
+                        VkDeviceSize size)
+{
+    const memory_manager_t *manager = &device->memory_manager;
+    if (size > manager->budget || manager->usage > manager->budget - size) {
+        return false;
+    }
+    return size <= query_heap_available(device, heap_index);
+}
+
+static bool is_evictable(const sccl_buffer_t buffer)
+{
+    switch (buffer->type) {
+    case sccl_buffer_type_device_storage:
+    case sccl_buffer_type_device_uniform:
+        break;
+    default:
+        /* other buffer types can be host mapped */
+        return false;
+    }
+    return buffer->device_local && !buffer->spilled &&
+           !buffer->destroy_pending && buffer->pending_use_count == 0;
+}
+
+/**
+ * Release pooled buffers, or spill least recently used idle buffer to host
+ * memory.
+ * Returns `sccl_out_of_resources_error` if there is nothing to evict.
+ */
+static sccl_error_t evict_buffer_locked(sccl_device_t device,
+                                        const sccl_buffer_t keep)
+{
+    memory_manager_t *manager = &device->memory_manager;
+
+    /* release idle pooled buffers before spilling buffers that are in use */
+    if (device->memory_pool.size > 0) {
+        memory_pool_trim_locked(&device->memory_pool, 0);
+        return sccl_success;
+    }
+
+    if (memory_bindless_pending_locked(manager)) {
+        return sccl_out_of_resources_error;
+    }
+
+    sccl_buffer_t victim = SCCL_NULL;
+    for (size_t i = 0; i < vector_get_size(&manager->buffers); ++i) {
+        sccl_buffer_t buffer =
+            *(sccl_buffer_t *)vector_get_element(&manager->buffers, i);
+        if (buffer == keep || !is_evictable(buffer)) {
+            continue;
+        }
+        if (victim == SCCL_NULL || buffer->last_use < victim->last_use) {
+            victim = buffer;
+        }
+    }
+    if (victim == SCCL_NULL) {
+        return sccl_out_of_resources_error;
+    }
+
+    return buffer_spill_locked(victim);
+}
+
+/**
+ * Allocate from a single memory type, evicting buffers if `allow_eviction` is
+ * set.
+ */
+static sccl_error_t allocate_memory_type_locked(
+    sccl_device_t device, const VkMemoryRequirements *requirements,
+    uint32_t memory_type_index, const sccl_buffer_t keep, bool allow_eviction,
+    VkDeviceMemory *memory, bool *device_local)
+{
+    memory_manager_t *manager = &device->memory_manager;
+
+    uint32_t heap_index =
+        manager->memory_properties.memoryTypes[memory_type_index].heapIndex;
+    *device_local = is_heap_device_local(manager, heap_index);
+
+    if (*device_local) {
+        while (!fits_budget(device, heap_index, requirements->size)) {
+            if (!allow_eviction) {
+                return sccl_out_of_resources_error;
+            }
+            CHECK_SCCL_ERROR_RET(evict_buffer_locked(device, keep));
+        }
+    }
+
+    VkMemoryAllocateInfo alloc_info = {0};
+    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc_info.allocationSize = requirements->size;
+    alloc_info.memoryTypeIndex = memory_type_index;
+
+    /* driver can still run out of memory, budget might not be supported or
+     * other processes allocate memory */
+    while (true) {
+        VkResult res =
+            vkAllocateMemory(device->device, &alloc_info, NULL, memory);
+        if (res == VK_SUCCESS) {
+            break;
+        }
+        if (res == VK_ERROR_OUT_OF_DEVICE_MEMORY && *device_local &&
+            allow_eviction) {
+            CHECK_SCCL_ERROR_RET(evict_buffer_locked(device, keep));
+            continue;
+        }
+        if (res == VK_ERROR_OUT_OF_DEVICE_MEMORY ||
+            res == VK_ERROR_OUT_OF_HOST_MEMORY) {
+            return sccl_out_of_resources_error;
+        }
+        return sccl_unhandled_vulkan_error;
+    }
+
+    if (*device_local) {
+        manager->usage += requirements->size;
+    }
+
+    return sccl_success;
+}
+
+sccl_error_t memory_allocate_locked(sccl_device_t device,
+                                    const VkMemoryRequirements *requirements,
+                                    memory_class_t memory_class,
+                                    const sccl_buffer_t keep,
+                                    VkDeviceMemory *memory,
+                                    uint32_t *memory_type_index,
+                                    bool *device_local)
+{
+    const memory_manager_t *manager = &device->memory_manager;
+    const uint32_t *ranked = manager->ranked_memory_types[memory_class];
+    uint32_t ranked_count = manager->ranked_memory_types_count[memory_class];
+
+    /* try every allowed memory type without evicting */
+    bool found = false;
+    for (uint32_t i = 0; i < ranked_count; ++i) {
+        if (!(requirements->memoryTypeBits & (1u << ranked[i]))) {
+            continue;
+        }
+        if (!found) {
+            *memory_type_index = ranked[i];
+            found = true;
+        }
+        sccl_error_t error = allocate_memory_type_locked(
+            device, requirements, ranked[i], keep, false, memory,
+            device_local);
+        if (error != sccl_out_of_resources_error) {
+            if (error == sccl_success) {
+                *memory_type_index = ranked[i];
+            }
+            return error;
+        }
+    }
+
+    if (!found) {
+        /* host memory is device memory, nothing to gain from spilling */
+        return memory_class == memory_class_spill ? sccl_out_of_resources_error
+                                                  : sccl_unsupported_error;
+    }
+
+    /* make room in best memory type */
+    if (memory_class == memory_class_spill ||
+        manager->overcommit_policy != sccl_memory_overcommit_policy_spill) {
+        return sccl_out_of_resources_error;
+    }
+    return allocate_memory_type_locked(device, requirements, *memory_type_index,
+                                       keep, true, memory, device_local);
+}
+
+void memory_free_locked(sccl_device_t device, VkDeviceMemory memory,
+                        VkDeviceSize size, bool device_local)
+{
+    vkFreeMemory(device->device, memory, NULL);
+    if (device_local) {
+        assert(device->memory_manager.usage >= size);
+        device->memory_manager.usage -= size;
+    }
+}
+
+sccl_error_t memory_add_buffer_locked(sccl_device_t device,
+                                      sccl_buffer_t buffer)
+{
+    memory_manager_t *manager = &device->memory_manager;
+    buffer->memory_manager_index = vector_get_size(&manager->buffers);
+    CHECK_SCCL_ERROR_RET(vector_add_element(&manager->buffers, &buffer));
+    memory_touch_buffer_locked(device, buffer);
+    return sccl_success;
+}
+
+void memory_remove_buffer_locked(sccl_device_t device, sccl_buffer_t buffer)
+{
+    memory_manager_t *manager = &device->memory_manager;
+    size_t index = buffer->memory_manager_index;
+    assert(*(sccl_buffer_t *)vector_get_element(&manager->buffers, index) ==
+           buffer);
+    vector_swap_remove_element(&manager->buffers, index);
+    /* fix index of buffer moved into the removed slot */
+    if (index < vector_get_size(&manager->buffers)) {
+        sccl_buffer_t moved =
+            *(sccl_buffer_t *)vector_get_element(&manager->buffers, index);
+        moved->memory_manager_index = index;
+    }
+}
+
+sccl_error_t memory_begin_bindless_locked(sccl_device_t device,
+                                          uint64_t *ticket)
+{
+    memory_manager_t *manager = &device->memory_manager;
+    *ticket = manager->next_bindless_ticket;
+    CHECK_SCCL_ERROR_RET(
+        vector_add_element(&manager->bindless_tickets, ticket));
+    ++manager->next_bindless_ticket;
+    return sccl_success;
+}
+
+void memory_end_bindless_locked(sccl_device_t device, uint64_t ticket)
+{
+    memory_manager_t *manager = &device->memory_manager;
+    for (size_t i = 0; i < vector_get_size(&manager->bindless_tickets); ++i) {
+        if (*(uint64_t *)vector_get_element(&manager->bindless_tickets, i) ==
+            ticket) {
+            vector_swap_remove_element(&manager->bindless_tickets, i);
+            return;
+        }
+    }
+    assert(false);
+}
+
+bool memory_bindless_pending_locked(const memory_manager_t *manager)
+{
+    return vector_get_size(&manager->bindless_tickets) > 0;
+}
+
+bool memory_bindless_retired_locked(const memory_manager_t *manager,
+                                    uint64_t ticket)
+{
+    for (size_t i = 0; i < vector_get_size(&manager->bindless_tickets); ++i) {
+        if (*(uint64_t *)vector_get_element(&manager->bindless_tickets, i) <
+            ticket) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void memory_touch_buffer_locked(sccl_device_t device, sccl_buffer_t buffer)
+{
+    buffer->last_use = ++device->memory_manager.use_tick;
+}
+
+sccl_error_t
+sccl_set_device_memory_budget(const sccl_device_t device, size_t budget,
+                              sccl_memory_overcommit_policy_t policy)
+{
+    switch (policy) {
+    case sccl_memory_overcommit_policy_fail:
+    case sccl_memory_overcommit_policy_spill:
+        break;
+    default:
+        return sccl_invalid_argument;
+    }
+
+    pthread_mutex_lock(&device->mutex);
+    device->memory_manager.budget = budget;
+    device->memory_manager.overcommit_policy = policy;
+    pthread_mutex_unlock(&device->mutex);
+
+    return sccl_success;
+}
+
+sccl_error_t sccl_get_device_memory_usage(const sccl_device_t device,
+                                          size_t *usage, size_t *budget)
+{
+    pthread_mutex_lock(&device->mutex);
+
+    const memory_manager_t *manager = &device->memory_manager;
+    *usage = manager->usage;
+
+    /* remaining budget is limited by both user budget and driver budget */
+    size_t available = manager->budget > manager->usage
+                           ? manager->budget - manager->usage
+                           : 0;
+    if (manager->budget_extension_supported) {
+        size_t heaps_available = 0;
+        for (uint32_t i = 0; i < manager->memory_properties.memoryHeapCount;
+             ++i) {
+            if (is_heap_device_local(manager, i)) {
+                heaps_available += query_heap_available(device, i);
+            }
+        }
+        if (heaps_available < available) {
+            available = heaps_available;
+        }
+    }
+    *budget = available > SIZE_MAX - *usage ? SIZE_MAX : *usage + available;
+
+    pthread_mutex_unlock(&device->mutex);
+
+    return sccl_success;
+}
+
+sccl_error_t memory_get_class(sccl_buffer_type_t type,
+                              sccl_memory_usage_t usage,
+                              memory_class_t *memory_class)
+{
+    switch (type) {
+    case sccl_buffer_type_device_storage:
+    case sccl_buffer_type_device_uniform:
+        if (usage != sccl_memory_usage_default &&
+            usage != sccl_memory_usage_device_only) {
+            return sccl_invalid_argument;
+        }
+        *memory_class = memory_class_device;
+        return sccl_success;
+    case sccl_buffer_type_host_storage:
+    case sccl_buffer_type_host_uniform:
+        switch (usage) {
+        case sccl_memory_usage_default:
+            *memory_class = memory_class_host;
+            return sccl_success;
+        case sccl_memory_usage_upload:
+            *memory_class = memory_class_host_upload;
+            return sccl_success;
+        case sccl_memory_usage_readback:
+            *memory_class = memory_class_host_readback;
+            return sccl_success;
+        default:
+            return sccl_invalid_argument;
+        }
+    case sccl_buffer_type_shared_storage:
+    case sccl_buffer_type_shared_uniform:
+        switch (usage) {
+        case sccl_memory_usage_default:
+        case sccl_memory_usage_upload:
+            *memory_class = memory_class_shared;
+            return sccl_success;
+        case sccl_memory_usage_readback:
+            *memory_class = memory_class_host_readback;
+            return sccl_success;
+        default:
+            return sccl_invalid_argument;
+        }
+    default:
+        return sccl_invalid_argument;
+    }
+}
+
+void memory_get_type_info(const memory_manager_t *manager,
+                          uint32_t memory_type_index,
+                          sccl_memory_type_info_t *info)
+{
+    const VkMemoryType *memory_type =
+        &manager->memory_properties.memoryTypes[memory_type_index];
+    memset(info, 0, sizeof(sccl_memory_type_info_t));
+    info->memory_type_index = memory_type_index;
+    info->heap_index = memory_type->heapIndex;
+    info->heap_size = get_heap_size(manager, memory_type_index);
+    info->device_local = is_heap_device_local(manager, memory_type->heapIndex);
+    info->host_visible =
+        memory_type->propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    info->host_cached =
+        memory_type->propertyFlags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    info->large_bar = manager->large_bar;
+}
+
+sccl_error_t sccl_get_device_memory_type_info(const sccl_device_t device,
+                                              sccl_buffer_type_t type,
+                                              sccl_memory_usage_t usage,
+                                              sccl_memory_type_info_t *info)
+{
+    memory_class_t memory_class;
+    CHECK_SCCL_ERROR_RET(memory_get_class(type, usage, &memory_class));
+
+    /* ranking is immutable after device creation, no need to lock */
+    const memory_manager_t *manager = &device->memory_manager;
+    if (manager->ranked_memory_types_count[memory_class] == 0) {
+        return sccl_unsupported_error;
+    }
+    memory_get_type_info(manager, manager->ranked_memory_types[memory_class][0],
+                         info);
+
+    return sccl_success;
+}
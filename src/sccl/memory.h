@@ -0,0 +1,131 @@
+#pragma once
+#ifndef MEMORY_HEADER
+#define MEMORY_HEADER
+
+#include "sccl.h"
+#include "vector.h"
+#include <stdbool.h>
+#include <vulkan/vulkan.h>
+
+/**
+ * Tracks device local memory allocated by a device and enforces the memory
+ * budget. When the budget is exceeded and the overcommit policy is
+ * `sccl_memory_overcommit_policy_spill`, the least recently used idle device
+ * buffers are moved to host memory. Spilled buffers are moved back when they
+ * are recorded in a stream again.
+ *
+ * All functions with `_locked` suffix expect the device mutex to be held.
+ */
+/* BAR heaps without resizable BAR are 256 MiB */
+#define MEMORY_SMALL_BAR_HEAP_SIZE (256 * 1024 * 1024)
+
+/**
+ * What buffer memory is used for, each class has its own ranking of memory
+ * types.
+ */
+typedef enum {
+    memory_class_device = 0,
+    memory_class_host = 1,
+    memory_class_host_upload = 2,
+    memory_class_host_readback = 3,
+    memory_class_shared = 4,
+    /* host memory for spilled buffers, never in a device local heap */
+    memory_class_spill = 5,
+    memory_class_count = 6
+} memory_class_t;
+
+typedef struct {
+    bool budget_extension_supported;
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    /* true if a device local memory type is host visible and larger than the
+     * 256 MiB BAR window */
+    bool large_bar;
+    /* memory type indices for each class, best first, computed when device is
+     * created */
+    uint32_t ranked_memory_types[memory_class_count][VK_MAX_MEMORY_TYPES];
+    uint32_t ranked_memory_types_count[memory_class_count];
+    sccl_memory_overcommit_policy_t overcommit_policy;
+    /* user set budget for device local allocations */
+    size_t budget;
+    /* bytes currently allocated from device local heaps */
+    size_t usage;
+    /* incremented every time a buffer is recorded, used for LRU eviction */
+    uint64_t use_tick;
+    /* every buffer on the device, buffers store their own index */
+    vector_t buffers;
+    /* tickets of streams with recorded bindless work that is not joined yet,
+     * buffers can't be evicted while there are any since bindless shaders may
+     * access any buffer */
+    vector_t bindless_tickets;
+    uint64_t next_bindless_ticket;
+    /* number of buffers with `destroy_pending` set */
+    size_t deferred_buffers_count;
+} memory_manager_t;
+
+sccl_error_t memory_manager_init(VkPhysicalDevice physical_device,
+                                 memory_manager_t *manager);
+
+void memory_manager_destroy(memory_manager_t *manager);
+
+/**
+ * Get memory class of buffer type with usage intent.
+ */
+sccl_error_t memory_get_class(sccl_buffer_type_t type,
+                              sccl_memory_usage_t usage,
+                              memory_class_t *memory_class);
+
+void memory_get_type_info(const memory_manager_t *manager,
+                          uint32_t memory_type_index,
+                          sccl_memory_type_info_t *info);
+
+/**
+ * Allocate memory for buffer requirements from best ranked memory type of
+ * `memory_class` allowed by the requirements. If the best memory type is out of
+ * memory the next type in the ranking is tried, before falling back to
+ * evicting buffers from the best type.
+ * Device local allocations are checked against the budget, buffer `keep` is
+ * never evicted to make room (can be SCCL_NULL). Nothing is evicted for
+ * `memory_class_spill`.
+ */
+sccl_error_t memory_allocate_locked(sccl_device_t device,
+                                    const VkMemoryRequirements *requirements,
+                                    memory_class_t memory_class,
+                                    const sccl_buffer_t keep,
+                                    VkDeviceMemory *memory,
+                                    uint32_t *memory_type_index,
+                                    bool *device_local);
+
+void memory_free_locked(sccl_device_t device, VkDeviceMemory memory,
+                        VkDeviceSize size, bool device_local);
+
+sccl_error_t memory_add_buffer_locked(sccl_device_t device,
+                                      sccl_buffer_t buffer);
+
+void memory_remove_buffer_locked(sccl_device_t device, sccl_buffer_t buffer);
+
+/**
+ * Register bindless work recorded in a stream, returns ticket to pass to
+ * `memory_end_bindless_locked` when the stream is joined.
+ */
+sccl_error_t memory_begin_bindless_locked(sccl_device_t device,
+                                          uint64_t *ticket);
+
+void memory_end_bindless_locked(sccl_device_t device, uint64_t ticket);
+
+/**
+ * True if there is bindless work that is not joined yet.
+ */
+bool memory_bindless_pending_locked(const memory_manager_t *manager);
+
+/**
+ * True if all bindless work registered before `ticket` was issued is joined.
+ */
+bool memory_bindless_retired_locked(const memory_manager_t *manager,
+                                    uint64_t ticket);
+
+/**
+ * Mark buffer as most recently used.
+ */
+void memory_touch_buffer_locked(sccl_device_t device, sccl_buffer_t buffer);
+
+#endif // MEMORY_HEADER
@@ -0,0 +1,92 @@
+#include "memory_pool.h"
+#include "buffer.h"
+#include "device.h"
+#include "error.h"
+
+#include <pthread.h>
+
+sccl_error_t memory_pool_init(memory_pool_t *pool)
+{
+    pool->size = 0;
+    pool->release_threshold = 0;
+    return vector_init(&pool->buffers, sizeof(sccl_buffer_t));
+}
+
+void memory_pool_destroy_locked(memory_pool_t *pool)
+{
+    memory_pool_trim_locked(pool, 0);
+    vector_destroy(&pool->buffers);
+}
+
+sccl_buffer_t memory_pool_find_buffer(const vector_t *buffers,
+                                      sccl_buffer_type_t type,
+                                      memory_class_t memory_class,
+                                      size_t size, size_t *index)
+{
+    /* best fit */
+    sccl_buffer_t found = SCCL_NULL;
+    for (size_t i = 0; i < vector_get_size(buffers); ++i) {
+        sccl_buffer_t buffer = *(sccl_buffer_t *)vector_get_element(buffers, i);
+        if (buffer->type != type || buffer->memory_class != memory_class ||
+            buffer->size < size || buffer->size / 2 > size) {
+            continue;
+        }
+        if (found == SCCL_NULL || buffer->size < found->size) {
+            found = buffer;
+            *index = i;
+        }
+    }
+    return found;
+}
+
+void memory_pool_take_buffer_locked(memory_pool_t *pool,
+                                    sccl_buffer_type_t type,
+                                    memory_class_t memory_class, size_t size,
+                                    sccl_buffer_t *buffer)
+{
+    size_t index;
+    *buffer = memory_pool_find_buffer(&pool->buffers, type, memory_class, size,
+                                      &index);
+    if (*buffer != SCCL_NULL) {
+        vector_swap_remove_element(&pool->buffers, index);
+        pool->size -= (*buffer)->size;
+    }
+}
+
+sccl_error_t memory_pool_add_buffer_locked(memory_pool_t *pool,
+                                           sccl_buffer_t buffer)
+{
+    CHECK_SCCL_ERROR_RET(vector_add_element(&pool->buffers, &buffer));
+    pool->size += buffer->size;
+    return sccl_success;
+}
+
+void memory_pool_trim_locked(memory_pool_t *pool, size_t min_bytes_to_keep)
+{
+    while (pool->size > min_bytes_to_keep) {
+        assert(vector_get_size(&pool->buffers) > 0);
+        sccl_buffer_t buffer =
+            *(sccl_buffer_t *)vector_get_element(&pool->buffers, 0);
+        vector_swap_remove_element(&pool->buffers, 0);
+        pool->size -= buffer->size;
+        buffer_destroy_locked(buffer);
+    }
+}
+
+sccl_error_t
+sccl_set_device_memory_pool_release_threshold(const sccl_device_t device,
+                                              size_t threshold)
+{
+    pthread_mutex_lock(&device->mutex);
+    device->memory_pool.release_threshold = threshold;
+    pthread_mutex_unlock(&device->mutex);
+    return sccl_success;
+}
+
+void sccl_trim_device_memory_pool(const sccl_device_t device,
+                                  size_t min_bytes_to_keep)
+{
+    pthread_mutex_lock(&device->mutex);
+    memory_pool_trim_locked(&device->memory_pool, min_bytes_to_keep);
+    pthread_mutex_unlock(&device->mutex);
+}
@@ -0,0 +1,57 @@
+#pragma once
+#ifndef MEMORY_POOL_HEADER
+#define MEMORY_POOL_HEADER
+
+#include "memory.h"
+#include "sccl.h"
+#include "vector.h"
+
+/**
+ * Idle buffers freed with `sccl_free_async` whose stream is joined, they can
+ * be reused by allocations on any stream.
+ *
+ * All functions with `_locked` suffix expect the device mutex to be held.
+ */
+typedef struct {
+    vector_t buffers;
+    /* bytes held by buffers in pool */
+    size_t size;
+    /* pool is trimmed down to this many bytes when a stream is joined */
+    size_t release_threshold;
+} memory_pool_t;
+
+sccl_error_t memory_pool_init(memory_pool_t *pool);
+
+/**
+ * Destroy pool and all buffers in it.
+ */
+void memory_pool_destroy_locked(memory_pool_t *pool);
+
+/**
+ * Find buffer that can be reused for allocation, buffers are at most twice as
+ * large as requested.
+ * Returns `SCCL_NULL` if there is none.
+ */
+sccl_buffer_t memory_pool_find_buffer(const vector_t *buffers,
+                                      sccl_buffer_type_t type,
+                                      memory_class_t memory_class,
+                                      size_t size, size_t *index);
+
+/**
+ * Take buffer matching allocation out of pool, `*buffer` is `SCCL_NULL` if
+ * there is none.
+ */
+void memory_pool_take_buffer_locked(memory_pool_t *pool,
+                                    sccl_buffer_type_t type,
+                                    memory_class_t memory_class, size_t size,
+                                    sccl_buffer_t *buffer);
+
+sccl_error_t memory_pool_add_buffer_locked(memory_pool_t *pool,
+                                           sccl_buffer_t buffer);
+
+/**
+ * Destroy buffers in pool until it holds at most `min_bytes_to_keep` bytes.
+ */
+void memory_pool_trim_locked(memory_pool_t *pool, size_t min_bytes_to_keep);
+
+#endif // MEMORY_POOL_HEADER
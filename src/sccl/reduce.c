@@ -0,0 +1,251 @@
+#include "reduce.h"
+#include "buffer.h"
+#include "device.h"
+#include "error.h"
+#include "kernel.h"
+#include "sccl.h"
+#include "stream.h"
+
+#include <string.h>
+
+/* shader bundle names, indexed by `reduce_variant_t` */
+static const char *const reduce_variant_names[] = {
+    "reduce_int32",
+    "reduce_uint32",
+    "reduce_float32",
+    "reduce_int64",
+    "reduce_float16",
+    "reduce_float16_in",
+    "reduce_float16_out",
+};
+
+/* shader bundle names, indexed by `sccl_dtype_t` */
+static const char *const combine_names[] = {
+    "combine_int32",
+    "combine_uint32",
+    "combine_float32",
+    "combine_float16",
+    "combine_int64",
+};
+
+void reduce_kernels_init(VkPhysicalDevice physical_device,
+                         const VkPhysicalDeviceVulkan11Features *features_11,
+                         const VkPhysicalDeviceVulkan12Features *features_12,
+                         reduce_kernels_t *kernels)
+{
+    memset(kernels, 0, sizeof(reduce_kernels_t));
+
+    VkPhysicalDeviceSubgroupProperties subgroup_properties = {0};
+    subgroup_properties.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties = {0};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &subgroup_properties;
+    vkGetPhysicalDeviceProperties2(physical_device, &properties);
+
+    VkSubgroupFeatureFlags required_operations =
+        VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_ARITHMETIC_BIT;
+    kernels->supported =
+        (subgroup_properties.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) &&
+        (subgroup_properties.supportedOperations & required_operations) ==
+            required_operations;
+    kernels->float16_supported = features_11->storageBuffer16BitAccess;
+    kernels->int64_supported =
+        kernels->supported && features_12->shaderSubgroupExtendedTypes;
+}
+
+void reduce_kernels_enable_features(
+    const reduce_kernels_t *kernels,
+    VkPhysicalDeviceVulkan11Features *features_11,
+    VkPhysicalDeviceVulkan12Features *features_12)
+{
+    if (kernels->float16_supported) {
+        features_11->storageBuffer16BitAccess = true;
+    }
+    if (kernels->int64_supported) {
+        features_12->shaderSubgroupExtendedTypes = true;
+    }
+}
+
+void reduce_kernels_destroy(reduce_kernels_t *kernels)
+{
+    for (size_t i = 0; i < reduce_variant_count; ++i) {
+        for (size_t j = 0; j < REDUCE_OP_COUNT; ++j) {
+            if (kernels->shaders[i][j] != SCCL_NULL) {
+                sccl_destroy_shader(kernels->shaders[i][j]);
+                kernels->shaders[i][j] = SCCL_NULL;
+            }
+        }
+    }
+    for (size_t i = 0; i < REDUCE_DTYPE_COUNT; ++i) {
+        for (size_t j = 0; j < REDUCE_OP_COUNT; ++j) {
+            if (kernels->combine_shaders[i][j] != SCCL_NULL) {
+                sccl_destroy_shader(kernels->combine_shaders[i][j]);
+                kernels->combine_shaders[i][j] = SCCL_NULL;
+            }
+        }
+    }
+}
+
+size_t reduce_dtype_size(sccl_dtype_t dtype)
+{
+    switch (dtype) {
+    case sccl_dtype_int32:
+    case sccl_dtype_uint32:
+    case sccl_dtype_float32:
+        return 4;
+    case sccl_dtype_float16:
+        return 2;
+    case sccl_dtype_int64:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Get variant of pass, `first` if pass reads `src` and `last` if pass writes
+ * `dst`. Partial results of float16 are kept in float32.
+ */
+static reduce_variant_t select_variant(sccl_dtype_t dtype, bool first,
+                                       bool last)
+{
+    switch (dtype) {
+    case sccl_dtype_int32:
+        return reduce_variant_int32;
+    case sccl_dtype_uint32:
+        return reduce_variant_uint32;
+    case sccl_dtype_int64:
+        return reduce_variant_int64;
+    case sccl_dtype_float16:
+        if (first && last) {
+            return reduce_variant_float16;
+        }
+        return first ? reduce_variant_float16_in : reduce_variant_float16_out;
+    case sccl_dtype_float32:
+    default:
+        return reduce_variant_float32;
+    }
+}
+
+bool reduce_is_dtype_supported(const reduce_kernels_t *kernels,
+                               sccl_dtype_t dtype)
+{
+    if (!kernels->supported) {
+        return false;
+    }
+    switch (dtype) {
+    case sccl_dtype_float16:
+        return kernels->float16_supported;
+    case sccl_dtype_int64:
+        return kernels->int64_supported;
+    default:
+        return true;
+    }
+}
+
+bool reduce_is_combine_supported(const reduce_kernels_t *kernels,
+                                 sccl_dtype_t dtype)
+{
+    /* 64-bit integers are always enabled */
+    return dtype != sccl_dtype_float16 || kernels->float16_supported;
+}
+
+static uint32_t get_group_count(size_t count)
+{
+    size_t items_per_group =
+        REDUCE_WORKGROUP_SIZE * REDUCE_ITEMS_PER_INVOCATION;
+    size_t group_count = (count + items_per_group - 1) / items_per_group;
+    if (group_count == 0) {
+        return 1;
+    }
+    if (group_count > REDUCE_MAX_GROUP_COUNT) {
+        return REDUCE_MAX_GROUP_COUNT;
+    }
+    return (uint32_t)group_count;
+}
+
+static sccl_error_t run_pass(const sccl_stream_t stream, sccl_dtype_t dtype,
+                             sccl_reduce_op_t op, bool first, bool last,
+                             const sccl_buffer_t src, const sccl_buffer_t dst,
+                             uint32_t count, uint32_t group_count)
+{
+    sccl_device_t device = stream->device;
+    reduce_variant_t variant = select_variant(dtype, first, last);
+    sccl_shader_t shader;
+    CHECK_SCCL_ERROR_RET(kernel_get_shader(
+        device, &device->reduce_kernels.shaders[variant][op],
+        reduce_variant_names[variant], op, 2, sizeof(uint32_t), &shader));
+
+    sccl_buffer_t buffers[] = {src, dst};
+    return kernel_run(stream, shader, buffers, 2, &count, group_count, 1);
+}
+
+sccl_error_t sccl_reduce(const sccl_stream_t stream, const sccl_buffer_t src,
+                         const sccl_buffer_t dst, size_t count,
+                         sccl_dtype_t dtype, sccl_reduce_op_t op)
+{
+    CHECK_SCCL_NULL_RET(stream);
+    CHECK_SCCL_NULL_RET(src);
+    CHECK_SCCL_NULL_RET(dst);
+    size_t element_size = reduce_dtype_size(dtype);
+    if (element_size == 0 || (uint32_t)op >= REDUCE_OP_COUNT) {
+        return sccl_invalid_argument;
+    }
+    if (count > UINT32_MAX || !buffer_is_storage(src) ||
+        !buffer_is_storage(dst) || src->size < count * element_size ||
+        dst->size < element_size) {
+        return sccl_invalid_argument;
+    }
+    if (!reduce_is_dtype_supported(&stream->device->reduce_kernels, dtype)) {
+        return sccl_unsupported_error;
+    }
+
+    uint32_t group_count = get_group_count(count);
+    if (group_count == 1) {
+        return run_pass(stream, dtype, op, true, true, src, dst,
+                        (uint32_t)count, 1);
+    }
+
+    /* one partial result per workgroup, float16 partials are float32 */
+    size_t partial_size =
+        dtype == sccl_dtype_float16 ? sizeof(float) : element_size;
+    sccl_buffer_t partials;
+    CHECK_SCCL_ERROR_RET(sccl_alloc_async(stream, &partials,
+                                          sccl_buffer_type_device_storage,
+                                          group_count * partial_size));
+
+    CHECK_SCCL_ERROR_RET(run_pass(stream, dtype, op, true, false, src,
+                                  partials, (uint32_t)count, group_count));
+    /* `REDUCE_MAX_GROUP_COUNT` partials always fit in one workgroup */
+    CHECK_SCCL_ERROR_RET(run_pass(stream, dtype, op, false, true, partials,
+                                  dst, group_count, 1));
+
+    return sccl_free_async(stream, partials);
+}
+
+sccl_error_t reduce_record_combine(const sccl_stream_t stream,
+                                   const sccl_buffer_t src, size_t src_offset,
+                                   const sccl_buffer_t dst, size_t dst_offset,
+                                   size_t count, sccl_dtype_t dtype,
+                                   sccl_reduce_op_t op)
+{
+    sccl_device_t device = stream->device;
+    sccl_shader_t shader;
+    CHECK_SCCL_ERROR_RET(kernel_get_shader(
+        device, &device->reduce_kernels.combine_shaders[dtype][op],
+        combine_names[dtype], op, 2, 3 * sizeof(uint32_t), &shader));
+
+    sccl_buffer_t buffers[] = {src, dst};
+    uint32_t push_constants[3] = {(uint32_t)count, (uint32_t)src_offset,
+                                  (uint32_t)dst_offset};
+
+    size_t group_count =
+        (count + COMBINE_WORKGROUP_SIZE - 1) / COMBINE_WORKGROUP_SIZE;
+    if (group_count > COMBINE_MAX_GROUP_COUNT) {
+        group_count = COMBINE_MAX_GROUP_COUNT;
+    }
+
+    return kernel_run(stream, shader, buffers, 2, push_constants,
+                      group_count > 0 ? (uint32_t)group_count : 1, 1);
+}
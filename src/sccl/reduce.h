@@ -0,0 +1,104 @@
+#pragma once
+#ifndef REDUCE_HEADER
+#define REDUCE_HEADER
+
+#include "sccl.h"
+#include <stdbool.h>
+#include <vulkan/vulkan.h>
+
+/* must match `WORKGROUP_SIZE` in shaders/reduce.comp */
+#define REDUCE_WORKGROUP_SIZE 256
+/* elements each invocation accumulates before the workgroup reduction, only
+ * used to pick the number of workgroups */
+#define REDUCE_ITEMS_PER_INVOCATION 8
+/* upper bound on workgroups in the first pass, the partial results then fit
+ * in a single workgroup so there are never more than two passes */
+#define REDUCE_MAX_GROUP_COUNT                                                 \
+    (REDUCE_WORKGROUP_SIZE * REDUCE_ITEMS_PER_INVOCATION)
+#define REDUCE_OP_COUNT 4
+#define REDUCE_DTYPE_COUNT 5
+/* must match `WORKGROUP_SIZE` in shaders/combine.comp */
+#define COMBINE_WORKGROUP_SIZE 256
+#define COMBINE_MAX_GROUP_COUNT 65535
+
+/* element types the reduce kernel is compiled for, see shaders/reduce.comp */
+typedef enum {
+    reduce_variant_int32 = 0,
+    reduce_variant_uint32 = 1,
+    reduce_variant_float32 = 2,
+    reduce_variant_int64 = 3,
+    reduce_variant_float16 = 4,
+    reduce_variant_float16_in = 5,
+    reduce_variant_float16_out = 6,
+    reduce_variant_count = 7
+} reduce_variant_t;
+
+/**
+ * Built-in reduction kernels of a device.
+ * Shaders are created the first time a variant and operation is used.
+ */
+typedef struct {
+    /* subgroup arithmetic is supported in compute shaders */
+    bool supported;
+    /* 16-bit storage buffer access is supported */
+    bool float16_supported;
+    /* 64-bit subgroup arithmetic is supported */
+    bool int64_supported;
+    sccl_shader_t shaders[reduce_variant_count][REDUCE_OP_COUNT];
+    /* elementwise combine kernels (shaders/combine.comp), indexed by
+     * `sccl_dtype_t`, these don't use subgroup operations */
+    sccl_shader_t combine_shaders[REDUCE_DTYPE_COUNT][REDUCE_OP_COUNT];
+} reduce_kernels_t;
+
+/**
+ * Check which reduce kernels physical device can run.
+ * Feature structs are zero initialized if the device does not support
+ * Vulkan 1.2.
+ */
+void reduce_kernels_init(VkPhysicalDevice physical_device,
+                         const VkPhysicalDeviceVulkan11Features *features_11,
+                         const VkPhysicalDeviceVulkan12Features *features_12,
+                         reduce_kernels_t *kernels);
+
+/**
+ * Enable the features required by supported reduce kernels.
+ */
+void reduce_kernels_enable_features(
+    const reduce_kernels_t *kernels,
+    VkPhysicalDeviceVulkan11Features *features_11,
+    VkPhysicalDeviceVulkan12Features *features_12);
+
+/**
+ * Get size in bytes of element type, 0 if `dtype` is invalid.
+ */
+size_t reduce_dtype_size(sccl_dtype_t dtype);
+
+/**
+ * Check if subgroup kernels for `dtype` can run on the device.
+ */
+bool reduce_is_dtype_supported(const reduce_kernels_t *kernels,
+                               sccl_dtype_t dtype);
+
+/**
+ * Check if elementwise combine kernel for `dtype` can run on the device.
+ */
+bool reduce_is_combine_supported(const reduce_kernels_t *kernels,
+                                 sccl_dtype_t dtype);
+
+/**
+ * Record `dst[dst_offset + i] = op(dst[dst_offset + i], src[src_offset + i])`
+ * for `count` elements, offsets are in elements and must fit in 32 bits.
+ * Arguments are not validated.
+ */
+sccl_error_t reduce_record_combine(const sccl_stream_t stream,
+                                   const sccl_buffer_t src, size_t src_offset,
+                                   const sccl_buffer_t dst, size_t dst_offset,
+                                   size_t count, sccl_dtype_t dtype,
+                                   sccl_reduce_op_t op);
+
+/**
+ * Destroy created shaders, streams that used them must be joined.
+ */
+void reduce_kernels_destroy(reduce_kernels_t *kernels);
+
+#endif // REDUCE_HEADER
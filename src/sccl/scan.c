@@ -0,0 +1,265 @@
+#include "scan.h"
+#include "buffer.h"
+#include "device.h"
+#include "environment_variables.h"
+#include "error.h"
+#include "kernel.h"
+#include "reduce.h"
+#include "sccl.h"
+#include "stream.h"
+
+#include <string.h>
+
+/* shader bundle names, indexed by `scan_mode_t` and `sccl_dtype_t` */
+static const char *const scan_names[scan_mode_count][REDUCE_DTYPE_COUNT] = {
+    {
+        "scan_lookback_int32",
+        "scan_lookback_uint32",
+        "scan_lookback_float32",
+        "scan_lookback_float16",
+        "scan_lookback_int64",
+    },
+    {
+        "scan_reduce_int32",
+        "scan_reduce_uint32",
+        "scan_reduce_float32",
+        "scan_reduce_float16",
+        "scan_reduce_int64",
+    },
+    {
+        "scan_downsweep_int32",
+        "scan_downsweep_uint32",
+        "scan_downsweep_float32",
+        "scan_downsweep_float16",
+        "scan_downsweep_int64",
+    },
+};
+
+/* number of storage buffers bound by each mode */
+static const size_t scan_buffers_counts[scan_mode_count] = {4, 2, 3};
+
+/* PCI vendor IDs of desktop GPUs whose schedulers keep running workgroups
+ * resident, other devices can starve a workgroup that waits for an earlier
+ * tile */
+#define VENDOR_ID_AMD 0x1002
+#define VENDOR_ID_NVIDIA 0x10de
+#define VENDOR_ID_INTEL 0x8086
+
+typedef struct {
+    uint32_t count;
+    uint32_t exclusive;
+    uint32_t use_prefix;
+} scan_push_constants_t;
+
+void scan_kernels_init(VkPhysicalDevice physical_device,
+                       scan_kernels_t *kernels)
+{
+    memset(kernels, 0, sizeof(scan_kernels_t));
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    switch (properties.vendorID) {
+    case VENDOR_ID_AMD:
+    case VENDOR_ID_NVIDIA:
+    case VENDOR_ID_INTEL:
+        kernels->decoupled_lookback =
+            properties.deviceType != VK_PHYSICAL_DEVICE_TYPE_CPU;
+        break;
+    default:
+        kernels->decoupled_lookback = false;
+        break;
+    }
+    if (is_force_decoupled_lookback_set()) {
+        kernels->decoupled_lookback = true;
+    }
+    if (is_disable_decoupled_lookback_set()) {
+        kernels->decoupled_lookback = false;
+    }
+}
+
+void scan_kernels_destroy(scan_kernels_t *kernels)
+{
+    for (size_t i = 0; i < scan_mode_count; ++i) {
+        for (size_t j = 0; j < REDUCE_DTYPE_COUNT; ++j) {
+            for (size_t k = 0; k < REDUCE_OP_COUNT; ++k) {
+                if (kernels->shaders[i][j][k] != SCCL_NULL) {
+                    sccl_destroy_shader(kernels->shaders[i][j][k]);
+                    kernels->shaders[i][j][k] = SCCL_NULL;
+                }
+            }
+        }
+    }
+}
+
+static uint32_t get_tile_count(size_t count)
+{
+    return (uint32_t)((count + SCAN_TILE_SIZE - 1) / SCAN_TILE_SIZE);
+}
+
+/**
+ * Tile aggregates and prefixes of float16 are kept in float32.
+ */
+static sccl_dtype_t get_accumulator_dtype(sccl_dtype_t dtype)
+{
+    return dtype == sccl_dtype_float16 ? sccl_dtype_float32 : dtype;
+}
+
+/**
+ * Record `mode` kernel with one workgroup per tile.
+ */
+static sccl_error_t run_kernel(const sccl_stream_t stream, scan_mode_t mode,
+                               sccl_dtype_t dtype, sccl_reduce_op_t op,
+                               const sccl_buffer_t *buffers, size_t count,
+                               bool exclusive, bool use_prefix)
+{
+    sccl_device_t device = stream->device;
+    sccl_shader_t shader;
+    CHECK_SCCL_ERROR_RET(kernel_get_shader(
+        device, &device->scan_kernels.shaders[mode][dtype][op],
+        scan_names[mode][dtype], op, scan_buffers_counts[mode],
+        sizeof(scan_push_constants_t), &shader));
+
+    scan_push_constants_t push_constants = {
+        .count = (uint32_t)count,
+        .exclusive = exclusive,
+        .use_prefix = use_prefix,
+    };
+
+    uint32_t group_count_x, group_count_y;
+    kernel_get_group_counts(get_tile_count(count), &group_count_x,
+                            &group_count_y);
+
+    return kernel_run(stream, shader, buffers, scan_buffers_counts[mode],
+                      &push_constants, group_count_x, group_count_y);
+}
+
+static sccl_error_t scan_lookback(const sccl_stream_t stream,
+                                  const sccl_buffer_t src,
+                                  const sccl_buffer_t dst, size_t count,
+                                  sccl_dtype_t dtype, sccl_reduce_op_t op,
+                                  bool exclusive)
+{
+    size_t tile_count = get_tile_count(count);
+    size_t value_size = reduce_dtype_size(get_accumulator_dtype(dtype));
+
+    /* aggregate and inclusive prefix of every tile, plus tile states and
+     * the tile counter that must start at 0 */
+    sccl_buffer_t tile_values, tile_states;
+    CHECK_SCCL_ERROR_RET(sccl_alloc_async(stream, &tile_values,
+                                          sccl_buffer_type_device_storage,
+                                          2 * tile_count * value_size));
+    size_t tile_states_size = (tile_count + 1) * sizeof(uint32_t);
+    sccl_error_t error = sccl_alloc_async(stream, &tile_states,
+                                          sccl_buffer_type_device_storage,
+                                          tile_states_size);
+    if (error != sccl_success) {
+        sccl_free_async(stream, tile_values);
+        return error;
+    }
+
+    error = stream_record_fill(stream, tile_states, 0, tile_states_size, 0);
+    if (error == sccl_success) {
+        sccl_buffer_t buffers[] = {src, dst, tile_values, tile_states};
+        error = run_kernel(stream, scan_mode_lookback, dtype, op, buffers,
+                           count, exclusive, false);
+    }
+
+    /* freed on error too, in stream order after anything recorded */
+    sccl_error_t free_error = sccl_free_async(stream, tile_states);
+    if (error == sccl_success) {
+        error = free_error;
+    }
+    free_error = sccl_free_async(stream, tile_values);
+    return error != sccl_success ? error : free_error;
+}
+
+/**
+ * Reduce every tile, scan the tile aggregates recursively and scan every tile
+ * again starting from its prefix.
+ */
+static sccl_error_t scan_reduce_then_scan(const sccl_stream_t stream,
+                                          const sccl_buffer_t src,
+                                          const sccl_buffer_t dst,
+                                          size_t count, sccl_dtype_t dtype,
+                                          sccl_reduce_op_t op, bool exclusive)
+{
+    size_t tile_count = get_tile_count(count);
+    if (tile_count == 1) {
+        /* prefix buffer is not read, any buffer can be bound */
+        sccl_buffer_t buffers[] = {src, dst, src};
+        return run_kernel(stream, scan_mode_downsweep, dtype, op, buffers,
+                          count, exclusive, false);
+    }
+
+    sccl_dtype_t accumulator_dtype = get_accumulator_dtype(dtype);
+    sccl_buffer_t tile_values;
+    CHECK_SCCL_ERROR_RET(sccl_alloc_async(
+        stream, &tile_values, sccl_buffer_type_device_storage,
+        tile_count * reduce_dtype_size(accumulator_dtype)));
+
+    sccl_buffer_t reduce_buffers[] = {src, tile_values};
+    sccl_error_t error = run_kernel(stream, scan_mode_reduce, dtype, op,
+                                    reduce_buffers, count, false, false);
+    /* aggregates become exclusive tile prefixes in place */
+    if (error == sccl_success) {
+        error = scan_reduce_then_scan(stream, tile_values, tile_values,
+                                      tile_count, accumulator_dtype, op,
+                                      true);
+    }
+    if (error == sccl_success) {
+        sccl_buffer_t downsweep_buffers[] = {src, dst, tile_values};
+        error = run_kernel(stream, scan_mode_downsweep, dtype, op,
+                           downsweep_buffers, count, exclusive, true);
+    }
+
+    /* freed on error too, in stream order after anything recorded */
+    sccl_error_t free_error = sccl_free_async(stream, tile_values);
+    return error != sccl_success ? error : free_error;
+}
+
+static sccl_error_t scan(const sccl_stream_t stream, const sccl_buffer_t src,
+                         const sccl_buffer_t dst, size_t count,
+                         sccl_dtype_t dtype, sccl_reduce_op_t op,
+                         bool exclusive)
+{
+    CHECK_SCCL_NULL_RET(stream);
+    CHECK_SCCL_NULL_RET(src);
+    CHECK_SCCL_NULL_RET(dst);
+    size_t element_size = reduce_dtype_size(dtype);
+    if (element_size == 0 || (uint32_t)op >= REDUCE_OP_COUNT) {
+        return sccl_invalid_argument;
+    }
+    if (count > SCCL_SCAN_MAX_COUNT || !buffer_is_storage(src) ||
+        !buffer_is_storage(dst) || src->size < count * element_size ||
+        dst->size < count * element_size) {
+        return sccl_invalid_argument;
+    }
+    sccl_device_t device = stream->device;
+    if (!reduce_is_dtype_supported(&device->reduce_kernels, dtype)) {
+        return sccl_unsupported_error;
+    }
+
+    if (count == 0) {
+        return sccl_success;
+    }
+    if (device->scan_kernels.decoupled_lookback) {
+        return scan_lookback(stream, src, dst, count, dtype, op, exclusive);
+    }
+    return scan_reduce_then_scan(stream, src, dst, count, dtype, op,
+                                 exclusive);
+}
+
+sccl_error_t sccl_scan(const sccl_stream_t stream, const sccl_buffer_t src,
+                       const sccl_buffer_t dst, size_t count,
+                       sccl_dtype_t dtype, sccl_reduce_op_t op)
+{
+    return scan(stream, src, dst, count, dtype, op, false);
+}
+
+sccl_error_t sccl_scan_exclusive(const sccl_stream_t stream,
+                                 const sccl_buffer_t src,
+                                 const sccl_buffer_t dst, size_t count,
+                                 sccl_dtype_t dtype, sccl_reduce_op_t op)
+{
+    return scan(stream, src, dst, count, dtype, op, true);
+}
@@ -0,0 +1,52 @@
+#pragma once
+#ifndef SCAN_HEADER
+#define SCAN_HEADER
+
+#include "reduce.h"
+#include "sccl.h"
+#include <stdbool.h>
+#include <vulkan/vulkan.h>
+
+/* must match `WORKGROUP_SIZE` and `ITEMS_PER_INVOCATION` in
+ * shaders/scan.comp */
+#define SCAN_WORKGROUP_SIZE 256
+#define SCAN_ITEMS_PER_INVOCATION 8
+#define SCAN_TILE_SIZE (SCAN_WORKGROUP_SIZE * SCAN_ITEMS_PER_INVOCATION)
+
+#if SCAN_TILE_SIZE != SCCL_SCAN_TILE_SIZE
+#error "SCAN_TILE_SIZE must match SCCL_SCAN_TILE_SIZE"
+#endif
+
+/* algorithms the scan kernel is compiled for, see shaders/scan.comp */
+typedef enum {
+    scan_mode_lookback = 0,
+    scan_mode_reduce = 1,
+    scan_mode_downsweep = 2,
+    scan_mode_count = 3
+} scan_mode_t;
+
+/**
+ * Built-in scan kernels of a device, indexed by mode, `sccl_dtype_t` and
+ * `sccl_reduce_op_t`. Shaders are created the first time they are used.
+ * Which element types are supported follows `reduce_kernels_t`.
+ */
+typedef struct {
+    /* workgroups of the device make forward progress, so single pass
+     * decoupled lookback can be used */
+    bool decoupled_lookback;
+    sccl_shader_t shaders[scan_mode_count][REDUCE_DTYPE_COUNT]
+                         [REDUCE_OP_COUNT];
+} scan_kernels_t;
+
+/**
+ * Select scan algorithm of physical device.
+ */
+void scan_kernels_init(VkPhysicalDevice physical_device,
+                       scan_kernels_t *kernels);
+
+/**
+ * Destroy created shaders, streams that used them must be joined.
+ */
+void scan_kernels_destroy(scan_kernels_t *kernels);
+
+#endif // SCAN_HEADER
@@ -7,6 +7,7 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -24,7 +25,8 @@ typedef enum {
     sccl_internal_error = 3,
     sccl_invalid_argument = 4,
     sccl_unsupported_error = 5,
-    sccl_out_of_resources_error = 6
+    sccl_out_of_resources_error = 6,
+    sccl_not_ready = 7
 } sccl_error_t;
 
 /* Buffer type enum */
@@ -40,11 +42,80 @@ typedef enum {
     sccl_buffer_type_shared_uniform = 6
 } sccl_buffer_type_t;
 
+/* How buffer memory is accessed, used to select memory type */
+typedef enum {
+    /* selection based on buffer type alone */
+    sccl_memory_usage_default = 0,
+    /* only accessed by device, only valid for device buffers */
+    sccl_memory_usage_device_only = 1,
+    /* written sequentially by host, read by device */
+    sccl_memory_usage_upload = 2,
+    /* written by device, read by host */
+    sccl_memory_usage_readback = 3
+} sccl_memory_usage_t;
+
+/* Memory type selected for buffers, see `sccl_get_device_memory_type_info` */
+typedef struct {
+    uint32_t memory_type_index;
+    uint32_t heap_index;
+    size_t heap_size;
+    bool device_local;
+    bool host_visible;
+    bool host_cached;
+    /* true if device has host visible device local memory larger than a
+     * 256 MiB BAR window (resizable BAR or unified memory) */
+    bool large_bar;
+} sccl_memory_type_info_t;
+
+/* What to do when a device allocation does not fit in the memory budget */
+typedef enum {
+    /* fail allocation with `sccl_out_of_resources_error` */
+    sccl_memory_overcommit_policy_fail = 0,
+    /* move least recently used idle device buffers to host memory */
+    sccl_memory_overcommit_policy_spill = 1
+} sccl_memory_overcommit_policy_t;
+
+/* Element type of buffer data used by built-in kernels */
+typedef enum {
+    sccl_dtype_int32 = 0,
+    sccl_dtype_uint32 = 1,
+    sccl_dtype_float32 = 2,
+    /* IEEE 754 half precision */
+    sccl_dtype_float16 = 3,
+    sccl_dtype_int64 = 4
+} sccl_dtype_t;
+
+/* Reduction operation used by built-in kernels */
+typedef enum {
+    sccl_reduce_op_sum = 0,
+    sccl_reduce_op_min = 1,
+    sccl_reduce_op_max = 2,
+    sccl_reduce_op_prod = 3
+} sccl_reduce_op_t;
+
+/* Comparison with a constant used by `sccl_select_if` */
+typedef enum {
+    sccl_compare_op_equal = 0,
+    sccl_compare_op_not_equal = 1,
+    sccl_compare_op_less = 2,
+    sccl_compare_op_less_equal = 3,
+    sccl_compare_op_greater = 4,
+    sccl_compare_op_greater_equal = 5
+} sccl_compare_op_t;
+
+/* Built-in operation of a `sccl_worker_enqueue` job on 32-bit words */
+typedef enum {
+    sccl_worker_op_fill = 0, /* dst[i] = value */
+    sccl_worker_op_copy = 1, /* dst[i] = src[i] */
+    sccl_worker_op_add = 2   /* dst[i] = src[i] + value */
+} sccl_worker_op_t;
+
 typedef struct sccl_instance *sccl_instance_t; /* Opaque handle */
 typedef struct sccl_device *sccl_device_t;     /* Opaque handle */
 typedef struct sccl_buffer *sccl_buffer_t;     /* Opaque handle */
 typedef struct sccl_stream *sccl_stream_t;     /* Opaque handle */
 typedef struct sccl_shader *sccl_shader_t;     /* Opaque handle */
+typedef struct sccl_worker *sccl_worker_t;     /* Opaque handle */
 #define SCCL_NULL NULL
 
 typedef struct {
@@ -90,6 +161,9 @@ typedef struct {
     size_t push_constant_layouts_count;
     sccl_shader_buffer_layout_t *buffer_layouts; /* optional */
     size_t buffer_layouts_count;
+    /* optional, access buffers through the device descriptor table instead of
+     * `buffer_layouts`, see `sccl_get_buffer_descriptor_index` */
+    bool bindless;
 } sccl_shader_config_t;
 
 typedef struct {
@@ -102,8 +176,115 @@ typedef struct {
     sccl_shader_push_constant_binding
         *push_constant_bindings; /* required if set in `sccl_shader_config_t` */
     size_t push_constant_bindings_count;
+    /* optional, return `sccl_not_ready` instead of waiting if the pipeline of
+     * a shader from `sccl_create_shader_async` is still compiling */
+    bool fail_if_not_ready;
 } sccl_shader_run_params_t;
 
+typedef struct {
+    /* false if the device does not report pipeline creation feedback, then
+     * `cache_hit` is unknown */
+    bool valid;
+    /* pipeline was found in the device pipeline cache */
+    bool cache_hit;
+    /* time spent creating the pipeline, measured by the driver if `valid`,
+     * else on the host */
+    uint64_t duration_ns;
+} sccl_shader_feedback_t;
+
+/* Objects alive in the device shader cache */
+typedef struct {
+    size_t shader_module_count;
+    size_t descriptor_set_layout_count;
+    size_t pipeline_layout_count;
+    /* shader objects that were reused instead of created */
+    uint64_t hit_count;
+} sccl_shader_cache_stats_t;
+
+/**
+ * Record one run of `shader` on representative inputs for `sccl_autotune`,
+ * `values` are the tuned specialization constants of the candidate, e.g. to
+ * compute group counts from a tuned local size.
+ */
+typedef sccl_error_t (*sccl_autotune_record_t)(sccl_stream_t stream,
+                                               sccl_shader_t shader,
+                                               const uint32_t *values,
+                                               void *user_data);
+
+typedef struct {
+    /* required, specialization constants with tuned ids are replaced by the
+     * candidate values */
+    const sccl_shader_config_t *shader_config;
+    /* required, ids of tuned 32-bit specialization constants, at most
+     * `SCCL_AUTOTUNE_MAX_CONSTANTS` */
+    const uint32_t *constant_ids;
+    size_t constant_ids_count;
+    /* required, `candidates_count` rows of `constant_ids_count` values */
+    const uint32_t *candidates;
+    size_t candidates_count;
+    /* results are stored per power of two bucket of problem size */
+    size_t problem_size;
+    sccl_autotune_record_t record; /* required */
+    void *user_data;               /* optional, passed to `record` */
+    size_t iterations; /* optional, timed runs of each candidate */
+    /* optional, overrides environment variable `SCCL_AUTOTUNE_CACHE` */
+    const char *cache_path;
+} sccl_autotune_config_t;
+
+/**
+ * How `sccl_join_stream` waits for submitted work. The fence is polled for
+ * `spin_ns`, then polled while yielding the thread until `spin_ns + yield_ns`
+ * have passed, then the thread blocks in the driver until the work is done.
+ * The zero policy always blocks and is the default for new streams.
+ */
+typedef struct {
+    uint64_t spin_ns;
+    uint64_t yield_ns;
+    /* shorten spin and yield phases to twice the recent average wait, and
+     * block right away while the average wait outlasts both phases */
+    bool adaptive;
+    /* poll the completion flag instead of the fence, see
+     * `sccl_get_stream_completion_flag` */
+    bool completion_flag;
+} sccl_stream_wait_policy_t;
+
+/* Counts of joins by the wait phase they completed in */
+typedef struct {
+    uint64_t spin_count;
+    uint64_t yield_count;
+    uint64_t block_count;
+    /* exponential moving average of join wait times */
+    uint64_t average_wait_ns;
+} sccl_stream_wait_stats_t;
+
+typedef struct {
+    /* optional, jobs in flight, default `SCCL_WORKER_DEFAULT_CAPACITY` */
+    size_t capacity;
+    /* optional, the watchdog stops the worker kernel after it has run this
+     * long, default `SCCL_WORKER_DEFAULT_LIFETIME_NS` */
+    uint64_t lifetime_ns;
+    /* optional, polls of an empty ring before the worker kernel exits,
+     * default `SCCL_WORKER_DEFAULT_IDLE_POLLS` */
+    uint32_t idle_polls;
+} sccl_worker_config_t;
+
+typedef struct {
+    sccl_worker_op_t op;
+    sccl_buffer_t src; /* unused by `sccl_worker_op_fill` */
+    size_t src_offset;
+    sccl_buffer_t dst;
+    size_t dst_offset;
+    size_t size; /* bytes, offsets and size must be multiples of 4 */
+    uint32_t value;
+} sccl_worker_job_t;
+
+typedef struct {
+    /* launches of the worker kernel */
+    uint64_t launch_count;
+    /* launches stopped by the watchdog at the end of their lifetime */
+    uint64_t watchdog_stop_count;
+} sccl_worker_stats_t;
+
 /**
  * To enable validation layers, set enviroment variable
  * `SCCL_ENABLE_VALIDATION_LAYERS=1`
@@ -114,6 +295,67 @@ typedef struct {
 #define SCCL_ENABLE_VALIDATION_LAYERS "SCCL_ENABLE_VALIDATION_LAYERS"
 #define SCCL_ASSERT_ON_VALIDATION_ERROR "SCCL_ASSERT_ON_VALIDATION_ERROR"
 
+/**
+ * To make `sccl_scan` use reduce-then-scan on every device, set environment
+ * variable `SCCL_DISABLE_DECOUPLED_LOOKBACK=1` before the device is created.
+ */
+#define SCCL_DISABLE_DECOUPLED_LOOKBACK "SCCL_DISABLE_DECOUPLED_LOOKBACK"
+
+/**
+ * To make `sccl_scan` use decoupled lookback on every device, e.g. to test it
+ * where it is off by default, set environment variable
+ * `SCCL_FORCE_DECOUPLED_LOOKBACK=1` before the device is created. Devices that
+ * don't keep running workgroups resident can hang.
+ * `SCCL_DISABLE_DECOUPLED_LOOKBACK` takes precedence.
+ */
+#define SCCL_FORCE_DECOUPLED_LOOKBACK "SCCL_FORCE_DECOUPLED_LOOKBACK"
+
+/**
+ * Path of the file `sccl_autotune` stores results in when
+ * `sccl_autotune_config_t::cache_path` is not set, results are not stored if
+ * neither is set.
+ */
+#define SCCL_AUTOTUNE_CACHE "SCCL_AUTOTUNE_CACHE"
+
+/**
+ * Bindless shaders (`sccl_shader_config_t::bindless`) see every storage buffer
+ * on the device through a descriptor array at set 0, binding 0 (see
+ * `sccl_descriptor_table.glsl`), and index it with values from push constants.
+ * All bindless shaders share one pipeline layout, so the table is bound once
+ * per stream dispatch no matter how many buffers or shaders are used.
+ *
+ * Push constants of bindless shaders can at most be
+ * `SCCL_DESCRIPTOR_TABLE_PUSH_CONSTANT_SIZE` bytes in total.
+ */
+#define SCCL_DESCRIPTOR_TABLE_PUSH_CONSTANT_SIZE 128
+#define SCCL_DESCRIPTOR_TABLE_INVALID_INDEX UINT32_MAX
+
+/* Bytes of workgroup counts read by `sccl_run_shader_indirect` */
+#define SCCL_INDIRECT_ARGS_SIZE (3 * sizeof(uint32_t))
+/* Largest x workgroup count written by `sccl_write_group_counts` */
+#define SCCL_INDIRECT_MAX_GROUP_COUNT_X 65535
+
+/* Elements scanned by each workgroup of `sccl_scan` */
+#define SCCL_SCAN_TILE_SIZE 2048
+#define SCCL_SCAN_MAX_COUNT (UINT32_MAX - SCCL_SCAN_TILE_SIZE)
+
+/* Keys ranked by each workgroup of `sccl_sort_keys` and `sccl_sort_pairs`,
+ * keys and values in the temporary buffer are indexed with 32 bits */
+#define SCCL_SORT_TILE_SIZE 2048
+#define SCCL_SORT_MAX_COUNT (UINT32_MAX / 4)
+
+/* Specialization constants tuned together by `sccl_autotune` */
+#define SCCL_AUTOTUNE_MAX_CONSTANTS 8
+
+/* Defaults of `sccl_worker_config_t`, the lifetime is far below the GPU
+ * timeouts of common drivers */
+#define SCCL_WORKER_DEFAULT_CAPACITY 1024
+#define SCCL_WORKER_DEFAULT_LIFETIME_NS 100000000
+#define SCCL_WORKER_DEFAULT_IDLE_POLLS 100000
+
+/* Size of host staging slices used by collectives */
+#define SCCL_COLLECTIVE_SLICE_SIZE (4 * 1024 * 1024)
+
 sccl_error_t sccl_create_instance(sccl_instance_t *instance);
 
 void sccl_destroy_instance(sccl_instance_t instance);
@@ -126,12 +368,80 @@ sccl_error_t sccl_create_device(const sccl_instance_t instance,
 
 void sccl_destroy_device(sccl_device_t device);
 
+/**
+ * Set budget in bytes for device local memory allocated by `device`, and what
+ * to do when an allocation would exceed it. The budget is also limited by
+ * what the driver reports as available through `VK_EXT_memory_budget` when
+ * supported. Default budget is `SIZE_MAX` with
+ * `sccl_memory_overcommit_policy_fail`.
+ *
+ * With `sccl_memory_overcommit_policy_spill`, buffers of type
+ * `sccl_buffer_type_device_storage` and `sccl_buffer_type_device_uniform` that
+ * are not used by any stream waiting to be joined can be moved to host memory.
+ * A spilled buffer is moved back to device memory the next time it is recorded
+ * in a stream. Buffers are never spilled while a bindless shader run is
+ * recorded in a stream that is not joined yet.
+ */
+sccl_error_t
+sccl_set_device_memory_budget(const sccl_device_t device, size_t budget,
+                              sccl_memory_overcommit_policy_t policy);
+
+/**
+ * Get bytes of device local memory currently allocated by `device`, and the
+ * effective budget.
+ */
+sccl_error_t sccl_get_device_memory_usage(const sccl_device_t device,
+                                          size_t *usage, size_t *budget);
+
 sccl_error_t sccl_create_buffer(const sccl_device_t device,
                                 sccl_buffer_t *buffer, sccl_buffer_type_t type,
                                 size_t size);
 
+/**
+ * Create buffer with memory type selected for `usage`.
+ * Memory types are ranked per buffer type and usage when the device is
+ * created, considering exact property flag match, heap size and whether the
+ * device has a large BAR. If the best memory type is out of memory the next
+ * best is used.
+ *
+ * Shared buffers are placed in device local memory only if the device has a
+ * large BAR, otherwise in host memory.
+ * Host buffers with `sccl_memory_usage_readback` prefer host cached memory,
+ * and with `sccl_memory_usage_upload` prefer device local memory if the device
+ * has a large BAR.
+ * Returns `sccl_invalid_argument` for host usage with device buffers or
+ * `sccl_memory_usage_device_only` with host or shared buffers.
+ */
+sccl_error_t sccl_create_buffer_with_usage(const sccl_device_t device,
+                                           sccl_buffer_t *buffer,
+                                           sccl_buffer_type_t type, size_t size,
+                                           sccl_memory_usage_t usage);
+
+/**
+ * Destroy buffer.
+ * If the buffer is recorded in a stream that is not joined yet, or it's in the
+ * descriptor table while bindless shader runs are pending, it's destroyed when
+ * that work is joined. The handle must not be used after this call.
+ */
 void sccl_destroy_buffer(sccl_buffer_t buffer);
 
+/**
+ * Get memory type buffers of `type` with `usage` are allocated from when
+ * there is room.
+ */
+sccl_error_t sccl_get_device_memory_type_info(const sccl_device_t device,
+                                              sccl_buffer_type_t type,
+                                              sccl_memory_usage_t usage,
+                                              sccl_memory_type_info_t *info);
+
+/**
+ * Get memory type buffer is currently allocated from, this can differ from
+ * `sccl_get_device_memory_type_info` if the best memory type was full or the
+ * buffer is spilled.
+ */
+sccl_error_t sccl_get_buffer_memory_type_info(const sccl_buffer_t buffer,
+                                              sccl_memory_type_info_t *info);
+
 /**
  * Map buffer memory on host.
  * It's only possible to have 1 map at any time per buffer.
@@ -147,6 +457,15 @@ sccl_error_t sccl_host_map_buffer(const sccl_buffer_t buffer, void **data,
  */
 void sccl_host_unmap_buffer(const sccl_buffer_t buffer);
 
+/**
+ * Get index of buffer in the device descriptor table.
+ * Index is stable for the lifetime of the buffer.
+ * Returns `sccl_unsupported_error` if device does not support descriptor
+ * indexing, or if buffer is not a storage buffer.
+ */
+sccl_error_t sccl_get_buffer_descriptor_index(const sccl_buffer_t buffer,
+                                              uint32_t *index);
+
 sccl_error_t sccl_create_stream(const sccl_device_t device,
                                 sccl_stream_t *stream);
 
@@ -156,6 +475,68 @@ sccl_error_t sccl_dispatch_stream(const sccl_stream_t stream);
 
 sccl_error_t sccl_join_stream(const sccl_stream_t stream);
 
+/**
+ * Set how `sccl_join_stream` waits, see `sccl_stream_wait_policy_t`. Spinning
+ * trades a busy host thread for lower latency of short dispatches.
+ * The policy applies to dispatches after it's set.
+ */
+sccl_error_t
+sccl_set_stream_wait_policy(const sccl_stream_t stream,
+                            const sccl_stream_wait_policy_t *policy);
+
+sccl_error_t sccl_get_stream_wait_stats(const sccl_stream_t stream,
+                                        sccl_stream_wait_stats_t *stats);
+
+/**
+ * Get completion flag of a stream with `completion_flag` set in its wait
+ * policy. The last command of every dispatch writes the dispatch sequence
+ * number to the flag in host coherent memory, the last dispatch is done when
+ * `*flag == *sequence`, so completion can be polled without Vulkan calls or
+ * syscalls. The stream must still be joined before it's recorded again.
+ * Returns `sccl_invalid_argument` if the flag is not enabled.
+ */
+sccl_error_t
+sccl_get_stream_completion_flag(const sccl_stream_t stream,
+                                const volatile uint32_t **flag,
+                                uint32_t *sequence);
+
+/**
+ * Allocate buffer in stream order.
+ * Buffers freed earlier with `sccl_free_async` on the same stream are reused
+ * right away, buffers freed on other streams are reused once those streams are
+ * joined. The returned buffer can be up to twice as large as `size`.
+ * Returns a new buffer if there is nothing to reuse.
+ */
+sccl_error_t sccl_alloc_async(const sccl_stream_t stream,
+                              sccl_buffer_t *buffer, sccl_buffer_type_t type,
+                              size_t size);
+
+/**
+ * Free buffer in stream order.
+ * Buffer can still be used by commands recorded in `stream` before this call,
+ * but not by any command recorded after it. When `stream` is joined the buffer
+ * is moved to the device memory pool, and the pool is trimmed down to the
+ * release threshold.
+ * Any buffer can be freed with this, not only ones from `sccl_alloc_async`.
+ */
+sccl_error_t sccl_free_async(const sccl_stream_t stream, sccl_buffer_t buffer);
+
+/**
+ * Set how many bytes of freed buffers the device memory pool keeps when a
+ * stream is joined. Default is 0, so freed buffers are only reused within the
+ * stream until it's joined.
+ */
+sccl_error_t
+sccl_set_device_memory_pool_release_threshold(const sccl_device_t device,
+                                              size_t threshold);
+
+/**
+ * Destroy buffers in device memory pool until it holds at most
+ * `min_bytes_to_keep` bytes.
+ */
+void sccl_trim_device_memory_pool(const sccl_device_t device,
+                                  size_t min_bytes_to_keep);
+
 sccl_error_t sccl_copy_buffer(const sccl_stream_t stream,
                               const sccl_buffer_t src, size_t src_offset,
                               const sccl_buffer_t dst, size_t dst_offset,
@@ -165,11 +546,406 @@ sccl_error_t sccl_create_shader(const sccl_device_t device,
                                 sccl_shader_t *shader,
                                 const sccl_shader_config_t *config);
 
+/**
+ * Create `count` shaders from `configs` in parallel on up to one thread per
+ * cpu, including the calling thread. All pipelines on a device share its
+ * pipeline cache, so shaders that were created before are cheap to create
+ * again. Either all shaders are created or none, on failure the first error
+ * in `configs` order is returned.
+ */
+sccl_error_t sccl_create_shaders(const sccl_device_t device,
+                                 const sccl_shader_config_t *configs,
+                                 size_t count, sccl_shader_t *shaders);
+
+/**
+ * Create shader from the SPIR-V of a built-in kernel embedded in the library,
+ * without reading any file. `name` is the kernel source name followed by its
+ * variant, e.g. `reduce_float32`, `scan_lookback_int64` or `group_counts`.
+ * `config` describes layouts and constants as for `sccl_create_shader`, its
+ * shader source code must be unset. The library creates its own kernels from
+ * the same bundle.
+ * Returns `sccl_invalid_argument` if no kernel is named `name`.
+ */
+sccl_error_t sccl_create_shader_from_bundle(const sccl_device_t device,
+                                           const char *name,
+                                           sccl_shader_t *shader,
+                                           const sccl_shader_config_t *config);
+
+/**
+ * Create shader like `sccl_create_shader`, but compile its pipeline on a
+ * background thread and return right away. The config is only read during
+ * this call. Running the shader waits until the pipeline is compiled, or
+ * returns `sccl_not_ready` if `sccl_shader_run_params_t::fail_if_not_ready`
+ * is set. If compiling fails, runs return the compile error.
+ */
+sccl_error_t sccl_create_shader_async(const sccl_device_t device,
+                                      sccl_shader_t *shader,
+                                      const sccl_shader_config_t *config);
+
+/**
+ * Wait until the pipeline of shader is compiled and return the compile
+ * result. Returns right away for shaders from `sccl_create_shader`.
+ */
+sccl_error_t sccl_wait_shader(const sccl_shader_t shader);
+
+/**
+ * Get pipeline creation feedback of shader, uses
+ * `VK_EXT_pipeline_creation_feedback` when the device supports it.
+ * Returns `sccl_not_ready` without waiting if the pipeline is still
+ * compiling, or the compile error if compiling failed.
+ */
+sccl_error_t sccl_get_shader_feedback(const sccl_shader_t shader,
+                                      sccl_shader_feedback_t *feedback);
+
+/**
+ * Get stats of the device shader cache. Shader modules, descriptor set
+ * layouts and pipeline layouts are shared by all shaders of a device that
+ * are created from identical SPIR-V or identical buffer and push constant
+ * layouts, and destroyed with the last shader using them.
+ */
+sccl_error_t sccl_get_shader_cache_stats(const sccl_device_t device,
+                                         sccl_shader_cache_stats_t *stats);
+
+/**
+ * Destroy shader.
+ * Waits for the pipeline of a shader from `sccl_create_shader_async` to finish
+ * compiling. If the shader is recorded in a stream that is not joined yet,
+ * it's destroyed when the last such stream is joined. The handle must not be
+ * used after this call.
+ */
 void sccl_destroy_shader(sccl_shader_t shader);
 
-sccl_error_t sccl_run_shader(const sccl_shader_t shader,
+/**
+ * Record shader dispatch in stream.
+ * A barrier is recorded after the dispatch so later commands in the stream
+ * see the results.
+ */
+sccl_error_t sccl_run_shader(const sccl_stream_t stream,
+                             const sccl_shader_t shader,
                              const sccl_shader_run_params_t *params);
 
+/**
+ * Record shader dispatch in stream with workgroup counts read by the device
+ * from `args_buffer` when the dispatch runs, three `uint32_t` (x, y, z) at
+ * `args_offset` bytes, like `VkDispatchIndirectCommand`. This lets earlier
+ * commands in the stream size the dispatch without a round trip to the host,
+ * see `sccl_write_group_counts`.
+ * `args_buffer` must be a storage buffer and `args_offset` a multiple of 4,
+ * group counts of `params` are ignored. Counts must not exceed the device
+ * limits, a count of 0 in any dimension dispatches nothing.
+ */
+sccl_error_t sccl_run_shader_indirect(const sccl_stream_t stream,
+                                      const sccl_shader_t shader,
+                                      const sccl_buffer_t args_buffer,
+                                      size_t args_offset,
+                                      const sccl_shader_run_params_t *params);
+
+/**
+ * Set group counts of `params` to launch at least `count` invocations of a
+ * shader with `local_size` invocations per workgroup, spread over x, y and z
+ * within the device limits with less than one row of padding workgroups.
+ * Shaders get their linear index and bounds check from `sccl_launch.glsl`
+ * and must be passed `count`, e.g. as a push constant.
+ * Returns `sccl_invalid_argument` if `local_size` is 0, `count` or the
+ * linear index of the last workgroup don't fit in 32 bits, or the workgroups
+ * don't fit the device limits.
+ */
+sccl_error_t sccl_get_group_counts(const sccl_device_t device, size_t count,
+                                   uint32_t local_size,
+                                   sccl_shader_run_params_t *params);
+
+/**
+ * Record run of a built-in kernel that reads the `uint32_t` element count at
+ * `count_offset` bytes of `count_buffer` and writes workgroup counts for
+ * `ceil(count / elements_per_group)` workgroups to `args_buffer` at
+ * `args_offset` bytes, for `sccl_run_shader_indirect`.
+ * Workgroups past `SCCL_INDIRECT_MAX_GROUP_COUNT_X` are split over y, so the
+ * shader should compute its linear workgroup index as
+ * `gl_WorkGroupID.x + gl_WorkGroupID.y * gl_NumWorkGroups.x` and return if
+ * it's past the work. Count 0 writes zero workgroups in x, the workgroup
+ * count must not exceed 65535 * 65535.
+ * Both buffers must be storage buffers and may be the same buffer, offsets
+ * must be multiples of 4 and `elements_per_group` larger than 0.
+ */
+sccl_error_t sccl_write_group_counts(const sccl_stream_t stream,
+                                     const sccl_buffer_t count_buffer,
+                                     size_t count_offset,
+                                     const sccl_buffer_t args_buffer,
+                                     size_t args_offset,
+                                     uint32_t elements_per_group);
+
+/**
+ * Find the fastest candidate of specialization constant values (local size,
+ * tile sizes) for a shader and return its index in `best_candidate`.
+ * Each candidate shader is created, recorded once by `config->record` as
+ * warmup and then `config->iterations` times between GPU timestamps in
+ * `stream`, which must have nothing recorded. Candidates the device can't
+ * create a pipeline for are skipped. An error from `config->record` is
+ * returned after the partly recorded commands are dispatched and joined, so
+ * `stream` is left with nothing recorded.
+ * The winner is appended to the cache file keyed by a hash of the shader
+ * code and untuned constants, the device UUID and the problem size bucket,
+ * later calls with the same key return it without running anything as long
+ * as its values are still among the candidates.
+ * Returns `sccl_unsupported_error` if the queue has no timestamps.
+ */
+sccl_error_t sccl_autotune(const sccl_stream_t stream,
+                           const sccl_autotune_config_t *config,
+                           size_t *best_candidate);
+
+/**
+ * Record reduction of the first `count` elements of `src` into the first
+ * element of `dst`, both must be storage buffers. If `count` is 0 the identity
+ * of `op` is written.
+ * Runs one or two passes of a built-in kernel using subgroup arithmetic,
+ * intermediate results are stored in buffers from `sccl_alloc_async`.
+ * `sccl_dtype_float16` is accumulated in single precision.
+ * Returns `sccl_unsupported_error` if the device lacks subgroup arithmetic in
+ * compute shaders, 16-bit storage buffer access for `sccl_dtype_float16`, or
+ * 64-bit subgroup arithmetic for `sccl_dtype_int64`.
+ * Returns `sccl_invalid_argument` if `count` does not fit in 32 bits.
+ */
+sccl_error_t sccl_reduce(const sccl_stream_t stream, const sccl_buffer_t src,
+                         const sccl_buffer_t dst, size_t count,
+                         sccl_dtype_t dtype, sccl_reduce_op_t op);
+
+/**
+ * Record inclusive prefix scan of the first `count` elements of `src` into
+ * `dst`, element `i` of `dst` is `op` applied to elements `0..i` of `src`.
+ * Both must be storage buffers and can be the same buffer.
+ * Uses a single pass decoupled lookback kernel on devices known to guarantee
+ * forward progress of running workgroups, otherwise reduce-then-scan with
+ * one pass more for every factor of `SCCL_SCAN_TILE_SIZE` elements.
+ * Intermediate results are stored in buffers from `sccl_alloc_async`.
+ * Returns `sccl_unsupported_error` under the same conditions as
+ * `sccl_reduce`.
+ * Returns `sccl_invalid_argument` if `count` is larger than
+ * `SCCL_SCAN_MAX_COUNT`.
+ */
+sccl_error_t sccl_scan(const sccl_stream_t stream, const sccl_buffer_t src,
+                       const sccl_buffer_t dst, size_t count,
+                       sccl_dtype_t dtype, sccl_reduce_op_t op);
+
+/**
+ * Same as `sccl_scan` but writes exclusive prefixes, element `i` of `dst` is
+ * `op` applied to elements `0..i-1` of `src` and element 0 is the identity of
+ * `op`.
+ */
+sccl_error_t sccl_scan_exclusive(const sccl_stream_t stream,
+                                 const sccl_buffer_t src,
+                                 const sccl_buffer_t dst, size_t count,
+                                 sccl_dtype_t dtype, sccl_reduce_op_t op);
+
+/**
+ * Get size in bytes of the temporary buffer needed to sort `count` keys of
+ * `key_dtype`, with 32-bit values if `with_values` is true.
+ * Returns `sccl_invalid_argument` for key types that can't be sorted, see
+ * `sccl_sort_keys`.
+ */
+sccl_error_t sccl_get_sort_temp_size(size_t count, sccl_dtype_t key_dtype,
+                                     bool with_values, size_t *temp_size);
+
+/**
+ * Record ascending sort of the first `count` keys of `keys`. Keys can be
+ * `sccl_dtype_uint32`, `sccl_dtype_int32`, `sccl_dtype_float32` (-0.0 sorts
+ * before 0.0, NaNs sort to the end or start depending on sign) or
+ * `sccl_dtype_int64`. The sort is stable.
+ * `temp` must be a storage buffer of at least the size from
+ * `sccl_get_sort_temp_size`, it can be SCCL_NULL if that size is 0.
+ * Uses least significant digit radix sort over 8 bits per pass, every pass
+ * counts digits per tile, scans the counts with `sccl_scan_exclusive` and
+ * ranks keys within a tile with subgroup ballots.
+ * Returns `sccl_unsupported_error` if the device lacks subgroup ballots or
+ * arithmetic in compute shaders.
+ * Returns `sccl_invalid_argument` if `count` is larger than
+ * `SCCL_SORT_MAX_COUNT`.
+ */
+sccl_error_t sccl_sort_keys(const sccl_stream_t stream,
+                            const sccl_buffer_t keys,
+                            const sccl_buffer_t temp, size_t count,
+                            sccl_dtype_t key_dtype);
+
+/**
+ * Same as `sccl_sort_keys`, but also moves the first `count` 32-bit values of
+ * `values` along with their keys.
+ */
+sccl_error_t sccl_sort_pairs(const sccl_stream_t stream,
+                             const sccl_buffer_t keys,
+                             const sccl_buffer_t values,
+                             const sccl_buffer_t temp, size_t count,
+                             sccl_dtype_t key_dtype);
+
+/**
+ * Record stream compaction of the first `count` elements of `src`: elements
+ * whose 32-bit entry in `flags` is not 0 are written to the start of `dst` in
+ * their original order, and their number is written as a uint32 to the first
+ * element of `selected_count`. The count stays on the device so later
+ * commands in the stream can use it without reading it back.
+ * All buffers must be storage buffers, `dst` must have room for `count`
+ * elements.
+ * Returns `sccl_unsupported_error` if the device lacks subgroup arithmetic in
+ * compute shaders (used to count selected elements) or 16-bit storage buffer
+ * access for `sccl_dtype_float16`.
+ * Returns `sccl_invalid_argument` if `count` is larger than
+ * `SCCL_SCAN_MAX_COUNT`.
+ */
+sccl_error_t sccl_compact(const sccl_stream_t stream, const sccl_buffer_t src,
+                          const sccl_buffer_t flags, const sccl_buffer_t dst,
+                          const sccl_buffer_t selected_count, size_t count,
+                          sccl_dtype_t dtype);
+
+/**
+ * Same as `sccl_compact`, but selects elements where
+ * `src[i] compare_op *value` holds. `value` points to one element of `dtype`,
+ * except for `sccl_dtype_float16` where it points to a float.
+ * The comparison is a specialization constant of the kernel and the value a
+ * push constant, so changing the value does not create a new pipeline.
+ */
+sccl_error_t sccl_select_if(const sccl_stream_t stream,
+                            const sccl_buffer_t src, const sccl_buffer_t dst,
+                            const sccl_buffer_t selected_count, size_t count,
+                            sccl_dtype_t dtype, sccl_compare_op_t compare_op,
+                            const void *value);
+
+/**
+ * Record `C = alpha * op(A) * op(B) + beta * C` for row major matrices, where
+ * `op(A)` is `m x k`, `op(B)` is `k x n` and `C` is `m x n`. `op(A)` is `A`
+ * transposed if `trans_a` is true, so `A` is stored `k x m`, and likewise for
+ * `B`. If `beta` is 0, `C` is not read. `dtype` is `sccl_dtype_float32` or
+ * `sccl_dtype_float16`, float16 is accumulated in single precision.
+ * Uses shared memory tiles of `A` and `B` and register blocks of `C`, tile
+ * sizes are specialization constants selected from the subgroup size and
+ * compute limits of the device.
+ * Returns `sccl_unsupported_error` if `dtype` is `sccl_dtype_float16` and the
+ * device lacks 16-bit storage buffer access.
+ * Returns `sccl_invalid_argument` if a matrix has more than `UINT32_MAX`
+ * elements.
+ */
+sccl_error_t sccl_gemm(const sccl_stream_t stream, const sccl_buffer_t a,
+                       const sccl_buffer_t b, const sccl_buffer_t c, size_t m,
+                       size_t n, size_t k, sccl_dtype_t dtype, bool trans_a,
+                       bool trans_b, float alpha, float beta);
+
+/**
+ * Reduce the first `count` elements of `buffers` across `rank_count` ranks,
+ * every buffer holds the result when this returns. Rank `i` records its
+ * commands in `streams[i]`, which must be on the same device as `buffers[i]`.
+ * Ranks can be on different devices or on the same device.
+ *
+ * Uses a ring algorithm: data is split into one chunk per rank, chunks are
+ * passed around the ring and reduced (reduce-scatter) and then passed around
+ * again so every rank gets every reduced chunk (all-gather). Transfers go
+ * through host staging buffers in slices of `SCCL_COLLECTIVE_SLICE_SIZE`
+ * bytes. Each rank sends on a transfer stream of its own, so the device copy
+ * of the next slice and the reduction of the previous one overlap with the
+ * host copy of the current one.
+ *
+ * This dispatches and joins the streams, commands recorded earlier are
+ * executed before the collective. Buffers must be storage buffers.
+ * Returns `sccl_unsupported_error` if `dtype` is `sccl_dtype_float16` and a
+ * device lacks 16-bit storage buffer access.
+ */
+sccl_error_t sccl_allreduce(const sccl_stream_t *streams,
+                            const sccl_buffer_t *buffers, size_t rank_count,
+                            size_t count, sccl_dtype_t dtype,
+                            sccl_reduce_op_t op);
+
+/**
+ * Copy the first `size` bytes of `buffers[root]` to all other buffers.
+ * Data is forwarded along the ring starting at `root`, slices are in flight
+ * on all hops at the same time. See `sccl_allreduce` for how ranks, streams
+ * and staging work.
+ */
+sccl_error_t sccl_broadcast(const sccl_stream_t *streams,
+                            const sccl_buffer_t *buffers, size_t rank_count,
+                            size_t root, size_t size);
+
+/**
+ * Copy chunk `i` of `size` bytes from `src` on rank `root` to the start of
+ * `dst_buffers[i]`. `src` must hold `rank_count * size` bytes.
+ */
+sccl_error_t sccl_scatter(const sccl_stream_t *streams,
+                          const sccl_buffer_t src,
+                          const sccl_buffer_t *dst_buffers, size_t rank_count,
+                          size_t root, size_t size);
+
+/**
+ * Copy the first `size` bytes of `src_buffers[i]` to chunk `i` of `dst` on
+ * rank `root`. `dst` must hold `rank_count * size` bytes.
+ */
+sccl_error_t sccl_gather(const sccl_stream_t *streams,
+                         const sccl_buffer_t *src_buffers,
+                         const sccl_buffer_t dst, size_t rank_count,
+                         size_t root, size_t size);
+
+/**
+ * Reduce `src_buffers` of `rank_count * count` elements across ranks, rank
+ * `i` gets chunk `i` of `count` elements of the result in `dst_buffers[i]`.
+ * `src_buffers` are not modified. Uses the reduce-scatter half of the ring
+ * in `sccl_allreduce`.
+ */
+sccl_error_t sccl_reduce_scatter(const sccl_stream_t *streams,
+                                 const sccl_buffer_t *src_buffers,
+                                 const sccl_buffer_t *dst_buffers,
+                                 size_t rank_count, size_t count,
+                                 sccl_dtype_t dtype, sccl_reduce_op_t op);
+
+/**
+ * Copy the first `size` bytes of `src_buffers[i]` to chunk `i` of every
+ * buffer in `dst_buffers`, which must hold `rank_count * size` bytes. Uses
+ * the all-gather half of the ring in `sccl_allreduce`.
+ */
+sccl_error_t sccl_all_gather(const sccl_stream_t *streams,
+                             const sccl_buffer_t *src_buffers,
+                             const sccl_buffer_t *dst_buffers,
+                             size_t rank_count, size_t size);
+
+/**
+ * Create persistent worker. Jobs are written to a ring in shared memory and
+ * executed by a long running kernel that polls the ring, so enqueuing a job
+ * is a memory write without any submission. A watchdog thread launches the
+ * kernel when jobs are pending, and stops it after `lifetime_ns` so it never
+ * runs into the driver timeout, the kernel also exits after `idle_polls`
+ * polls of an empty ring.
+ * While the kernel runs, commands of other streams on the device that wait
+ * for earlier commands also wait for the kernel to exit.
+ * Returns `sccl_unsupported_error` if the device has no descriptor table,
+ * see `sccl_get_buffer_descriptor_index`.
+ */
+sccl_error_t sccl_create_worker(const sccl_device_t device,
+                                const sccl_worker_config_t *config,
+                                sccl_worker_t *worker);
+
+/**
+ * Stop worker, jobs that are not done are dropped.
+ */
+void sccl_destroy_worker(sccl_worker_t worker);
+
+/**
+ * Enqueue job, `ticket` identifies it in `sccl_query_worker` and
+ * `sccl_wait_worker`. Jobs run in enqueue order, one at a time. Buffers must
+ * be storage buffers of the worker device and must not be destroyed before
+ * the job is done. Waits for a free slot if the ring is full.
+ * Safe to call from multiple threads.
+ */
+sccl_error_t sccl_enqueue_worker(const sccl_worker_t worker,
+                                 const sccl_worker_job_t *job,
+                                 uint64_t *ticket);
+
+/**
+ * Check if job `ticket` and all jobs enqueued before it are done.
+ */
+sccl_error_t sccl_query_worker(const sccl_worker_t worker, uint64_t ticket,
+                               bool *done);
+
+/**
+ * Wait until job `ticket` and all jobs enqueued before it are done.
+ */
+sccl_error_t sccl_wait_worker(const sccl_worker_t worker, uint64_t ticket);
+
+sccl_error_t sccl_get_worker_stats(const sccl_worker_t worker,
+                                   sccl_worker_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
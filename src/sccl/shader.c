@@ -1,14 +1,19 @@
 
 #include "shader.h"
 #include "alloc.h"
+#include "buffer.h"
 #include "device.h"
 #include "error.h"
 #include "sccl.h"
+#include "shader_cache.h"
+#include "stream.h"
 #include "vector.h"
 
-#include <inttypes.h>
-#include <stdio.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 typedef struct {
     uint32_t set;
@@ -160,28 +165,11 @@ sccl_buffer_type_to_vk_descriptor_type(const sccl_buffer_type_t type)
     }
 }
 
-static void
-count_buffer_types(const sccl_shader_buffer_layout_t *buffer_layouts,
-                   size_t buffer_layouts_count, size_t *storage_buffer_count,
-                   size_t *uniform_buffer_count)
-{
-    for (size_t i = 0; i < buffer_layouts_count; ++i) {
-        switch (
-            sccl_buffer_type_to_vk_descriptor_type(buffer_layouts[i].type)) {
-        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
-            ++storage_buffer_count;
-            break;
-        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
-            ++uniform_buffer_count;
-            break;
-        default:
-            assert(false);
-        }
-    }
-}
-
+/**
+ * Acquire one descriptor set layout per set from the device shader cache.
+ */
 static sccl_error_t create_descriptor_set_layouts(
-    VkDevice device, const sccl_shader_buffer_layout_t *buffer_layouts,
+    sccl_device_t device, const sccl_shader_buffer_layout_t *buffer_layouts,
     size_t buffer_layouts_count, VkDescriptorSetLayout **descriptor_set_layouts,
     size_t *descriptor_set_layouts_count)
 {
@@ -223,30 +211,14 @@ static sccl_error_t create_descriptor_set_layouts(
             descriptor_set_bindings[j].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
         }
 
-        VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info = {0};
-        descriptor_set_layout_create_info.sType =
-            VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        descriptor_set_layout_create_info.pBindings = descriptor_set_bindings;
-        descriptor_set_layout_create_info.bindingCount =
-            vector_get_size(&entry->buffer_layouts);
-
-        CHECK_VKRESULT_RET(vkCreateDescriptorSetLayout(
-            device, &descriptor_set_layout_create_info, NULL,
+        CHECK_SCCL_ERROR_RET(shader_cache_acquire_descriptor_set_layout(
+            device->device, &device->shader_cache, descriptor_set_bindings,
+            vector_get_size(&entry->buffer_layouts),
             &(*descriptor_set_layouts)[i]));
 
         sccl_free(descriptor_set_bindings);
     }
 
-    printf("vector_get_size(&descriptor_sets_to_allocate) = %lu\n",
-           vector_get_size(&descriptor_sets_to_allocate));
-    for (size_t i = 0; i < vector_get_size(&descriptor_sets_to_allocate); ++i) {
-        descriptor_set_entry_t *e =
-            vector_get_element(&descriptor_sets_to_allocate, i);
-        printf("descriptor_sets_to_allocate[%lu]: set = %" PRIu32
-               ", size = %lu\n",
-               i, e->set, vector_get_size(&e->buffer_layouts));
-    }
-
     /* destroy descriptor_sets_to_allocate */
     for (size_t i = 0; i < vector_get_size(&descriptor_sets_to_allocate); ++i) {
         descriptor_set_entry_destroy(
@@ -257,47 +229,159 @@ static sccl_error_t create_descriptor_set_layouts(
     return sccl_success;
 }
 
-static sccl_error_t create_descriptor_pool(VkDevice device,
-                                           size_t storage_buffer_count,
-                                           size_t uniform_buffer_count,
-                                           size_t max_descriptor_sets,
-                                           VkDescriptorPool *descriptor_pool)
-{
-    const size_t max_descriptor_pool_sizes_count = 2; /* storage and uniform */
-    VkDescriptorType structure_types[] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-                                          VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER};
-    size_t counts[] = {storage_buffer_count, uniform_buffer_count};
-
-    VkDescriptorPoolSize descriptor_pool_sizes[max_descriptor_pool_sizes_count];
-    memset(descriptor_pool_sizes, 0,
-           sizeof(VkDescriptorPoolSize) * max_descriptor_pool_sizes_count);
-
-    size_t actual_descriptor_pool_sizes_count = 0;
-    for (size_t i = 0; i < max_descriptor_pool_sizes_count; ++i) {
-        if (counts[i] > 0) {
-            descriptor_pool_sizes[actual_descriptor_pool_sizes_count].type =
-                structure_types[i];
-            descriptor_pool_sizes[actual_descriptor_pool_sizes_count]
-                .descriptorCount = counts[i];
-            ++actual_descriptor_pool_sizes_count;
+static sccl_error_t
+create_push_constant_ranges(const sccl_shader_push_constant_layout_t *layouts,
+                            size_t layouts_count, VkPushConstantRange **ranges,
+                            uint32_t *total_size)
+{
+    /* alloc returned memory, this needs to be freed! */
+    CHECK_SCCL_ERROR_RET(sccl_calloc((void **)ranges, layouts_count,
+                                     sizeof(VkPushConstantRange)));
+
+    /* pack ranges back to back in the order they are given */
+    uint32_t offset = 0;
+    for (size_t i = 0; i < layouts_count; ++i) {
+        /* push constant offsets and sizes must be multiples of 4 */
+        if (layouts[i].size == 0 || layouts[i].size % 4 != 0) {
+            return sccl_invalid_argument;
         }
+        (*ranges)[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        (*ranges)[i].offset = offset;
+        (*ranges)[i].size = layouts[i].size;
+        offset += layouts[i].size;
     }
+    *total_size = offset;
 
-    VkDescriptorPoolCreateInfo descriptor_pool_create_info = {0};
-    descriptor_pool_create_info.sType =
-        VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    descriptor_pool_create_info.poolSizeCount =
-        actual_descriptor_pool_sizes_count;
-    descriptor_pool_create_info.pPoolSizes = descriptor_pool_sizes;
-    descriptor_pool_create_info.maxSets = max_descriptor_sets;
-    CHECK_VKRESULT_RET(vkCreateDescriptorPool(
-        device, &descriptor_pool_create_info, NULL, descriptor_pool));
     return sccl_success;
 }
 
-sccl_error_t sccl_create_shader(const sccl_device_t device,
-                                sccl_shader_t *shader,
-                                const sccl_shader_config_t *config)
+/**
+ * Pack specialization constants back to back in `data` with one map entry per
+ * constant. Returned memory needs to be freed.
+ */
+static sccl_error_t create_specialization_info(
+    const sccl_shader_specialization_constant_t *constants,
+    size_t constants_count, VkSpecializationMapEntry **map_entries,
+    void **data, VkSpecializationInfo *info)
+{
+    size_t data_size = 0;
+    for (size_t i = 0; i < constants_count; ++i) {
+        if (constants[i].size == 0 || constants[i].data == NULL) {
+            return sccl_invalid_argument;
+        }
+        data_size += constants[i].size;
+    }
+
+    CHECK_SCCL_ERROR_RET(sccl_calloc((void **)map_entries, constants_count,
+                                     sizeof(VkSpecializationMapEntry)));
+    CHECK_SCCL_ERROR_RET(sccl_calloc(data, data_size, 1));
+
+    size_t offset = 0;
+    for (size_t i = 0; i < constants_count; ++i) {
+        (*map_entries)[i].constantID = constants[i].constant_id;
+        (*map_entries)[i].offset = (uint32_t)offset;
+        (*map_entries)[i].size = constants[i].size;
+        memcpy((char *)*data + offset, constants[i].data, constants[i].size);
+        offset += constants[i].size;
+    }
+
+    info->mapEntryCount = (uint32_t)constants_count;
+    info->pMapEntries = *map_entries;
+    info->dataSize = data_size;
+    info->pData = *data;
+
+    return sccl_success;
+}
+
+static uint64_t get_time_ns(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000 + (uint64_t)time.tv_nsec;
+}
+
+/**
+ * Acquire and allocate the objects of a zeroed shader, on error they are
+ * released by `shader_destroy_now`.
+ */
+static sccl_error_t init_shader_objects(const sccl_device_t device,
+                                        const sccl_shader_config_t *config,
+                                        struct sccl_shader *shader_internal)
+{
+    shader_internal->device = device;
+    shader_internal->bindless = config->bindless;
+    atomic_init(&shader_internal->compile_done, false);
+
+    /* shader modules and layouts are shared with identical shaders */
+    CHECK_SCCL_ERROR_RET(shader_cache_acquire_shader_module(
+        device->device, &device->shader_cache, config->shader_source_code,
+        config->shader_source_code_length, &shader_internal->shader_module));
+
+    /* create descriptor set layout based on provided config */
+    if (config->buffer_layouts != NULL && config->buffer_layouts_count > 0) {
+        CHECK_SCCL_ERROR_RET(create_descriptor_set_layouts(
+            device, config->buffer_layouts,
+            config->buffer_layouts_count,
+            &shader_internal->descriptor_set_layouts,
+            &shader_internal->descriptor_set_layouts_count));
+
+        /* keep buffer layouts, needed to write descriptor sets when running */
+        CHECK_SCCL_ERROR_RET(sccl_calloc(
+            (void **)&shader_internal->buffer_layouts,
+            config->buffer_layouts_count, sizeof(sccl_shader_buffer_layout_t)));
+        memcpy(shader_internal->buffer_layouts, config->buffer_layouts,
+               config->buffer_layouts_count *
+                   sizeof(sccl_shader_buffer_layout_t));
+        shader_internal->buffer_layouts_count = config->buffer_layouts_count;
+    }
+
+    /* create push constant ranges */
+    uint32_t push_constants_size = 0;
+    if (config->push_constant_layouts_count > 0) {
+        CHECK_SCCL_NULL_RET(config->push_constant_layouts);
+        CHECK_SCCL_ERROR_RET(create_push_constant_ranges(
+            config->push_constant_layouts, config->push_constant_layouts_count,
+            &shader_internal->push_constant_ranges, &push_constants_size));
+        shader_internal->push_constant_ranges_count =
+            config->push_constant_layouts_count;
+    }
+
+    /* create pipeline layout */
+    if (shader_internal->bindless) {
+        if (push_constants_size > SCCL_DESCRIPTOR_TABLE_PUSH_CONSTANT_SIZE) {
+            return sccl_invalid_argument;
+        }
+        shader_internal->pipeline_layout =
+            device->descriptor_table.pipeline_layout;
+    } else {
+        CHECK_SCCL_ERROR_RET(shader_cache_acquire_pipeline_layout(
+            device->device, &device->shader_cache,
+            shader_internal->descriptor_set_layouts,
+            (uint32_t)shader_internal->descriptor_set_layouts_count,
+            push_constants_size, &shader_internal->pipeline_layout));
+    }
+
+    /* create specialization info, freed by `create_pipeline` */
+    if (config->specialization_constants_count > 0) {
+        CHECK_SCCL_NULL_RET(config->specialization_constants);
+        CHECK_SCCL_ERROR_RET(create_specialization_info(
+            config->specialization_constants,
+            config->specialization_constants_count,
+            &shader_internal->specialization_map_entries,
+            &shader_internal->specialization_data,
+            &shader_internal->specialization_info));
+    }
+
+    return sccl_success;
+}
+
+/**
+ * Validate config and create everything of a shader except the compute
+ * pipeline, see `create_pipeline`.
+ */
+static sccl_error_t create_shader_objects(const sccl_device_t device,
+                                          const sccl_shader_config_t *config,
+                                          struct sccl_shader **shader)
 {
     /* validate config */
     CHECK_SCCL_NULL_RET(config);
@@ -305,74 +389,115 @@ sccl_error_t sccl_create_shader(const sccl_device_t device,
     if (config->shader_source_code_length <= 0) {
         return sccl_invalid_argument;
     }
+    if (config->bindless) {
+        /* bindless shaders get their buffers from the descriptor table */
+        if (config->buffer_layouts_count > 0) {
+            return sccl_invalid_argument;
+        }
+        if (!device->descriptor_table.supported) {
+            return sccl_unsupported_error;
+        }
+    }
 
     /* create internal handle */
     struct sccl_shader *shader_internal;
     CHECK_SCCL_ERROR_RET(
         sccl_calloc((void **)&shader_internal, 1, sizeof(struct sccl_shader)));
 
-    shader_internal->device = device->device;
+    sccl_error_t error = init_shader_objects(device, config, shader_internal);
+    if (error != sccl_success) {
+        shader_destroy_now(shader_internal);
+        return error;
+    }
 
-    /* create shader module */
-    VkShaderModuleCreateInfo shader_module_create_info = {0};
-    shader_module_create_info.sType =
-        VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    shader_module_create_info.codeSize = config->shader_source_code_length;
-    shader_module_create_info.pCode =
-        (const uint32_t *)config->shader_source_code;
-    CHECK_VKRESULT_RET(
-        vkCreateShaderModule(device->device, &shader_module_create_info,
-                             VK_NULL_HANDLE, &shader_internal->shader_module));
+    *shader = shader_internal;
 
-    /* create descriptor set layout based on provided config */
-    if (config->buffer_layouts != NULL) {
-        CHECK_SCCL_ERROR_RET(create_descriptor_set_layouts(
-            shader_internal->device, config->buffer_layouts,
-            config->buffer_layouts_count,
-            &shader_internal->descriptor_set_layouts,
-            &shader_internal->descriptor_set_layouts_count));
-    }
+    return sccl_success;
+}
 
-    /* create descriptor pool */
-    size_t storage_buffer_count = 0;
-    size_t uniform_buffer_count = 0;
-    count_buffer_types(config->buffer_layouts, config->buffer_layouts_count,
-                       &storage_buffer_count, &uniform_buffer_count);
-    if (storage_buffer_count > 0 || uniform_buffer_count > 0) {
-        CHECK_SCCL_ERROR_RET(create_descriptor_pool(
-            shader_internal->device, storage_buffer_count, uniform_buffer_count,
-            shader_internal->descriptor_set_layouts_count,
-            &shader_internal->descriptor_pool));
-    }
-
-    /* create compute pipeline */
-    VkPipelineLayoutCreateInfo pipeline_layout_create_info = {0};
-    pipeline_layout_create_info.sType =
-        VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipeline_layout_create_info.pSetLayouts =
-        shader_internal->descriptor_set_layouts;
-    pipeline_layout_create_info.setLayoutCount =
-        shader_internal->descriptor_set_layouts_count;
-    CHECK_VKRESULT_RET(
-        vkCreatePipelineLayout(device->device, &pipeline_layout_create_info,
-                               NULL, &shader_internal->pipeline_layout));
+/**
+ * Create compute pipeline of shader from `create_shader_objects` and record
+ * creation feedback. Only touches the shader and the internally synchronized
+ * pipeline cache, so it can run on any thread.
+ */
+static sccl_error_t create_pipeline(struct sccl_shader *shader)
+{
+    sccl_device_t device = shader->device;
 
     VkPipelineShaderStageCreateInfo pipeline_shader_stage_create_info = {0};
     pipeline_shader_stage_create_info.sType =
         VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     pipeline_shader_stage_create_info.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-    pipeline_shader_stage_create_info.module = shader_internal->shader_module;
+    pipeline_shader_stage_create_info.module = shader->shader_module;
     pipeline_shader_stage_create_info.pName = "main";
-    pipeline_shader_stage_create_info.pSpecializationInfo = NULL;
+    if (shader->specialization_map_entries != NULL) {
+        pipeline_shader_stage_create_info.pSpecializationInfo =
+            &shader->specialization_info;
+    }
 
     VkComputePipelineCreateInfo compute_pipeline_create_info = {0};
     compute_pipeline_create_info.sType =
         VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-    compute_pipeline_create_info.layout = shader_internal->pipeline_layout;
+    compute_pipeline_create_info.layout = shader->pipeline_layout;
     compute_pipeline_create_info.stage = pipeline_shader_stage_create_info;
-    CHECK_VKRESULT_RET(vkCreateComputePipelines(
-        device->device, NULL, 1, &compute_pipeline_create_info, NULL,
-        &shader_internal->compute_pipeline));
+
+    /* compute pipelines have exactly one stage */
+    VkPipelineCreationFeedback pipeline_feedback = {0};
+    VkPipelineCreationFeedback stage_feedback = {0};
+    VkPipelineCreationFeedbackCreateInfo feedback_create_info = {0};
+    if (device->pipeline_creation_feedback_supported) {
+        feedback_create_info.sType =
+            VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO;
+        feedback_create_info.pPipelineCreationFeedback = &pipeline_feedback;
+        feedback_create_info.pipelineStageCreationFeedbackCount = 1;
+        feedback_create_info.pPipelineStageCreationFeedbacks = &stage_feedback;
+        compute_pipeline_create_info.pNext = &feedback_create_info;
+    }
+
+    uint64_t start_ns = get_time_ns();
+    VkResult result = vkCreateComputePipelines(
+        device->device, device->pipeline_cache, 1,
+        &compute_pipeline_create_info, NULL, &shader->compute_pipeline);
+    uint64_t duration_ns = get_time_ns() - start_ns;
+
+    if (shader->specialization_map_entries != NULL) {
+        sccl_free(shader->specialization_map_entries);
+        sccl_free(shader->specialization_data);
+        shader->specialization_map_entries = NULL;
+        shader->specialization_data = NULL;
+    }
+    CHECK_VKRESULT_RET(result);
+
+    /* driver may leave feedback invalid even if the extension is enabled */
+    VkPipelineCreationFeedbackFlags flags = pipeline_feedback.flags;
+    if (flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT) {
+        shader->feedback.valid = true;
+        shader->feedback.cache_hit =
+            flags &
+            VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT;
+        shader->feedback.duration_ns = pipeline_feedback.duration;
+    } else {
+        shader->feedback.duration_ns = duration_ns;
+    }
+
+    return sccl_success;
+}
+
+sccl_error_t sccl_create_shader(const sccl_device_t device,
+                                sccl_shader_t *shader,
+                                const sccl_shader_config_t *config)
+{
+    struct sccl_shader *shader_internal;
+    CHECK_SCCL_ERROR_RET(
+        create_shader_objects(device, config, &shader_internal));
+
+    sccl_error_t error = create_pipeline(shader_internal);
+    if (error != sccl_success) {
+        shader_destroy_now(shader_internal);
+        return error;
+    }
+    shader_internal->compile_error = sccl_success;
+    atomic_store(&shader_internal->compile_done, true);
 
     /* set public handle */
     *shader = (sccl_shader_t)shader_internal;
@@ -380,26 +505,564 @@ sccl_error_t sccl_create_shader(const sccl_device_t device,
     return sccl_success;
 }
 
-void sccl_destroy_shader(sccl_shader_t shader)
+/**
+ * Processors available for compiling, at least 1 and at most
+ * `SHADER_MAX_COMPILE_THREADS`.
+ */
+static size_t get_compile_thread_limit(void)
+{
+    long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t thread_count = cpu_count > 1 ? (size_t)cpu_count : 1;
+    if (thread_count > SHADER_MAX_COMPILE_THREADS) {
+        thread_count = SHADER_MAX_COMPILE_THREADS;
+    }
+    return thread_count;
+}
+
+static void compile_shader(struct sccl_shader *shader)
+{
+    sccl_error_t error = create_pipeline(shader);
+
+    pthread_mutex_lock(&shader->compile_mutex);
+    shader->compile_error = error;
+    atomic_store(&shader->compile_done, true);
+    pthread_cond_broadcast(&shader->compile_cond);
+    pthread_mutex_unlock(&shader->compile_mutex);
+}
+
+static void *compile_pool_main(void *arg)
+{
+    shader_compile_pool_t *pool = arg;
+    pthread_mutex_lock(&pool->mutex);
+    while (true) {
+        while (pool->queue_head == NULL && !pool->stopping) {
+            ++pool->idle_count;
+            pthread_cond_wait(&pool->cond, &pool->mutex);
+            --pool->idle_count;
+        }
+        if (pool->queue_head == NULL) {
+            break;
+        }
+        struct sccl_shader *shader = pool->queue_head;
+        pool->queue_head = shader->compile_next;
+        if (pool->queue_head == NULL) {
+            pool->queue_tail = NULL;
+        }
+        --pool->queue_count;
+
+        pthread_mutex_unlock(&pool->mutex);
+        compile_shader(shader);
+        pthread_mutex_lock(&pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+sccl_error_t shader_compile_pool_init(shader_compile_pool_t *pool)
+{
+    *pool = (shader_compile_pool_t){0};
+    if (pthread_mutex_init(&pool->mutex, NULL) != 0) {
+        return sccl_system_error;
+    }
+    if (pthread_cond_init(&pool->cond, NULL) != 0) {
+        pthread_mutex_destroy(&pool->mutex);
+        return sccl_system_error;
+    }
+    pool->thread_limit = get_compile_thread_limit();
+    return sccl_success;
+}
+
+void shader_compile_pool_destroy(shader_compile_pool_t *pool)
+{
+    pthread_mutex_lock(&pool->mutex);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+    for (size_t i = 0; i < pool->thread_count; ++i) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->mutex);
+}
+
+static sccl_error_t compile_pool_push(shader_compile_pool_t *pool,
+                                      struct sccl_shader *shader)
+{
+    pthread_mutex_lock(&pool->mutex);
+    /* a new thread only if every idle one already has a job waiting */
+    if (pool->idle_count <= pool->queue_count &&
+        pool->thread_count < pool->thread_limit &&
+        pthread_create(&pool->threads[pool->thread_count], NULL,
+                       compile_pool_main, pool) == 0) {
+        ++pool->thread_count;
+    }
+    if (pool->thread_count == 0) {
+        pthread_mutex_unlock(&pool->mutex);
+        return sccl_system_error;
+    }
+
+    shader->compile_next = NULL;
+    if (pool->queue_tail != NULL) {
+        pool->queue_tail->compile_next = shader;
+    } else {
+        pool->queue_head = shader;
+    }
+    pool->queue_tail = shader;
+    ++pool->queue_count;
+    pthread_cond_signal(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    return sccl_success;
+}
+
+/**
+ * Remove shader from the queue, returns false if it was not queued because a
+ * thread already took it.
+ */
+static bool compile_pool_remove(shader_compile_pool_t *pool,
+                                struct sccl_shader *shader)
 {
-    vkDestroyPipeline(shader->device, shader->compute_pipeline, NULL);
-    vkDestroyPipelineLayout(shader->device, shader->pipeline_layout, NULL);
-    if (shader->descriptor_pool != NULL) {
-        vkDestroyDescriptorPool(shader->device, shader->descriptor_pool, NULL);
+    bool removed = false;
+    pthread_mutex_lock(&pool->mutex);
+    struct sccl_shader *previous = NULL;
+    for (struct sccl_shader *it = pool->queue_head; it != NULL;
+         it = it->compile_next) {
+        if (it != shader) {
+            previous = it;
+            continue;
+        }
+        if (previous != NULL) {
+            previous->compile_next = it->compile_next;
+        } else {
+            pool->queue_head = it->compile_next;
+        }
+        if (pool->queue_tail == it) {
+            pool->queue_tail = previous;
+        }
+        --pool->queue_count;
+        removed = true;
+        break;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return removed;
+}
+
+sccl_error_t sccl_create_shader_async(const sccl_device_t device,
+                                      sccl_shader_t *shader,
+                                      const sccl_shader_config_t *config)
+{
+    struct sccl_shader *shader_internal;
+    CHECK_SCCL_ERROR_RET(
+        create_shader_objects(device, config, &shader_internal));
+
+    if (pthread_mutex_init(&shader_internal->compile_mutex, NULL) != 0) {
+        shader_destroy_now(shader_internal);
+        return sccl_system_error;
+    }
+    if (pthread_cond_init(&shader_internal->compile_cond, NULL) != 0) {
+        pthread_mutex_destroy(&shader_internal->compile_mutex);
+        shader_destroy_now(shader_internal);
+        return sccl_system_error;
+    }
+    shader_internal->async = true;
+    sccl_error_t error =
+        compile_pool_push(&device->shader_compile_pool, shader_internal);
+    if (error != sccl_success) {
+        shader_internal->async = false;
+        pthread_cond_destroy(&shader_internal->compile_cond);
+        pthread_mutex_destroy(&shader_internal->compile_mutex);
+        shader_destroy_now(shader_internal);
+        return error;
+    }
+
+    /* set public handle */
+    *shader = (sccl_shader_t)shader_internal;
+
+    return sccl_success;
+}
+
+sccl_error_t sccl_wait_shader(const sccl_shader_t shader)
+{
+    if (!atomic_load(&shader->compile_done)) {
+        pthread_mutex_lock(&shader->compile_mutex);
+        while (!atomic_load(&shader->compile_done)) {
+            pthread_cond_wait(&shader->compile_cond, &shader->compile_mutex);
+        }
+        pthread_mutex_unlock(&shader->compile_mutex);
+    }
+    return shader->compile_error;
+}
+
+sccl_error_t sccl_get_shader_feedback(const sccl_shader_t shader,
+                                      sccl_shader_feedback_t *feedback)
+{
+    CHECK_SCCL_NULL_RET(feedback);
+    if (!atomic_load(&shader->compile_done)) {
+        return sccl_not_ready;
+    }
+    CHECK_SCCL_ERROR_RET(shader->compile_error);
+    *feedback = shader->feedback;
+    return sccl_success;
+}
+
+typedef struct {
+    sccl_device_t device;
+    const sccl_shader_config_t *configs;
+    size_t count;
+    sccl_shader_t *shaders;
+    sccl_error_t *errors;
+    atomic_size_t next_index;
+} create_shaders_context_t;
+
+static void *create_shaders_main(void *arg)
+{
+    create_shaders_context_t *context = arg;
+    while (true) {
+        size_t i = atomic_fetch_add(&context->next_index, 1);
+        if (i >= context->count) {
+            return NULL;
+        }
+        context->errors[i] = sccl_create_shader(
+            context->device, &context->shaders[i], &context->configs[i]);
+    }
+}
+
+sccl_error_t sccl_create_shaders(const sccl_device_t device,
+                                 const sccl_shader_config_t *configs,
+                                 size_t count, sccl_shader_t *shaders)
+{
+    if (count == 0) {
+        return sccl_success;
+    }
+    CHECK_SCCL_NULL_RET(configs);
+    CHECK_SCCL_NULL_RET(shaders);
+
+    create_shaders_context_t context = {0};
+    context.device = device;
+    context.configs = configs;
+    context.count = count;
+    context.shaders = shaders;
+    atomic_init(&context.next_index, 0);
+    CHECK_SCCL_ERROR_RET(
+        sccl_calloc((void **)&context.errors, count, sizeof(sccl_error_t)));
+
+    /* calling thread compiles too, so at least one thread always runs */
+    size_t thread_count = get_compile_thread_limit();
+    if (thread_count > count) {
+        thread_count = count;
+    }
+    pthread_t threads[SHADER_MAX_COMPILE_THREADS];
+    size_t started_count = 0;
+    for (size_t i = 1; i < thread_count; ++i) {
+        if (pthread_create(&threads[started_count], NULL, create_shaders_main,
+                           &context) != 0) {
+            break;
+        }
+        ++started_count;
+    }
+    create_shaders_main(&context);
+    for (size_t i = 0; i < started_count; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    /* all or nothing, destroy created shaders if any failed */
+    sccl_error_t error = sccl_success;
+    for (size_t i = 0; i < count && error == sccl_success; ++i) {
+        error = context.errors[i];
+    }
+    if (error != sccl_success) {
+        for (size_t i = 0; i < count; ++i) {
+            if (context.errors[i] == sccl_success) {
+                shader_destroy_now(shaders[i]);
+            }
+        }
+    }
+    sccl_free(context.errors);
+
+    return error;
+}
+
+void shader_destroy_now(sccl_shader_t shader)
+{
+    if (shader->async) {
+        /* pipeline compile uses module and layout, let it finish first
+         * unless it has not started, waits under the mutex so the compiling
+         * thread has released it before it is destroyed */
+        if (!compile_pool_remove(&shader->device->shader_compile_pool,
+                                 shader)) {
+            pthread_mutex_lock(&shader->compile_mutex);
+            while (!atomic_load(&shader->compile_done)) {
+                pthread_cond_wait(&shader->compile_cond,
+                                  &shader->compile_mutex);
+            }
+            pthread_mutex_unlock(&shader->compile_mutex);
+        }
+        pthread_cond_destroy(&shader->compile_cond);
+        pthread_mutex_destroy(&shader->compile_mutex);
+    }
+
+    VkDevice device = shader->device->device;
+    shader_cache_t *cache = &shader->device->shader_cache;
+    vkDestroyPipeline(device, shader->compute_pipeline, NULL);
+    if (!shader->bindless && shader->pipeline_layout != VK_NULL_HANDLE) {
+        shader_cache_release_pipeline_layout(device, cache,
+                                             shader->pipeline_layout);
     }
     if (shader->descriptor_set_layouts != NULL) {
         for (size_t i = 0; i < shader->descriptor_set_layouts_count; ++i) {
-            vkDestroyDescriptorSetLayout(
-                shader->device, shader->descriptor_set_layouts[i], NULL);
+            shader_cache_release_descriptor_set_layout(
+                device, cache, shader->descriptor_set_layouts[i]);
         }
         sccl_free(shader->descriptor_set_layouts);
     }
+    if (shader->buffer_layouts != NULL) {
+        sccl_free(shader->buffer_layouts);
+    }
+    if (shader->push_constant_ranges != NULL) {
+        sccl_free(shader->push_constant_ranges);
+    }
+    if (shader->specialization_map_entries != NULL) {
+        sccl_free(shader->specialization_map_entries);
+        sccl_free(shader->specialization_data);
+    }
+
+    if (shader->shader_module != VK_NULL_HANDLE) {
+        shader_cache_release_shader_module(device, cache,
+                                           shader->shader_module);
+    }
+
+    sccl_free(shader);
+}
+
+void sccl_destroy_shader(sccl_shader_t shader)
+{
+    sccl_device_t device = shader->device;
+    pthread_mutex_lock(&device->mutex);
+    /* destroyed when the last stream that recorded the shader is joined */
+    bool deferred = shader->pending_use_count > 0;
+    shader->destroy_pending = deferred;
+    pthread_mutex_unlock(&device->mutex);
+    if (!deferred) {
+        shader_destroy_now(shader);
+    }
+}
+
+sccl_error_t sccl_get_shader_cache_stats(const sccl_device_t device,
+                                         sccl_shader_cache_stats_t *stats)
+{
+    CHECK_SCCL_NULL_RET(stats);
+    shader_cache_get_stats(&device->shader_cache, stats);
+    return sccl_success;
+}
+
+static const sccl_shader_buffer_layout_t *
+find_buffer_layout(const sccl_shader_t shader,
+                   const sccl_shader_buffer_position_t *position)
+{
+    for (size_t i = 0; i < shader->buffer_layouts_count; ++i) {
+        const sccl_shader_buffer_layout_t *layout = &shader->buffer_layouts[i];
+        if (layout->position.set == position->set &&
+            layout->position.binding == position->binding) {
+            return layout;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Checks that every buffer layout of shader is bound exactly once with a
+ * buffer of matching descriptor type, and that all push constant indices are
+ * valid.
+ */
+static bool validate_run_params(const sccl_shader_t shader,
+                                const sccl_shader_run_params_t *params)
+{
+    if (params->buffer_bindings_count != shader->buffer_layouts_count) {
+        return false;
+    }
+    for (size_t i = 0; i < params->buffer_bindings_count; ++i) {
+        const sccl_shader_buffer_binding_t *binding =
+            &params->buffer_bindings[i];
+        const sccl_shader_buffer_layout_t *layout =
+            find_buffer_layout(shader, &binding->position);
+        if (layout == NULL || binding->buffer == SCCL_NULL) {
+            return false;
+        }
+        if (sccl_buffer_type_to_vk_descriptor_type(layout->type) !=
+            sccl_buffer_type_to_vk_descriptor_type(binding->buffer->type)) {
+            return false;
+        }
+        /* duplicate positions would leave some other layout unbound */
+        for (size_t j = 0; j < i; ++j) {
+            const sccl_shader_buffer_position_t *other =
+                &params->buffer_bindings[j].position;
+            if (other->set == binding->position.set &&
+                other->binding == binding->position.binding) {
+                return false;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < params->push_constant_bindings_count; ++i) {
+        const sccl_shader_push_constant_binding *binding =
+            &params->push_constant_bindings[i];
+        if (binding->index >= shader->push_constant_ranges_count ||
+            binding->data == NULL) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static sccl_error_t bind_buffers(const sccl_stream_t stream,
+                                 const sccl_shader_t shader,
+                                 const sccl_shader_run_params_t *params)
+{
+    /* tracking may move buffer memory, so track before reading VkBuffer */
+    for (size_t i = 0; i < params->buffer_bindings_count; ++i) {
+        CHECK_SCCL_ERROR_RET(
+            stream_track_buffer(stream, params->buffer_bindings[i].buffer));
+    }
+
+    VkDescriptorSet *descriptor_sets;
+    CHECK_SCCL_ERROR_RET(sccl_calloc((void **)&descriptor_sets,
+                                     shader->descriptor_set_layouts_count,
+                                     sizeof(VkDescriptorSet)));
+    CHECK_SCCL_ERROR_RET(stream_allocate_descriptor_sets(
+        stream, shader->descriptor_set_layouts,
+        shader->descriptor_set_layouts_count, descriptor_sets));
+
+    VkDescriptorBufferInfo *descriptor_buffer_infos;
+    CHECK_SCCL_ERROR_RET(sccl_calloc((void **)&descriptor_buffer_infos,
+                                     params->buffer_bindings_count,
+                                     sizeof(VkDescriptorBufferInfo)));
+    VkWriteDescriptorSet *write_descriptor_sets;
+    CHECK_SCCL_ERROR_RET(sccl_calloc((void **)&write_descriptor_sets,
+                                     params->buffer_bindings_count,
+                                     sizeof(VkWriteDescriptorSet)));
+
+    for (size_t i = 0; i < params->buffer_bindings_count; ++i) {
+        const sccl_shader_buffer_binding_t *binding =
+            &params->buffer_bindings[i];
+
+        descriptor_buffer_infos[i].buffer = binding->buffer->buffer;
+        descriptor_buffer_infos[i].offset = 0;
+        descriptor_buffer_infos[i].range = VK_WHOLE_SIZE;
+
+        /* sets are validated to be a contiguous range starting at 0 */
+        write_descriptor_sets[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write_descriptor_sets[i].dstSet =
+            descriptor_sets[binding->position.set];
+        write_descriptor_sets[i].dstBinding = binding->position.binding;
+        write_descriptor_sets[i].dstArrayElement = 0;
+        write_descriptor_sets[i].descriptorCount = 1;
+        write_descriptor_sets[i].descriptorType =
+            sccl_buffer_type_to_vk_descriptor_type(binding->buffer->type);
+        write_descriptor_sets[i].pBufferInfo = &descriptor_buffer_infos[i];
+    }
+
+    vkUpdateDescriptorSets(shader->device->device,
+                           params->buffer_bindings_count, write_descriptor_sets,
+                           0, NULL);
+
+    vkCmdBindDescriptorSets(stream->command_buffer,
+                            VK_PIPELINE_BIND_POINT_COMPUTE,
+                            shader->pipeline_layout, 0,
+                            shader->descriptor_set_layouts_count,
+                            descriptor_sets, 0, NULL);
+    /* set 0 now has this shader's layout, next bindless run must rebind the
+     * descriptor table */
+    stream->descriptor_table_bound = false;
+
+    sccl_free(write_descriptor_sets);
+    sccl_free(descriptor_buffer_infos);
+    sccl_free(descriptor_sets);
+
+    return sccl_success;
+}
+
+/**
+ * Record everything of a shader run except the dispatch itself.
+ */
+static sccl_error_t record_shader_state(const sccl_stream_t stream,
+                                        const sccl_shader_t shader,
+                                        const sccl_shader_run_params_t *params)
+{
+    CHECK_SCCL_NULL_RET(params);
+    if (!validate_run_params(shader, params)) {
+        return sccl_invalid_argument;
+    }
+
+    if (params->fail_if_not_ready && !atomic_load(&shader->compile_done)) {
+        return sccl_not_ready;
+    }
+    CHECK_SCCL_ERROR_RET(sccl_wait_shader(shader));
+
+    CHECK_SCCL_ERROR_RET(stream_track_shader(stream, shader));
+
+    vkCmdBindPipeline(stream->command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                      shader->compute_pipeline);
+
+    if (shader->bindless) {
+        CHECK_SCCL_ERROR_RET(stream_track_bindless(stream));
+        stream_bind_descriptor_table(stream);
+    } else if (shader->descriptor_set_layouts_count > 0) {
+        CHECK_SCCL_ERROR_RET(bind_buffers(stream, shader, params));
+    }
+
+    for (size_t i = 0; i < params->push_constant_bindings_count; ++i) {
+        const sccl_shader_push_constant_binding *binding =
+            &params->push_constant_bindings[i];
+        const VkPushConstantRange *range =
+            &shader->push_constant_ranges[binding->index];
+        vkCmdPushConstants(stream->command_buffer, shader->pipeline_layout,
+                           range->stageFlags, range->offset, range->size,
+                           binding->data);
+    }
 
-    vkDestroyShaderModule(shader->device, shader->shader_module, NULL);
+    return sccl_success;
+}
+
+sccl_error_t sccl_run_shader(const sccl_stream_t stream,
+                             const sccl_shader_t shader,
+                             const sccl_shader_run_params_t *params)
+{
+    CHECK_SCCL_ERROR_RET(record_shader_state(stream, shader, params));
+
+    vkCmdDispatch(stream->command_buffer, params->group_count_x,
+                  params->group_count_y, params->group_count_z);
+
+    /* create barrier so next command will wait until this is finished */
+    stream_record_barrier(stream);
+
+    return sccl_success;
 }
 
-// sccl_error_t sccl_run_shader(const sccl_shader_t shader, const
-// sccl_shader_run_params_t *params)
-//{
-//     return sccl_success;
-// }
+sccl_error_t sccl_run_shader_indirect(const sccl_stream_t stream,
+                                      const sccl_shader_t shader,
+                                      const sccl_buffer_t args_buffer,
+                                      size_t args_offset,
+                                      const sccl_shader_run_params_t *params)
+{
+    CHECK_SCCL_NULL_RET(args_buffer);
+    if (args_buffer->device != stream->device ||
+        !buffer_is_storage(args_buffer) ||
+        args_offset % sizeof(uint32_t) != 0 ||
+        args_offset > args_buffer->size ||
+        args_buffer->size - args_offset < SCCL_INDIRECT_ARGS_SIZE) {
+        return sccl_invalid_argument;
+    }
+
+    CHECK_SCCL_ERROR_RET(stream_track_buffer(stream, args_buffer));
+    CHECK_SCCL_ERROR_RET(record_shader_state(stream, shader, params));
+
+    /* barriers of earlier commands cover the indirect command read */
+    vkCmdDispatchIndirect(stream->command_buffer, args_buffer->buffer,
+                          args_offset);
+
+    stream_record_barrier(stream);
+
+    return sccl_success;
+}
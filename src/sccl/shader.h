@@ -2,16 +2,90 @@
 #ifndef SHADER_HEADER
 #define SHADER_HEADER
 
+#include "sccl.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <vulkan/vulkan.h>
 
+/* upper bound on threads used by `sccl_create_shaders` and by the compile
+ * pool of a device */
+#define SHADER_MAX_COMPILE_THREADS 16
+
+/**
+ * Device wide threads compiling the pipelines of `sccl_create_shader_async`
+ * shaders in FIFO order. A thread is started when a job is queued and no
+ * thread is idle, up to `SHADER_MAX_COMPILE_THREADS` or the processor count,
+ * threads run until the pool is destroyed.
+ */
+typedef struct {
+    pthread_mutex_t mutex;
+    /* signaled when a job is queued or the pool is stopping */
+    pthread_cond_t cond;
+    /* queued shaders linked through `sccl_shader::compile_next` */
+    struct sccl_shader *queue_head;
+    struct sccl_shader *queue_tail;
+    size_t queue_count;
+    pthread_t threads[SHADER_MAX_COMPILE_THREADS];
+    size_t thread_count;
+    size_t thread_limit;
+    /* threads waiting for a job */
+    size_t idle_count;
+    bool stopping;
+} shader_compile_pool_t;
+
 struct sccl_shader {
-    VkDevice device;
+    sccl_device_t device;
+    bool bindless;
     VkShaderModule shader_module;
     VkDescriptorSetLayout *descriptor_set_layouts;
     size_t descriptor_set_layouts_count;
-    VkDescriptorPool descriptor_pool;
+    /* copy of `sccl_shader_config_t::buffer_layouts` */
+    sccl_shader_buffer_layout_t *buffer_layouts;
+    size_t buffer_layouts_count;
+    /* one range per `sccl_shader_config_t::push_constant_layouts` entry,
+     * packed back to back */
+    VkPushConstantRange *push_constant_ranges;
+    size_t push_constant_ranges_count;
+    /* owned by device descriptor table if shader is bindless */
     VkPipelineLayout pipeline_layout;
     VkPipeline compute_pipeline;
+    /* kept until the pipeline is compiled, NULL without constants */
+    VkSpecializationMapEntry *specialization_map_entries;
+    void *specialization_data;
+    VkSpecializationInfo specialization_info;
+    /* pipeline is compiled by the device compile pool, see
+     * `sccl_create_shader_async` */
+    bool async;
+    /* next shader in the compile pool queue */
+    struct sccl_shader *compile_next;
+    /* protects `compile_cond` waits, only used if `async` */
+    pthread_mutex_t compile_mutex;
+    pthread_cond_t compile_cond;
+    /* set when compiling finished, `compile_error` is the result */
+    atomic_bool compile_done;
+    sccl_error_t compile_error;
+    sccl_shader_feedback_t feedback;
+    /* number of times shader is recorded in streams that are not joined yet */
+    uint32_t pending_use_count;
+    /* see `sccl_buffer::tracked_stream` */
+    sccl_stream_t tracked_stream;
+    uint64_t tracked_epoch;
+    /* `sccl_destroy_shader` is called while shader is in use, shader is
+     * destroyed when `pending_use_count` reaches 0 */
+    bool destroy_pending;
 };
 
+/**
+ * Destroy shader right away, shader must not be used by pending work.
+ */
+void shader_destroy_now(sccl_shader_t shader);
+
+sccl_error_t shader_compile_pool_init(shader_compile_pool_t *pool);
+
+/**
+ * Stop the threads after the queued jobs are done.
+ */
+void shader_compile_pool_destroy(shader_compile_pool_t *pool);
+
 #endif // SHADER_HEADER
\ No newline at end of file
@@ -0,0 +1,359 @@
+
+#include "shader_cache.h"
+#include "alloc.h"
+#include "error.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+typedef struct {
+    uint64_t hash;
+    void *key;
+    size_t key_size;
+    uint32_t reference_count;
+    union {
+        VkShaderModule shader_module;
+        VkDescriptorSetLayout descriptor_set_layout;
+        VkPipelineLayout pipeline_layout;
+    } object;
+} shader_cache_entry_t;
+
+/* FNV-1a */
+static uint64_t hash_bytes(const void *data, size_t size)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+/**
+ * Find entry with key, take a reference and count a hit if found.
+ */
+static shader_cache_entry_t *acquire_entry(shader_cache_t *cache,
+                                           const vector_t *entries,
+                                           uint64_t hash, const void *key,
+                                           size_t key_size)
+{
+    for (size_t i = 0; i < vector_get_size(entries); ++i) {
+        shader_cache_entry_t *entry = vector_get_element(entries, i);
+        if (entry->hash == hash && entry->key_size == key_size &&
+            memcmp(entry->key, key, key_size) == 0) {
+            ++entry->reference_count;
+            ++cache->hit_count;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Add entry with one reference, key is copied.
+ */
+static sccl_error_t add_entry(vector_t *entries, uint64_t hash,
+                              const void *key, size_t key_size,
+                              shader_cache_entry_t *entry)
+{
+    entry->hash = hash;
+    entry->key_size = key_size;
+    entry->reference_count = 1;
+    CHECK_SCCL_ERROR_RET(sccl_calloc(&entry->key, key_size, 1));
+    memcpy(entry->key, key, key_size);
+    sccl_error_t error = vector_add_element(entries, entry);
+    if (error != sccl_success) {
+        sccl_free(entry->key);
+    }
+    return error;
+}
+
+/**
+ * Drop a reference of entry at `index`, returns true if it was the last one
+ * and the entry is removed.
+ */
+static bool release_entry(vector_t *entries, size_t index)
+{
+    shader_cache_entry_t *entry = vector_get_element(entries, index);
+    if (--entry->reference_count > 0) {
+        return false;
+    }
+    sccl_free(entry->key);
+    vector_swap_remove_element(entries, index);
+    return true;
+}
+
+sccl_error_t shader_cache_init(shader_cache_t *cache)
+{
+    memset(cache, 0, sizeof(shader_cache_t));
+    if (pthread_mutex_init(&cache->mutex, NULL) != 0) {
+        return sccl_system_error;
+    }
+    CHECK_SCCL_ERROR_RET(
+        vector_init(&cache->shader_modules, sizeof(shader_cache_entry_t)));
+    CHECK_SCCL_ERROR_RET(vector_init(&cache->descriptor_set_layouts,
+                                     sizeof(shader_cache_entry_t)));
+    CHECK_SCCL_ERROR_RET(
+        vector_init(&cache->pipeline_layouts, sizeof(shader_cache_entry_t)));
+    return sccl_success;
+}
+
+void shader_cache_destroy(VkDevice device, shader_cache_t *cache)
+{
+    /* pipeline layouts reference descriptor set layouts, destroy them first */
+    for (size_t i = 0; i < vector_get_size(&cache->pipeline_layouts); ++i) {
+        shader_cache_entry_t *entry =
+            vector_get_element(&cache->pipeline_layouts, i);
+        vkDestroyPipelineLayout(device, entry->object.pipeline_layout, NULL);
+        sccl_free(entry->key);
+    }
+    for (size_t i = 0; i < vector_get_size(&cache->descriptor_set_layouts);
+         ++i) {
+        shader_cache_entry_t *entry =
+            vector_get_element(&cache->descriptor_set_layouts, i);
+        vkDestroyDescriptorSetLayout(device,
+                                     entry->object.descriptor_set_layout, NULL);
+        sccl_free(entry->key);
+    }
+    for (size_t i = 0; i < vector_get_size(&cache->shader_modules); ++i) {
+        shader_cache_entry_t *entry =
+            vector_get_element(&cache->shader_modules, i);
+        vkDestroyShaderModule(device, entry->object.shader_module, NULL);
+        sccl_free(entry->key);
+    }
+    vector_destroy(&cache->pipeline_layouts);
+    vector_destroy(&cache->descriptor_set_layouts);
+    vector_destroy(&cache->shader_modules);
+    pthread_mutex_destroy(&cache->mutex);
+}
+
+sccl_error_t shader_cache_acquire_shader_module(VkDevice device,
+                                                shader_cache_t *cache,
+                                                const void *code,
+                                                size_t code_size,
+                                                VkShaderModule *shader_module)
+{
+    uint64_t hash = hash_bytes(code, code_size);
+
+    pthread_mutex_lock(&cache->mutex);
+    shader_cache_entry_t *found =
+        acquire_entry(cache, &cache->shader_modules, hash, code, code_size);
+    if (found != NULL) {
+        *shader_module = found->object.shader_module;
+        pthread_mutex_unlock(&cache->mutex);
+        return sccl_success;
+    }
+
+    VkShaderModuleCreateInfo shader_module_create_info = {0};
+    shader_module_create_info.sType =
+        VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shader_module_create_info.codeSize = code_size;
+    shader_module_create_info.pCode = (const uint32_t *)code;
+    shader_cache_entry_t entry = {0};
+    if (vkCreateShaderModule(device, &shader_module_create_info, NULL,
+                             &entry.object.shader_module) != VK_SUCCESS) {
+        pthread_mutex_unlock(&cache->mutex);
+        return sccl_unhandled_vulkan_error;
+    }
+    sccl_error_t error =
+        add_entry(&cache->shader_modules, hash, code, code_size, &entry);
+    pthread_mutex_unlock(&cache->mutex);
+    if (error != sccl_success) {
+        vkDestroyShaderModule(device, entry.object.shader_module, NULL);
+        return error;
+    }
+
+    *shader_module = entry.object.shader_module;
+
+    return sccl_success;
+}
+
+void shader_cache_release_shader_module(VkDevice device, shader_cache_t *cache,
+                                        VkShaderModule shader_module)
+{
+    pthread_mutex_lock(&cache->mutex);
+    for (size_t i = 0; i < vector_get_size(&cache->shader_modules); ++i) {
+        shader_cache_entry_t *entry =
+            vector_get_element(&cache->shader_modules, i);
+        if (entry->object.shader_module == shader_module) {
+            if (release_entry(&cache->shader_modules, i)) {
+                vkDestroyShaderModule(device, shader_module, NULL);
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+sccl_error_t shader_cache_acquire_descriptor_set_layout(
+    VkDevice device, shader_cache_t *cache,
+    const VkDescriptorSetLayoutBinding *bindings, uint32_t bindings_count,
+    VkDescriptorSetLayout *descriptor_set_layout)
+{
+    /* key on the binding description only, immutable samplers are not
+     * used for buffers */
+    uint32_t *key;
+    size_t key_size = bindings_count * 4 * sizeof(uint32_t);
+    CHECK_SCCL_ERROR_RET(sccl_calloc((void **)&key, bindings_count * 4,
+                                     sizeof(uint32_t)));
+    for (uint32_t i = 0; i < bindings_count; ++i) {
+        key[i * 4 + 0] = bindings[i].binding;
+        key[i * 4 + 1] = (uint32_t)bindings[i].descriptorType;
+        key[i * 4 + 2] = bindings[i].descriptorCount;
+        key[i * 4 + 3] = bindings[i].stageFlags;
+    }
+    uint64_t hash = hash_bytes(key, key_size);
+
+    pthread_mutex_lock(&cache->mutex);
+    shader_cache_entry_t *found = acquire_entry(
+        cache, &cache->descriptor_set_layouts, hash, key, key_size);
+    if (found != NULL) {
+        *descriptor_set_layout = found->object.descriptor_set_layout;
+        pthread_mutex_unlock(&cache->mutex);
+        sccl_free(key);
+        return sccl_success;
+    }
+
+    VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info = {0};
+    descriptor_set_layout_create_info.sType =
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    descriptor_set_layout_create_info.pBindings = bindings;
+    descriptor_set_layout_create_info.bindingCount = bindings_count;
+    shader_cache_entry_t entry = {0};
+    VkResult result = vkCreateDescriptorSetLayout(
+        device, &descriptor_set_layout_create_info, NULL,
+        &entry.object.descriptor_set_layout);
+    if (result != VK_SUCCESS) {
+        pthread_mutex_unlock(&cache->mutex);
+        sccl_free(key);
+        return sccl_unhandled_vulkan_error;
+    }
+    sccl_error_t error = add_entry(&cache->descriptor_set_layouts, hash, key,
+                                   key_size, &entry);
+    pthread_mutex_unlock(&cache->mutex);
+    sccl_free(key);
+    if (error != sccl_success) {
+        vkDestroyDescriptorSetLayout(device,
+                                     entry.object.descriptor_set_layout, NULL);
+        return error;
+    }
+
+    *descriptor_set_layout = entry.object.descriptor_set_layout;
+
+    return sccl_success;
+}
+
+void shader_cache_release_descriptor_set_layout(
+    VkDevice device, shader_cache_t *cache,
+    VkDescriptorSetLayout descriptor_set_layout)
+{
+    pthread_mutex_lock(&cache->mutex);
+    for (size_t i = 0; i < vector_get_size(&cache->descriptor_set_layouts);
+         ++i) {
+        shader_cache_entry_t *entry =
+            vector_get_element(&cache->descriptor_set_layouts, i);
+        if (entry->object.descriptor_set_layout == descriptor_set_layout) {
+            if (release_entry(&cache->descriptor_set_layouts, i)) {
+                vkDestroyDescriptorSetLayout(device, descriptor_set_layout,
+                                             NULL);
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+sccl_error_t shader_cache_acquire_pipeline_layout(
+    VkDevice device, shader_cache_t *cache,
+    const VkDescriptorSetLayout *descriptor_set_layouts,
+    uint32_t descriptor_set_layouts_count, uint32_t push_constants_size,
+    VkPipelineLayout *pipeline_layout)
+{
+    /* push constant size followed by descriptor set layout handles, handles
+     * identify layouts since they are cached too */
+    size_t handles_size =
+        descriptor_set_layouts_count * sizeof(VkDescriptorSetLayout);
+    size_t key_size = sizeof(uint32_t) + handles_size;
+    char *key;
+    CHECK_SCCL_ERROR_RET(sccl_calloc((void **)&key, key_size, 1));
+    memcpy(key, &push_constants_size, sizeof(uint32_t));
+    if (handles_size > 0) {
+        memcpy(key + sizeof(uint32_t), descriptor_set_layouts, handles_size);
+    }
+    uint64_t hash = hash_bytes(key, key_size);
+
+    pthread_mutex_lock(&cache->mutex);
+    shader_cache_entry_t *found =
+        acquire_entry(cache, &cache->pipeline_layouts, hash, key, key_size);
+    if (found != NULL) {
+        *pipeline_layout = found->object.pipeline_layout;
+        pthread_mutex_unlock(&cache->mutex);
+        sccl_free(key);
+        return sccl_success;
+    }
+
+    VkPushConstantRange push_constant_range = {0};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push_constant_range.offset = 0;
+    push_constant_range.size = push_constants_size;
+
+    VkPipelineLayoutCreateInfo pipeline_layout_create_info = {0};
+    pipeline_layout_create_info.sType =
+        VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_create_info.pSetLayouts = descriptor_set_layouts;
+    pipeline_layout_create_info.setLayoutCount = descriptor_set_layouts_count;
+    if (push_constants_size > 0) {
+        pipeline_layout_create_info.pushConstantRangeCount = 1;
+        pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+    }
+    shader_cache_entry_t entry = {0};
+    if (vkCreatePipelineLayout(device, &pipeline_layout_create_info, NULL,
+                               &entry.object.pipeline_layout) != VK_SUCCESS) {
+        pthread_mutex_unlock(&cache->mutex);
+        sccl_free(key);
+        return sccl_unhandled_vulkan_error;
+    }
+    sccl_error_t error =
+        add_entry(&cache->pipeline_layouts, hash, key, key_size, &entry);
+    pthread_mutex_unlock(&cache->mutex);
+    sccl_free(key);
+    if (error != sccl_success) {
+        vkDestroyPipelineLayout(device, entry.object.pipeline_layout, NULL);
+        return error;
+    }
+
+    *pipeline_layout = entry.object.pipeline_layout;
+
+    return sccl_success;
+}
+
+void shader_cache_release_pipeline_layout(VkDevice device,
+                                          shader_cache_t *cache,
+                                          VkPipelineLayout pipeline_layout)
+{
+    pthread_mutex_lock(&cache->mutex);
+    for (size_t i = 0; i < vector_get_size(&cache->pipeline_layouts); ++i) {
+        shader_cache_entry_t *entry =
+            vector_get_element(&cache->pipeline_layouts, i);
+        if (entry->object.pipeline_layout == pipeline_layout) {
+            if (release_entry(&cache->pipeline_layouts, i)) {
+                vkDestroyPipelineLayout(device, pipeline_layout, NULL);
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+void shader_cache_get_stats(shader_cache_t *cache,
+                            sccl_shader_cache_stats_t *stats)
+{
+    pthread_mutex_lock(&cache->mutex);
+    stats->shader_module_count = vector_get_size(&cache->shader_modules);
+    stats->descriptor_set_layout_count =
+        vector_get_size(&cache->descriptor_set_layouts);
+    stats->pipeline_layout_count = vector_get_size(&cache->pipeline_layouts);
+    stats->hit_count = cache->hit_count;
+    pthread_mutex_unlock(&cache->mutex);
+}
@@ -0,0 +1,78 @@
+#pragma once
+#ifndef SHADER_CACHE_HEADER
+#define SHADER_CACHE_HEADER
+
+#include "sccl.h"
+#include "vector.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+
+/**
+ * Device wide content addressed cache of the Vulkan objects shaders are built
+ * from. Shader modules are keyed by their SPIR-V, descriptor set layouts by
+ * their bindings and pipeline layouts by their (cached, so unique) descriptor
+ * set layouts and push constant size. Objects are reference counted: every
+ * acquire returns the existing object for an identical key and must be paired
+ * with a release, the object is destroyed with its last reference.
+ *
+ * All functions are thread safe.
+ */
+typedef struct {
+    /* held while objects are created, so identical keys never race */
+    pthread_mutex_t mutex;
+    /* `shader_cache_entry_t` per object kind */
+    vector_t shader_modules;
+    vector_t descriptor_set_layouts;
+    vector_t pipeline_layouts;
+    /* acquires that returned an existing object */
+    uint64_t hit_count;
+} shader_cache_t;
+
+sccl_error_t shader_cache_init(shader_cache_t *cache);
+
+/**
+ * Destroy cache and every object still referenced.
+ */
+void shader_cache_destroy(VkDevice device, shader_cache_t *cache);
+
+sccl_error_t shader_cache_acquire_shader_module(VkDevice device,
+                                                shader_cache_t *cache,
+                                                const void *code,
+                                                size_t code_size,
+                                                VkShaderModule *shader_module);
+
+void shader_cache_release_shader_module(VkDevice device, shader_cache_t *cache,
+                                        VkShaderModule shader_module);
+
+/**
+ * Bindings must be sorted by binding number, equal layouts with bindings in
+ * another order are not matched.
+ */
+sccl_error_t shader_cache_acquire_descriptor_set_layout(
+    VkDevice device, shader_cache_t *cache,
+    const VkDescriptorSetLayoutBinding *bindings, uint32_t bindings_count,
+    VkDescriptorSetLayout *descriptor_set_layout);
+
+void shader_cache_release_descriptor_set_layout(
+    VkDevice device, shader_cache_t *cache,
+    VkDescriptorSetLayout descriptor_set_layout);
+
+/**
+ * `descriptor_set_layouts` must be acquired from the cache. One push constant
+ * range of `push_constants_size` bytes is used if size is not 0.
+ */
+sccl_error_t shader_cache_acquire_pipeline_layout(
+    VkDevice device, shader_cache_t *cache,
+    const VkDescriptorSetLayout *descriptor_set_layouts,
+    uint32_t descriptor_set_layouts_count, uint32_t push_constants_size,
+    VkPipelineLayout *pipeline_layout);
+
+void shader_cache_release_pipeline_layout(VkDevice device,
+                                          shader_cache_t *cache,
+                                          VkPipelineLayout pipeline_layout);
+
+void shader_cache_get_stats(shader_cache_t *cache,
+                            sccl_shader_cache_stats_t *stats);
+
+#endif // SHADER_CACHE_HEADER
@@ -0,0 +1,264 @@
+#include "sort.h"
+#include "buffer.h"
+#include "device.h"
+#include "error.h"
+#include "kernel.h"
+#include "sccl.h"
+#include "stream.h"
+
+#include <string.h>
+
+/* shader bundle names, indexed by `sort_pass_t` and `sort_key_t` */
+static const char *const sort_names[sort_pass_count][sort_key_count] = {
+    {
+        "sort_histogram_uint32",
+        "sort_histogram_int32",
+        "sort_histogram_float32",
+        "sort_histogram_int64",
+    },
+    {
+        "sort_scatter_uint32",
+        "sort_scatter_int32",
+        "sort_scatter_float32",
+        "sort_scatter_int64",
+    },
+};
+
+/* number of storage buffers bound by each pass */
+static const size_t sort_buffers_counts[sort_pass_count] = {2, 5};
+
+typedef struct {
+    uint32_t count;
+    uint32_t shift;
+    uint32_t tile_count;
+    uint32_t keys_in_offset;
+    uint32_t keys_out_offset;
+    uint32_t values_in_offset;
+    uint32_t values_out_offset;
+} sort_push_constants_t;
+
+/**
+ * Temporary buffer holds the digit counts of every tile first, so they can be
+ * scanned in place, followed by a second copy of the keys and values.
+ * Offsets are in bytes.
+ */
+typedef struct {
+    uint32_t tile_count;
+    size_t histogram_count;
+    size_t keys_offset;
+    size_t values_offset;
+    size_t size;
+} sort_temp_layout_t;
+
+void sort_kernels_init(VkPhysicalDevice physical_device,
+                       sort_kernels_t *kernels)
+{
+    memset(kernels, 0, sizeof(sort_kernels_t));
+
+    VkPhysicalDeviceSubgroupProperties subgroup_properties = {0};
+    subgroup_properties.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties = {0};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &subgroup_properties;
+    vkGetPhysicalDeviceProperties2(physical_device, &properties);
+
+    VkSubgroupFeatureFlags required_operations =
+        VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_BALLOT_BIT |
+        VK_SUBGROUP_FEATURE_ARITHMETIC_BIT;
+    kernels->supported =
+        (subgroup_properties.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) &&
+        (subgroup_properties.supportedOperations & required_operations) ==
+            required_operations;
+}
+
+void sort_kernels_destroy(sort_kernels_t *kernels)
+{
+    for (size_t i = 0; i < sort_pass_count; ++i) {
+        for (size_t j = 0; j < sort_key_count; ++j) {
+            for (size_t k = 0; k < 2; ++k) {
+                if (kernels->shaders[i][j][k] != SCCL_NULL) {
+                    sccl_destroy_shader(kernels->shaders[i][j][k]);
+                    kernels->shaders[i][j][k] = SCCL_NULL;
+                }
+            }
+        }
+    }
+}
+
+static sccl_error_t get_key_type(sccl_dtype_t dtype, sort_key_t *key,
+                                 size_t *key_size)
+{
+    switch (dtype) {
+    case sccl_dtype_uint32:
+        *key = sort_key_uint32;
+        *key_size = 4;
+        return sccl_success;
+    case sccl_dtype_int32:
+        *key = sort_key_int32;
+        *key_size = 4;
+        return sccl_success;
+    case sccl_dtype_float32:
+        *key = sort_key_float32;
+        *key_size = 4;
+        return sccl_success;
+    case sccl_dtype_int64:
+        *key = sort_key_int64;
+        *key_size = 8;
+        return sccl_success;
+    default:
+        return sccl_invalid_argument;
+    }
+}
+
+static void get_temp_layout(size_t count, size_t key_size, bool with_values,
+                            sort_temp_layout_t *layout)
+{
+    layout->tile_count =
+        (uint32_t)((count + SORT_TILE_SIZE - 1) / SORT_TILE_SIZE);
+    layout->histogram_count = (size_t)layout->tile_count * SORT_RADIX;
+    /* keys are aligned to their size, values are 32-bit */
+    size_t histogram_size = layout->histogram_count * sizeof(uint32_t);
+    layout->keys_offset = (histogram_size + key_size - 1) / key_size * key_size;
+    layout->values_offset = layout->keys_offset + count * key_size;
+    layout->size = layout->values_offset;
+    if (with_values) {
+        layout->size += count * sizeof(uint32_t);
+    }
+}
+
+sccl_error_t sccl_get_sort_temp_size(size_t count, sccl_dtype_t key_dtype,
+                                     bool with_values, size_t *temp_size)
+{
+    CHECK_SCCL_NULL_RET(temp_size);
+    sort_key_t key;
+    size_t key_size;
+    CHECK_SCCL_ERROR_RET(get_key_type(key_dtype, &key, &key_size));
+    if (count > SCCL_SORT_MAX_COUNT) {
+        return sccl_invalid_argument;
+    }
+
+    if (count == 0) {
+        *temp_size = 0;
+        return sccl_success;
+    }
+    sort_temp_layout_t layout;
+    get_temp_layout(count, key_size, with_values, &layout);
+    *temp_size = layout.size;
+    return sccl_success;
+}
+
+static sccl_error_t run_pass(const sccl_stream_t stream, sort_pass_t pass,
+                             sort_key_t key, bool with_values,
+                             const sccl_buffer_t *buffers,
+                             const sort_push_constants_t *push_constants)
+{
+    sccl_device_t device = stream->device;
+    sccl_shader_t shader;
+    CHECK_SCCL_ERROR_RET(kernel_get_shader(
+        device, &device->sort_kernels.shaders[pass][key][with_values],
+        sort_names[pass][key], with_values, sort_buffers_counts[pass],
+        sizeof(sort_push_constants_t), &shader));
+
+    uint32_t group_count_x, group_count_y;
+    kernel_get_group_counts(push_constants->tile_count, &group_count_x,
+                            &group_count_y);
+    return kernel_run(stream, shader, buffers, sort_buffers_counts[pass],
+                      push_constants, group_count_x, group_count_y);
+}
+
+static sccl_error_t validate_buffer(const sccl_stream_t stream,
+                                    const sccl_buffer_t buffer, size_t size)
+{
+    CHECK_SCCL_NULL_RET(buffer);
+    if (buffer->device != stream->device || !buffer_is_storage(buffer) ||
+        buffer->size < size) {
+        return sccl_invalid_argument;
+    }
+    return sccl_success;
+}
+
+static sccl_error_t sort(const sccl_stream_t stream, const sccl_buffer_t keys,
+                         const sccl_buffer_t values, const sccl_buffer_t temp,
+                         size_t count, sccl_dtype_t key_dtype)
+{
+    CHECK_SCCL_NULL_RET(stream);
+    sort_key_t key;
+    size_t key_size;
+    CHECK_SCCL_ERROR_RET(get_key_type(key_dtype, &key, &key_size));
+    if (count > SCCL_SORT_MAX_COUNT) {
+        return sccl_invalid_argument;
+    }
+    bool with_values = values != SCCL_NULL;
+    CHECK_SCCL_ERROR_RET(validate_buffer(stream, keys, count * key_size));
+    if (with_values) {
+        CHECK_SCCL_ERROR_RET(
+            validate_buffer(stream, values, count * sizeof(uint32_t)));
+    }
+    if (count == 0) {
+        return sccl_success;
+    }
+    sort_temp_layout_t layout;
+    get_temp_layout(count, key_size, with_values, &layout);
+    CHECK_SCCL_ERROR_RET(validate_buffer(stream, temp, layout.size));
+    if (!stream->device->sort_kernels.supported) {
+        return sccl_unsupported_error;
+    }
+
+    /* keys move between `keys` and `temp` every pass, the number of passes
+     * is even so they end up in `keys` */
+    sccl_buffer_t key_buffers[2] = {keys, temp};
+    uint32_t key_offsets[2] = {0, (uint32_t)(layout.keys_offset / key_size)};
+    sccl_buffer_t value_buffers[2] = {with_values ? values : keys, temp};
+    uint32_t value_offsets[2] = {
+        0, (uint32_t)(layout.values_offset / sizeof(uint32_t))};
+
+    size_t pass_count = key_size * 8 / SORT_RADIX_BITS;
+    for (size_t pass = 0; pass < pass_count; ++pass) {
+        size_t in = pass % 2;
+        size_t out = 1 - in;
+        sort_push_constants_t push_constants = {
+            .count = (uint32_t)count,
+            .shift = (uint32_t)(pass * SORT_RADIX_BITS),
+            .tile_count = layout.tile_count,
+            .keys_in_offset = key_offsets[in],
+            .keys_out_offset = key_offsets[out],
+            .values_in_offset = value_offsets[in],
+            .values_out_offset = value_offsets[out],
+        };
+
+        sccl_buffer_t histogram_buffers[] = {key_buffers[in], temp};
+        CHECK_SCCL_ERROR_RET(run_pass(stream, sort_pass_histogram, key,
+                                      with_values, histogram_buffers,
+                                      &push_constants));
+        CHECK_SCCL_ERROR_RET(sccl_scan_exclusive(
+            stream, temp, temp, layout.histogram_count, sccl_dtype_uint32,
+            sccl_reduce_op_sum));
+        sccl_buffer_t scatter_buffers[] = {key_buffers[in], key_buffers[out],
+                                           temp, value_buffers[in],
+                                           value_buffers[out]};
+        CHECK_SCCL_ERROR_RET(run_pass(stream, sort_pass_scatter, key,
+                                      with_values, scatter_buffers,
+                                      &push_constants));
+    }
+
+    return sccl_success;
+}
+
+sccl_error_t sccl_sort_keys(const sccl_stream_t stream,
+                            const sccl_buffer_t keys,
+                            const sccl_buffer_t temp, size_t count,
+                            sccl_dtype_t key_dtype)
+{
+    return sort(stream, keys, SCCL_NULL, temp, count, key_dtype);
+}
+
+sccl_error_t sccl_sort_pairs(const sccl_stream_t stream,
+                             const sccl_buffer_t keys,
+                             const sccl_buffer_t values,
+                             const sccl_buffer_t temp, size_t count,
+                             sccl_dtype_t key_dtype)
+{
+    CHECK_SCCL_NULL_RET(values);
+    return sort(stream, keys, values, temp, count, key_dtype);
+}
@@ -0,0 +1,60 @@
+#pragma once
+#ifndef SORT_HEADER
+#define SORT_HEADER
+
+#include "sccl.h"
+#include <stdbool.h>
+#include <vulkan/vulkan.h>
+
+/* must match `WORKGROUP_SIZE`, `ITEMS_PER_INVOCATION` and `RADIX_BITS` in
+ * shaders/sort.comp */
+#define SORT_WORKGROUP_SIZE 256
+#define SORT_ITEMS_PER_INVOCATION 8
+#define SORT_TILE_SIZE (SORT_WORKGROUP_SIZE * SORT_ITEMS_PER_INVOCATION)
+#define SORT_RADIX_BITS 8
+#define SORT_RADIX (1 << SORT_RADIX_BITS)
+
+#if SORT_TILE_SIZE != SCCL_SORT_TILE_SIZE
+#error "SORT_TILE_SIZE must match SCCL_SORT_TILE_SIZE"
+#endif
+
+/* passes the sort kernel is compiled for, see shaders/sort.comp */
+typedef enum {
+    sort_pass_histogram = 0,
+    sort_pass_scatter = 1,
+    sort_pass_count = 2
+} sort_pass_t;
+
+/* key types the sort kernel is compiled for */
+typedef enum {
+    sort_key_uint32 = 0,
+    sort_key_int32 = 1,
+    sort_key_float32 = 2,
+    sort_key_int64 = 3,
+    sort_key_count = 4
+} sort_key_t;
+
+/**
+ * Built-in radix sort kernels of a device, indexed by pass, key type and
+ * whether values are moved with the keys. Shaders are created the first time
+ * they are used.
+ */
+typedef struct {
+    /* subgroup ballots and arithmetic (for the scan between passes) are
+     * supported in compute shaders */
+    bool supported;
+    sccl_shader_t shaders[sort_pass_count][sort_key_count][2];
+} sort_kernels_t;
+
+/**
+ * Check if physical device can run the sort kernels.
+ */
+void sort_kernels_init(VkPhysicalDevice physical_device,
+                       sort_kernels_t *kernels);
+
+/**
+ * Destroy created shaders, streams that used them must be joined.
+ */
+void sort_kernels_destroy(sort_kernels_t *kernels);
+
+#endif // SORT_HEADER
@@ -4,7 +4,20 @@
 #include "buffer.h"
 #include "device.h"
 #include "error.h"
+#include "shader.h"
+#include <pthread.h>
+#include <sched.h>
 #include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+/* size of each descriptor pool used for shader buffer bindings */
+#define STREAM_DESCRIPTOR_POOL_MAX_SETS 64
+#define STREAM_DESCRIPTOR_POOL_STORAGE_BUFFERS 256
+#define STREAM_DESCRIPTOR_POOL_UNIFORM_BUFFERS 64
+
+/* weight of the newest wait in the average wait time is 1 / 2^shift */
+#define STREAM_WAIT_AVERAGE_SHIFT 3
 
 static sccl_error_t reset_command_buffer(const sccl_stream_t stream)
 {
@@ -17,6 +30,405 @@ static sccl_error_t reset_command_buffer(const sccl_stream_t stream)
     CHECK_VKRESULT_RET(
         vkBeginCommandBuffer(stream->command_buffer, &begin_info));
 
+    stream->descriptor_table_bound = false;
+
+    return sccl_success;
+}
+
+static sccl_error_t create_descriptor_pool(VkDevice device,
+                                           VkDescriptorPool *descriptor_pool)
+{
+    VkDescriptorPoolSize descriptor_pool_sizes[2];
+    memset(descriptor_pool_sizes, 0, sizeof(descriptor_pool_sizes));
+    descriptor_pool_sizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptor_pool_sizes[0].descriptorCount =
+        STREAM_DESCRIPTOR_POOL_STORAGE_BUFFERS;
+    descriptor_pool_sizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descriptor_pool_sizes[1].descriptorCount =
+        STREAM_DESCRIPTOR_POOL_UNIFORM_BUFFERS;
+
+    VkDescriptorPoolCreateInfo descriptor_pool_create_info = {0};
+    descriptor_pool_create_info.sType =
+        VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descriptor_pool_create_info.poolSizeCount = 2;
+    descriptor_pool_create_info.pPoolSizes = descriptor_pool_sizes;
+    descriptor_pool_create_info.maxSets = STREAM_DESCRIPTOR_POOL_MAX_SETS;
+    CHECK_VKRESULT_RET(vkCreateDescriptorPool(
+        device, &descriptor_pool_create_info, NULL, descriptor_pool));
+    return sccl_success;
+}
+
+static sccl_error_t reset_descriptor_pools(const sccl_stream_t stream)
+{
+    for (size_t i = 0; i < vector_get_size(&stream->descriptor_pools); ++i) {
+        VkDescriptorPool *descriptor_pool =
+            vector_get_element(&stream->descriptor_pools, i);
+        CHECK_VKRESULT_RET(vkResetDescriptorPool(stream->device->device,
+                                                 *descriptor_pool, 0));
+    }
+    stream->descriptor_pool_index = 0;
+    return sccl_success;
+}
+
+sccl_error_t
+stream_allocate_descriptor_sets(const sccl_stream_t stream,
+                                const VkDescriptorSetLayout *layouts,
+                                size_t layouts_count, VkDescriptorSet *sets)
+{
+    VkDescriptorSetAllocateInfo descriptor_set_allocate_info = {0};
+    descriptor_set_allocate_info.sType =
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    descriptor_set_allocate_info.descriptorSetCount = layouts_count;
+    descriptor_set_allocate_info.pSetLayouts = layouts;
+
+    /* try current pool, if it's exhausted move on to next pool */
+    while (true) {
+        bool new_pool = false;
+        if (stream->descriptor_pool_index ==
+            vector_get_size(&stream->descriptor_pools)) {
+            VkDescriptorPool descriptor_pool;
+            CHECK_SCCL_ERROR_RET(create_descriptor_pool(stream->device->device,
+                                                        &descriptor_pool));
+            CHECK_SCCL_ERROR_RET(vector_add_element(&stream->descriptor_pools,
+                                                    &descriptor_pool));
+            new_pool = true;
+        }
+
+        VkDescriptorPool *descriptor_pool = vector_get_element(
+            &stream->descriptor_pools, stream->descriptor_pool_index);
+        descriptor_set_allocate_info.descriptorPool = *descriptor_pool;
+        VkResult res = vkAllocateDescriptorSets(
+            stream->device->device, &descriptor_set_allocate_info, sets);
+        if (res == VK_SUCCESS) {
+            return sccl_success;
+        }
+        if (res != VK_ERROR_OUT_OF_POOL_MEMORY &&
+            res != VK_ERROR_FRAGMENTED_POOL) {
+            return sccl_unhandled_vulkan_error;
+        }
+        if (new_pool) {
+            /* request does not fit in an empty pool */
+            return sccl_out_of_resources_error;
+        }
+        ++stream->descriptor_pool_index;
+    }
+}
+
+void stream_bind_descriptor_table(const sccl_stream_t stream)
+{
+    if (stream->descriptor_table_bound) {
+        return;
+    }
+    const descriptor_table_t *table = &stream->device->descriptor_table;
+    vkCmdBindDescriptorSets(stream->command_buffer,
+                            VK_PIPELINE_BIND_POINT_COMPUTE,
+                            table->pipeline_layout, 0, 1,
+                            &table->descriptor_set, 0, NULL);
+    stream->descriptor_table_bound = true;
+}
+
+void stream_record_barrier(const sccl_stream_t stream)
+{
+    VkMemoryBarrier memory_barrier = {};
+    memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memory_barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+    memory_barrier.dstAccessMask =
+        VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    vkCmdPipelineBarrier(stream->command_buffer,
+                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1,
+                         &memory_barrier, 0, NULL, 0, NULL);
+}
+
+sccl_error_t stream_track_buffer(const sccl_stream_t stream,
+                                 sccl_buffer_t buffer)
+{
+    sccl_device_t device = stream->device;
+    sccl_error_t error = sccl_success;
+
+    pthread_mutex_lock(&device->mutex);
+
+    /* restore spilled buffer if no other stream is using it, if there is no
+     * room the buffer is used from host memory */
+    if (buffer->spilled && buffer->pending_use_count == 0 &&
+        !memory_bindless_pending_locked(&device->memory_manager)) {
+        error = buffer_restore_locked(buffer);
+        if (error == sccl_out_of_resources_error) {
+            error = sccl_success;
+        }
+    }
+
+    if (error == sccl_success && (buffer->tracked_stream != stream ||
+                                  buffer->tracked_epoch != stream->epoch)) {
+        error = vector_add_element(&stream->tracked_buffers, &buffer);
+        if (error == sccl_success) {
+            ++buffer->pending_use_count;
+            buffer->tracked_stream = stream;
+            buffer->tracked_epoch = stream->epoch;
+        }
+    }
+
+    if (error == sccl_success) {
+        memory_touch_buffer_locked(device, buffer);
+    }
+
+    pthread_mutex_unlock(&device->mutex);
+
+    return error;
+}
+
+sccl_error_t stream_track_shader(const sccl_stream_t stream,
+                                 sccl_shader_t shader)
+{
+    sccl_error_t error = sccl_success;
+
+    pthread_mutex_lock(&stream->device->mutex);
+    if (shader->tracked_stream != stream ||
+        shader->tracked_epoch != stream->epoch) {
+        error = vector_add_element(&stream->tracked_shaders, &shader);
+        if (error == sccl_success) {
+            ++shader->pending_use_count;
+            shader->tracked_stream = stream;
+            shader->tracked_epoch = stream->epoch;
+        }
+    }
+    pthread_mutex_unlock(&stream->device->mutex);
+
+    return error;
+}
+
+sccl_error_t stream_track_bindless(const sccl_stream_t stream)
+{
+    if (stream->bindless_ticket != 0) {
+        return sccl_success;
+    }
+    pthread_mutex_lock(&stream->device->mutex);
+    sccl_error_t error =
+        memory_begin_bindless_locked(stream->device, &stream->bindless_ticket);
+    pthread_mutex_unlock(&stream->device->mutex);
+    return error;
+}
+
+/**
+ * Release buffers and shaders tracked since last join, objects destroyed
+ * while in use by the stream are destroyed here.
+ */
+static void release_tracked_objects(const sccl_stream_t stream)
+{
+    sccl_device_t device = stream->device;
+
+    pthread_mutex_lock(&device->mutex);
+    for (size_t i = 0; i < vector_get_size(&stream->tracked_buffers); ++i) {
+        sccl_buffer_t buffer =
+            *(sccl_buffer_t *)vector_get_element(&stream->tracked_buffers, i);
+        assert(buffer->pending_use_count > 0);
+        --buffer->pending_use_count;
+        if (buffer->tracked_stream == stream) {
+            buffer->tracked_stream = SCCL_NULL;
+        }
+    }
+    for (size_t i = 0; i < vector_get_size(&stream->tracked_shaders); ++i) {
+        sccl_shader_t shader =
+            *(sccl_shader_t *)vector_get_element(&stream->tracked_shaders, i);
+        assert(shader->pending_use_count > 0);
+        --shader->pending_use_count;
+        if (shader->tracked_stream == stream) {
+            shader->tracked_stream = SCCL_NULL;
+        }
+        if (shader->pending_use_count == 0 && shader->destroy_pending) {
+            shader_destroy_now(shader);
+        }
+    }
+    if (stream->bindless_ticket != 0) {
+        memory_end_bindless_locked(device, stream->bindless_ticket);
+    }
+    buffer_destroy_deferred_locked(device);
+    pthread_mutex_unlock(&device->mutex);
+
+    vector_clear(&stream->tracked_buffers);
+    vector_clear(&stream->tracked_shaders);
+    stream->bindless_ticket = 0;
+    ++stream->epoch;
+}
+
+/**
+ * Move buffers freed since last join to device memory pool.
+ */
+static void release_freed_buffers(const sccl_stream_t stream)
+{
+    sccl_device_t device = stream->device;
+    memory_pool_t *pool = &device->memory_pool;
+
+    pthread_mutex_lock(&device->mutex);
+    for (size_t i = 0; i < vector_get_size(&stream->freed_buffers); ++i) {
+        sccl_buffer_t buffer =
+            *(sccl_buffer_t *)vector_get_element(&stream->freed_buffers, i);
+        if (memory_pool_add_buffer_locked(pool, buffer) != sccl_success) {
+            buffer_destroy_locked(buffer);
+        }
+    }
+    memory_pool_trim_locked(pool, pool->release_threshold);
+    pthread_mutex_unlock(&device->mutex);
+
+    vector_clear(&stream->freed_buffers);
+}
+
+/**
+ * Record write of the next sequence number to the completion flag after all
+ * other commands, made visible to host reads.
+ */
+static void record_completion_flag(const sccl_stream_t stream)
+{
+    stream_record_barrier(stream);
+    ++stream->completion_sequence;
+    vkCmdFillBuffer(stream->command_buffer, stream->completion_buffer->buffer,
+                    0, sizeof(uint32_t), stream->completion_sequence);
+
+    VkMemoryBarrier memory_barrier = {0};
+    memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    memory_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(stream->command_buffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &memory_barrier, 0,
+                         NULL, 0, NULL);
+}
+
+static sccl_error_t submit_locked(const sccl_stream_t stream)
+{
+    stream->completion_flag_pending = stream->wait_policy.completion_flag;
+    if (stream->completion_flag_pending) {
+        record_completion_flag(stream);
+    }
+
+    CHECK_VKRESULT_RET(vkEndCommandBuffer(stream->command_buffer));
+
+    VkSubmitInfo submit_info = {0};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &stream->command_buffer;
+
+    VkQueue queue;
+    vkGetDeviceQueue(stream->device->device, stream->device->queue_family_index,
+                     SCCL_QUEUE_INDEX, &queue);
+
+    CHECK_VKRESULT_RET(vkQueueSubmit(queue, 1, &submit_info, stream->fence));
+
+    return sccl_success;
+}
+
+static uint64_t get_time_ns(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000 + (uint64_t)time.tv_nsec;
+}
+
+/**
+ * Get end of spin and yield phases relative to start of the wait, adaptive
+ * policies scale them to recent waits.
+ */
+static void get_wait_phases(const sccl_stream_t stream, uint64_t *spin_end_ns,
+                            uint64_t *yield_end_ns)
+{
+    const sccl_stream_wait_policy_t *policy = &stream->wait_policy;
+    const sccl_stream_wait_stats_t *stats = &stream->wait_stats;
+    *spin_end_ns = policy->spin_ns;
+    *yield_end_ns = policy->spin_ns + policy->yield_ns;
+
+    uint64_t wait_count =
+        stats->spin_count + stats->yield_count + stats->block_count;
+    if (!policy->adaptive || wait_count == 0) {
+        return;
+    }
+    if (stats->average_wait_ns > *yield_end_ns) {
+        /* waits usually end up blocking, polling only burns cpu time */
+        *spin_end_ns = 0;
+        *yield_end_ns = 0;
+        return;
+    }
+    uint64_t budget_ns = 2 * stats->average_wait_ns;
+    *spin_end_ns = *spin_end_ns < budget_ns ? *spin_end_ns : budget_ns;
+    *yield_end_ns = *yield_end_ns < budget_ns ? *yield_end_ns : budget_ns;
+}
+
+static void update_wait_stats(sccl_stream_wait_stats_t *stats,
+                              uint64_t *completed_count, uint64_t wait_ns)
+{
+    if (stats->spin_count + stats->yield_count + stats->block_count == 0) {
+        stats->average_wait_ns = wait_ns;
+    } else {
+        stats->average_wait_ns =
+            stats->average_wait_ns -
+            (stats->average_wait_ns >> STREAM_WAIT_AVERAGE_SHIFT) +
+            (wait_ns >> STREAM_WAIT_AVERAGE_SHIFT);
+    }
+    ++*completed_count;
+}
+
+/**
+ * Check if pending dispatch is done, from the completion flag if the dispatch
+ * writes it or else the fence.
+ */
+static VkResult get_completion_status(const sccl_stream_t stream)
+{
+    if (stream->completion_flag_pending) {
+        return *stream->completion_flag == stream->completion_sequence
+                   ? VK_SUCCESS
+                   : VK_NOT_READY;
+    }
+    return vkGetFenceStatus(stream->device->device, stream->fence);
+}
+
+static sccl_error_t wait_fence(const sccl_stream_t stream)
+{
+    VkDevice device = stream->device->device;
+    sccl_stream_wait_stats_t *stats = &stream->wait_stats;
+    uint64_t spin_end_ns, yield_end_ns;
+    get_wait_phases(stream, &spin_end_ns, &yield_end_ns);
+
+    /* poll fence, yielding the thread after the spin phase */
+    uint64_t start_ns = get_time_ns();
+    uint64_t elapsed_ns = 0;
+    uint64_t *completed_count = &stats->block_count;
+    VkResult res = VK_NOT_READY;
+    while (elapsed_ns < yield_end_ns) {
+        res = get_completion_status(stream);
+        if (res != VK_NOT_READY) {
+            completed_count = elapsed_ns < spin_end_ns ? &stats->spin_count
+                                                       : &stats->yield_count;
+            break;
+        }
+        if (elapsed_ns >= spin_end_ns) {
+            sched_yield();
+        }
+        elapsed_ns = get_time_ns() - start_ns;
+    }
+
+    /* block until command buffer is done, the fence is signaled right after
+     * the completion flag is written and must be waited for before reset
+     * 1 fence per stream
+     * 1 minute timeout */
+    if (res == VK_NOT_READY || stream->completion_flag_pending) {
+        do {
+            res = vkWaitForFences(device, 1, &stream->fence, false,
+                                  60000000000);
+        } while (res == VK_TIMEOUT);
+    }
+    CHECK_VKRESULT_RET(res);
+    update_wait_stats(stats, completed_count, get_time_ns() - start_ns);
+
+    /* reset fence */
+    CHECK_VKRESULT_RET(vkResetFences(device, 1, &stream->fence));
+
+    return sccl_success;
+}
+
+sccl_error_t stream_flush_locked(const sccl_stream_t stream)
+{
+    CHECK_SCCL_ERROR_RET(submit_locked(stream));
+    CHECK_SCCL_ERROR_RET(wait_fence(stream));
+    CHECK_SCCL_ERROR_RET(reset_command_buffer(stream));
     return sccl_success;
 }
 
@@ -29,6 +441,17 @@ sccl_error_t sccl_create_stream(const sccl_device_t device,
         sccl_calloc((void **)&stream_internal, 1, sizeof(struct sccl_stream)));
 
     stream_internal->device = device;
+    /* epoch starts at 1 so untracked buffers never match */
+    stream_internal->epoch = 1;
+
+    CHECK_SCCL_ERROR_RET(vector_init(&stream_internal->descriptor_pools,
+                                     sizeof(VkDescriptorPool)));
+    CHECK_SCCL_ERROR_RET(vector_init(&stream_internal->tracked_buffers,
+                                     sizeof(sccl_buffer_t)));
+    CHECK_SCCL_ERROR_RET(vector_init(&stream_internal->tracked_shaders,
+                                     sizeof(sccl_shader_t)));
+    CHECK_SCCL_ERROR_RET(vector_init(&stream_internal->freed_buffers,
+                                     sizeof(sccl_buffer_t)));
 
     VkCommandPoolCreateInfo command_pool_create_info = {0};
     command_pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
@@ -68,6 +491,22 @@ sccl_error_t sccl_create_stream(const sccl_device_t device,
 
 void sccl_destroy_stream(sccl_stream_t stream)
 {
+    release_tracked_objects(stream);
+    vector_destroy(&stream->tracked_buffers);
+    vector_destroy(&stream->tracked_shaders);
+    release_freed_buffers(stream);
+    vector_destroy(&stream->freed_buffers);
+    for (size_t i = 0; i < vector_get_size(&stream->descriptor_pools); ++i) {
+        VkDescriptorPool *descriptor_pool =
+            vector_get_element(&stream->descriptor_pools, i);
+        vkDestroyDescriptorPool(stream->device->device, *descriptor_pool,
+                                NULL);
+    }
+    vector_destroy(&stream->descriptor_pools);
+    if (stream->completion_buffer != SCCL_NULL) {
+        sccl_host_unmap_buffer(stream->completion_buffer);
+        sccl_destroy_buffer(stream->completion_buffer);
+    }
     vkDestroyFence(stream->device->device, stream->fence, NULL);
     vkFreeCommandBuffers(stream->device->device, stream->command_pool, 1,
                          &stream->command_buffer);
@@ -77,45 +516,83 @@ void sccl_destroy_stream(sccl_stream_t stream)
 
 sccl_error_t sccl_dispatch_stream(const sccl_stream_t stream)
 {
-    CHECK_VKRESULT_RET(vkEndCommandBuffer(stream->command_buffer));
-
-    VkSubmitInfo submit_info = {0};
-    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submit_info.commandBufferCount = 1;
-    submit_info.pCommandBuffers = &stream->command_buffer;
-
-    VkQueue queue;
-    vkGetDeviceQueue(stream->device->device, stream->device->queue_family_index,
-                     SCCL_QUEUE_INDEX, &queue);
-
-    CHECK_VKRESULT_RET(vkQueueSubmit(queue, 1, &submit_info, stream->fence));
+    pthread_mutex_lock(&stream->device->mutex);
+    sccl_error_t error = submit_locked(stream);
+    pthread_mutex_unlock(&stream->device->mutex);
 
     /* Can't reset command buffer here as buffer is in pending state until
      * execution completes */
 
-    return sccl_success;
+    return error;
 }
 
 sccl_error_t sccl_join_stream(const sccl_stream_t stream)
 {
+    CHECK_SCCL_ERROR_RET(wait_fence(stream));
 
-    /* block until command buffer is done
-     * 1 fence per stream
-     * 1 minute timeout */
-    VkResult res = VK_SUCCESS;
-    do {
-        res = vkWaitForFences(stream->device->device, 1, &stream->fence, false,
-                              60000000000);
-    } while (res == VK_TIMEOUT);
-    CHECK_VKRESULT_RET(res);
+    /* buffers used by the finished command buffer can be migrated again, and
+     * objects destroyed while in use are destroyed */
+    release_tracked_objects(stream);
 
-    /* reset fence */
-    CHECK_VKRESULT_RET(
-        vkResetFences(stream->device->device, 1, &stream->fence));
+    /* buffers freed in the finished command buffer can be used by any stream */
+    release_freed_buffers(stream);
 
     /* reset command buffer here so we can record for next dispatch */
     CHECK_SCCL_ERROR_RET(reset_command_buffer(stream));
 
+    /* descriptor sets used by the finished command buffer can be reused */
+    CHECK_SCCL_ERROR_RET(reset_descriptor_pools(stream));
+
+    return sccl_success;
+}
+
+sccl_error_t
+sccl_set_stream_wait_policy(const sccl_stream_t stream,
+                            const sccl_stream_wait_policy_t *policy)
+{
+    if (policy == NULL || policy->spin_ns > UINT64_MAX - policy->yield_ns) {
+        return sccl_invalid_argument;
+    }
+    if (policy->completion_flag && stream->completion_buffer == SCCL_NULL) {
+        sccl_buffer_t buffer;
+        CHECK_SCCL_ERROR_RET(sccl_create_buffer(
+            stream->device, &buffer, sccl_buffer_type_host, sizeof(uint32_t)));
+        void *mapped;
+        sccl_error_t error =
+            sccl_host_map_buffer(buffer, &mapped, 0, sizeof(uint32_t));
+        if (error != sccl_success) {
+            sccl_destroy_buffer(buffer);
+            return error;
+        }
+        stream->completion_buffer = buffer;
+        stream->completion_flag = mapped;
+        *stream->completion_flag = stream->completion_sequence;
+    }
+    stream->wait_policy = *policy;
+    return sccl_success;
+}
+
+sccl_error_t sccl_get_stream_wait_stats(const sccl_stream_t stream,
+                                        sccl_stream_wait_stats_t *stats)
+{
+    if (stats == NULL) {
+        return sccl_invalid_argument;
+    }
+    *stats = stream->wait_stats;
+    return sccl_success;
+}
+
+sccl_error_t
+sccl_get_stream_completion_flag(const sccl_stream_t stream,
+                                const volatile uint32_t **flag,
+                                uint32_t *sequence)
+{
+    if (flag == NULL || sequence == NULL ||
+        !stream->wait_policy.completion_flag) {
+        return sccl_invalid_argument;
+    }
+    *flag = stream->completion_flag;
+    *sequence = stream->completion_sequence;
     return sccl_success;
 }
 
@@ -124,6 +601,9 @@ sccl_error_t sccl_copy_buffer(const sccl_stream_t stream,
                               const sccl_buffer_t dst, size_t dst_offset,
                               size_t size)
 {
+    CHECK_SCCL_ERROR_RET(stream_track_buffer(stream, src));
+    CHECK_SCCL_ERROR_RET(stream_track_buffer(stream, dst));
+
     VkBufferCopy buffer_copy = {0};
     buffer_copy.srcOffset = src_offset;
     buffer_copy.dstOffset = dst_offset;
@@ -132,14 +612,57 @@ sccl_error_t sccl_copy_buffer(const sccl_stream_t stream,
                     &buffer_copy);
 
     /* create barrier so next command will wait until this is finished */
-    VkMemoryBarrier memory_barrier = {};
-    memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
-    memory_barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
-    memory_barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-    vkCmdPipelineBarrier(stream->command_buffer,
-                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1,
-                         &memory_barrier, 0, NULL, 0, NULL);
+    stream_record_barrier(stream);
 
     return sccl_success;
 }
+
+sccl_error_t stream_record_fill(const sccl_stream_t stream,
+                                const sccl_buffer_t buffer, size_t offset,
+                                size_t size, uint32_t value)
+{
+    CHECK_SCCL_ERROR_RET(stream_track_buffer(stream, buffer));
+
+    vkCmdFillBuffer(stream->command_buffer, buffer->buffer, offset, size,
+                    value);
+    stream_record_barrier(stream);
+
+    return sccl_success;
+}
+
+sccl_error_t sccl_alloc_async(const sccl_stream_t stream,
+                              sccl_buffer_t *buffer, sccl_buffer_type_t type,
+                              size_t size)
+{
+    memory_class_t memory_class;
+    CHECK_SCCL_ERROR_RET(
+        memory_get_class(type, sccl_memory_usage_default, &memory_class));
+
+    /* buffers freed earlier in this stream are only used by commands recorded
+     * before the free, which finish before later commands start */
+    size_t index;
+    *buffer = memory_pool_find_buffer(&stream->freed_buffers, type,
+                                      memory_class, size, &index);
+    if (*buffer != SCCL_NULL) {
+        vector_swap_remove_element(&stream->freed_buffers, index);
+        return sccl_success;
+    }
+
+    pthread_mutex_lock(&stream->device->mutex);
+    memory_pool_take_buffer_locked(&stream->device->memory_pool, type,
+                                   memory_class, size, buffer);
+    pthread_mutex_unlock(&stream->device->mutex);
+    if (*buffer != SCCL_NULL) {
+        return sccl_success;
+    }
+
+    return sccl_create_buffer(stream->device, buffer, type, size);
+}
+
+sccl_error_t sccl_free_async(const sccl_stream_t stream, sccl_buffer_t buffer)
+{
+    if (buffer->device != stream->device) {
+        return sccl_invalid_argument;
+    }
+    return vector_add_element(&stream->freed_buffers, &buffer);
+}
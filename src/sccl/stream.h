@@ -3,6 +3,7 @@
 #define STREAM_HEADER
 
 #include "sccl.h"
+#include "vector.h"
 #include <vulkan/vulkan.h>
 
 struct sccl_stream {
@@ -10,6 +11,93 @@ struct sccl_stream {
     VkCommandPool command_pool;
     VkCommandBuffer command_buffer;
     VkFence fence;
+    /* pools for descriptor sets used by recorded shader runs, all pools are
+     * reset when the stream is joined */
+    vector_t descriptor_pools;
+    size_t descriptor_pool_index;
+    /* true if device descriptor table is bound at set 0 in current command
+     * buffer, cleared when another shader binds its own set 0 */
+    bool descriptor_table_bound;
+    /* buffers recorded since last join, see `stream_track_buffer` */
+    vector_t tracked_buffers;
+    /* incremented every join */
+    uint64_t epoch;
+    /* shaders recorded since last join, see `stream_track_shader` */
+    vector_t tracked_shaders;
+    /* bindless ticket if a bindless shader run is recorded since last join,
+     * 0 otherwise */
+    uint64_t bindless_ticket;
+    /* buffers freed with `sccl_free_async` since last join, they can be reused
+     * by allocations in this stream right away and are moved to the device
+     * memory pool when the stream is joined */
+    vector_t freed_buffers;
+    /* how joins wait for the fence, see `sccl_set_stream_wait_policy` */
+    sccl_stream_wait_policy_t wait_policy;
+    sccl_stream_wait_stats_t wait_stats;
+    /* host coherent buffer the last command of every dispatch writes
+     * `completion_sequence` to, created when a wait policy enables it */
+    sccl_buffer_t completion_buffer;
+    volatile uint32_t *completion_flag;
+    uint32_t completion_sequence;
+    /* true if the pending dispatch writes the completion flag */
+    bool completion_flag_pending;
 };
 
+/**
+ * Allocate descriptor sets that are valid until the stream is joined.
+ */
+sccl_error_t
+stream_allocate_descriptor_sets(const sccl_stream_t stream,
+                                const VkDescriptorSetLayout *layouts,
+                                size_t layouts_count, VkDescriptorSet *sets);
+
+/**
+ * Bind device descriptor table, only records a command the first time it's
+ * called for each command buffer.
+ */
+void stream_bind_descriptor_table(const sccl_stream_t stream);
+
+/**
+ * Record barrier so next command will wait until previous commands are
+ * finished.
+ */
+void stream_record_barrier(const sccl_stream_t stream);
+
+/**
+ * Record fill of `size` bytes of buffer at `offset` with the 32-bit `value`,
+ * offset and size must be multiples of 4.
+ */
+sccl_error_t stream_record_fill(const sccl_stream_t stream,
+                                const sccl_buffer_t buffer, size_t offset,
+                                size_t size, uint32_t value);
+
+/**
+ * Register that `buffer` is used by commands recorded in stream. Buffer memory
+ * is not migrated until the stream is joined. Spilled buffers are restored to
+ * device memory when possible.
+ * Must be called before the VkBuffer handle of `buffer` is recorded.
+ */
+sccl_error_t stream_track_buffer(const sccl_stream_t stream,
+                                 sccl_buffer_t buffer);
+
+/**
+ * Register that `shader` is used by commands recorded in stream, destruction
+ * of the shader is deferred until the stream is joined.
+ */
+sccl_error_t stream_track_shader(const sccl_stream_t stream,
+                                 sccl_shader_t shader);
+
+/**
+ * Register that a bindless shader run is recorded in stream, no buffers on the
+ * device are migrated and buffers in the descriptor table are not destroyed
+ * until the stream is joined.
+ */
+sccl_error_t stream_track_bindless(const sccl_stream_t stream);
+
+/**
+ * Submit recorded commands, wait for them to finish and start recording again.
+ * Used for internal streams while device mutex is held.
+ */
+sccl_error_t stream_flush_locked(const sccl_stream_t stream);
+
 #endif // STREAM_HEADER
\ No newline at end of file
@@ -42,6 +42,19 @@ void *vector_get_element(const vector_t *vec, size_t index)
     return get_element_internal(vec, index);
 }
 
+void vector_swap_remove_element(vector_t *vec, size_t index)
+{
+    assert(index < vector_get_size(vec));
+    size_t last = vector_get_size(vec) - 1;
+    if (index != last) {
+        memcpy(get_element_internal(vec, index),
+               get_element_internal(vec, last), vec->element_size);
+    }
+    --vec->size;
+}
+
+void vector_clear(vector_t *vec) { vec->size = 0; }
+
 void vector_destroy(vector_t *vec)
 {
     assert(vec != NULL);
@@ -22,6 +22,17 @@ size_t vector_get_size(const vector_t *vec);
 
 void *vector_get_element(const vector_t *vec, size_t index);
 
+/**
+ * Remove element by moving last element into its place, order is not
+ * preserved.
+ */
+void vector_swap_remove_element(vector_t *vec, size_t index);
+
+/**
+ * Remove all elements, capacity is kept.
+ */
+void vector_clear(vector_t *vec);
+
 void vector_destroy(vector_t *vec);
 
 void vector_sort(vector_t *vec, int (*compar)(const void *, const void *));
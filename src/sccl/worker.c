@@ -0,0 +1,364 @@
+
+#include "worker.h"
+#include "alloc.h"
+#include "buffer.h"
+#include "device.h"
+#include "error.h"
+#include "kernel.h"
+#include "sccl.h"
+#include "stream.h"
+
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+
+/* ring layout, must match shaders/worker.comp */
+#define WORKER_RING_COMPLETED 0
+#define WORKER_RING_STOP 1
+#define WORKER_RING_HEADER_WORDS 4
+#define WORKER_JOB_SEQUENCE 0
+#define WORKER_JOB_OP 1
+#define WORKER_JOB_SRC 2
+#define WORKER_JOB_SRC_OFFSET 3
+#define WORKER_JOB_DST 4
+#define WORKER_JOB_DST_OFFSET 5
+#define WORKER_JOB_COUNT 6
+#define WORKER_JOB_VALUE 7
+#define WORKER_JOB_WORDS 8
+
+/* time between watchdog checks of the worker kernel */
+#define WORKER_WATCHDOG_PERIOD_NS 50000
+
+typedef struct {
+    uint32_t ring_index;
+    uint32_t capacity;
+    uint32_t first_ticket;
+    uint32_t idle_polls;
+} worker_push_constants_t;
+
+void worker_kernels_destroy(worker_kernels_t *kernels)
+{
+    if (kernels->shader != SCCL_NULL) {
+        sccl_destroy_shader(kernels->shader);
+        kernels->shader = SCCL_NULL;
+    }
+}
+
+static uint64_t get_time_ns(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000 + (uint64_t)time.tv_nsec;
+}
+
+/**
+ * Tickets wrap at 32 bits on the device, jobs in flight are far fewer than
+ * 2^31 so the signed difference orders them.
+ */
+static bool is_ticket_done(const sccl_worker_t worker, uint64_t ticket)
+{
+    uint32_t completed = worker->ring_data[WORKER_RING_COMPLETED];
+    return (int32_t)(completed - (uint32_t)(ticket + 1)) >= 0;
+}
+
+static sccl_error_t launch_kernel(const sccl_worker_t worker)
+{
+    sccl_shader_t shader;
+    CHECK_SCCL_ERROR_RET(kernel_get_bindless_shader(
+        worker->device, &worker->device->worker_kernels.shader,
+        "worker", sizeof(worker_push_constants_t), &shader));
+
+    /* submission makes host writes before it visible to the kernel */
+    worker->ring_data[WORKER_RING_STOP] = 0;
+    worker_push_constants_t push_constants = {0};
+    push_constants.ring_index = worker->ring_index;
+    push_constants.capacity = worker->capacity;
+    push_constants.first_ticket = worker->ring_data[WORKER_RING_COMPLETED];
+    push_constants.idle_polls = worker->idle_polls;
+    sccl_shader_push_constant_binding push_constant_binding = {
+        .index = 0, .data = &push_constants};
+
+    sccl_shader_run_params_t params = {0};
+    params.group_count_x = 1;
+    params.group_count_y = 1;
+    params.group_count_z = 1;
+    params.push_constant_bindings = &push_constant_binding;
+    params.push_constant_bindings_count = 1;
+    CHECK_SCCL_ERROR_RET(sccl_run_shader(worker->stream, shader, &params));
+    CHECK_SCCL_ERROR_RET(sccl_dispatch_stream(worker->stream));
+    atomic_fetch_add(&worker->launch_count, 1);
+    return sccl_success;
+}
+
+/**
+ * Launch the worker kernel while jobs are pending, stop it at the end of its
+ * lifetime and relaunch it for the remaining jobs.
+ */
+static sccl_error_t run_watchdog(const sccl_worker_t worker)
+{
+    bool running = false;
+    bool stopped = false;
+    uint64_t launch_ns = 0;
+    const struct timespec period = {0, WORKER_WATCHDOG_PERIOD_NS};
+
+    while (true) {
+        bool shutdown = atomic_load(&worker->shutdown);
+        if (running) {
+            const volatile uint32_t *flag;
+            uint32_t sequence;
+            CHECK_SCCL_ERROR_RET(sccl_get_stream_completion_flag(
+                worker->stream, &flag, &sequence));
+            if (*flag == sequence) {
+                CHECK_SCCL_ERROR_RET(sccl_join_stream(worker->stream));
+                running = false;
+                continue;
+            }
+            if (!stopped && (shutdown || get_time_ns() - launch_ns >=
+                                             worker->lifetime_ns)) {
+                worker->ring_data[WORKER_RING_STOP] = 1;
+                stopped = true;
+                if (!shutdown) {
+                    atomic_fetch_add(&worker->watchdog_stop_count, 1);
+                }
+            }
+        } else if (shutdown) {
+            return sccl_success;
+        } else {
+            uint64_t next_ticket = atomic_load(&worker->next_ticket);
+            if (next_ticket > 0 && !is_ticket_done(worker, next_ticket - 1)) {
+                CHECK_SCCL_ERROR_RET(launch_kernel(worker));
+                running = true;
+                stopped = false;
+                launch_ns = get_time_ns();
+            }
+        }
+        nanosleep(&period, NULL);
+    }
+}
+
+static void *watchdog_main(void *arg)
+{
+    sccl_worker_t worker = arg;
+    sccl_error_t error = run_watchdog(worker);
+    atomic_store(&worker->error, (int)error);
+    return NULL;
+}
+
+/**
+ * Destroy what `init_worker` created, the watchdog must not be running.
+ */
+static void destroy_worker_objects(struct sccl_worker *worker)
+{
+    if (worker->stream != NULL) {
+        sccl_destroy_stream(worker->stream);
+    }
+    if (worker->ring != SCCL_NULL) {
+        if (worker->ring_data != NULL) {
+            sccl_host_unmap_buffer(worker->ring);
+        }
+        sccl_destroy_buffer(worker->ring);
+    }
+    sccl_free(worker);
+}
+
+/**
+ * Create the objects of a zeroed worker and start its watchdog, on error
+ * they are destroyed by `destroy_worker_objects`.
+ */
+static sccl_error_t init_worker(const sccl_device_t device,
+                                const sccl_worker_config_t *config,
+                                struct sccl_worker *worker_internal)
+{
+    worker_internal->device = device;
+    worker_internal->capacity = (uint32_t)config->capacity;
+    worker_internal->lifetime_ns = config->lifetime_ns;
+    worker_internal->idle_polls = config->idle_polls;
+    atomic_init(&worker_internal->next_ticket, 0);
+    atomic_init(&worker_internal->error, sccl_success);
+    atomic_init(&worker_internal->shutdown, false);
+    atomic_init(&worker_internal->launch_count, 0);
+    atomic_init(&worker_internal->watchdog_stop_count, 0);
+
+    /* the watchdog polls the completion flag instead of blocking in a join */
+    CHECK_SCCL_ERROR_RET(sccl_create_stream(device, &worker_internal->stream));
+    sccl_stream_wait_policy_t policy = {0};
+    policy.completion_flag = true;
+    CHECK_SCCL_ERROR_RET(
+        sccl_set_stream_wait_policy(worker_internal->stream, &policy));
+
+    size_t ring_size =
+        (WORKER_RING_HEADER_WORDS + config->capacity * WORKER_JOB_WORDS) *
+        sizeof(uint32_t);
+    CHECK_SCCL_ERROR_RET(sccl_create_buffer(device, &worker_internal->ring,
+                                            sccl_buffer_type_shared,
+                                            ring_size));
+    CHECK_SCCL_ERROR_RET(sccl_get_buffer_descriptor_index(
+        worker_internal->ring, &worker_internal->ring_index));
+    void *mapped;
+    CHECK_SCCL_ERROR_RET(
+        sccl_host_map_buffer(worker_internal->ring, &mapped, 0, ring_size));
+    memset(mapped, 0, ring_size);
+    worker_internal->ring_data = mapped;
+
+    if (pthread_create(&worker_internal->watchdog, NULL, watchdog_main,
+                       worker_internal) != 0) {
+        return sccl_system_error;
+    }
+
+    return sccl_success;
+}
+
+sccl_error_t sccl_create_worker(const sccl_device_t device,
+                                const sccl_worker_config_t *config,
+                                sccl_worker_t *worker)
+{
+    sccl_worker_config_t worker_config = {0};
+    if (config != NULL) {
+        worker_config = *config;
+    }
+    if (worker_config.capacity == 0) {
+        worker_config.capacity = SCCL_WORKER_DEFAULT_CAPACITY;
+    }
+    if (worker_config.lifetime_ns == 0) {
+        worker_config.lifetime_ns = SCCL_WORKER_DEFAULT_LIFETIME_NS;
+    }
+    if (worker_config.idle_polls == 0) {
+        worker_config.idle_polls = SCCL_WORKER_DEFAULT_IDLE_POLLS;
+    }
+    if (worker_config.capacity > INT32_MAX / WORKER_JOB_WORDS) {
+        return sccl_invalid_argument;
+    }
+    if (!device->descriptor_table.supported) {
+        return sccl_unsupported_error;
+    }
+
+    struct sccl_worker *worker_internal;
+    CHECK_SCCL_ERROR_RET(
+        sccl_calloc((void **)&worker_internal, 1, sizeof(struct sccl_worker)));
+    sccl_error_t error = init_worker(device, &worker_config, worker_internal);
+    if (error != sccl_success) {
+        destroy_worker_objects(worker_internal);
+        return error;
+    }
+
+    *worker = (sccl_worker_t)worker_internal;
+
+    return sccl_success;
+}
+
+void sccl_destroy_worker(sccl_worker_t worker)
+{
+    atomic_store(&worker->shutdown, true);
+    pthread_join(worker->watchdog, NULL);
+    destroy_worker_objects(worker);
+}
+
+/**
+ * Check that `size` bytes at `offset` of `buffer` are in a storage buffer of
+ * the worker device, get its descriptor table index.
+ */
+static sccl_error_t get_job_buffer(const sccl_worker_t worker,
+                                   const sccl_buffer_t buffer, size_t offset,
+                                   size_t size, uint32_t *index)
+{
+    CHECK_SCCL_NULL_RET(buffer);
+    if (buffer->device != worker->device || !buffer_is_storage(buffer) ||
+        offset % sizeof(uint32_t) != 0 || offset > buffer->size ||
+        buffer->size - offset < size ||
+        offset / sizeof(uint32_t) > UINT32_MAX) {
+        return sccl_invalid_argument;
+    }
+    return sccl_get_buffer_descriptor_index(buffer, index);
+}
+
+sccl_error_t sccl_enqueue_worker(const sccl_worker_t worker,
+                                 const sccl_worker_job_t *job,
+                                 uint64_t *ticket)
+{
+    CHECK_SCCL_NULL_RET(job);
+    CHECK_SCCL_NULL_RET(ticket);
+    if (job->size % sizeof(uint32_t) != 0 ||
+        job->size / sizeof(uint32_t) > UINT32_MAX) {
+        return sccl_invalid_argument;
+    }
+    uint32_t src_index = 0;
+    uint32_t dst_index;
+    switch (job->op) {
+    case sccl_worker_op_copy:
+    case sccl_worker_op_add:
+        CHECK_SCCL_ERROR_RET(get_job_buffer(worker, job->src, job->src_offset,
+                                            job->size, &src_index));
+        break;
+    case sccl_worker_op_fill:
+        break;
+    default:
+        return sccl_invalid_argument;
+    }
+    CHECK_SCCL_ERROR_RET(get_job_buffer(worker, job->dst, job->dst_offset,
+                                        job->size, &dst_index));
+
+    /* slot is free once the job `capacity` tickets earlier is done */
+    uint64_t job_ticket = atomic_fetch_add(&worker->next_ticket, 1);
+    while (job_ticket >= worker->capacity &&
+           !is_ticket_done(worker, job_ticket - worker->capacity)) {
+        sccl_error_t error = (sccl_error_t)atomic_load(&worker->error);
+        if (error != sccl_success) {
+            return error;
+        }
+        sched_yield();
+    }
+
+    volatile uint32_t *slot =
+        worker->ring_data + WORKER_RING_HEADER_WORDS +
+        (job_ticket % worker->capacity) * WORKER_JOB_WORDS;
+    slot[WORKER_JOB_OP] = (uint32_t)job->op;
+    slot[WORKER_JOB_SRC] = src_index;
+    slot[WORKER_JOB_SRC_OFFSET] =
+        (uint32_t)(job->src_offset / sizeof(uint32_t));
+    slot[WORKER_JOB_DST] = dst_index;
+    slot[WORKER_JOB_DST_OFFSET] =
+        (uint32_t)(job->dst_offset / sizeof(uint32_t));
+    slot[WORKER_JOB_COUNT] = (uint32_t)(job->size / sizeof(uint32_t));
+    slot[WORKER_JOB_VALUE] = job->value;
+    /* publish job after its fields */
+    atomic_thread_fence(memory_order_release);
+    slot[WORKER_JOB_SEQUENCE] = (uint32_t)(job_ticket + 1);
+
+    *ticket = job_ticket;
+    return sccl_success;
+}
+
+sccl_error_t sccl_query_worker(const sccl_worker_t worker, uint64_t ticket,
+                               bool *done)
+{
+    CHECK_SCCL_NULL_RET(done);
+    if (ticket >= atomic_load(&worker->next_ticket)) {
+        return sccl_invalid_argument;
+    }
+    *done = is_ticket_done(worker, ticket);
+    if (!*done) {
+        return (sccl_error_t)atomic_load(&worker->error);
+    }
+    return sccl_success;
+}
+
+sccl_error_t sccl_wait_worker(const sccl_worker_t worker, uint64_t ticket)
+{
+    bool done = false;
+    while (true) {
+        CHECK_SCCL_ERROR_RET(sccl_query_worker(worker, ticket, &done));
+        if (done) {
+            return sccl_success;
+        }
+        sched_yield();
+    }
+}
+
+sccl_error_t sccl_get_worker_stats(const sccl_worker_t worker,
+                                   sccl_worker_stats_t *stats)
+{
+    CHECK_SCCL_NULL_RET(stats);
+    stats->launch_count = atomic_load(&worker->launch_count);
+    stats->watchdog_stop_count = atomic_load(&worker->watchdog_stop_count);
+    return sccl_success;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#ifndef WORKER_HEADER
+#define WORKER_HEADER
+
+#include "sccl.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+/**
+ * Persistent worker kernel of a device, created the first time a worker is
+ * created.
+ */
+typedef struct {
+    sccl_shader_t shader;
+} worker_kernels_t;
+
+/**
+ * Destroy created shader, workers that used it must be destroyed.
+ */
+void worker_kernels_destroy(worker_kernels_t *kernels);
+
+struct sccl_worker {
+    sccl_device_t device;
+    /* runs the worker kernel, joins poll its completion flag */
+    sccl_stream_t stream;
+    /* shared storage buffer holding the ring header and job slots, see
+     * shaders/worker.comp for the layout */
+    sccl_buffer_t ring;
+    volatile uint32_t *ring_data;
+    uint32_t ring_index;
+    uint32_t capacity;
+    uint64_t lifetime_ns;
+    uint32_t idle_polls;
+    /* next ticket handed out by `sccl_enqueue_worker` */
+    atomic_uint_fast64_t next_ticket;
+    /* first error of the watchdog thread, jobs are not run after it */
+    atomic_int error;
+    atomic_bool shutdown;
+    atomic_uint_fast64_t launch_count;
+    atomic_uint_fast64_t watchdog_stop_count;
+    pthread_t watchdog;
+};
+
+#endif // WORKER_HEADER
@@ -0,0 +1,210 @@
+
+/**
+ * Build time tool that packs SPIR-V files into a C source fragment with an
+ * index and the compressed data of every shader, included by
+ * `src/sccl/bundle.c`.
+ *
+ * Usage: sccl_shader_bundle <output> <name>=<spirv path>...
+ *
+ * Every shader is compressed on its own so one can be unpacked without the
+ * rest. The compressed format is a sequence of
+ *     varint literal count, literal bytes
+ *     varint match length - BUNDLE_MIN_MATCH, varint match offset
+ * that ends after a literal run. Varints are little endian base 128. Must be
+ * kept in sync with `bundle_decompress` in `src/sccl/bundle.c`.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BUNDLE_MIN_MATCH 4
+#define BUNDLE_HASH_BITS 14
+
+typedef struct {
+    const char *name;
+    uint8_t *data;
+    size_t size;
+    uint8_t *compressed;
+    size_t compressed_size;
+} bundle_shader_t;
+
+static bool read_file(const char *path, uint8_t **data, size_t *size)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    bool ok = fseek(file, 0, SEEK_END) == 0;
+    long length = ok ? ftell(file) : -1;
+    ok = length > 0 && fseek(file, 0, SEEK_SET) == 0;
+    if (ok) {
+        *size = (size_t)length;
+        *data = malloc(*size);
+        ok = *data != NULL && fread(*data, 1, *size, file) == *size;
+    }
+    fclose(file);
+    return ok;
+}
+
+static uint8_t *write_varint(uint8_t *out, size_t value)
+{
+    while (value >= 0x80) {
+        *out++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (uint8_t)value;
+    return out;
+}
+
+static uint32_t hash_word(const uint8_t *bytes)
+{
+    uint32_t word;
+    memcpy(&word, bytes, sizeof(word));
+    return (word * 2654435761u) >> (32 - BUNDLE_HASH_BITS);
+}
+
+/**
+ * Greedy LZ77 with the most recent position of every hashed 4 byte sequence
+ * as the only match candidate. `out` must hold `2 * size + 16` bytes.
+ */
+static size_t compress(const uint8_t *in, size_t size, uint8_t *out)
+{
+    static size_t table[1 << BUNDLE_HASH_BITS];
+    for (size_t i = 0; i < (1 << BUNDLE_HASH_BITS); ++i) {
+        table[i] = SIZE_MAX;
+    }
+
+    uint8_t *begin = out;
+    size_t anchor = 0;
+    size_t pos = 0;
+    while (pos + BUNDLE_MIN_MATCH <= size) {
+        uint32_t hash = hash_word(&in[pos]);
+        size_t candidate = table[hash];
+        table[hash] = pos;
+        if (candidate == SIZE_MAX ||
+            memcmp(&in[candidate], &in[pos], BUNDLE_MIN_MATCH) != 0) {
+            ++pos;
+            continue;
+        }
+
+        size_t length = BUNDLE_MIN_MATCH;
+        while (pos + length < size &&
+               in[candidate + length] == in[pos + length]) {
+            ++length;
+        }
+        out = write_varint(out, pos - anchor);
+        memcpy(out, &in[anchor], pos - anchor);
+        out += pos - anchor;
+        out = write_varint(out, length - BUNDLE_MIN_MATCH);
+        out = write_varint(out, pos - candidate);
+        pos += length;
+        anchor = pos;
+    }
+    out = write_varint(out, size - anchor);
+    memcpy(out, &in[anchor], size - anchor);
+    out += size - anchor;
+
+    return (size_t)(out - begin);
+}
+
+static int compare_shader_name(const void *lhs, const void *rhs)
+{
+    return strcmp(((const bundle_shader_t *)lhs)->name,
+                  ((const bundle_shader_t *)rhs)->name);
+}
+
+static void write_bundle(FILE *file, const bundle_shader_t *shaders,
+                         size_t count)
+{
+    fprintf(file, "/* generated by sccl_shader_bundle, do not edit */\n\n");
+    fprintf(file, "static const bundle_entry_t bundle_entries[] = {\n");
+    size_t offset = 0;
+    for (size_t i = 0; i < count; ++i) {
+        fprintf(file, "    {\"%s\", %zuu, %zuu, %zuu},\n", shaders[i].name,
+                offset, shaders[i].compressed_size, shaders[i].size);
+        offset += shaders[i].compressed_size;
+    }
+    fprintf(file, "};\n\n");
+
+    fprintf(file, "static const uint8_t bundle_data[] = {");
+    size_t column = 0;
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t j = 0; j < shaders[i].compressed_size; ++j) {
+            fprintf(file, "%s0x%02x,", column % 12 == 0 ? "\n    " : " ",
+                    shaders[i].compressed[j]);
+            ++column;
+        }
+    }
+    fprintf(file, "\n};\n");
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <output> <name>=<spirv path>...\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    size_t count = (size_t)argc - 2;
+    bundle_shader_t *shaders = calloc(count, sizeof(bundle_shader_t));
+    if (shaders == NULL) {
+        return EXIT_FAILURE;
+    }
+    size_t total_size = 0;
+    size_t total_compressed_size = 0;
+    for (size_t i = 0; i < count; ++i) {
+        char *argument = argv[i + 2];
+        char *separator = strchr(argument, '=');
+        if (separator == NULL || separator == argument) {
+            fprintf(stderr, "expected <name>=<spirv path>: %s\n", argument);
+            return EXIT_FAILURE;
+        }
+        *separator = '\0';
+        shaders[i].name = argument;
+        if (!read_file(separator + 1, &shaders[i].data, &shaders[i].size)) {
+            fprintf(stderr, "failed to read %s\n", separator + 1);
+            return EXIT_FAILURE;
+        }
+        shaders[i].compressed = malloc(2 * shaders[i].size + 16);
+        if (shaders[i].compressed == NULL) {
+            return EXIT_FAILURE;
+        }
+        shaders[i].compressed_size =
+            compress(shaders[i].data, shaders[i].size, shaders[i].compressed);
+        total_size += shaders[i].size;
+        total_compressed_size += shaders[i].compressed_size;
+    }
+
+    /* sorted, so the library can binary search the index */
+    qsort(shaders, count, sizeof(bundle_shader_t), compare_shader_name);
+    for (size_t i = 1; i < count; ++i) {
+        if (strcmp(shaders[i - 1].name, shaders[i].name) == 0) {
+            fprintf(stderr, "duplicate shader name %s\n", shaders[i].name);
+            return EXIT_FAILURE;
+        }
+    }
+
+    FILE *file = fopen(argv[1], "w");
+    if (file == NULL) {
+        fprintf(stderr, "failed to open %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    write_bundle(file, shaders, count);
+    if (fclose(file) != 0) {
+        return EXIT_FAILURE;
+    }
+    printf("bundled %zu shaders, %zu bytes compressed to %zu\n", count,
+           total_size, total_compressed_size);
+
+    for (size_t i = 0; i < count; ++i) {
+        free(shaders[i].data);
+        free(shaders[i].compressed);
+    }
+    free(shaders);
+
+    return EXIT_SUCCESS;
+}
@@ -2,12 +2,18 @@
 #ifndef COMMON_HEADER
 #define COMMON_HEADER
 
+#include <sccl.h>
+
+#include <algorithm>
+#include <cstring>
+#include <gtest/gtest.h>
 #include <inttypes.h>
 #include <optional>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
+#include <vector>
 
 inline uint32_t get_environment_gpu_index()
 {
@@ -20,6 +26,63 @@ inline uint32_t get_environment_gpu_index()
     return gpu_index;
 }
 
+/**
+ * Fixture with an instance, the environment device and a stream on it.
+ */
+class device_stream_test : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        EXPECT_EQ(sccl_create_instance(&instance), sccl_success);
+        EXPECT_EQ(
+            sccl_create_device(instance, &device, get_environment_gpu_index()),
+            sccl_success);
+        EXPECT_EQ(sccl_create_stream(device, &stream), sccl_success);
+    }
+
+    void TearDown() override
+    {
+        sccl_destroy_stream(stream);
+        sccl_destroy_device(device);
+        sccl_destroy_instance(instance);
+    }
+
+    /**
+     * Create shared buffer holding `data`, at least 1 byte large.
+     */
+    template <typename T> sccl_buffer_t upload(const std::vector<T> &data)
+    {
+        size_t size = std::max<size_t>(data.size() * sizeof(T), 1);
+        sccl_buffer_t buffer;
+        EXPECT_EQ(sccl_create_buffer(device, &buffer, sccl_buffer_type_shared,
+                                     size),
+                  sccl_success);
+        void *mapped;
+        EXPECT_EQ(sccl_host_map_buffer(buffer, &mapped, 0, size),
+                  sccl_success);
+        memcpy(mapped, data.data(), data.size() * sizeof(T));
+        sccl_host_unmap_buffer(buffer);
+        return buffer;
+    }
+
+    template <typename T>
+    std::vector<T> download(sccl_buffer_t buffer, size_t count)
+    {
+        std::vector<T> data(count);
+        void *mapped;
+        EXPECT_EQ(sccl_host_map_buffer(buffer, &mapped, 0, count * sizeof(T)),
+                  sccl_success);
+        memcpy(data.data(), mapped, count * sizeof(T));
+        sccl_host_unmap_buffer(buffer);
+        return data;
+    }
+
+    sccl_instance_t instance;
+    sccl_device_t device;
+    sccl_stream_t stream;
+};
+
 inline const char *get_environment_shaders_dir()
 {
     const char *str = getenv("SCCL_TEST_SHADERS_DIR");
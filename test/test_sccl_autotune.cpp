@@ -0,0 +1,274 @@
+
+#include <sccl.h>
+
+#include "common.hpp"
+#include <cstring>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+/* elements processed by every recorded run */
+#define AUTOTUNE_TEST_COUNT (1 << 16)
+
+struct record_context_t {
+    sccl_device_t device;
+    sccl_buffer_t input;
+    sccl_buffer_t output;
+    size_t record_calls;
+};
+
+static sccl_error_t record_add(sccl_stream_t stream, sccl_shader_t shader,
+                               const uint32_t *values, void *user_data)
+{
+    record_context_t *context = static_cast<record_context_t *>(user_data);
+    ++context->record_calls;
+
+    sccl_shader_buffer_binding_t buffer_bindings[2];
+    buffer_bindings[0].position = {0, 0};
+    buffer_bindings[0].buffer = context->input;
+    buffer_bindings[1].position = {0, 1};
+    buffer_bindings[1].buffer = context->output;
+
+    uint32_t push_constants[2] = {AUTOTUNE_TEST_COUNT, 3};
+    sccl_shader_push_constant_binding push_constant_binding = {};
+    push_constant_binding.index = 0;
+    push_constant_binding.data = push_constants;
+
+    sccl_shader_run_params_t params = {};
+    params.buffer_bindings = buffer_bindings;
+    params.buffer_bindings_count = 2;
+    params.push_constant_bindings = &push_constant_binding;
+    params.push_constant_bindings_count = 1;
+
+    /* values[0] is the local size */
+    sccl_error_t error = sccl_get_group_counts(
+        context->device, AUTOTUNE_TEST_COUNT, values[0], &params);
+    if (error != sccl_success) {
+        return error;
+    }
+    return sccl_run_shader(stream, shader, &params);
+}
+
+/* records a run, then fails on the second call */
+static sccl_error_t record_add_then_fail(sccl_stream_t stream,
+                                         sccl_shader_t shader,
+                                         const uint32_t *values,
+                                         void *user_data)
+{
+    sccl_error_t error = record_add(stream, shader, values, user_data);
+    if (error != sccl_success) {
+        return error;
+    }
+    record_context_t *context = static_cast<record_context_t *>(user_data);
+    return context->record_calls == 2 ? sccl_out_of_resources_error
+                                      : sccl_success;
+}
+
+class autotune_test : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        EXPECT_EQ(sccl_create_instance(&instance), sccl_success);
+        EXPECT_EQ(
+            sccl_create_device(instance, &device, get_environment_gpu_index()),
+            sccl_success);
+        EXPECT_EQ(sccl_create_stream(device, &stream), sccl_success);
+
+        shader_source = read_test_shader("tunable_add_shader.spv").value();
+
+        buffer_layouts[0].position = {0, 0};
+        buffer_layouts[0].type = sccl_buffer_type_shared_storage;
+        buffer_layouts[1].position = {0, 1};
+        buffer_layouts[1].type = sccl_buffer_type_shared_storage;
+        push_constant_layout.size = 2 * sizeof(uint32_t);
+
+        shader_config.shader_source_code = shader_source.data();
+        shader_config.shader_source_code_length = shader_source.size();
+        shader_config.buffer_layouts = buffer_layouts;
+        shader_config.buffer_layouts_count = 2;
+        shader_config.push_constant_layouts = &push_constant_layout;
+        shader_config.push_constant_layouts_count = 1;
+
+        const size_t size = AUTOTUNE_TEST_COUNT * sizeof(uint32_t);
+        context.device = device;
+        EXPECT_EQ(sccl_create_buffer(device, &context.input,
+                                     sccl_buffer_type_shared, size),
+                  sccl_success);
+        EXPECT_EQ(sccl_create_buffer(device, &context.output,
+                                     sccl_buffer_type_shared, size),
+                  sccl_success);
+        void *mapped;
+        EXPECT_EQ(sccl_host_map_buffer(context.input, &mapped, 0, size),
+                  sccl_success);
+        for (uint32_t i = 0; i < AUTOTUNE_TEST_COUNT; ++i) {
+            static_cast<uint32_t *>(mapped)[i] = i;
+        }
+        sccl_host_unmap_buffer(context.input);
+
+        cache_path = (std::filesystem::temp_directory_path() /
+                      (std::string("sccl_autotune_") +
+                       testing::UnitTest::GetInstance()
+                           ->current_test_info()
+                           ->name() +
+                       ".txt"))
+                         .string();
+        std::filesystem::remove(cache_path);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove(cache_path);
+        sccl_destroy_buffer(context.output);
+        sccl_destroy_buffer(context.input);
+        sccl_destroy_stream(stream);
+        sccl_destroy_device(device);
+        sccl_destroy_instance(instance);
+    }
+
+    sccl_autotune_config_t
+    make_config(const std::vector<uint32_t> &candidates, size_t problem_size)
+    {
+        sccl_autotune_config_t config = {};
+        config.shader_config = &shader_config;
+        config.constant_ids = &local_size_id;
+        config.constant_ids_count = 1;
+        config.candidates = candidates.data();
+        config.candidates_count = candidates.size();
+        config.problem_size = problem_size;
+        config.record = record_add;
+        config.user_data = &context;
+        config.iterations = 3;
+        config.cache_path = cache_path.c_str();
+        return config;
+    }
+
+    sccl_instance_t instance;
+    sccl_device_t device;
+    sccl_stream_t stream;
+    std::string shader_source;
+    sccl_shader_buffer_layout_t buffer_layouts[2];
+    sccl_shader_push_constant_layout_t push_constant_layout = {};
+    sccl_shader_config_t shader_config = {};
+    const uint32_t local_size_id = 0;
+    record_context_t context = {};
+    std::string cache_path;
+};
+
+TEST_F(autotune_test, tune_and_reuse_cached_result)
+{
+    std::vector<uint32_t> candidates = {32, 64, 128, 256};
+    sccl_autotune_config_t config =
+        make_config(candidates, AUTOTUNE_TEST_COUNT);
+
+    size_t best = candidates.size();
+    sccl_error_t error = sccl_autotune(stream, &config, &best);
+    if (error == sccl_unsupported_error) {
+        GTEST_SKIP() << "timestamps not supported";
+    }
+    ASSERT_EQ(error, sccl_success);
+    EXPECT_LT(best, candidates.size());
+    /* warmup and timed runs of every candidate */
+    EXPECT_EQ(context.record_calls, candidates.size() * (1 + 3));
+    EXPECT_TRUE(std::filesystem::exists(cache_path));
+
+    /* every candidate computes the same result */
+    void *mapped;
+    EXPECT_EQ(sccl_host_map_buffer(context.output, &mapped, 0,
+                                   AUTOTUNE_TEST_COUNT * sizeof(uint32_t)),
+              sccl_success);
+    size_t mismatches = 0;
+    for (uint32_t i = 0; i < AUTOTUNE_TEST_COUNT; ++i) {
+        mismatches += static_cast<uint32_t *>(mapped)[i] != i + 3;
+    }
+    EXPECT_EQ(mismatches, 0u);
+    sccl_host_unmap_buffer(context.output);
+
+    /* same key is read from cache, sizes in the same power of two bucket
+     * share the result */
+    context.record_calls = 0;
+    config.problem_size = AUTOTUNE_TEST_COUNT + 1;
+    size_t cached_best = candidates.size();
+    EXPECT_EQ(sccl_autotune(stream, &config, &cached_best), sccl_success);
+    EXPECT_EQ(cached_best, best);
+    EXPECT_EQ(context.record_calls, 0u);
+
+    /* cached values are found at their new index */
+    std::vector<uint32_t> reversed(candidates.rbegin(), candidates.rend());
+    config.candidates = reversed.data();
+    EXPECT_EQ(sccl_autotune(stream, &config, &cached_best), sccl_success);
+    EXPECT_EQ(reversed[cached_best], candidates[best]);
+    EXPECT_EQ(context.record_calls, 0u);
+}
+
+TEST_F(autotune_test, retune_on_key_or_candidate_change)
+{
+    std::vector<uint32_t> candidates = {32, 64};
+    sccl_autotune_config_t config =
+        make_config(candidates, AUTOTUNE_TEST_COUNT);
+
+    size_t best;
+    sccl_error_t error = sccl_autotune(stream, &config, &best);
+    if (error == sccl_unsupported_error) {
+        GTEST_SKIP() << "timestamps not supported";
+    }
+    ASSERT_EQ(error, sccl_success);
+
+    /* other size bucket */
+    context.record_calls = 0;
+    config.problem_size = AUTOTUNE_TEST_COUNT * 4;
+    EXPECT_EQ(sccl_autotune(stream, &config, &best), sccl_success);
+    EXPECT_GT(context.record_calls, 0u);
+
+    /* cached values are not candidates anymore */
+    std::vector<uint32_t> other_candidates = {128, 256};
+    config.candidates = other_candidates.data();
+    context.record_calls = 0;
+    EXPECT_EQ(sccl_autotune(stream, &config, &best), sccl_success);
+    EXPECT_GT(context.record_calls, 0u);
+    EXPECT_LT(best, other_candidates.size());
+}
+
+TEST_F(autotune_test, record_error_leaves_stream_empty)
+{
+    std::vector<uint32_t> candidates = {32, 64};
+    sccl_autotune_config_t config =
+        make_config(candidates, AUTOTUNE_TEST_COUNT);
+    config.record = record_add_then_fail;
+
+    size_t best;
+    sccl_error_t error = sccl_autotune(stream, &config, &best);
+    if (error == sccl_unsupported_error) {
+        GTEST_SKIP() << "timestamps not supported";
+    }
+    EXPECT_EQ(error, sccl_out_of_resources_error);
+    EXPECT_EQ(context.record_calls, 2u);
+    EXPECT_FALSE(std::filesystem::exists(cache_path));
+
+    /* stream was joined, so it can be used again */
+    config.record = record_add;
+    EXPECT_EQ(sccl_autotune(stream, &config, &best), sccl_success);
+    EXPECT_LT(best, candidates.size());
+}
+
+TEST_F(autotune_test, invalid_config)
+{
+    std::vector<uint32_t> candidates = {32, 64};
+    size_t best;
+
+    sccl_autotune_config_t config = make_config(candidates, 1);
+    config.candidates_count = 0;
+    EXPECT_EQ(sccl_autotune(stream, &config, &best), sccl_invalid_argument);
+
+    config = make_config(candidates, 1);
+    config.record = NULL;
+    EXPECT_EQ(sccl_autotune(stream, &config, &best), sccl_invalid_argument);
+
+    config = make_config(candidates, 1);
+    config.constant_ids_count = SCCL_AUTOTUNE_MAX_CONSTANTS + 1;
+    EXPECT_EQ(sccl_autotune(stream, &config, &best), sccl_invalid_argument);
+
+    EXPECT_EQ(context.record_calls, 0u);
+    EXPECT_FALSE(std::filesystem::exists(cache_path));
+}
@@ -0,0 +1,336 @@
+
+#include <sccl.h>
+
+#include "common.hpp"
+#include <cstring>
+#include <gtest/gtest.h>
+#include <vector>
+
+/* several logical devices on the same physical device */
+#define RANK_COUNT 3
+
+class collective_test : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        EXPECT_EQ(sccl_create_instance(&instance), sccl_success);
+        for (size_t i = 0; i < RANK_COUNT; ++i) {
+            EXPECT_EQ(sccl_create_device(instance, &devices[i],
+                                         get_environment_gpu_index()),
+                      sccl_success);
+            EXPECT_EQ(sccl_create_stream(devices[i], &streams[i]),
+                      sccl_success);
+        }
+    }
+
+    void TearDown() override
+    {
+        for (size_t i = 0; i < RANK_COUNT; ++i) {
+            sccl_destroy_stream(streams[i]);
+            sccl_destroy_device(devices[i]);
+        }
+        sccl_destroy_instance(instance);
+    }
+
+    /* create shared buffer on device of rank filled with `data` */
+    template <typename T>
+    sccl_buffer_t create_buffer(size_t rank, const std::vector<T> &data)
+    {
+        size_t size = data.size() * sizeof(T);
+        sccl_buffer_t buffer;
+        EXPECT_EQ(sccl_create_buffer(devices[rank], &buffer,
+                                     sccl_buffer_type_shared, size),
+                  sccl_success);
+        void *mapped;
+        EXPECT_EQ(sccl_host_map_buffer(buffer, &mapped, 0, size),
+                  sccl_success);
+        memcpy(mapped, data.data(), size);
+        sccl_host_unmap_buffer(buffer);
+        return buffer;
+    }
+
+    /* create shared buffer on every rank, filled with `data[rank]` */
+    template <typename T>
+    void create_buffers(const std::vector<std::vector<T>> &data)
+    {
+        for (size_t i = 0; i < RANK_COUNT; ++i) {
+            buffers[i] = create_buffer(i, data[i]);
+        }
+    }
+
+    template <typename T>
+    std::vector<T> read_buffer(sccl_buffer_t buffer, size_t count)
+    {
+        std::vector<T> result(count);
+        void *mapped;
+        EXPECT_EQ(
+            sccl_host_map_buffer(buffer, &mapped, 0, count * sizeof(T)),
+            sccl_success);
+        memcpy(result.data(), mapped, count * sizeof(T));
+        sccl_host_unmap_buffer(buffer);
+        return result;
+    }
+
+    template <typename T> std::vector<T> read_buffer(size_t rank, size_t count)
+    {
+        return read_buffer<T>(buffers[rank], count);
+    }
+
+    void destroy_buffers()
+    {
+        for (size_t i = 0; i < RANK_COUNT; ++i) {
+            sccl_destroy_buffer(buffers[i]);
+        }
+    }
+
+    sccl_instance_t instance;
+    sccl_device_t devices[RANK_COUNT];
+    sccl_stream_t streams[RANK_COUNT];
+    sccl_buffer_t buffers[RANK_COUNT];
+};
+
+TEST_F(collective_test, allreduce_sum_int32)
+{
+    /* more than one staging slice per chunk, not divisible by rank count */
+    size_t count = 2 * SCCL_COLLECTIVE_SLICE_SIZE / sizeof(int32_t) + 7;
+    std::vector<std::vector<int32_t>> data(RANK_COUNT);
+    for (size_t i = 0; i < RANK_COUNT; ++i) {
+        data[i].resize(count);
+        for (size_t j = 0; j < count; ++j) {
+            data[i][j] = (int32_t)(j % 1000) * (int32_t)(i + 1);
+        }
+    }
+    create_buffers(data);
+
+    EXPECT_EQ(sccl_allreduce(streams, buffers, RANK_COUNT, count,
+                             sccl_dtype_int32, sccl_reduce_op_sum),
+              sccl_success);
+
+    for (size_t i = 0; i < RANK_COUNT; ++i) {
+        std::vector<int32_t> result = read_buffer<int32_t>(i, count);
+        for (size_t j = 0; j < count; ++j) {
+            /* 1 + 2 + 3 */
+            ASSERT_EQ(result[j], (int32_t)(j % 1000) * 6);
+        }
+    }
+
+    destroy_buffers();
+}
+
+TEST_F(collective_test, allreduce_max_float32)
+{
+    size_t count = 1000;
+    std::vector<std::vector<float>> data(RANK_COUNT);
+    for (size_t i = 0; i < RANK_COUNT; ++i) {
+        data[i].resize(count);
+        for (size_t j = 0; j < count; ++j) {
+            /* rank with the largest value differs per element */
+            data[i][j] = (float)((j + i) % RANK_COUNT) - 0.5f;
+        }
+    }
+    create_buffers(data);
+
+    EXPECT_EQ(sccl_allreduce(streams, buffers, RANK_COUNT, count,
+                             sccl_dtype_float32, sccl_reduce_op_max),
+              sccl_success);
+
+    for (size_t i = 0; i < RANK_COUNT; ++i) {
+        std::vector<float> result = read_buffer<float>(i, count);
+        for (size_t j = 0; j < count; ++j) {
+            ASSERT_EQ(result[j], (float)(RANK_COUNT - 1) - 0.5f);
+        }
+    }
+
+    destroy_buffers();
+}
+
+TEST_F(collective_test, allreduce_fewer_elements_than_ranks)
+{
+    /* some chunks are empty */
+    size_t count = 2;
+    std::vector<std::vector<int64_t>> data(RANK_COUNT);
+    for (size_t i = 0; i < RANK_COUNT; ++i) {
+        data[i] = {(int64_t)i + 1, (int64_t)1 << (40 + i)};
+    }
+    create_buffers(data);
+
+    EXPECT_EQ(sccl_allreduce(streams, buffers, RANK_COUNT, count,
+                             sccl_dtype_int64, sccl_reduce_op_sum),
+              sccl_success);
+
+    for (size_t i = 0; i < RANK_COUNT; ++i) {
+        std::vector<int64_t> result = read_buffer<int64_t>(i, count);
+        EXPECT_EQ(result[0], 6);
+        EXPECT_EQ(result[1], ((int64_t)1 << 40) * 7);
+    }
+
+    destroy_buffers();
+}
+
+TEST_F(collective_test, allreduce_invalid_arguments)
+{
+    std::vector<std::vector<uint32_t>> data(RANK_COUNT,
+                                            std::vector<uint32_t>(16));
+    create_buffers(data);
+
+    /* buffer too small */
+    EXPECT_EQ(sccl_allreduce(streams, buffers, RANK_COUNT, 17,
+                             sccl_dtype_uint32, sccl_reduce_op_sum),
+              sccl_invalid_argument);
+
+    /* buffer on other device than stream */
+    sccl_stream_t swapped_streams[RANK_COUNT] = {streams[1], streams[0],
+                                                 streams[2]};
+    EXPECT_EQ(sccl_allreduce(swapped_streams, buffers, RANK_COUNT, 16,
+                             sccl_dtype_uint32, sccl_reduce_op_sum),
+              sccl_invalid_argument);
+
+    EXPECT_EQ(sccl_allreduce(streams, buffers, 0, 16, sccl_dtype_uint32,
+                             sccl_reduce_op_sum),
+              sccl_invalid_argument);
+
+    /* single rank is a no-op */
+    EXPECT_EQ(sccl_allreduce(streams, buffers, 1, 16, sccl_dtype_uint32,
+                             sccl_reduce_op_sum),
+              sccl_success);
+
+    destroy_buffers();
+}
+
+TEST_F(collective_test, broadcast)
+{
+    /* several slices, so hops are pipelined */
+    size_t count = 3 * SCCL_COLLECTIVE_SLICE_SIZE / sizeof(uint32_t) + 1;
+    std::vector<std::vector<uint32_t>> data(RANK_COUNT);
+    for (size_t i = 0; i < RANK_COUNT; ++i) {
+        data[i].resize(count);
+        for (size_t j = 0; j < count; ++j) {
+            data[i][j] = (uint32_t)(j * RANK_COUNT + i);
+        }
+    }
+    create_buffers(data);
+
+    size_t root = 1;
+    EXPECT_EQ(sccl_broadcast(streams, buffers, RANK_COUNT, root,
+                             count * sizeof(uint32_t)),
+              sccl_success);
+
+    for (size_t i = 0; i < RANK_COUNT; ++i) {
+        EXPECT_EQ(read_buffer<uint32_t>(i, count), data[root]);
+    }
+
+    EXPECT_EQ(
+        sccl_broadcast(streams, buffers, RANK_COUNT, RANK_COUNT, sizeof(int)),
+        sccl_invalid_argument);
+
+    destroy_buffers();
+}
+
+TEST_F(collective_test, scatter_gather)
+{
+    size_t count = 1000;
+    size_t root = 2;
+    std::vector<uint32_t> data(RANK_COUNT * count);
+    for (size_t j = 0; j < data.size(); ++j) {
+        data[j] = (uint32_t)j;
+    }
+    sccl_buffer_t root_buffer = create_buffer(root, data);
+    create_buffers(std::vector<std::vector<uint32_t>>(
+        RANK_COUNT, std::vector<uint32_t>(count)));
+
+    EXPECT_EQ(sccl_scatter(streams, root_buffer, buffers, RANK_COUNT, root,
+                           count * sizeof(uint32_t)),
+              sccl_success);
+    for (size_t i = 0; i < RANK_COUNT; ++i) {
+        std::vector<uint32_t> result = read_buffer<uint32_t>(i, count);
+        EXPECT_EQ(result, std::vector<uint32_t>(data.begin() + i * count,
+                                                data.begin() +
+                                                    (i + 1) * count));
+    }
+
+    /* gather back to a cleared root buffer */
+    sccl_destroy_buffer(root_buffer);
+    root_buffer =
+        create_buffer(root, std::vector<uint32_t>(RANK_COUNT * count));
+    EXPECT_EQ(sccl_gather(streams, buffers, root_buffer, RANK_COUNT, root,
+                          count * sizeof(uint32_t)),
+              sccl_success);
+    EXPECT_EQ(read_buffer<uint32_t>(root_buffer, RANK_COUNT * count), data);
+
+    /* root buffer must be on root device */
+    EXPECT_EQ(sccl_gather(streams, buffers, root_buffer, RANK_COUNT, 0,
+                          count * sizeof(uint32_t)),
+              sccl_invalid_argument);
+
+    sccl_destroy_buffer(root_buffer);
+    destroy_buffers();
+}
+
+TEST_F(collective_test, reduce_scatter_sum_int32)
+{
+    size_t count = SCCL_COLLECTIVE_SLICE_SIZE / sizeof(int32_t) + 3;
+    std::vector<std::vector<int32_t>> data(RANK_COUNT);
+    for (size_t i = 0; i < RANK_COUNT; ++i) {
+        data[i].resize(RANK_COUNT * count);
+        for (size_t j = 0; j < data[i].size(); ++j) {
+            data[i][j] = (int32_t)(j % 100) + (int32_t)i;
+        }
+    }
+    create_buffers(data);
+    sccl_buffer_t dst_buffers[RANK_COUNT];
+    for (size_t i = 0; i < RANK_COUNT; ++i) {
+        dst_buffers[i] = create_buffer(i, std::vector<int32_t>(count));
+    }
+
+    EXPECT_EQ(sccl_reduce_scatter(streams, buffers, dst_buffers, RANK_COUNT,
+                                  count, sccl_dtype_int32, sccl_reduce_op_sum),
+              sccl_success);
+
+    for (size_t i = 0; i < RANK_COUNT; ++i) {
+        std::vector<int32_t> result =
+            read_buffer<int32_t>(dst_buffers[i], count);
+        for (size_t j = 0; j < count; ++j) {
+            /* sum of (x + rank) over ranks 0, 1, 2 */
+            int32_t x = (int32_t)((i * count + j) % 100);
+            ASSERT_EQ(result[j], RANK_COUNT * x + 3);
+        }
+        /* source is left as is */
+        EXPECT_EQ(read_buffer<int32_t>(i, RANK_COUNT * count), data[i]);
+        sccl_destroy_buffer(dst_buffers[i]);
+    }
+
+    destroy_buffers();
+}
+
+TEST_F(collective_test, all_gather)
+{
+    size_t count = 777;
+    std::vector<std::vector<uint32_t>> data(RANK_COUNT);
+    std::vector<uint32_t> expected;
+    for (size_t i = 0; i < RANK_COUNT; ++i) {
+        data[i].resize(count);
+        for (size_t j = 0; j < count; ++j) {
+            data[i][j] = (uint32_t)(i * 1000000 + j);
+        }
+        expected.insert(expected.end(), data[i].begin(), data[i].end());
+    }
+    create_buffers(data);
+    sccl_buffer_t dst_buffers[RANK_COUNT];
+    for (size_t i = 0; i < RANK_COUNT; ++i) {
+        dst_buffers[i] =
+            create_buffer(i, std::vector<uint32_t>(RANK_COUNT * count));
+    }
+
+    EXPECT_EQ(sccl_all_gather(streams, buffers, dst_buffers, RANK_COUNT,
+                              count * sizeof(uint32_t)),
+              sccl_success);
+
+    for (size_t i = 0; i < RANK_COUNT; ++i) {
+        EXPECT_EQ(read_buffer<uint32_t>(dst_buffers[i], RANK_COUNT * count),
+                  expected);
+        sccl_destroy_buffer(dst_buffers[i]);
+    }
+
+    destroy_buffers();
+}
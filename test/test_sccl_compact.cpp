@@ -0,0 +1,214 @@
+
+#include <sccl.h>
+
+#include "common.hpp"
+#include <algorithm>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <vector>
+
+class compact_test : public device_stream_test
+{
+protected:
+    void SetUp() override
+    {
+        device_stream_test::SetUp();
+        EXPECT_EQ(sccl_create_buffer(device, &selected_count,
+                                     sccl_buffer_type_shared,
+                                     sizeof(uint32_t)),
+                  sccl_success);
+    }
+
+    void TearDown() override
+    {
+        sccl_destroy_buffer(selected_count);
+        device_stream_test::TearDown();
+    }
+
+    /**
+     * Read selected count and that many elements of `dst`.
+     */
+    template <typename T> std::vector<T> read_selected(sccl_buffer_t dst)
+    {
+        void *mapped;
+        EXPECT_EQ(sccl_host_map_buffer(selected_count, &mapped, 0,
+                                       sizeof(uint32_t)),
+                  sccl_success);
+        uint32_t count = *static_cast<uint32_t *>(mapped);
+        sccl_host_unmap_buffer(selected_count);
+
+        std::vector<T> data(count);
+        if (count > 0) {
+            EXPECT_EQ(sccl_host_map_buffer(dst, &mapped, 0, count * sizeof(T)),
+                      sccl_success);
+            memcpy(data.data(), mapped, count * sizeof(T));
+            sccl_host_unmap_buffer(dst);
+        }
+        return data;
+    }
+
+    /**
+     * Run `sccl_select_if` on `data`, returns error of the call. Selected
+     * elements are only written if it succeeded.
+     */
+    template <typename T, typename V>
+    sccl_error_t select_if(const std::vector<T> &data, sccl_dtype_t dtype,
+                           sccl_compare_op_t compare_op, V value,
+                           std::vector<T> *selected)
+    {
+        sccl_buffer_t src = upload(data);
+        sccl_buffer_t dst = upload(std::vector<T>(data.size()));
+        sccl_error_t error = sccl_select_if(stream, src, dst, selected_count,
+                                            data.size(), dtype, compare_op,
+                                            &value);
+        EXPECT_EQ(sccl_dispatch_stream(stream), sccl_success);
+        EXPECT_EQ(sccl_join_stream(stream), sccl_success);
+        if (error == sccl_success) {
+            *selected = read_selected<T>(dst);
+        }
+        sccl_destroy_buffer(dst);
+        sccl_destroy_buffer(src);
+        return error;
+    }
+
+    sccl_buffer_t selected_count;
+};
+
+TEST_F(compact_test, compact_flags)
+{
+    std::vector<int32_t> data(1000000);
+    std::vector<uint32_t> flags(data.size());
+    std::vector<int32_t> expected;
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = (int32_t)i - 500;
+        /* any non-zero flag selects */
+        flags[i] = (i % 3 == 0) ? (uint32_t)i + 1 : 0;
+        if (flags[i] != 0) {
+            expected.push_back(data[i]);
+        }
+    }
+
+    sccl_buffer_t src = upload(data);
+    sccl_buffer_t flag_buffer = upload(flags);
+    sccl_buffer_t dst = upload(std::vector<int32_t>(data.size()));
+    ASSERT_EQ(sccl_compact(stream, src, flag_buffer, dst, selected_count,
+                           data.size(), sccl_dtype_int32),
+              sccl_success);
+    ASSERT_EQ(sccl_dispatch_stream(stream), sccl_success);
+    ASSERT_EQ(sccl_join_stream(stream), sccl_success);
+    EXPECT_EQ(read_selected<int32_t>(dst), expected);
+
+    sccl_destroy_buffer(dst);
+    sccl_destroy_buffer(flag_buffer);
+    sccl_destroy_buffer(src);
+}
+
+TEST_F(compact_test, select_if_float32)
+{
+    std::vector<float> data(300000);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = (float)((i * 2654435761u) % 1000u) - 500.0f;
+    }
+
+    const sccl_compare_op_t ops[] = {
+        sccl_compare_op_equal,      sccl_compare_op_not_equal,
+        sccl_compare_op_less,       sccl_compare_op_less_equal,
+        sccl_compare_op_greater,    sccl_compare_op_greater_equal};
+    for (sccl_compare_op_t op : ops) {
+        float value = 17.0f;
+        std::vector<float> expected;
+        for (float x : data) {
+            bool keep[] = {x == value, x != value, x < value,
+                           x <= value, x > value,  x >= value};
+            if (keep[op]) {
+                expected.push_back(x);
+            }
+        }
+        std::vector<float> selected;
+        ASSERT_EQ(select_if(data, sccl_dtype_float32, op, value, &selected),
+                  sccl_success);
+        EXPECT_EQ(selected, expected);
+    }
+}
+
+TEST_F(compact_test, select_if_int64)
+{
+    std::vector<int64_t> data(100000);
+    std::vector<int64_t> expected;
+    int64_t value = ((int64_t)1 << 40) + 3;
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = ((int64_t)1 << 40) + (int64_t)(i % 7);
+        if (data[i] >= value) {
+            expected.push_back(data[i]);
+        }
+    }
+    std::vector<int64_t> selected;
+    ASSERT_EQ(select_if(data, sccl_dtype_int64,
+                        sccl_compare_op_greater_equal, value, &selected),
+              sccl_success);
+    EXPECT_EQ(selected, expected);
+}
+
+TEST_F(compact_test, select_if_float16)
+{
+    /* 1.0, 2.0 and -2.0 as half precision */
+    std::vector<uint16_t> data = {0x3c00, 0x4000, 0xc000, 0x4000, 0x3c00};
+    std::vector<uint16_t> selected;
+    sccl_error_t error = select_if(data, sccl_dtype_float16,
+                                   sccl_compare_op_greater, 1.5f, &selected);
+    if (error == sccl_unsupported_error) {
+        GTEST_SKIP() << "16-bit storage buffer access not supported";
+    }
+    ASSERT_EQ(error, sccl_success);
+    EXPECT_EQ(selected, (std::vector<uint16_t>{0x4000, 0x4000}));
+}
+
+TEST_F(compact_test, empty_writes_zero_count)
+{
+    std::vector<uint32_t> data = {1};
+    sccl_buffer_t src = upload(data);
+    /* count is written on the device even if nothing is selected */
+    void *mapped;
+    ASSERT_EQ(sccl_host_map_buffer(selected_count, &mapped, 0,
+                                   sizeof(uint32_t)),
+              sccl_success);
+    *static_cast<uint32_t *>(mapped) = 123;
+    sccl_host_unmap_buffer(selected_count);
+
+    ASSERT_EQ(sccl_compact(stream, src, src, src, selected_count, 0,
+                           sccl_dtype_uint32),
+              sccl_success);
+    ASSERT_EQ(sccl_dispatch_stream(stream), sccl_success);
+    ASSERT_EQ(sccl_join_stream(stream), sccl_success);
+    EXPECT_TRUE(read_selected<uint32_t>(src).empty());
+
+    sccl_destroy_buffer(src);
+}
+
+TEST_F(compact_test, invalid_arguments)
+{
+    std::vector<uint32_t> data(16, 1);
+    sccl_buffer_t buffer = upload(data);
+    uint32_t value = 1;
+
+    /* buffers too small */
+    EXPECT_EQ(sccl_compact(stream, buffer, buffer, buffer, selected_count,
+                           17, sccl_dtype_uint32),
+              sccl_invalid_argument);
+    EXPECT_EQ(sccl_select_if(stream, buffer, buffer, selected_count, 9,
+                             sccl_dtype_int64, sccl_compare_op_equal, &value),
+              sccl_invalid_argument);
+    /* missing value, invalid comparison and type */
+    EXPECT_EQ(sccl_select_if(stream, buffer, buffer, selected_count, 16,
+                             sccl_dtype_uint32, sccl_compare_op_equal, NULL),
+              sccl_invalid_argument);
+    EXPECT_EQ(sccl_select_if(stream, buffer, buffer, selected_count, 16,
+                             sccl_dtype_uint32, (sccl_compare_op_t)99,
+                             &value),
+              sccl_invalid_argument);
+    EXPECT_EQ(sccl_select_if(stream, buffer, buffer, selected_count, 16,
+                             (sccl_dtype_t)99, sccl_compare_op_equal, &value),
+              sccl_invalid_argument);
+
+    sccl_destroy_buffer(buffer);
+}
@@ -0,0 +1,333 @@
+#include <sccl.h>
+
+#include "common.hpp"
+#include <gtest/gtest.h>
+
+#include <set>
+
+class descriptor_table_test : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        EXPECT_EQ(sccl_create_instance(&instance), sccl_success);
+        EXPECT_EQ(
+            sccl_create_device(instance, &device, get_environment_gpu_index()),
+            sccl_success);
+
+        /* skip if device does not support descriptor indexing */
+        sccl_buffer_t buffer;
+        EXPECT_EQ(
+            sccl_create_buffer(device, &buffer, sccl_buffer_type_host, 0x1000),
+            sccl_success);
+        uint32_t index;
+        sccl_error_t error = sccl_get_buffer_descriptor_index(buffer, &index);
+        sccl_destroy_buffer(buffer);
+        if (error == sccl_unsupported_error) {
+            GTEST_SKIP() << "descriptor indexing not supported";
+        }
+        EXPECT_EQ(error, sccl_success);
+    }
+
+    void TearDown() override
+    {
+        sccl_destroy_device(device);
+        sccl_destroy_instance(instance);
+    }
+
+    sccl_instance_t instance;
+    sccl_device_t device;
+};
+
+TEST_F(descriptor_table_test, unique_indices)
+{
+    const size_t buffer_count = 32;
+    std::vector<sccl_buffer_t> buffers(buffer_count);
+    std::set<uint32_t> indices;
+
+    for (sccl_buffer_t &buffer : buffers) {
+        EXPECT_EQ(sccl_create_buffer(device, &buffer,
+                                     sccl_buffer_type_device_storage, 0x1000),
+                  sccl_success);
+        uint32_t index;
+        EXPECT_EQ(sccl_get_buffer_descriptor_index(buffer, &index),
+                  sccl_success);
+        EXPECT_NE(index, SCCL_DESCRIPTOR_TABLE_INVALID_INDEX);
+        indices.insert(index);
+    }
+    EXPECT_EQ(indices.size(), buffer_count);
+
+    /* index is stable */
+    for (sccl_buffer_t buffer : buffers) {
+        uint32_t index;
+        EXPECT_EQ(sccl_get_buffer_descriptor_index(buffer, &index),
+                  sccl_success);
+        EXPECT_EQ(indices.count(index), 1);
+    }
+
+    for (sccl_buffer_t buffer : buffers) {
+        sccl_destroy_buffer(buffer);
+    }
+}
+
+TEST_F(descriptor_table_test, uniform_buffer_not_in_table)
+{
+    sccl_buffer_t buffer;
+    EXPECT_EQ(sccl_create_buffer(device, &buffer,
+                                 sccl_buffer_type_host_uniform, 0x1000),
+              sccl_success);
+    uint32_t index;
+    EXPECT_EQ(sccl_get_buffer_descriptor_index(buffer, &index),
+              sccl_unsupported_error);
+    sccl_destroy_buffer(buffer);
+}
+
+TEST_F(descriptor_table_test, bindless_shader_with_buffer_layouts)
+{
+    std::string shader_source =
+        read_test_shader("bindless_add_shader.spv").value();
+
+    sccl_shader_buffer_layout_t buffer_layout = {};
+    buffer_layout.type = sccl_buffer_type_host_storage;
+
+    sccl_shader_config_t shader_config = {};
+    shader_config.shader_source_code = shader_source.data();
+    shader_config.shader_source_code_length = shader_source.size();
+    shader_config.buffer_layouts = &buffer_layout;
+    shader_config.buffer_layouts_count = 1;
+    shader_config.bindless = true;
+
+    sccl_shader_t shader;
+    EXPECT_EQ(sccl_create_shader(device, &shader, &shader_config),
+              sccl_invalid_argument);
+}
+
+TEST_F(descriptor_table_test, run_bindless_shader)
+{
+    std::string shader_source =
+        read_test_shader("bindless_add_shader.spv").value();
+
+    struct {
+        uint32_t input_index;
+        uint32_t output_index;
+        uint32_t value;
+    } push_constants;
+
+    sccl_shader_push_constant_layout_t push_constant_layout = {};
+    push_constant_layout.size = sizeof(push_constants);
+
+    sccl_shader_config_t shader_config = {};
+    shader_config.shader_source_code = shader_source.data();
+    shader_config.shader_source_code_length = shader_source.size();
+    shader_config.push_constant_layouts = &push_constant_layout;
+    shader_config.push_constant_layouts_count = 1;
+    shader_config.bindless = true;
+
+    sccl_shader_t shader;
+    EXPECT_EQ(sccl_create_shader(device, &shader, &shader_config),
+              sccl_success);
+
+    /* shader has local size 64 */
+    const size_t element_count = 64 * 16;
+    const size_t size = element_count * sizeof(uint32_t);
+    const size_t buffer_count = 4;
+    std::vector<sccl_buffer_t> buffers(buffer_count);
+    std::vector<uint32_t> indices(buffer_count);
+    for (size_t i = 0; i < buffer_count; ++i) {
+        EXPECT_EQ(sccl_create_buffer(device, &buffers[i],
+                                     sccl_buffer_type_host, size),
+                  sccl_success);
+        EXPECT_EQ(sccl_get_buffer_descriptor_index(buffers[i], &indices[i]),
+                  sccl_success);
+    }
+
+    void *data_ptr;
+    EXPECT_EQ(sccl_host_map_buffer(buffers[0], &data_ptr, 0, size),
+              sccl_success);
+    for (size_t i = 0; i < element_count; ++i) {
+        static_cast<uint32_t *>(data_ptr)[i] = i;
+    }
+    sccl_host_unmap_buffer(buffers[0]);
+
+    sccl_stream_t stream;
+    EXPECT_EQ(sccl_create_stream(device, &stream), sccl_success);
+
+    /* chain runs through all buffers in a single dispatch */
+    push_constants.value = 5;
+    for (size_t i = 0; i + 1 < buffer_count; ++i) {
+        push_constants.input_index = indices[i];
+        push_constants.output_index = indices[i + 1];
+
+        sccl_shader_push_constant_binding push_constant_binding = {};
+        push_constant_binding.index = 0;
+        push_constant_binding.data = &push_constants;
+
+        sccl_shader_run_params_t params = {};
+        params.group_count_x = element_count / 64;
+        params.group_count_y = 1;
+        params.group_count_z = 1;
+        params.push_constant_bindings = &push_constant_binding;
+        params.push_constant_bindings_count = 1;
+        EXPECT_EQ(sccl_run_shader(stream, shader, &params), sccl_success);
+    }
+
+    EXPECT_EQ(sccl_dispatch_stream(stream), sccl_success);
+    EXPECT_EQ(sccl_join_stream(stream), sccl_success);
+
+    EXPECT_EQ(
+        sccl_host_map_buffer(buffers[buffer_count - 1], &data_ptr, 0, size),
+        sccl_success);
+    for (size_t i = 0; i < element_count; ++i) {
+        EXPECT_EQ(static_cast<uint32_t *>(data_ptr)[i],
+                  i + (buffer_count - 1) * push_constants.value);
+    }
+    sccl_host_unmap_buffer(buffers[buffer_count - 1]);
+
+    sccl_destroy_stream(stream);
+    for (sccl_buffer_t buffer : buffers) {
+        sccl_destroy_buffer(buffer);
+    }
+    sccl_destroy_shader(shader);
+}
+
+TEST_F(descriptor_table_test, run_bindless_shader_after_shader)
+{
+    std::string bindless_shader_source =
+        read_test_shader("bindless_add_shader.spv").value();
+    std::string shader_source = read_test_shader("add_shader.spv").value();
+
+    struct {
+        uint32_t input_index;
+        uint32_t output_index;
+        uint32_t value;
+    } push_constants;
+
+    sccl_shader_push_constant_layout_t bindless_push_constant_layout = {};
+    bindless_push_constant_layout.size = sizeof(push_constants);
+
+    sccl_shader_config_t bindless_shader_config = {};
+    bindless_shader_config.shader_source_code = bindless_shader_source.data();
+    bindless_shader_config.shader_source_code_length =
+        bindless_shader_source.size();
+    bindless_shader_config.push_constant_layouts =
+        &bindless_push_constant_layout;
+    bindless_shader_config.push_constant_layouts_count = 1;
+    bindless_shader_config.bindless = true;
+
+    sccl_shader_t bindless_shader;
+    EXPECT_EQ(
+        sccl_create_shader(device, &bindless_shader, &bindless_shader_config),
+        sccl_success);
+
+    /* classic shader binds its own, incompatible, set 0 */
+    sccl_shader_buffer_layout_t buffer_layouts[2];
+    buffer_layouts[0].position.set = 0;
+    buffer_layouts[0].position.binding = 0;
+    buffer_layouts[0].type = sccl_buffer_type_host_storage;
+    buffer_layouts[1].position.set = 1;
+    buffer_layouts[1].position.binding = 0;
+    buffer_layouts[1].type = sccl_buffer_type_host_storage;
+
+    sccl_shader_push_constant_layout_t push_constant_layout = {};
+    push_constant_layout.size = sizeof(uint32_t);
+
+    sccl_shader_config_t shader_config = {};
+    shader_config.shader_source_code = shader_source.data();
+    shader_config.shader_source_code_length = shader_source.size();
+    shader_config.buffer_layouts = buffer_layouts;
+    shader_config.buffer_layouts_count = 2;
+    shader_config.push_constant_layouts = &push_constant_layout;
+    shader_config.push_constant_layouts_count = 1;
+
+    sccl_shader_t shader;
+    EXPECT_EQ(sccl_create_shader(device, &shader, &shader_config),
+              sccl_success);
+
+    /* shaders have local size 64 */
+    const size_t element_count = 64 * 16;
+    const size_t size = element_count * sizeof(uint32_t);
+    const size_t buffer_count = 4;
+    std::vector<sccl_buffer_t> buffers(buffer_count);
+    std::vector<uint32_t> indices(buffer_count);
+    for (size_t i = 0; i < buffer_count; ++i) {
+        EXPECT_EQ(sccl_create_buffer(device, &buffers[i],
+                                     sccl_buffer_type_host, size),
+                  sccl_success);
+        EXPECT_EQ(sccl_get_buffer_descriptor_index(buffers[i], &indices[i]),
+                  sccl_success);
+    }
+
+    void *data_ptr;
+    EXPECT_EQ(sccl_host_map_buffer(buffers[0], &data_ptr, 0, size),
+              sccl_success);
+    for (size_t i = 0; i < element_count; ++i) {
+        static_cast<uint32_t *>(data_ptr)[i] = i;
+    }
+    sccl_host_unmap_buffer(buffers[0]);
+
+    sccl_stream_t stream;
+    EXPECT_EQ(sccl_create_stream(device, &stream), sccl_success);
+
+    sccl_shader_push_constant_binding bindless_push_constant_binding = {};
+    bindless_push_constant_binding.index = 0;
+    bindless_push_constant_binding.data = &push_constants;
+
+    sccl_shader_run_params_t bindless_params = {};
+    bindless_params.group_count_x = element_count / 64;
+    bindless_params.group_count_y = 1;
+    bindless_params.group_count_z = 1;
+    bindless_params.push_constant_bindings = &bindless_push_constant_binding;
+    bindless_params.push_constant_bindings_count = 1;
+
+    /* bindless, classic, bindless in one stream */
+    push_constants.input_index = indices[0];
+    push_constants.output_index = indices[1];
+    push_constants.value = 5;
+    EXPECT_EQ(sccl_run_shader(stream, bindless_shader, &bindless_params),
+              sccl_success);
+
+    uint32_t value = 7;
+    sccl_shader_buffer_binding_t buffer_bindings[2];
+    buffer_bindings[0].position = buffer_layouts[0].position;
+    buffer_bindings[0].buffer = buffers[1];
+    buffer_bindings[1].position = buffer_layouts[1].position;
+    buffer_bindings[1].buffer = buffers[2];
+
+    sccl_shader_push_constant_binding push_constant_binding = {};
+    push_constant_binding.index = 0;
+    push_constant_binding.data = &value;
+
+    sccl_shader_run_params_t params = {};
+    params.group_count_x = element_count / 64;
+    params.group_count_y = 1;
+    params.group_count_z = 1;
+    params.buffer_bindings = buffer_bindings;
+    params.buffer_bindings_count = 2;
+    params.push_constant_bindings = &push_constant_binding;
+    params.push_constant_bindings_count = 1;
+    EXPECT_EQ(sccl_run_shader(stream, shader, &params), sccl_success);
+
+    push_constants.input_index = indices[2];
+    push_constants.output_index = indices[3];
+    EXPECT_EQ(sccl_run_shader(stream, bindless_shader, &bindless_params),
+              sccl_success);
+
+    EXPECT_EQ(sccl_dispatch_stream(stream), sccl_success);
+    EXPECT_EQ(sccl_join_stream(stream), sccl_success);
+
+    EXPECT_EQ(
+        sccl_host_map_buffer(buffers[buffer_count - 1], &data_ptr, 0, size),
+        sccl_success);
+    for (size_t i = 0; i < element_count; ++i) {
+        EXPECT_EQ(static_cast<uint32_t *>(data_ptr)[i],
+                  i + 2 * push_constants.value + value);
+    }
+    sccl_host_unmap_buffer(buffers[buffer_count - 1]);
+
+    sccl_destroy_stream(stream);
+    for (sccl_buffer_t buffer : buffers) {
+        sccl_destroy_buffer(buffer);
+    }
+    sccl_destroy_shader(shader);
+    sccl_destroy_shader(bindless_shader);
+}
@@ -0,0 +1,175 @@
+
+#include <sccl.h>
+
+#include "common.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <limits>
+#include <random>
+#include <vector>
+
+class gemm_test : public device_stream_test
+{
+protected:
+    /**
+     * Run float32 gemm on device and compare with host reference.
+     */
+    void check_float32(size_t m, size_t n, size_t k, bool trans_a,
+                       bool trans_b, float alpha, float beta)
+    {
+        std::mt19937 rng((uint32_t)(m * 31 + n * 7 + k));
+        std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+        std::vector<float> a(m * k), b(k * n), c(m * n);
+        for (float &x : a) {
+            x = distribution(rng);
+        }
+        for (float &x : b) {
+            x = distribution(rng);
+        }
+        for (float &x : c) {
+            x = distribution(rng);
+        }
+
+        std::vector<float> expected(m * n);
+        for (size_t i = 0; i < m; ++i) {
+            for (size_t j = 0; j < n; ++j) {
+                double sum = 0.0;
+                for (size_t l = 0; l < k; ++l) {
+                    float x = trans_a ? a[l * m + i] : a[i * k + l];
+                    float y = trans_b ? b[j * k + l] : b[l * n + j];
+                    sum += (double)x * y;
+                }
+                expected[i * n + j] =
+                    (float)(alpha * sum + beta * c[i * n + j]);
+            }
+        }
+
+        sccl_buffer_t a_buffer = upload(a);
+        sccl_buffer_t b_buffer = upload(b);
+        sccl_buffer_t c_buffer = upload(c);
+        ASSERT_EQ(sccl_gemm(stream, a_buffer, b_buffer, c_buffer, m, n, k,
+                            sccl_dtype_float32, trans_a, trans_b, alpha,
+                            beta),
+                  sccl_success);
+        ASSERT_EQ(sccl_dispatch_stream(stream), sccl_success);
+        ASSERT_EQ(sccl_join_stream(stream), sccl_success);
+
+        std::vector<float> result = download<float>(c_buffer, m * n);
+        /* summation order differs from the reference */
+        float tolerance = 1e-5f * (float)k + 1e-5f;
+        for (size_t i = 0; i < m * n; ++i) {
+            ASSERT_NEAR(result[i], expected[i], tolerance) << "index " << i;
+        }
+
+        sccl_destroy_buffer(c_buffer);
+        sccl_destroy_buffer(b_buffer);
+        sccl_destroy_buffer(a_buffer);
+    }
+};
+
+TEST_F(gemm_test, float32_square)
+{
+    check_float32(128, 128, 128, false, false, 1.0f, 0.0f);
+}
+
+TEST_F(gemm_test, float32_partial_tiles)
+{
+    /* sizes that are not multiples of any tile size */
+    check_float32(67, 45, 33, false, false, 1.0f, 0.0f);
+    check_float32(1, 200, 17, false, false, 1.0f, 0.0f);
+    check_float32(200, 1, 17, false, false, 1.0f, 0.0f);
+}
+
+TEST_F(gemm_test, float32_transposed)
+{
+    check_float32(70, 50, 40, true, false, 1.0f, 0.0f);
+    check_float32(70, 50, 40, false, true, 1.0f, 0.0f);
+    check_float32(70, 50, 40, true, true, 1.0f, 0.0f);
+}
+
+TEST_F(gemm_test, float32_alpha_beta)
+{
+    check_float32(96, 80, 48, false, false, 0.5f, -2.0f);
+    /* k of 0 only scales C */
+    check_float32(16, 16, 0, false, false, 1.0f, 3.0f);
+}
+
+TEST_F(gemm_test, beta_zero_ignores_c)
+{
+    std::vector<float> a(4, 1.0f), b(4, 1.0f);
+    std::vector<float> c(4, std::numeric_limits<float>::quiet_NaN());
+    sccl_buffer_t a_buffer = upload(a);
+    sccl_buffer_t b_buffer = upload(b);
+    sccl_buffer_t c_buffer = upload(c);
+    ASSERT_EQ(sccl_gemm(stream, a_buffer, b_buffer, c_buffer, 2, 2, 2,
+                        sccl_dtype_float32, false, false, 1.0f, 0.0f),
+              sccl_success);
+    ASSERT_EQ(sccl_dispatch_stream(stream), sccl_success);
+    ASSERT_EQ(sccl_join_stream(stream), sccl_success);
+    EXPECT_EQ(download<float>(c_buffer, 4), std::vector<float>(4, 2.0f));
+
+    sccl_destroy_buffer(c_buffer);
+    sccl_destroy_buffer(b_buffer);
+    sccl_destroy_buffer(a_buffer);
+}
+
+TEST_F(gemm_test, float16)
+{
+    /* all ones, products and sums are exact in half precision */
+    size_t m = 40, n = 72, k = 24;
+    std::vector<uint16_t> a(m * k, 0x3c00), b(k * n, 0x3c00), c(m * n, 0);
+    sccl_buffer_t a_buffer = upload(a);
+    sccl_buffer_t b_buffer = upload(b);
+    sccl_buffer_t c_buffer = upload(c);
+    sccl_error_t error =
+        sccl_gemm(stream, a_buffer, b_buffer, c_buffer, m, n, k,
+                  sccl_dtype_float16, false, true, 1.0f, 0.0f);
+    ASSERT_EQ(sccl_dispatch_stream(stream), sccl_success);
+    ASSERT_EQ(sccl_join_stream(stream), sccl_success);
+    if (error != sccl_unsupported_error) {
+        ASSERT_EQ(error, sccl_success);
+        /* 24.0 as half precision */
+        EXPECT_EQ(download<uint16_t>(c_buffer, m * n),
+                  std::vector<uint16_t>(m * n, 0x4e00));
+    }
+
+    sccl_destroy_buffer(c_buffer);
+    sccl_destroy_buffer(b_buffer);
+    sccl_destroy_buffer(a_buffer);
+    if (error == sccl_unsupported_error) {
+        GTEST_SKIP() << "16-bit storage buffer access not supported";
+    }
+}
+
+TEST_F(gemm_test, invalid_arguments)
+{
+    sccl_buffer_t buffer, uniform;
+    ASSERT_EQ(sccl_create_buffer(device, &buffer, sccl_buffer_type_shared,
+                                 16 * sizeof(float)),
+              sccl_success);
+    ASSERT_EQ(sccl_create_buffer(device, &uniform,
+                                 sccl_buffer_type_shared_uniform,
+                                 16 * sizeof(float)),
+              sccl_success);
+
+    /* matrices too large for buffers */
+    EXPECT_EQ(sccl_gemm(stream, buffer, buffer, buffer, 4, 4, 5,
+                        sccl_dtype_float32, false, false, 1.0f, 0.0f),
+              sccl_invalid_argument);
+    EXPECT_EQ(sccl_gemm(stream, buffer, buffer, buffer, 5, 4, 4,
+                        sccl_dtype_float32, false, false, 1.0f, 0.0f),
+              sccl_invalid_argument);
+    /* not a storage buffer */
+    EXPECT_EQ(sccl_gemm(stream, uniform, buffer, buffer, 4, 4, 4,
+                        sccl_dtype_float32, false, false, 1.0f, 0.0f),
+              sccl_invalid_argument);
+    /* only float types */
+    EXPECT_EQ(sccl_gemm(stream, buffer, buffer, buffer, 4, 4, 4,
+                        sccl_dtype_int32, false, false, 1.0f, 0.0f),
+              sccl_invalid_argument);
+
+    sccl_destroy_buffer(uniform);
+    sccl_destroy_buffer(buffer);
+}
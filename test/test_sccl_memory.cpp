@@ -0,0 +1,244 @@
+
+#include <sccl.h>
+
+#include "common.hpp"
+#include <gtest/gtest.h>
+
+class memory_test : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        EXPECT_EQ(sccl_create_instance(&instance), sccl_success);
+        EXPECT_EQ(
+            sccl_create_device(instance, &device, get_environment_gpu_index()),
+            sccl_success);
+        EXPECT_EQ(sccl_create_stream(device, &stream), sccl_success);
+    }
+
+    void TearDown() override
+    {
+        sccl_destroy_stream(stream);
+        sccl_destroy_device(device);
+        sccl_destroy_instance(instance);
+    }
+
+    void copy_and_join(sccl_buffer_t src, sccl_buffer_t dst, size_t size)
+    {
+        EXPECT_EQ(sccl_copy_buffer(stream, src, 0, dst, 0, size),
+                  sccl_success);
+        EXPECT_EQ(sccl_dispatch_stream(stream), sccl_success);
+        EXPECT_EQ(sccl_join_stream(stream), sccl_success);
+    }
+
+    sccl_instance_t instance;
+    sccl_device_t device;
+    sccl_stream_t stream;
+};
+
+TEST_F(memory_test, usage_accounting)
+{
+    size_t initial_usage, budget;
+    EXPECT_EQ(sccl_get_device_memory_usage(device, &initial_usage, &budget),
+              sccl_success);
+    EXPECT_GE(budget, initial_usage);
+
+    size_t size = 0x10000;
+    sccl_buffer_t buffer;
+    EXPECT_EQ(
+        sccl_create_buffer(device, &buffer, sccl_buffer_type_device, size),
+        sccl_success);
+
+    size_t usage;
+    EXPECT_EQ(sccl_get_device_memory_usage(device, &usage, &budget),
+              sccl_success);
+    EXPECT_GE(usage, initial_usage + size);
+
+    sccl_destroy_buffer(buffer);
+
+    EXPECT_EQ(sccl_get_device_memory_usage(device, &usage, &budget),
+              sccl_success);
+    EXPECT_EQ(usage, initial_usage);
+}
+
+TEST_F(memory_test, invalid_policy)
+{
+    EXPECT_EQ(sccl_set_device_memory_budget(
+                  device, 0, (sccl_memory_overcommit_policy_t)42),
+              sccl_invalid_argument);
+}
+
+TEST_F(memory_test, over_budget_fail)
+{
+    size_t size = 0x10000;
+    size_t usage, budget;
+    EXPECT_EQ(sccl_get_device_memory_usage(device, &usage, &budget),
+              sccl_success);
+    EXPECT_EQ(sccl_set_device_memory_budget(device, usage + size + size / 2,
+                                            sccl_memory_overcommit_policy_fail),
+              sccl_success);
+
+    sccl_buffer_t buffer;
+    EXPECT_EQ(
+        sccl_create_buffer(device, &buffer, sccl_buffer_type_device, size),
+        sccl_success);
+
+    sccl_buffer_t over_budget_buffer;
+    EXPECT_EQ(sccl_create_buffer(device, &over_budget_buffer,
+                                 sccl_buffer_type_device, size),
+              sccl_out_of_resources_error);
+
+    sccl_destroy_buffer(buffer);
+
+    /* there is room after buffer is destroyed */
+    EXPECT_EQ(
+        sccl_create_buffer(device, &buffer, sccl_buffer_type_device, size),
+        sccl_success);
+    sccl_destroy_buffer(buffer);
+}
+
+TEST_F(memory_test, over_budget_spill)
+{
+    const size_t element_count = 0x4000;
+    const size_t size = element_count * sizeof(uint32_t);
+    std::vector<uint32_t> test_data(element_count);
+    for (size_t i = 0; i < element_count; ++i) {
+        test_data[i] = (uint32_t)i;
+    }
+
+    sccl_buffer_t host_buffer;
+    EXPECT_EQ(
+        sccl_create_buffer(device, &host_buffer, sccl_buffer_type_host, size),
+        sccl_success);
+    void *data_ptr;
+    EXPECT_EQ(sccl_host_map_buffer(host_buffer, &data_ptr, 0, size),
+              sccl_success);
+    memcpy(data_ptr, test_data.data(), size);
+
+    /* room for a single device buffer */
+    size_t usage, budget;
+    EXPECT_EQ(sccl_get_device_memory_usage(device, &usage, &budget),
+              sccl_success);
+    EXPECT_EQ(
+        sccl_set_device_memory_budget(device, usage + size + size / 2,
+                                      sccl_memory_overcommit_policy_spill),
+        sccl_success);
+
+    sccl_buffer_t first_buffer;
+    EXPECT_EQ(sccl_create_buffer(device, &first_buffer,
+                                 sccl_buffer_type_device, size),
+              sccl_success);
+    copy_and_join(host_buffer, first_buffer, size);
+
+    /* spills first buffer, on devices where host memory is device local there
+     * is nothing to gain from spilling */
+    sccl_buffer_t second_buffer;
+    sccl_error_t error = sccl_create_buffer(device, &second_buffer,
+                                            sccl_buffer_type_device, size);
+    if (error == sccl_out_of_resources_error) {
+        sccl_host_unmap_buffer(host_buffer);
+        sccl_destroy_buffer(first_buffer);
+        sccl_destroy_buffer(host_buffer);
+        GTEST_SKIP() << "host memory is device local, can't spill";
+    }
+    EXPECT_EQ(error, sccl_success);
+
+    size_t spilled_usage;
+    EXPECT_EQ(sccl_get_device_memory_usage(device, &spilled_usage, &budget),
+              sccl_success);
+    EXPECT_LE(spilled_usage, usage + size + size / 2);
+
+    /* using first buffer restores it and spills second buffer, data is
+     * preserved */
+    memset(data_ptr, 0, size);
+    copy_and_join(first_buffer, host_buffer, size);
+    EXPECT_EQ(memcmp(data_ptr, test_data.data(), size), 0);
+
+    sccl_host_unmap_buffer(host_buffer);
+    sccl_destroy_buffer(second_buffer);
+    sccl_destroy_buffer(first_buffer);
+    sccl_destroy_buffer(host_buffer);
+}
+
+TEST_F(memory_test, memory_type_selection)
+{
+    sccl_memory_type_info_t info;
+
+    EXPECT_EQ(sccl_get_device_memory_type_info(device, sccl_buffer_type_device,
+                                               sccl_memory_usage_default,
+                                               &info),
+              sccl_success);
+    EXPECT_TRUE(info.device_local);
+
+    for (sccl_memory_usage_t usage :
+         {sccl_memory_usage_default, sccl_memory_usage_upload,
+          sccl_memory_usage_readback}) {
+        for (sccl_buffer_type_t type :
+             {sccl_buffer_type_host, sccl_buffer_type_shared}) {
+            EXPECT_EQ(
+                sccl_get_device_memory_type_info(device, type, usage, &info),
+                sccl_success);
+            EXPECT_TRUE(info.host_visible);
+        }
+    }
+
+    /* shared buffers only use device local memory with a large BAR, so a
+     * small BAR heap is not exhausted */
+    EXPECT_EQ(sccl_get_device_memory_type_info(device, sccl_buffer_type_shared,
+                                               sccl_memory_usage_default,
+                                               &info),
+              sccl_success);
+    if (!info.large_bar) {
+        EXPECT_FALSE(info.device_local);
+    }
+}
+
+TEST_F(memory_test, invalid_memory_usage)
+{
+    sccl_memory_type_info_t info;
+    EXPECT_EQ(sccl_get_device_memory_type_info(device, sccl_buffer_type_device,
+                                               sccl_memory_usage_readback,
+                                               &info),
+              sccl_invalid_argument);
+    EXPECT_EQ(sccl_get_device_memory_type_info(device, sccl_buffer_type_host,
+                                               sccl_memory_usage_device_only,
+                                               &info),
+              sccl_invalid_argument);
+
+    sccl_buffer_t buffer;
+    EXPECT_EQ(sccl_create_buffer_with_usage(device, &buffer,
+                                            sccl_buffer_type_shared, 0x1000,
+                                            sccl_memory_usage_device_only),
+              sccl_invalid_argument);
+}
+
+TEST_F(memory_test, buffer_memory_type)
+{
+    size_t size = 0x1000;
+    for (sccl_memory_usage_t usage :
+         {sccl_memory_usage_default, sccl_memory_usage_upload,
+          sccl_memory_usage_readback}) {
+        sccl_buffer_t buffer;
+        EXPECT_EQ(sccl_create_buffer_with_usage(
+                      device, &buffer, sccl_buffer_type_host, size, usage),
+                  sccl_success);
+
+        sccl_memory_type_info_t selected_info;
+        EXPECT_EQ(sccl_get_device_memory_type_info(
+                      device, sccl_buffer_type_host, usage, &selected_info),
+                  sccl_success);
+        sccl_memory_type_info_t buffer_info;
+        EXPECT_EQ(sccl_get_buffer_memory_type_info(buffer, &buffer_info),
+                  sccl_success);
+        EXPECT_EQ(buffer_info.memory_type_index,
+                  selected_info.memory_type_index);
+
+        /* buffer is still host mappable */
+        void *data_ptr;
+        EXPECT_EQ(sccl_host_map_buffer(buffer, &data_ptr, 0, size),
+                  sccl_success);
+        sccl_host_unmap_buffer(buffer);
+
+        sccl_destroy_buffer(buffer);
+    }
+}
@@ -0,0 +1,160 @@
+
+#include <sccl.h>
+
+#include "common.hpp"
+#include <gtest/gtest.h>
+
+class memory_pool_test : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        EXPECT_EQ(sccl_create_instance(&instance), sccl_success);
+        EXPECT_EQ(
+            sccl_create_device(instance, &device, get_environment_gpu_index()),
+            sccl_success);
+        EXPECT_EQ(sccl_create_stream(device, &stream), sccl_success);
+        EXPECT_EQ(sccl_create_stream(device, &other_stream), sccl_success);
+    }
+
+    void TearDown() override
+    {
+        sccl_destroy_stream(other_stream);
+        sccl_destroy_stream(stream);
+        sccl_destroy_device(device);
+        sccl_destroy_instance(instance);
+    }
+
+    void dispatch_and_join(sccl_stream_t s)
+    {
+        EXPECT_EQ(sccl_dispatch_stream(s), sccl_success);
+        EXPECT_EQ(sccl_join_stream(s), sccl_success);
+    }
+
+    sccl_instance_t instance;
+    sccl_device_t device;
+    sccl_stream_t stream;
+    sccl_stream_t other_stream;
+};
+
+TEST_F(memory_pool_test, reuse_in_same_stream)
+{
+    size_t size = 0x1000;
+    sccl_buffer_t buffer;
+    EXPECT_EQ(sccl_alloc_async(stream, &buffer, sccl_buffer_type_device, size),
+              sccl_success);
+    EXPECT_EQ(sccl_free_async(stream, buffer), sccl_success);
+
+    /* reused without joining */
+    sccl_buffer_t reused_buffer;
+    EXPECT_EQ(
+        sccl_alloc_async(stream, &reused_buffer, sccl_buffer_type_device, size),
+        sccl_success);
+    EXPECT_EQ(reused_buffer, buffer);
+
+    /* different type is not reused */
+    EXPECT_EQ(sccl_free_async(stream, reused_buffer), sccl_success);
+    sccl_buffer_t host_buffer;
+    EXPECT_EQ(
+        sccl_alloc_async(stream, &host_buffer, sccl_buffer_type_host, size),
+        sccl_success);
+    EXPECT_NE(host_buffer, buffer);
+    EXPECT_EQ(sccl_free_async(stream, host_buffer), sccl_success);
+
+    dispatch_and_join(stream);
+}
+
+TEST_F(memory_pool_test, reuse_in_other_stream_after_join)
+{
+    EXPECT_EQ(sccl_set_device_memory_pool_release_threshold(device, SIZE_MAX),
+              sccl_success);
+
+    size_t size = 0x1000;
+    sccl_buffer_t buffer;
+    EXPECT_EQ(sccl_alloc_async(stream, &buffer, sccl_buffer_type_device, size),
+              sccl_success);
+    EXPECT_EQ(sccl_free_async(stream, buffer), sccl_success);
+
+    /* not reused by other stream before free is retired */
+    sccl_buffer_t other_buffer;
+    EXPECT_EQ(sccl_alloc_async(other_stream, &other_buffer,
+                               sccl_buffer_type_device, size),
+              sccl_success);
+    EXPECT_NE(other_buffer, buffer);
+    EXPECT_EQ(sccl_free_async(other_stream, other_buffer), sccl_success);
+    dispatch_and_join(other_stream);
+
+    dispatch_and_join(stream);
+
+    /* reused after stream is joined */
+    sccl_buffer_t reused_buffer;
+    EXPECT_EQ(sccl_alloc_async(other_stream, &reused_buffer,
+                               sccl_buffer_type_device, size),
+              sccl_success);
+    EXPECT_TRUE(reused_buffer == buffer || reused_buffer == other_buffer);
+    sccl_destroy_buffer(reused_buffer);
+
+    sccl_trim_device_memory_pool(device, 0);
+}
+
+TEST_F(memory_pool_test, release_threshold)
+{
+    size_t initial_usage, budget;
+    EXPECT_EQ(sccl_get_device_memory_usage(device, &initial_usage, &budget),
+              sccl_success);
+
+    size_t size = 0x10000;
+    sccl_buffer_t buffer;
+    EXPECT_EQ(sccl_alloc_async(stream, &buffer, sccl_buffer_type_device, size),
+              sccl_success);
+    EXPECT_EQ(sccl_free_async(stream, buffer), sccl_success);
+
+    /* default threshold releases everything on join */
+    dispatch_and_join(stream);
+
+    size_t usage;
+    EXPECT_EQ(sccl_get_device_memory_usage(device, &usage, &budget),
+              sccl_success);
+    EXPECT_EQ(usage, initial_usage);
+}
+
+TEST_F(memory_pool_test, copy_with_async_buffers)
+{
+    const std::vector<uint32_t> test_data = {0, 1, 2, 3, 4, 5, 6, 7};
+    const size_t size = test_data.size() * sizeof(uint32_t);
+
+    sccl_buffer_t host_buffer;
+    EXPECT_EQ(
+        sccl_create_buffer(device, &host_buffer, sccl_buffer_type_host, size),
+        sccl_success);
+    void *data_ptr;
+    EXPECT_EQ(sccl_host_map_buffer(host_buffer, &data_ptr, 0, size),
+              sccl_success);
+    memcpy(data_ptr, test_data.data(), size);
+
+    /* temporary device buffers are freed and reused within one dispatch */
+    sccl_buffer_t first_buffer;
+    EXPECT_EQ(
+        sccl_alloc_async(stream, &first_buffer, sccl_buffer_type_device, size),
+        sccl_success);
+    EXPECT_EQ(sccl_copy_buffer(stream, host_buffer, 0, first_buffer, 0, size),
+              sccl_success);
+    sccl_buffer_t second_buffer;
+    EXPECT_EQ(
+        sccl_alloc_async(stream, &second_buffer, sccl_buffer_type_device, size),
+        sccl_success);
+    EXPECT_EQ(
+        sccl_copy_buffer(stream, first_buffer, 0, second_buffer, 0, size),
+        sccl_success);
+    EXPECT_EQ(sccl_free_async(stream, first_buffer), sccl_success);
+    EXPECT_EQ(sccl_copy_buffer(stream, second_buffer, 0, host_buffer, 0, size),
+              sccl_success);
+    EXPECT_EQ(sccl_free_async(stream, second_buffer), sccl_success);
+
+    memset(data_ptr, 0, size);
+    dispatch_and_join(stream);
+    EXPECT_EQ(memcmp(data_ptr, test_data.data(), size), 0);
+
+    sccl_host_unmap_buffer(host_buffer);
+    sccl_destroy_buffer(host_buffer);
+}
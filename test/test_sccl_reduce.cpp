@@ -0,0 +1,239 @@
+
+#include <sccl.h>
+
+#include "common.hpp"
+#include <cmath>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <vector>
+
+class reduce_test : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        EXPECT_EQ(sccl_create_instance(&instance), sccl_success);
+        EXPECT_EQ(
+            sccl_create_device(instance, &device, get_environment_gpu_index()),
+            sccl_success);
+        EXPECT_EQ(sccl_create_stream(device, &stream), sccl_success);
+    }
+
+    void TearDown() override
+    {
+        sccl_destroy_stream(stream);
+        sccl_destroy_device(device);
+        sccl_destroy_instance(instance);
+    }
+
+    /**
+     * Reduce `data` on device, returns error of `sccl_reduce`. Result is only
+     * written if reduce succeeded.
+     */
+    template <typename T, typename R = T>
+    sccl_error_t reduce(const std::vector<T> &data, sccl_dtype_t dtype,
+                        sccl_reduce_op_t op, R *result)
+    {
+        size_t src_size = std::max<size_t>(data.size() * sizeof(T), 1);
+        sccl_buffer_t src, dst;
+        EXPECT_EQ(sccl_create_buffer(device, &src, sccl_buffer_type_shared,
+                                     src_size),
+                  sccl_success);
+        EXPECT_EQ(sccl_create_buffer(device, &dst, sccl_buffer_type_host,
+                                     sizeof(R)),
+                  sccl_success);
+
+        if (!data.empty()) {
+            void *mapped;
+            EXPECT_EQ(sccl_host_map_buffer(src, &mapped, 0, src_size),
+                      sccl_success);
+            memcpy(mapped, data.data(), data.size() * sizeof(T));
+            sccl_host_unmap_buffer(src);
+        }
+
+        sccl_error_t error =
+            sccl_reduce(stream, src, dst, data.size(), dtype, op);
+        EXPECT_EQ(sccl_dispatch_stream(stream), sccl_success);
+        EXPECT_EQ(sccl_join_stream(stream), sccl_success);
+
+        if (error == sccl_success) {
+            void *mapped;
+            EXPECT_EQ(sccl_host_map_buffer(dst, &mapped, 0, sizeof(R)),
+                      sccl_success);
+            memcpy(result, mapped, sizeof(R));
+            sccl_host_unmap_buffer(dst);
+        }
+
+        sccl_destroy_buffer(dst);
+        sccl_destroy_buffer(src);
+
+        return error;
+    }
+
+    sccl_instance_t instance;
+    sccl_device_t device;
+    sccl_stream_t stream;
+};
+
+/* exact conversions for half precision values that are normal numbers */
+static uint16_t float_to_half(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int32_t exponent = (int32_t)((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = (bits >> 13) & 0x3ff;
+    return (uint16_t)(sign | ((uint32_t)exponent << 10) | mantissa);
+}
+
+static float half_to_float(uint16_t value)
+{
+    uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+    uint32_t exponent = ((value >> 10) & 0x1f) - 15 + 127;
+    uint32_t mantissa = (uint32_t)(value & 0x3ff) << 13;
+    uint32_t bits = sign | (exponent << 23) | mantissa;
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+TEST_F(reduce_test, sum_int32_multi_pass)
+{
+    /* large enough for two passes, not a multiple of the workgroup size */
+    std::vector<int32_t> data(3 * 1024 * 1024 + 17);
+    int32_t expected = 0;
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = (int32_t)(i % 7) - 3;
+        expected += data[i];
+    }
+    int32_t result = 0;
+    ASSERT_EQ(reduce(data, sccl_dtype_int32, sccl_reduce_op_sum, &result),
+              sccl_success);
+    EXPECT_EQ(result, expected);
+}
+
+TEST_F(reduce_test, min_max_uint32)
+{
+    std::vector<uint32_t> data(100000);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = (uint32_t)((i * 2654435761u) % 1000000u) + 5;
+    }
+    data[77777] = 1;
+    data[12345] = 0xfffffff0u;
+
+    uint32_t result = 0;
+    ASSERT_EQ(reduce(data, sccl_dtype_uint32, sccl_reduce_op_min, &result),
+              sccl_success);
+    EXPECT_EQ(result, 1u);
+    ASSERT_EQ(reduce(data, sccl_dtype_uint32, sccl_reduce_op_max, &result),
+              sccl_success);
+    EXPECT_EQ(result, 0xfffffff0u);
+}
+
+TEST_F(reduce_test, float32)
+{
+    std::vector<float> data(50000, 0.5f);
+    data[49999] = -3.0f;
+    data[3] = 7.0f;
+
+    float result = 0.0f;
+    ASSERT_EQ(reduce(data, sccl_dtype_float32, sccl_reduce_op_sum, &result),
+              sccl_success);
+    EXPECT_FLOAT_EQ(result, 49998 * 0.5f + 4.0f);
+    ASSERT_EQ(reduce(data, sccl_dtype_float32, sccl_reduce_op_min, &result),
+              sccl_success);
+    EXPECT_EQ(result, -3.0f);
+    ASSERT_EQ(reduce(data, sccl_dtype_float32, sccl_reduce_op_max, &result),
+              sccl_success);
+    EXPECT_EQ(result, 7.0f);
+}
+
+TEST_F(reduce_test, prod_int32)
+{
+    std::vector<int32_t> data(4000, 1);
+    data[10] = 2;
+    data[2000] = 3;
+    data[3999] = -5;
+
+    int32_t result = 0;
+    ASSERT_EQ(reduce(data, sccl_dtype_int32, sccl_reduce_op_prod, &result),
+              sccl_success);
+    EXPECT_EQ(result, -30);
+}
+
+TEST_F(reduce_test, sum_int64)
+{
+    std::vector<int64_t> data(1 << 20, (int64_t)1 << 40);
+    int64_t result = 0;
+    sccl_error_t error =
+        reduce(data, sccl_dtype_int64, sccl_reduce_op_sum, &result);
+    if (error == sccl_unsupported_error) {
+        GTEST_SKIP() << "64-bit subgroup arithmetic not supported";
+    }
+    ASSERT_EQ(error, sccl_success);
+    EXPECT_EQ(result, (int64_t)1 << 60);
+}
+
+TEST_F(reduce_test, sum_float16)
+{
+    /* float16 is accumulated as float32, so the sums are exact */
+    for (size_t count : {1000, 1 << 20}) {
+        std::vector<uint16_t> data(count, float_to_half(1.0f / 64));
+        uint16_t result = 0;
+        sccl_error_t error =
+            reduce(data, sccl_dtype_float16, sccl_reduce_op_sum, &result);
+        if (error == sccl_unsupported_error) {
+            GTEST_SKIP() << "16-bit storage buffer access not supported";
+        }
+        ASSERT_EQ(error, sccl_success);
+        EXPECT_EQ(half_to_float(result), count / 64.0f);
+    }
+}
+
+TEST_F(reduce_test, empty_writes_identity)
+{
+    std::vector<int32_t> data;
+    int32_t result = 0;
+    ASSERT_EQ(reduce(data, sccl_dtype_int32, sccl_reduce_op_prod, &result),
+              sccl_success);
+    EXPECT_EQ(result, 1);
+    ASSERT_EQ(reduce(data, sccl_dtype_int32, sccl_reduce_op_max, &result),
+              sccl_success);
+    EXPECT_EQ(result, INT32_MIN);
+}
+
+TEST_F(reduce_test, invalid_arguments)
+{
+    sccl_buffer_t src, dst, uniform;
+    EXPECT_EQ(sccl_create_buffer(device, &src, sccl_buffer_type_device, 64),
+              sccl_success);
+    EXPECT_EQ(sccl_create_buffer(device, &dst, sccl_buffer_type_device, 2),
+              sccl_success);
+    EXPECT_EQ(sccl_create_buffer(device, &uniform,
+                                 sccl_buffer_type_device_uniform, 64),
+              sccl_success);
+
+    /* src too small */
+    EXPECT_EQ(sccl_reduce(stream, src, dst, 33, sccl_dtype_float16,
+                          sccl_reduce_op_sum),
+              sccl_invalid_argument);
+    /* dst too small */
+    EXPECT_EQ(sccl_reduce(stream, src, dst, 16, sccl_dtype_int32,
+                          sccl_reduce_op_sum),
+              sccl_invalid_argument);
+    /* not a storage buffer */
+    EXPECT_EQ(sccl_reduce(stream, uniform, src, 16, sccl_dtype_int32,
+                          sccl_reduce_op_sum),
+              sccl_invalid_argument);
+    /* invalid enums */
+    EXPECT_EQ(sccl_reduce(stream, src, src, 16, (sccl_dtype_t)99,
+                          sccl_reduce_op_sum),
+              sccl_invalid_argument);
+    EXPECT_EQ(sccl_reduce(stream, src, src, 16, sccl_dtype_int32,
+                          (sccl_reduce_op_t)99),
+              sccl_invalid_argument);
+
+    sccl_destroy_buffer(uniform);
+    sccl_destroy_buffer(dst);
+    sccl_destroy_buffer(src);
+}
@@ -0,0 +1,248 @@
+
+#include <sccl.h>
+
+#include "common.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <gtest/gtest.h>
+#include <limits>
+#include <vector>
+
+/**
+ * Parameter is true if reduce-then-scan is forced with
+ * `SCCL_DISABLE_DECOUPLED_LOOKBACK`, false if decoupled lookback is forced
+ * with `SCCL_FORCE_DECOUPLED_LOOKBACK`, so both run on every device.
+ */
+class scan_test : public testing::TestWithParam<bool>
+{
+protected:
+    void SetUp() override
+    {
+        setenv(GetParam() ? SCCL_DISABLE_DECOUPLED_LOOKBACK
+                          : SCCL_FORCE_DECOUPLED_LOOKBACK,
+               "1", 1);
+        EXPECT_EQ(sccl_create_instance(&instance), sccl_success);
+        EXPECT_EQ(
+            sccl_create_device(instance, &device, get_environment_gpu_index()),
+            sccl_success);
+        EXPECT_EQ(sccl_create_stream(device, &stream), sccl_success);
+    }
+
+    void TearDown() override
+    {
+        sccl_destroy_stream(stream);
+        sccl_destroy_device(device);
+        sccl_destroy_instance(instance);
+        unsetenv(SCCL_DISABLE_DECOUPLED_LOOKBACK);
+        unsetenv(SCCL_FORCE_DECOUPLED_LOOKBACK);
+    }
+
+    /**
+     * Scan `data` on device, returns error of the scan. Result is only
+     * written if scan succeeded.
+     */
+    template <typename T>
+    sccl_error_t scan(const std::vector<T> &data, sccl_dtype_t dtype,
+                      sccl_reduce_op_t op, bool exclusive,
+                      std::vector<T> *result)
+    {
+        size_t size = std::max<size_t>(data.size() * sizeof(T), 1);
+        sccl_buffer_t src, dst;
+        EXPECT_EQ(sccl_create_buffer(device, &src, sccl_buffer_type_shared,
+                                     size),
+                  sccl_success);
+        EXPECT_EQ(sccl_create_buffer(device, &dst, sccl_buffer_type_shared,
+                                     size),
+                  sccl_success);
+
+        if (!data.empty()) {
+            void *mapped;
+            EXPECT_EQ(sccl_host_map_buffer(src, &mapped, 0, size),
+                      sccl_success);
+            memcpy(mapped, data.data(), data.size() * sizeof(T));
+            sccl_host_unmap_buffer(src);
+        }
+
+        sccl_error_t error =
+            exclusive ? sccl_scan_exclusive(stream, src, dst, data.size(),
+                                            dtype, op)
+                      : sccl_scan(stream, src, dst, data.size(), dtype, op);
+        EXPECT_EQ(sccl_dispatch_stream(stream), sccl_success);
+        EXPECT_EQ(sccl_join_stream(stream), sccl_success);
+
+        if (error == sccl_success && !data.empty()) {
+            void *mapped;
+            EXPECT_EQ(sccl_host_map_buffer(dst, &mapped, 0, size),
+                      sccl_success);
+            result->resize(data.size());
+            memcpy(result->data(), mapped, data.size() * sizeof(T));
+            sccl_host_unmap_buffer(dst);
+        }
+
+        sccl_destroy_buffer(dst);
+        sccl_destroy_buffer(src);
+
+        return error;
+    }
+
+    sccl_instance_t instance;
+    sccl_device_t device;
+    sccl_stream_t stream;
+};
+
+template <typename T, typename F>
+static std::vector<T> host_scan(const std::vector<T> &data, T identity,
+                                bool exclusive, F op)
+{
+    std::vector<T> result(data.size());
+    T running = identity;
+    for (size_t i = 0; i < data.size(); ++i) {
+        if (exclusive) {
+            result[i] = running;
+            running = op(running, data[i]);
+        } else {
+            running = op(running, data[i]);
+            result[i] = running;
+        }
+    }
+    return result;
+}
+
+TEST_P(scan_test, inclusive_sum_int32)
+{
+    /* more tiles than fit in one tile, so reduce-then-scan recurses twice,
+     * not a multiple of the tile size */
+    for (size_t count : {1, 100, SCCL_SCAN_TILE_SIZE + 1,
+                         SCCL_SCAN_TILE_SIZE * SCCL_SCAN_TILE_SIZE + 1000}) {
+        std::vector<int32_t> data(count);
+        for (size_t i = 0; i < count; ++i) {
+            data[i] = (int32_t)(i % 7) - 3;
+        }
+        std::vector<int32_t> result;
+        ASSERT_EQ(scan(data, sccl_dtype_int32, sccl_reduce_op_sum, false,
+                       &result),
+                  sccl_success);
+        EXPECT_EQ(result, host_scan<int32_t>(data, 0, false,
+                                             std::plus<int32_t>()));
+    }
+}
+
+TEST_P(scan_test, exclusive_sum_uint32)
+{
+    std::vector<uint32_t> data(1000000);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = (uint32_t)(i * 2654435761u) >> 20;
+    }
+    std::vector<uint32_t> result;
+    ASSERT_EQ(
+        scan(data, sccl_dtype_uint32, sccl_reduce_op_sum, true, &result),
+        sccl_success);
+    EXPECT_EQ(result,
+              host_scan<uint32_t>(data, 0, true, std::plus<uint32_t>()));
+}
+
+TEST_P(scan_test, min_max_float32)
+{
+    std::vector<float> data(100000);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = (float)((i * 2654435761u) % 100003u) - 50000.0f;
+    }
+    float infinity = std::numeric_limits<float>::infinity();
+    auto min_op = [](float a, float b) { return std::min(a, b); };
+    auto max_op = [](float a, float b) { return std::max(a, b); };
+
+    std::vector<float> result;
+    ASSERT_EQ(
+        scan(data, sccl_dtype_float32, sccl_reduce_op_min, false, &result),
+        sccl_success);
+    EXPECT_EQ(result, host_scan<float>(data, infinity, false, min_op));
+    ASSERT_EQ(
+        scan(data, sccl_dtype_float32, sccl_reduce_op_max, true, &result),
+        sccl_success);
+    EXPECT_EQ(result, host_scan<float>(data, -infinity, true, max_op));
+}
+
+TEST_P(scan_test, sum_int64)
+{
+    std::vector<int64_t> data(300000, (int64_t)1 << 40);
+    std::vector<int64_t> result;
+    sccl_error_t error =
+        scan(data, sccl_dtype_int64, sccl_reduce_op_sum, false, &result);
+    if (error == sccl_unsupported_error) {
+        GTEST_SKIP() << "64-bit subgroup arithmetic not supported";
+    }
+    ASSERT_EQ(error, sccl_success);
+    EXPECT_EQ(result,
+              host_scan<int64_t>(data, 0, false, std::plus<int64_t>()));
+}
+
+TEST_P(scan_test, in_place)
+{
+    std::vector<int32_t> data(50000, 2);
+    sccl_buffer_t buffer;
+    ASSERT_EQ(sccl_create_buffer(device, &buffer, sccl_buffer_type_shared,
+                                 data.size() * sizeof(int32_t)),
+              sccl_success);
+    void *mapped;
+    ASSERT_EQ(sccl_host_map_buffer(buffer, &mapped, 0,
+                                   data.size() * sizeof(int32_t)),
+              sccl_success);
+    memcpy(mapped, data.data(), data.size() * sizeof(int32_t));
+
+    ASSERT_EQ(sccl_scan(stream, buffer, buffer, data.size(), sccl_dtype_int32,
+                        sccl_reduce_op_sum),
+              sccl_success);
+    ASSERT_EQ(sccl_dispatch_stream(stream), sccl_success);
+    ASSERT_EQ(sccl_join_stream(stream), sccl_success);
+
+    const int32_t *result = (const int32_t *)mapped;
+    for (size_t i = 0; i < data.size(); ++i) {
+        ASSERT_EQ(result[i], 2 * (int32_t)(i + 1));
+    }
+    sccl_host_unmap_buffer(buffer);
+    sccl_destroy_buffer(buffer);
+}
+
+TEST_P(scan_test, invalid_arguments)
+{
+    sccl_buffer_t buffer, uniform;
+    ASSERT_EQ(sccl_create_buffer(device, &buffer, sccl_buffer_type_shared, 64),
+              sccl_success);
+    ASSERT_EQ(sccl_create_buffer(device, &uniform,
+                                 sccl_buffer_type_shared_uniform, 64),
+              sccl_success);
+
+    /* too many elements for buffers */
+    EXPECT_EQ(sccl_scan(stream, buffer, buffer, 17, sccl_dtype_int32,
+                        sccl_reduce_op_sum),
+              sccl_invalid_argument);
+    /* not a storage buffer */
+    EXPECT_EQ(sccl_scan(stream, uniform, buffer, 1, sccl_dtype_int32,
+                        sccl_reduce_op_sum),
+              sccl_invalid_argument);
+    EXPECT_EQ(sccl_scan_exclusive(stream, buffer, uniform, 1,
+                                  sccl_dtype_int32, sccl_reduce_op_sum),
+              sccl_invalid_argument);
+    /* invalid type and operation */
+    EXPECT_EQ(sccl_scan(stream, buffer, buffer, 1, (sccl_dtype_t)99,
+                        sccl_reduce_op_sum),
+              sccl_invalid_argument);
+    EXPECT_EQ(sccl_scan(stream, buffer, buffer, 1, sccl_dtype_int32,
+                        (sccl_reduce_op_t)99),
+              sccl_invalid_argument);
+    /* nothing to do */
+    EXPECT_EQ(sccl_scan(stream, buffer, buffer, 0, sccl_dtype_int32,
+                        sccl_reduce_op_sum),
+              sccl_success);
+
+    sccl_destroy_buffer(uniform);
+    sccl_destroy_buffer(buffer);
+}
+
+INSTANTIATE_TEST_SUITE_P(scan, scan_test, testing::Bool(),
+                         [](const testing::TestParamInfo<bool> &info) {
+                             return info.param ? "reduce_then_scan"
+                                               : "decoupled_lookback";
+                         });
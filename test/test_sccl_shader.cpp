@@ -1,7 +1,9 @@
 #include <sccl.h>
 
 #include "common.hpp"
+#include <cstring>
 #include <gtest/gtest.h>
+#include <vector>
 
 class shader_test : public testing::Test
 {
@@ -69,3 +71,882 @@ TEST_F(shader_test, create_shader_buffer_layout_valid)
 
     sccl_destroy_shader(shader);
 }
+
+TEST_F(shader_test, run_shader_buffer_bindings)
+{
+    std::string shader_source = read_test_shader("add_shader.spv").value();
+
+    sccl_shader_buffer_layout_t buffer_layouts[2];
+    buffer_layouts[0].position.set = 0;
+    buffer_layouts[0].position.binding = 0;
+    buffer_layouts[0].type = sccl_buffer_type_host_storage;
+    buffer_layouts[1].position.set = 1;
+    buffer_layouts[1].position.binding = 0;
+    buffer_layouts[1].type = sccl_buffer_type_host_storage;
+
+    sccl_shader_push_constant_layout_t push_constant_layout = {};
+    push_constant_layout.size = sizeof(uint32_t);
+
+    sccl_shader_config_t shader_config = {};
+    shader_config.shader_source_code = shader_source.data();
+    shader_config.shader_source_code_length = shader_source.size();
+    shader_config.buffer_layouts = buffer_layouts;
+    shader_config.buffer_layouts_count = 2;
+    shader_config.push_constant_layouts = &push_constant_layout;
+    shader_config.push_constant_layouts_count = 1;
+
+    sccl_shader_t shader;
+    EXPECT_EQ(sccl_create_shader(device, &shader, &shader_config),
+              sccl_success);
+
+    /* shader has local size 64 */
+    const size_t element_count = 64 * 16;
+    const size_t size = element_count * sizeof(uint32_t);
+    sccl_buffer_t buffers[3];
+    for (sccl_buffer_t &buffer : buffers) {
+        EXPECT_EQ(
+            sccl_create_buffer(device, &buffer, sccl_buffer_type_host, size),
+            sccl_success);
+    }
+
+    void *data_ptr;
+    EXPECT_EQ(sccl_host_map_buffer(buffers[0], &data_ptr, 0, size),
+              sccl_success);
+    for (size_t i = 0; i < element_count; ++i) {
+        static_cast<uint32_t *>(data_ptr)[i] = i;
+    }
+    sccl_host_unmap_buffer(buffers[0]);
+
+    sccl_stream_t stream;
+    EXPECT_EQ(sccl_create_stream(device, &stream), sccl_success);
+
+    /* run shader twice in same dispatch with different bindings,
+     * buffers[0] -> buffers[1] -> buffers[2] */
+    uint32_t value = 3;
+    for (size_t run = 0; run < 2; ++run) {
+        sccl_shader_buffer_binding_t buffer_bindings[2];
+        buffer_bindings[0].position = buffer_layouts[0].position;
+        buffer_bindings[0].buffer = buffers[run];
+        buffer_bindings[1].position = buffer_layouts[1].position;
+        buffer_bindings[1].buffer = buffers[run + 1];
+
+        sccl_shader_push_constant_binding push_constant_binding = {};
+        push_constant_binding.index = 0;
+        push_constant_binding.data = &value;
+
+        sccl_shader_run_params_t params = {};
+        params.group_count_x = element_count / 64;
+        params.group_count_y = 1;
+        params.group_count_z = 1;
+        params.buffer_bindings = buffer_bindings;
+        params.buffer_bindings_count = 2;
+        params.push_constant_bindings = &push_constant_binding;
+        params.push_constant_bindings_count = 1;
+        EXPECT_EQ(sccl_run_shader(stream, shader, &params), sccl_success);
+    }
+
+    EXPECT_EQ(sccl_dispatch_stream(stream), sccl_success);
+    EXPECT_EQ(sccl_join_stream(stream), sccl_success);
+
+    EXPECT_EQ(sccl_host_map_buffer(buffers[2], &data_ptr, 0, size),
+              sccl_success);
+    for (size_t i = 0; i < element_count; ++i) {
+        EXPECT_EQ(static_cast<uint32_t *>(data_ptr)[i], i + 2 * value);
+    }
+    sccl_host_unmap_buffer(buffers[2]);
+
+    sccl_destroy_stream(stream);
+    for (sccl_buffer_t buffer : buffers) {
+        sccl_destroy_buffer(buffer);
+    }
+    sccl_destroy_shader(shader);
+}
+
+TEST_F(shader_test, run_shader_missing_buffer_binding)
+{
+    std::string shader_source = read_test_shader("add_shader.spv").value();
+
+    sccl_shader_buffer_layout_t buffer_layouts[2];
+    buffer_layouts[0].position.set = 0;
+    buffer_layouts[0].position.binding = 0;
+    buffer_layouts[0].type = sccl_buffer_type_host_storage;
+    buffer_layouts[1].position.set = 1;
+    buffer_layouts[1].position.binding = 0;
+    buffer_layouts[1].type = sccl_buffer_type_host_storage;
+
+    sccl_shader_push_constant_layout_t push_constant_layout = {};
+    push_constant_layout.size = sizeof(uint32_t);
+
+    sccl_shader_config_t shader_config = {};
+    shader_config.shader_source_code = shader_source.data();
+    shader_config.shader_source_code_length = shader_source.size();
+    shader_config.buffer_layouts = buffer_layouts;
+    shader_config.buffer_layouts_count = 2;
+    shader_config.push_constant_layouts = &push_constant_layout;
+    shader_config.push_constant_layouts_count = 1;
+
+    sccl_shader_t shader;
+    EXPECT_EQ(sccl_create_shader(device, &shader, &shader_config),
+              sccl_success);
+
+    sccl_buffer_t buffer;
+    EXPECT_EQ(
+        sccl_create_buffer(device, &buffer, sccl_buffer_type_host, 0x1000),
+        sccl_success);
+
+    sccl_stream_t stream;
+    EXPECT_EQ(sccl_create_stream(device, &stream), sccl_success);
+
+    /* only first of two layouts bound */
+    sccl_shader_buffer_binding_t buffer_binding;
+    buffer_binding.position = buffer_layouts[0].position;
+    buffer_binding.buffer = buffer;
+
+    sccl_shader_run_params_t params = {};
+    params.group_count_x = 1;
+    params.group_count_y = 1;
+    params.group_count_z = 1;
+    params.buffer_bindings = &buffer_binding;
+    params.buffer_bindings_count = 1;
+    EXPECT_EQ(sccl_run_shader(stream, shader, &params), sccl_invalid_argument);
+
+    sccl_destroy_stream(stream);
+    sccl_destroy_buffer(buffer);
+    sccl_destroy_shader(shader);
+}
+
+TEST_F(shader_test, destroy_while_in_flight)
+{
+    std::string shader_source = read_test_shader("add_shader.spv").value();
+
+    sccl_shader_buffer_layout_t buffer_layouts[2];
+    buffer_layouts[0].position.set = 0;
+    buffer_layouts[0].position.binding = 0;
+    buffer_layouts[0].type = sccl_buffer_type_host_storage;
+    buffer_layouts[1].position.set = 1;
+    buffer_layouts[1].position.binding = 0;
+    buffer_layouts[1].type = sccl_buffer_type_host_storage;
+
+    sccl_shader_push_constant_layout_t push_constant_layout = {};
+    push_constant_layout.size = sizeof(uint32_t);
+
+    sccl_shader_config_t shader_config = {};
+    shader_config.shader_source_code = shader_source.data();
+    shader_config.shader_source_code_length = shader_source.size();
+    shader_config.buffer_layouts = buffer_layouts;
+    shader_config.buffer_layouts_count = 2;
+    shader_config.push_constant_layouts = &push_constant_layout;
+    shader_config.push_constant_layouts_count = 1;
+
+    sccl_shader_t shader;
+    EXPECT_EQ(sccl_create_shader(device, &shader, &shader_config),
+              sccl_success);
+
+    const size_t element_count = 64 * 16;
+    const size_t size = element_count * sizeof(uint32_t);
+    sccl_buffer_t input_buffer, output_buffer;
+    EXPECT_EQ(
+        sccl_create_buffer(device, &input_buffer, sccl_buffer_type_host, size),
+        sccl_success);
+    EXPECT_EQ(
+        sccl_create_buffer(device, &output_buffer, sccl_buffer_type_host, size),
+        sccl_success);
+
+    void *data_ptr;
+    EXPECT_EQ(sccl_host_map_buffer(input_buffer, &data_ptr, 0, size),
+              sccl_success);
+    for (size_t i = 0; i < element_count; ++i) {
+        static_cast<uint32_t *>(data_ptr)[i] = i;
+    }
+    sccl_host_unmap_buffer(input_buffer);
+
+    sccl_stream_t stream;
+    EXPECT_EQ(sccl_create_stream(device, &stream), sccl_success);
+
+    sccl_shader_buffer_binding_t buffer_bindings[2];
+    buffer_bindings[0].position = buffer_layouts[0].position;
+    buffer_bindings[0].buffer = input_buffer;
+    buffer_bindings[1].position = buffer_layouts[1].position;
+    buffer_bindings[1].buffer = output_buffer;
+
+    uint32_t value = 5;
+    sccl_shader_push_constant_binding push_constant_binding = {};
+    push_constant_binding.index = 0;
+    push_constant_binding.data = &value;
+
+    sccl_shader_run_params_t params = {};
+    params.group_count_x = element_count / 64;
+    params.group_count_y = 1;
+    params.group_count_z = 1;
+    params.buffer_bindings = buffer_bindings;
+    params.buffer_bindings_count = 2;
+    params.push_constant_bindings = &push_constant_binding;
+    params.push_constant_bindings_count = 1;
+    EXPECT_EQ(sccl_run_shader(stream, shader, &params), sccl_success);
+
+    EXPECT_EQ(sccl_dispatch_stream(stream), sccl_success);
+
+    /* destruction is deferred until stream is joined */
+    sccl_destroy_shader(shader);
+    sccl_destroy_buffer(input_buffer);
+
+    EXPECT_EQ(sccl_join_stream(stream), sccl_success);
+
+    EXPECT_EQ(sccl_host_map_buffer(output_buffer, &data_ptr, 0, size),
+              sccl_success);
+    for (size_t i = 0; i < element_count; ++i) {
+        EXPECT_EQ(static_cast<uint32_t *>(data_ptr)[i], i + value);
+    }
+    sccl_host_unmap_buffer(output_buffer);
+
+    sccl_destroy_stream(stream);
+    sccl_destroy_buffer(output_buffer);
+}
+
+TEST_F(shader_test, create_shader_specialization_constant_invalid)
+{
+    std::string shader_source = read_test_shader("noop_shader.spv").value();
+
+    uint32_t value = 1;
+    sccl_shader_specialization_constant_t specialization_constant = {};
+    specialization_constant.constant_id = 0;
+    specialization_constant.size = 0;
+    specialization_constant.data = &value;
+
+    sccl_shader_config_t shader_config = {};
+    shader_config.shader_source_code = shader_source.data();
+    shader_config.shader_source_code_length = shader_source.size();
+    shader_config.specialization_constants = &specialization_constant;
+    shader_config.specialization_constants_count = 1;
+
+    sccl_shader_t shader;
+    EXPECT_EQ(sccl_create_shader(device, &shader, &shader_config),
+              sccl_invalid_argument);
+
+    /* constants not used by the shader are ignored */
+    specialization_constant.size = sizeof(value);
+    EXPECT_EQ(sccl_create_shader(device, &shader, &shader_config),
+              sccl_success);
+    sccl_destroy_shader(shader);
+}
+
+TEST_F(shader_test, create_shaders)
+{
+    std::string shader_source = read_test_shader("noop_shader.spv").value();
+
+    /* distinct specialization data, so every pipeline is compiled */
+    const size_t count = 32;
+    std::vector<uint32_t> values(count);
+    std::vector<sccl_shader_specialization_constant_t> constants(count);
+    std::vector<sccl_shader_config_t> configs(count);
+    for (size_t i = 0; i < count; ++i) {
+        values[i] = static_cast<uint32_t>(i);
+        constants[i].constant_id = 0;
+        constants[i].size = sizeof(uint32_t);
+        constants[i].data = &values[i];
+        configs[i] = {};
+        configs[i].shader_source_code = shader_source.data();
+        configs[i].shader_source_code_length = shader_source.size();
+        configs[i].specialization_constants = &constants[i];
+        configs[i].specialization_constants_count = 1;
+    }
+
+    std::vector<sccl_shader_t> shaders(count, SCCL_NULL);
+    EXPECT_EQ(
+        sccl_create_shaders(device, configs.data(), count, shaders.data()),
+        sccl_success);
+
+    sccl_stream_t stream;
+    EXPECT_EQ(sccl_create_stream(device, &stream), sccl_success);
+    sccl_shader_run_params_t params = {};
+    params.group_count_x = 1;
+    params.group_count_y = 1;
+    params.group_count_z = 1;
+    for (sccl_shader_t shader : shaders) {
+        EXPECT_NE(shader, SCCL_NULL);
+        EXPECT_EQ(sccl_run_shader(stream, shader, &params), sccl_success);
+    }
+    EXPECT_EQ(sccl_dispatch_stream(stream), sccl_success);
+    EXPECT_EQ(sccl_join_stream(stream), sccl_success);
+    sccl_destroy_stream(stream);
+
+    for (sccl_shader_t shader : shaders) {
+        sccl_destroy_shader(shader);
+    }
+
+    /* one invalid config fails the whole batch */
+    constants[count / 2].size = 0;
+    EXPECT_EQ(
+        sccl_create_shaders(device, configs.data(), count, shaders.data()),
+        sccl_invalid_argument);
+}
+
+TEST_F(shader_test, create_shader_async)
+{
+    std::string shader_source = read_test_shader("noop_shader.spv").value();
+
+    sccl_shader_config_t shader_config = {};
+    shader_config.shader_source_code = shader_source.data();
+    shader_config.shader_source_code_length = shader_source.size();
+
+    sccl_shader_t shader;
+    EXPECT_EQ(sccl_create_shader_async(device, &shader, &shader_config),
+              sccl_success);
+
+    sccl_stream_t stream;
+    EXPECT_EQ(sccl_create_stream(device, &stream), sccl_success);
+    sccl_shader_run_params_t params = {};
+    params.group_count_x = 1;
+    params.group_count_y = 1;
+    params.group_count_z = 1;
+
+    /* pipeline may or may not be compiled yet */
+    params.fail_if_not_ready = true;
+    sccl_error_t error = sccl_run_shader(stream, shader, &params);
+    EXPECT_TRUE(error == sccl_success || error == sccl_not_ready);
+    sccl_shader_feedback_t feedback;
+    error = sccl_get_shader_feedback(shader, &feedback);
+    EXPECT_TRUE(error == sccl_success || error == sccl_not_ready);
+
+    /* waiting run */
+    params.fail_if_not_ready = false;
+    EXPECT_EQ(sccl_run_shader(stream, shader, &params), sccl_success);
+    EXPECT_EQ(sccl_get_shader_feedback(shader, &feedback), sccl_success);
+
+    EXPECT_EQ(sccl_wait_shader(shader), sccl_success);
+    params.fail_if_not_ready = true;
+    EXPECT_EQ(sccl_run_shader(stream, shader, &params), sccl_success);
+    EXPECT_EQ(sccl_dispatch_stream(stream), sccl_success);
+    EXPECT_EQ(sccl_join_stream(stream), sccl_success);
+    sccl_destroy_stream(stream);
+    sccl_destroy_shader(shader);
+
+    /* destroy while compiling */
+    EXPECT_EQ(sccl_create_shader_async(device, &shader, &shader_config),
+              sccl_success);
+    sccl_destroy_shader(shader);
+
+    /* config is validated before returning */
+    shader_config.shader_source_code_length = 0;
+    EXPECT_EQ(sccl_create_shader_async(device, &shader, &shader_config),
+              sccl_invalid_argument);
+}
+
+TEST_F(shader_test, create_many_shaders_async)
+{
+    std::string shader_source = read_test_shader("noop_shader.spv").value();
+
+    sccl_shader_config_t shader_config = {};
+    shader_config.shader_source_code = shader_source.data();
+    shader_config.shader_source_code_length = shader_source.size();
+
+    /* more jobs than the at most 16 compile threads, so some are queued */
+    std::vector<sccl_shader_t> shaders(64);
+    for (sccl_shader_t &shader : shaders) {
+        EXPECT_EQ(sccl_create_shader_async(device, &shader, &shader_config),
+                  sccl_success);
+    }
+
+    /* destroy every other shader, queued ones are removed from the queue */
+    for (size_t i = 0; i < shaders.size(); i += 2) {
+        sccl_destroy_shader(shaders[i]);
+    }
+    for (size_t i = 1; i < shaders.size(); i += 2) {
+        EXPECT_EQ(sccl_wait_shader(shaders[i]), sccl_success);
+        sccl_destroy_shader(shaders[i]);
+    }
+}
+
+TEST_F(shader_test, get_shader_feedback)
+{
+    std::string shader_source = read_test_shader("noop_shader.spv").value();
+
+    sccl_shader_config_t shader_config = {};
+    shader_config.shader_source_code = shader_source.data();
+    shader_config.shader_source_code_length = shader_source.size();
+
+    sccl_shader_t shader;
+    EXPECT_EQ(sccl_create_shader(device, &shader, &shader_config),
+              sccl_success);
+    EXPECT_EQ(sccl_wait_shader(shader), sccl_success);
+    sccl_shader_feedback_t feedback;
+    EXPECT_EQ(sccl_get_shader_feedback(shader, &feedback), sccl_success);
+    if (!feedback.valid) {
+        EXPECT_FALSE(feedback.cache_hit);
+    }
+    EXPECT_EQ(sccl_get_shader_feedback(shader, SCCL_NULL),
+              sccl_invalid_argument);
+    sccl_destroy_shader(shader);
+}
+
+TEST_F(shader_test, shader_cache_shares_objects)
+{
+    std::string shader_source = read_test_shader("add_shader.spv").value();
+
+    sccl_shader_buffer_layout_t buffer_layouts[2];
+    buffer_layouts[0].position.set = 0;
+    buffer_layouts[0].position.binding = 0;
+    buffer_layouts[0].type = sccl_buffer_type_host_storage;
+    buffer_layouts[1].position.set = 1;
+    buffer_layouts[1].position.binding = 0;
+    buffer_layouts[1].type = sccl_buffer_type_host_storage;
+
+    sccl_shader_push_constant_layout_t push_constant_layout = {};
+    push_constant_layout.size = sizeof(uint32_t);
+
+    sccl_shader_config_t shader_config = {};
+    shader_config.shader_source_code = shader_source.data();
+    shader_config.shader_source_code_length = shader_source.size();
+    shader_config.buffer_layouts = buffer_layouts;
+    shader_config.buffer_layouts_count = 2;
+    shader_config.push_constant_layouts = &push_constant_layout;
+    shader_config.push_constant_layouts_count = 1;
+
+    sccl_shader_cache_stats_t before;
+    EXPECT_EQ(sccl_get_shader_cache_stats(device, &before), sccl_success);
+
+    /* identical config shares module and all layouts */
+    sccl_shader_t shaders[3];
+    EXPECT_EQ(sccl_create_shader(device, &shaders[0], &shader_config),
+              sccl_success);
+    EXPECT_EQ(sccl_create_shader(device, &shaders[1], &shader_config),
+              sccl_success);
+
+    sccl_shader_cache_stats_t stats;
+    EXPECT_EQ(sccl_get_shader_cache_stats(device, &stats), sccl_success);
+    EXPECT_EQ(stats.shader_module_count, before.shader_module_count + 1);
+    /* both sets have the same bindings */
+    EXPECT_EQ(stats.descriptor_set_layout_count,
+              before.descriptor_set_layout_count + 1);
+    EXPECT_EQ(stats.pipeline_layout_count, before.pipeline_layout_count + 1);
+    EXPECT_GT(stats.hit_count, before.hit_count);
+
+    /* other push constants only need a new pipeline layout */
+    push_constant_layout.size = 2 * sizeof(uint32_t);
+    EXPECT_EQ(sccl_create_shader(device, &shaders[2], &shader_config),
+              sccl_success);
+    EXPECT_EQ(sccl_get_shader_cache_stats(device, &stats), sccl_success);
+    EXPECT_EQ(stats.shader_module_count, before.shader_module_count + 1);
+    EXPECT_EQ(stats.descriptor_set_layout_count,
+              before.descriptor_set_layout_count + 1);
+    EXPECT_EQ(stats.pipeline_layout_count, before.pipeline_layout_count + 2);
+
+    /* objects live until their last shader is destroyed */
+    sccl_destroy_shader(shaders[0]);
+    EXPECT_EQ(sccl_get_shader_cache_stats(device, &stats), sccl_success);
+    EXPECT_EQ(stats.shader_module_count, before.shader_module_count + 1);
+    EXPECT_EQ(stats.pipeline_layout_count, before.pipeline_layout_count + 2);
+    sccl_destroy_shader(shaders[1]);
+    sccl_destroy_shader(shaders[2]);
+    EXPECT_EQ(sccl_get_shader_cache_stats(device, &stats), sccl_success);
+    EXPECT_EQ(stats.shader_module_count, before.shader_module_count);
+    EXPECT_EQ(stats.descriptor_set_layout_count,
+              before.descriptor_set_layout_count);
+    EXPECT_EQ(stats.pipeline_layout_count, before.pipeline_layout_count);
+}
+
+TEST_F(shader_test, create_shader_from_bundle)
+{
+    /* built-in kernel that turns an element count into workgroup counts */
+    sccl_shader_buffer_layout_t buffer_layouts[2];
+    for (uint32_t i = 0; i < 2; ++i) {
+        buffer_layouts[i].position.set = 0;
+        buffer_layouts[i].position.binding = i;
+        buffer_layouts[i].type = sccl_buffer_type_host_storage;
+    }
+    sccl_shader_push_constant_layout_t push_constant_layout = {};
+    push_constant_layout.size = 3 * sizeof(uint32_t);
+
+    sccl_shader_config_t shader_config = {};
+    shader_config.buffer_layouts = buffer_layouts;
+    shader_config.buffer_layouts_count = 2;
+    shader_config.push_constant_layouts = &push_constant_layout;
+    shader_config.push_constant_layouts_count = 1;
+
+    sccl_shader_t shader;
+    EXPECT_EQ(sccl_create_shader_from_bundle(device, "group_counts", &shader,
+                                             &shader_config),
+              sccl_success);
+
+    sccl_buffer_t count_buffer, args_buffer;
+    EXPECT_EQ(sccl_create_buffer(device, &count_buffer,
+                                 sccl_buffer_type_host, sizeof(uint32_t)),
+              sccl_success);
+    EXPECT_EQ(sccl_create_buffer(device, &args_buffer, sccl_buffer_type_host,
+                                 SCCL_INDIRECT_ARGS_SIZE),
+              sccl_success);
+    void *data_ptr;
+    EXPECT_EQ(
+        sccl_host_map_buffer(count_buffer, &data_ptr, 0, sizeof(uint32_t)),
+        sccl_success);
+    *static_cast<uint32_t *>(data_ptr) = 1000;
+    sccl_host_unmap_buffer(count_buffer);
+
+    /* count index, args index, elements per workgroup */
+    uint32_t push_constants[3] = {0, 0, 64};
+    sccl_shader_push_constant_binding push_constant_binding = {};
+    push_constant_binding.index = 0;
+    push_constant_binding.data = push_constants;
+    sccl_shader_buffer_binding_t buffer_bindings[2];
+    buffer_bindings[0].position = buffer_layouts[0].position;
+    buffer_bindings[0].buffer = count_buffer;
+    buffer_bindings[1].position = buffer_layouts[1].position;
+    buffer_bindings[1].buffer = args_buffer;
+    sccl_shader_run_params_t params = {};
+    params.group_count_x = 1;
+    params.group_count_y = 1;
+    params.group_count_z = 1;
+    params.buffer_bindings = buffer_bindings;
+    params.buffer_bindings_count = 2;
+    params.push_constant_bindings = &push_constant_binding;
+    params.push_constant_bindings_count = 1;
+
+    sccl_stream_t stream;
+    EXPECT_EQ(sccl_create_stream(device, &stream), sccl_success);
+    EXPECT_EQ(sccl_run_shader(stream, shader, &params), sccl_success);
+    EXPECT_EQ(sccl_dispatch_stream(stream), sccl_success);
+    EXPECT_EQ(sccl_join_stream(stream), sccl_success);
+
+    EXPECT_EQ(sccl_host_map_buffer(args_buffer, &data_ptr, 0,
+                                   SCCL_INDIRECT_ARGS_SIZE),
+              sccl_success);
+    const uint32_t *args = static_cast<uint32_t *>(data_ptr);
+    EXPECT_EQ(args[0], 16);
+    EXPECT_EQ(args[1], 1);
+    EXPECT_EQ(args[2], 1);
+    sccl_host_unmap_buffer(args_buffer);
+
+    sccl_destroy_stream(stream);
+    sccl_destroy_buffer(args_buffer);
+    sccl_destroy_buffer(count_buffer);
+    sccl_destroy_shader(shader);
+
+    /* unknown name and config with shader code */
+    EXPECT_EQ(sccl_create_shader_from_bundle(device, "no_such_kernel",
+                                             &shader, &shader_config),
+              sccl_invalid_argument);
+    uint32_t code = 0;
+    shader_config.shader_source_code = reinterpret_cast<char *>(&code);
+    shader_config.shader_source_code_length = sizeof(code);
+    EXPECT_EQ(sccl_create_shader_from_bundle(device, "group_counts", &shader,
+                                             &shader_config),
+              sccl_invalid_argument);
+}
+
+TEST_F(shader_test, run_shader_indirect)
+{
+    std::string shader_source = read_test_shader("add_shader.spv").value();
+
+    sccl_shader_buffer_layout_t buffer_layouts[2];
+    buffer_layouts[0].position.set = 0;
+    buffer_layouts[0].position.binding = 0;
+    buffer_layouts[0].type = sccl_buffer_type_host_storage;
+    buffer_layouts[1].position.set = 1;
+    buffer_layouts[1].position.binding = 0;
+    buffer_layouts[1].type = sccl_buffer_type_host_storage;
+
+    sccl_shader_push_constant_layout_t push_constant_layout = {};
+    push_constant_layout.size = sizeof(uint32_t);
+
+    sccl_shader_config_t shader_config = {};
+    shader_config.shader_source_code = shader_source.data();
+    shader_config.shader_source_code_length = shader_source.size();
+    shader_config.buffer_layouts = buffer_layouts;
+    shader_config.buffer_layouts_count = 2;
+    shader_config.push_constant_layouts = &push_constant_layout;
+    shader_config.push_constant_layouts_count = 1;
+
+    sccl_shader_t shader;
+    EXPECT_EQ(sccl_create_shader(device, &shader, &shader_config),
+              sccl_success);
+
+    /* shader has local size 64 and no bounds check, so only the first
+     * `count` elements must change */
+    const size_t element_count = 64 * 16;
+    const uint32_t count = 64 * 5;
+    const size_t size = element_count * sizeof(uint32_t);
+    sccl_buffer_t input_buffer, output_buffer, args_buffer;
+    EXPECT_EQ(sccl_create_buffer(device, &input_buffer, sccl_buffer_type_host,
+                                 size),
+              sccl_success);
+    EXPECT_EQ(sccl_create_buffer(device, &output_buffer,
+                                 sccl_buffer_type_host, size),
+              sccl_success);
+    /* count at word 0, arguments at word 1 */
+    EXPECT_EQ(sccl_create_buffer(device, &args_buffer, sccl_buffer_type_host,
+                                 4 * sizeof(uint32_t)),
+              sccl_success);
+
+    void *data_ptr;
+    EXPECT_EQ(sccl_host_map_buffer(input_buffer, &data_ptr, 0, size),
+              sccl_success);
+    for (size_t i = 0; i < element_count; ++i) {
+        static_cast<uint32_t *>(data_ptr)[i] = i;
+    }
+    sccl_host_unmap_buffer(input_buffer);
+    EXPECT_EQ(sccl_host_map_buffer(output_buffer, &data_ptr, 0, size),
+              sccl_success);
+    memset(data_ptr, 0, size);
+    sccl_host_unmap_buffer(output_buffer);
+    EXPECT_EQ(sccl_host_map_buffer(args_buffer, &data_ptr, 0,
+                                   sizeof(uint32_t)),
+              sccl_success);
+    *static_cast<uint32_t *>(data_ptr) = count;
+    sccl_host_unmap_buffer(args_buffer);
+
+    sccl_stream_t stream;
+    EXPECT_EQ(sccl_create_stream(device, &stream), sccl_success);
+
+    EXPECT_EQ(sccl_write_group_counts(stream, args_buffer, 0, args_buffer,
+                                      sizeof(uint32_t), 64),
+              sccl_success);
+
+    sccl_shader_buffer_binding_t buffer_bindings[2];
+    buffer_bindings[0].position = buffer_layouts[0].position;
+    buffer_bindings[0].buffer = input_buffer;
+    buffer_bindings[1].position = buffer_layouts[1].position;
+    buffer_bindings[1].buffer = output_buffer;
+
+    uint32_t value = 3;
+    sccl_shader_push_constant_binding push_constant_binding = {};
+    push_constant_binding.index = 0;
+    push_constant_binding.data = &value;
+
+    sccl_shader_run_params_t params = {};
+    params.buffer_bindings = buffer_bindings;
+    params.buffer_bindings_count = 2;
+    params.push_constant_bindings = &push_constant_binding;
+    params.push_constant_bindings_count = 1;
+    EXPECT_EQ(sccl_run_shader_indirect(stream, shader, args_buffer,
+                                       sizeof(uint32_t), &params),
+              sccl_success);
+
+    EXPECT_EQ(sccl_dispatch_stream(stream), sccl_success);
+    EXPECT_EQ(sccl_join_stream(stream), sccl_success);
+
+    EXPECT_EQ(sccl_host_map_buffer(args_buffer, &data_ptr, 0,
+                                   4 * sizeof(uint32_t)),
+              sccl_success);
+    EXPECT_EQ(static_cast<uint32_t *>(data_ptr)[1], count / 64);
+    EXPECT_EQ(static_cast<uint32_t *>(data_ptr)[2], 1u);
+    EXPECT_EQ(static_cast<uint32_t *>(data_ptr)[3], 1u);
+    sccl_host_unmap_buffer(args_buffer);
+
+    EXPECT_EQ(sccl_host_map_buffer(output_buffer, &data_ptr, 0, size),
+              sccl_success);
+    for (size_t i = 0; i < element_count; ++i) {
+        EXPECT_EQ(static_cast<uint32_t *>(data_ptr)[i],
+                  i < count ? i + value : 0);
+    }
+    sccl_host_unmap_buffer(output_buffer);
+
+    /* misaligned offset and arguments past the end of the buffer */
+    EXPECT_EQ(sccl_run_shader_indirect(stream, shader, args_buffer, 2,
+                                       &params),
+              sccl_invalid_argument);
+    EXPECT_EQ(sccl_run_shader_indirect(stream, shader, args_buffer,
+                                       2 * sizeof(uint32_t), &params),
+              sccl_invalid_argument);
+
+    sccl_destroy_stream(stream);
+    sccl_destroy_buffer(args_buffer);
+    sccl_destroy_buffer(output_buffer);
+    sccl_destroy_buffer(input_buffer);
+    sccl_destroy_shader(shader);
+}
+
+TEST_F(shader_test, write_group_counts)
+{
+    /* element counts and expected x, y and z workgroup counts for 64
+     * elements per workgroup */
+    const uint32_t counts[] = {0, 1, 64, 65, 65535 * 64, 65535 * 64 + 1};
+    const uint32_t expected[][3] = {
+        {0, 1, 1},     {1, 1, 1},     {1, 1, 1},
+        {2, 1, 1},     {65535, 1, 1}, {65535, 2, 1},
+    };
+    const size_t cases = sizeof(counts) / sizeof(counts[0]);
+
+    sccl_buffer_t count_buffer, args_buffer;
+    EXPECT_EQ(sccl_create_buffer(device, &count_buffer,
+                                 sccl_buffer_type_host, sizeof(counts)),
+              sccl_success);
+    EXPECT_EQ(sccl_create_buffer(device, &args_buffer, sccl_buffer_type_host,
+                                 sizeof(expected)),
+              sccl_success);
+
+    void *data_ptr;
+    EXPECT_EQ(sccl_host_map_buffer(count_buffer, &data_ptr, 0, sizeof(counts)),
+              sccl_success);
+    memcpy(data_ptr, counts, sizeof(counts));
+    sccl_host_unmap_buffer(count_buffer);
+
+    sccl_stream_t stream;
+    EXPECT_EQ(sccl_create_stream(device, &stream), sccl_success);
+    for (size_t i = 0; i < cases; ++i) {
+        EXPECT_EQ(sccl_write_group_counts(stream, count_buffer,
+                                          i * sizeof(uint32_t), args_buffer,
+                                          i * SCCL_INDIRECT_ARGS_SIZE, 64),
+                  sccl_success);
+    }
+    EXPECT_EQ(sccl_dispatch_stream(stream), sccl_success);
+    EXPECT_EQ(sccl_join_stream(stream), sccl_success);
+
+    EXPECT_EQ(
+        sccl_host_map_buffer(args_buffer, &data_ptr, 0, sizeof(expected)),
+        sccl_success);
+    for (size_t i = 0; i < cases; ++i) {
+        for (size_t j = 0; j < 3; ++j) {
+            EXPECT_EQ(static_cast<uint32_t *>(data_ptr)[i * 3 + j],
+                      expected[i][j])
+                << "count " << counts[i];
+        }
+    }
+    sccl_host_unmap_buffer(args_buffer);
+
+    /* zero elements per workgroup, misaligned and out of range offsets */
+    EXPECT_EQ(sccl_write_group_counts(stream, count_buffer, 0, args_buffer, 0,
+                                      0),
+              sccl_invalid_argument);
+    EXPECT_EQ(sccl_write_group_counts(stream, count_buffer, 1, args_buffer, 0,
+                                      64),
+              sccl_invalid_argument);
+    EXPECT_EQ(sccl_write_group_counts(stream, count_buffer, sizeof(counts),
+                                      args_buffer, 0, 64),
+              sccl_invalid_argument);
+    EXPECT_EQ(sccl_write_group_counts(stream, count_buffer, 0, args_buffer,
+                                      sizeof(expected), 64),
+              sccl_invalid_argument);
+
+    sccl_destroy_stream(stream);
+    sccl_destroy_buffer(args_buffer);
+    sccl_destroy_buffer(count_buffer);
+}
+
+TEST_F(shader_test, get_group_counts)
+{
+    const size_t counts[] = {0,
+                             1,
+                             1000,
+                             64 * 65535,
+                             64 * 65535 + 1,
+                             (size_t)UINT32_MAX};
+    for (size_t count : counts) {
+        sccl_shader_run_params_t params = {};
+        EXPECT_EQ(sccl_get_group_counts(device, count, 64, &params),
+                  sccl_success);
+        uint64_t group_count = (count + 63) / 64;
+        uint64_t launched = (uint64_t)params.group_count_x *
+                            params.group_count_y * params.group_count_z;
+        EXPECT_GE(launched, group_count) << "count " << count;
+        if (group_count > 0) {
+            /* padding is less than one row of workgroups */
+            EXPECT_LT(launched - group_count,
+                      (uint64_t)params.group_count_y * params.group_count_z)
+                << "count " << count;
+        }
+    }
+
+    sccl_shader_run_params_t params = {};
+    EXPECT_EQ(sccl_get_group_counts(device, 64, 0, &params),
+              sccl_invalid_argument);
+    /* count and linear indices are 32-bit in shaders */
+    EXPECT_EQ(sccl_get_group_counts(device, (size_t)UINT32_MAX + 1, 64,
+                                    &params),
+              sccl_invalid_argument);
+    EXPECT_EQ(sccl_get_group_counts(device, UINT32_MAX, 7, &params),
+              sccl_invalid_argument);
+}
+
+TEST_F(shader_test, run_shader_linear_index)
+{
+    std::string shader_source =
+        read_test_shader("linear_add_shader.spv").value();
+
+    sccl_shader_buffer_layout_t buffer_layouts[2];
+    buffer_layouts[0].position.set = 0;
+    buffer_layouts[0].position.binding = 0;
+    buffer_layouts[0].type = sccl_buffer_type_host_storage;
+    buffer_layouts[1].position.set = 0;
+    buffer_layouts[1].position.binding = 1;
+    buffer_layouts[1].type = sccl_buffer_type_host_storage;
+
+    sccl_shader_push_constant_layout_t push_constant_layout = {};
+    push_constant_layout.size = 2 * sizeof(uint32_t);
+
+    sccl_shader_config_t shader_config = {};
+    shader_config.shader_source_code = shader_source.data();
+    shader_config.shader_source_code_length = shader_source.size();
+    shader_config.buffer_layouts = buffer_layouts;
+    shader_config.buffer_layouts_count = 2;
+    shader_config.push_constant_layouts = &push_constant_layout;
+    shader_config.push_constant_layouts_count = 1;
+
+    sccl_shader_t shader;
+    EXPECT_EQ(sccl_create_shader(device, &shader, &shader_config),
+              sccl_success);
+
+    /* more workgroups than the x dimension of every device holds, with a
+     * partial last workgroup, one element past `count` must stay zero */
+    const uint32_t count = 64 * 65535 + 100;
+    const size_t size = (count + 1) * sizeof(uint32_t);
+    sccl_buffer_t input_buffer, output_buffer;
+    EXPECT_EQ(sccl_create_buffer(device, &input_buffer, sccl_buffer_type_host,
+                                 size),
+              sccl_success);
+    EXPECT_EQ(sccl_create_buffer(device, &output_buffer,
+                                 sccl_buffer_type_host, size),
+              sccl_success);
+
+    void *data_ptr;
+    EXPECT_EQ(sccl_host_map_buffer(input_buffer, &data_ptr, 0, size),
+              sccl_success);
+    for (size_t i = 0; i < count + 1; ++i) {
+        static_cast<uint32_t *>(data_ptr)[i] = i;
+    }
+    sccl_host_unmap_buffer(input_buffer);
+    EXPECT_EQ(sccl_host_map_buffer(output_buffer, &data_ptr, 0, size),
+              sccl_success);
+    memset(data_ptr, 0, size);
+    sccl_host_unmap_buffer(output_buffer);
+
+    sccl_shader_buffer_binding_t buffer_bindings[2];
+    buffer_bindings[0].position = buffer_layouts[0].position;
+    buffer_bindings[0].buffer = input_buffer;
+    buffer_bindings[1].position = buffer_layouts[1].position;
+    buffer_bindings[1].buffer = output_buffer;
+
+    uint32_t push_constants[2] = {count, 3};
+    sccl_shader_push_constant_binding push_constant_binding = {};
+    push_constant_binding.index = 0;
+    push_constant_binding.data = push_constants;
+
+    sccl_shader_run_params_t params = {};
+    params.buffer_bindings = buffer_bindings;
+    params.buffer_bindings_count = 2;
+    params.push_constant_bindings = &push_constant_binding;
+    params.push_constant_bindings_count = 1;
+    EXPECT_EQ(sccl_get_group_counts(device, count, 64, &params),
+              sccl_success);
+
+    sccl_stream_t stream;
+    EXPECT_EQ(sccl_create_stream(device, &stream), sccl_success);
+    EXPECT_EQ(sccl_run_shader(stream, shader, &params), sccl_success);
+    EXPECT_EQ(sccl_dispatch_stream(stream), sccl_success);
+    EXPECT_EQ(sccl_join_stream(stream), sccl_success);
+
+    EXPECT_EQ(sccl_host_map_buffer(output_buffer, &data_ptr, 0, size),
+              sccl_success);
+    const uint32_t *output = static_cast<const uint32_t *>(data_ptr);
+    size_t mismatches = 0;
+    for (size_t i = 0; i < count; ++i) {
+        mismatches += output[i] != i + 3;
+    }
+    EXPECT_EQ(mismatches, 0u);
+    EXPECT_EQ(output[count], 0u);
+    sccl_host_unmap_buffer(output_buffer);
+
+    sccl_destroy_stream(stream);
+    sccl_destroy_buffer(output_buffer);
+    sccl_destroy_buffer(input_buffer);
+    sccl_destroy_shader(shader);
+}
@@ -0,0 +1,221 @@
+
+#include <sccl.h>
+
+#include "common.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <limits>
+#include <random>
+#include <vector>
+
+class sort_test : public device_stream_test
+{
+protected:
+    sccl_buffer_t create_temp(size_t count, sccl_dtype_t key_dtype,
+                              bool with_values)
+    {
+        size_t temp_size = 0;
+        EXPECT_EQ(sccl_get_sort_temp_size(count, key_dtype, with_values,
+                                          &temp_size),
+                  sccl_success);
+        sccl_buffer_t temp;
+        EXPECT_EQ(sccl_create_buffer(device, &temp, sccl_buffer_type_device,
+                                     std::max<size_t>(temp_size, 1)),
+                  sccl_success);
+        return temp;
+    }
+
+    /**
+     * Sort `keys` on device, returns error of `sccl_sort_keys`. Keys are
+     * only replaced if sort succeeded.
+     */
+    template <typename T>
+    sccl_error_t sort_keys(std::vector<T> *keys, sccl_dtype_t key_dtype)
+    {
+        sccl_buffer_t buffer = upload(*keys);
+        sccl_buffer_t temp = create_temp(keys->size(), key_dtype, false);
+
+        sccl_error_t error =
+            sccl_sort_keys(stream, buffer, temp, keys->size(), key_dtype);
+        EXPECT_EQ(sccl_dispatch_stream(stream), sccl_success);
+        EXPECT_EQ(sccl_join_stream(stream), sccl_success);
+        if (error == sccl_success) {
+            *keys = download<T>(buffer, keys->size());
+        }
+
+        sccl_destroy_buffer(temp);
+        sccl_destroy_buffer(buffer);
+        return error;
+    }
+};
+
+TEST_F(sort_test, keys_uint32)
+{
+    std::mt19937 rng(1);
+    /* single tile, partial tile and many tiles */
+    for (size_t count : {1, 1000, SCCL_SORT_TILE_SIZE + 1, 3000000}) {
+        std::vector<uint32_t> keys(count);
+        for (uint32_t &key : keys) {
+            key = rng();
+        }
+        std::vector<uint32_t> expected = keys;
+        std::sort(expected.begin(), expected.end());
+
+        ASSERT_EQ(sort_keys(&keys, sccl_dtype_uint32), sccl_success);
+        EXPECT_EQ(keys, expected);
+    }
+}
+
+TEST_F(sort_test, keys_int32)
+{
+    std::mt19937 rng(2);
+    std::vector<int32_t> keys(100000);
+    for (int32_t &key : keys) {
+        key = (int32_t)rng();
+    }
+    keys[0] = INT32_MIN;
+    keys[1] = INT32_MAX;
+    std::vector<int32_t> expected = keys;
+    std::sort(expected.begin(), expected.end());
+
+    ASSERT_EQ(sort_keys(&keys, sccl_dtype_int32), sccl_success);
+    EXPECT_EQ(keys, expected);
+}
+
+TEST_F(sort_test, keys_float32)
+{
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> distribution(-1e6f, 1e6f);
+    std::vector<float> keys(100000);
+    for (float &key : keys) {
+        key = distribution(rng);
+    }
+    keys[10] = 0.0f;
+    keys[20] = -0.0f;
+    keys[30] = -std::numeric_limits<float>::infinity();
+    keys[40] = std::numeric_limits<float>::infinity();
+    std::vector<float> expected = keys;
+    std::sort(expected.begin(), expected.end());
+
+    ASSERT_EQ(sort_keys(&keys, sccl_dtype_float32), sccl_success);
+    /* std::sort keeps zeros in any order, -0.0 sorts before 0.0 */
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (expected[i] == 0.0f) {
+            ASSERT_EQ(keys[i], 0.0f);
+        } else {
+            ASSERT_EQ(keys[i], expected[i]);
+        }
+    }
+    auto zero = std::find(keys.begin(), keys.end(), 0.0f);
+    ASSERT_NE(zero, keys.end());
+    EXPECT_TRUE(std::signbit(*zero));
+}
+
+TEST_F(sort_test, keys_int64)
+{
+    std::mt19937_64 rng(4);
+    std::vector<int64_t> keys(500000);
+    for (int64_t &key : keys) {
+        key = (int64_t)rng();
+    }
+    std::vector<int64_t> expected = keys;
+    std::sort(expected.begin(), expected.end());
+
+    ASSERT_EQ(sort_keys(&keys, sccl_dtype_int64), sccl_success);
+    EXPECT_EQ(keys, expected);
+}
+
+TEST_F(sort_test, pairs_stable)
+{
+    /* few distinct keys, values are the original positions */
+    std::mt19937 rng(5);
+    size_t count = 200000;
+    std::vector<uint32_t> keys(count), values(count);
+    for (size_t i = 0; i < count; ++i) {
+        keys[i] = rng() % 100;
+        values[i] = (uint32_t)i;
+    }
+    std::vector<uint32_t> expected_values = values;
+    std::stable_sort(
+        expected_values.begin(), expected_values.end(),
+        [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+
+    sccl_buffer_t key_buffer = upload(keys);
+    sccl_buffer_t value_buffer = upload(values);
+    sccl_buffer_t temp = create_temp(count, sccl_dtype_uint32, true);
+    ASSERT_EQ(sccl_sort_pairs(stream, key_buffer, value_buffer, temp, count,
+                              sccl_dtype_uint32),
+              sccl_success);
+    ASSERT_EQ(sccl_dispatch_stream(stream), sccl_success);
+    ASSERT_EQ(sccl_join_stream(stream), sccl_success);
+
+    std::vector<uint32_t> sorted_values =
+        download<uint32_t>(value_buffer, count);
+    EXPECT_EQ(sorted_values, expected_values);
+    std::vector<uint32_t> sorted_keys = download<uint32_t>(key_buffer, count);
+    for (size_t i = 0; i < count; ++i) {
+        ASSERT_EQ(sorted_keys[i], keys[expected_values[i]]);
+    }
+
+    sccl_destroy_buffer(temp);
+    sccl_destroy_buffer(value_buffer);
+    sccl_destroy_buffer(key_buffer);
+}
+
+TEST_F(sort_test, temp_size)
+{
+    size_t size = 1;
+    EXPECT_EQ(sccl_get_sort_temp_size(0, sccl_dtype_uint32, true, &size),
+              sccl_success);
+    EXPECT_EQ(size, 0u);
+
+    size_t keys_size, pairs_size;
+    EXPECT_EQ(sccl_get_sort_temp_size(1000, sccl_dtype_int64, false,
+                                      &keys_size),
+              sccl_success);
+    EXPECT_GE(keys_size, 1000 * sizeof(int64_t));
+    EXPECT_EQ(sccl_get_sort_temp_size(1000, sccl_dtype_int64, true,
+                                      &pairs_size),
+              sccl_success);
+    EXPECT_EQ(pairs_size, keys_size + 1000 * sizeof(uint32_t));
+
+    EXPECT_EQ(sccl_get_sort_temp_size(10, sccl_dtype_float16, false, &size),
+              sccl_invalid_argument);
+    EXPECT_EQ(sccl_get_sort_temp_size(SCCL_SORT_MAX_COUNT + 1,
+                                      sccl_dtype_uint32, false, &size),
+              sccl_invalid_argument);
+}
+
+TEST_F(sort_test, invalid_arguments)
+{
+    std::vector<uint32_t> keys(5000, 1);
+    sccl_buffer_t key_buffer = upload(keys);
+    sccl_buffer_t temp = create_temp(keys.size(), sccl_dtype_uint32, false);
+    sccl_buffer_t small_temp;
+    ASSERT_EQ(sccl_create_buffer(device, &small_temp, sccl_buffer_type_device,
+                                 64),
+              sccl_success);
+
+    EXPECT_EQ(sccl_sort_keys(stream, key_buffer, small_temp, keys.size(),
+                             sccl_dtype_uint32),
+              sccl_invalid_argument);
+    EXPECT_EQ(sccl_sort_keys(stream, key_buffer, temp, keys.size() + 1,
+                             sccl_dtype_uint32),
+              sccl_invalid_argument);
+    EXPECT_EQ(sccl_sort_keys(stream, key_buffer, temp, keys.size(),
+                             sccl_dtype_float16),
+              sccl_invalid_argument);
+    EXPECT_EQ(sccl_sort_pairs(stream, key_buffer, SCCL_NULL, temp,
+                              keys.size(), sccl_dtype_uint32),
+              sccl_invalid_argument);
+    /* nothing to sort, temp is not needed */
+    EXPECT_EQ(sccl_sort_keys(stream, key_buffer, SCCL_NULL, 0,
+                             sccl_dtype_uint32),
+              sccl_success);
+
+    sccl_destroy_buffer(small_temp);
+    sccl_destroy_buffer(temp);
+    sccl_destroy_buffer(key_buffer);
+}
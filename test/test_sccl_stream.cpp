@@ -73,3 +73,128 @@ TEST_F(stream_test, dispatch_and_join_multiple)
         sccl_destroy_stream(stream);
     }
 }
+
+TEST_F(stream_test, wait_policy_default_blocks)
+{
+    sccl_stream_t stream;
+    EXPECT_EQ(sccl_create_stream(device, &stream), sccl_success);
+
+    EXPECT_EQ(sccl_dispatch_stream(stream), sccl_success);
+    EXPECT_EQ(sccl_join_stream(stream), sccl_success);
+
+    sccl_stream_wait_stats_t stats;
+    EXPECT_EQ(sccl_get_stream_wait_stats(stream, &stats), sccl_success);
+    EXPECT_EQ(stats.spin_count, 0u);
+    EXPECT_EQ(stats.yield_count, 0u);
+    EXPECT_EQ(stats.block_count, 1u);
+
+    sccl_destroy_stream(stream);
+}
+
+TEST_F(stream_test, wait_policy_phases)
+{
+    sccl_stream_t stream;
+    EXPECT_EQ(sccl_create_stream(device, &stream), sccl_success);
+
+    /* empty submissions finish long before the phase ends */
+    const uint64_t phase_ns = 10000000000;
+    sccl_stream_wait_policy_t policy = {};
+    policy.spin_ns = phase_ns;
+    EXPECT_EQ(sccl_set_stream_wait_policy(stream, &policy), sccl_success);
+    EXPECT_EQ(sccl_dispatch_stream(stream), sccl_success);
+    EXPECT_EQ(sccl_join_stream(stream), sccl_success);
+
+    policy.spin_ns = 0;
+    policy.yield_ns = phase_ns;
+    EXPECT_EQ(sccl_set_stream_wait_policy(stream, &policy), sccl_success);
+    EXPECT_EQ(sccl_dispatch_stream(stream), sccl_success);
+    EXPECT_EQ(sccl_join_stream(stream), sccl_success);
+
+    sccl_stream_wait_stats_t stats;
+    EXPECT_EQ(sccl_get_stream_wait_stats(stream, &stats), sccl_success);
+    EXPECT_EQ(stats.spin_count, 1u);
+    EXPECT_EQ(stats.yield_count, 1u);
+    EXPECT_EQ(stats.block_count, 0u);
+    EXPECT_LT(stats.average_wait_ns, phase_ns);
+
+    sccl_destroy_stream(stream);
+}
+
+TEST_F(stream_test, wait_policy_adaptive)
+{
+    sccl_stream_t stream;
+    EXPECT_EQ(sccl_create_stream(device, &stream), sccl_success);
+
+    /* all waits are far shorter than the phases, which are shortened to twice
+     * the average wait, so waits mostly complete while spinning */
+    sccl_stream_wait_policy_t policy = {};
+    policy.spin_ns = 10000000000;
+    policy.yield_ns = 10000000000;
+    policy.adaptive = true;
+    EXPECT_EQ(sccl_set_stream_wait_policy(stream, &policy), sccl_success);
+    const uint64_t join_count = 100;
+    for (uint64_t i = 0; i < join_count; ++i) {
+        EXPECT_EQ(sccl_dispatch_stream(stream), sccl_success);
+        EXPECT_EQ(sccl_join_stream(stream), sccl_success);
+    }
+
+    sccl_stream_wait_stats_t stats;
+    EXPECT_EQ(sccl_get_stream_wait_stats(stream, &stats), sccl_success);
+    EXPECT_EQ(stats.spin_count + stats.yield_count + stats.block_count,
+              join_count);
+    EXPECT_GT(stats.spin_count, 0u);
+    EXPECT_GT(stats.average_wait_ns, 0u);
+
+    sccl_destroy_stream(stream);
+}
+
+TEST_F(stream_test, wait_policy_invalid)
+{
+    sccl_stream_t stream;
+    EXPECT_EQ(sccl_create_stream(device, &stream), sccl_success);
+
+    sccl_stream_wait_policy_t policy = {};
+    policy.spin_ns = UINT64_MAX;
+    policy.yield_ns = 1;
+    EXPECT_EQ(sccl_set_stream_wait_policy(stream, &policy),
+              sccl_invalid_argument);
+    EXPECT_EQ(sccl_set_stream_wait_policy(stream, NULL),
+              sccl_invalid_argument);
+    EXPECT_EQ(sccl_get_stream_wait_stats(stream, NULL),
+              sccl_invalid_argument);
+
+    sccl_destroy_stream(stream);
+}
+
+TEST_F(stream_test, completion_flag)
+{
+    sccl_stream_t stream;
+    EXPECT_EQ(sccl_create_stream(device, &stream), sccl_success);
+
+    const volatile uint32_t *flag;
+    uint32_t sequence;
+    EXPECT_EQ(sccl_get_stream_completion_flag(stream, &flag, &sequence),
+              sccl_invalid_argument);
+
+    sccl_stream_wait_policy_t policy = {};
+    policy.spin_ns = 10000000000;
+    policy.completion_flag = true;
+    EXPECT_EQ(sccl_set_stream_wait_policy(stream, &policy), sccl_success);
+
+    for (uint32_t i = 1; i <= 3; ++i) {
+        EXPECT_EQ(sccl_dispatch_stream(stream), sccl_success);
+        EXPECT_EQ(sccl_get_stream_completion_flag(stream, &flag, &sequence),
+                  sccl_success);
+        EXPECT_EQ(sequence, i);
+        /* device writes the flag without any call into the library */
+        while (*flag != sequence) {
+        }
+        EXPECT_EQ(sccl_join_stream(stream), sccl_success);
+    }
+
+    sccl_stream_wait_stats_t stats;
+    EXPECT_EQ(sccl_get_stream_wait_stats(stream, &stats), sccl_success);
+    EXPECT_EQ(stats.spin_count, 3u);
+
+    sccl_destroy_stream(stream);
+}
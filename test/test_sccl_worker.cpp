@@ -0,0 +1,198 @@
+
+#include <sccl.h>
+
+#include "common.hpp"
+#include <cstring>
+#include <gtest/gtest.h>
+#include <vector>
+
+/* words in each test buffer */
+#define WORKER_TEST_COUNT 4096
+
+class worker_test : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        EXPECT_EQ(sccl_create_instance(&instance), sccl_success);
+        EXPECT_EQ(
+            sccl_create_device(instance, &device, get_environment_gpu_index()),
+            sccl_success);
+        const size_t size = WORKER_TEST_COUNT * sizeof(uint32_t);
+        EXPECT_EQ(
+            sccl_create_buffer(device, &src, sccl_buffer_type_shared, size),
+            sccl_success);
+        EXPECT_EQ(
+            sccl_create_buffer(device, &dst, sccl_buffer_type_shared, size),
+            sccl_success);
+        void *mapped;
+        EXPECT_EQ(sccl_host_map_buffer(src, &mapped, 0, size), sccl_success);
+        for (uint32_t i = 0; i < WORKER_TEST_COUNT; ++i) {
+            static_cast<uint32_t *>(mapped)[i] = i;
+        }
+        sccl_host_unmap_buffer(src);
+    }
+
+    void TearDown() override
+    {
+        sccl_destroy_buffer(dst);
+        sccl_destroy_buffer(src);
+        sccl_destroy_device(device);
+        sccl_destroy_instance(instance);
+    }
+
+    /* skip test if device has no descriptor table */
+    bool create_worker(const sccl_worker_config_t *config)
+    {
+        sccl_error_t error = sccl_create_worker(device, config, &worker);
+        if (error == sccl_unsupported_error) {
+            return false;
+        }
+        EXPECT_EQ(error, sccl_success);
+        return true;
+    }
+
+    std::vector<uint32_t> read_dst()
+    {
+        std::vector<uint32_t> data(WORKER_TEST_COUNT);
+        void *mapped;
+        EXPECT_EQ(sccl_host_map_buffer(dst, &mapped, 0,
+                                       WORKER_TEST_COUNT * sizeof(uint32_t)),
+                  sccl_success);
+        memcpy(data.data(), mapped, WORKER_TEST_COUNT * sizeof(uint32_t));
+        sccl_host_unmap_buffer(dst);
+        return data;
+    }
+
+    sccl_instance_t instance;
+    sccl_device_t device;
+    sccl_buffer_t src;
+    sccl_buffer_t dst;
+    sccl_worker_t worker;
+};
+
+TEST_F(worker_test, run_jobs)
+{
+    if (!create_worker(NULL)) {
+        GTEST_SKIP() << "descriptor indexing not supported";
+    }
+
+    /* dst = src + 5 in the first half, 7 in the second half, each job
+     * depends on the one before it */
+    const size_t half = WORKER_TEST_COUNT / 2 * sizeof(uint32_t);
+    sccl_worker_job_t job = {};
+    job.op = sccl_worker_op_fill;
+    job.dst = dst;
+    job.size = 2 * half;
+    job.value = 7;
+    uint64_t ticket;
+    EXPECT_EQ(sccl_enqueue_worker(worker, &job, &ticket), sccl_success);
+    job.op = sccl_worker_op_copy;
+    job.src = src;
+    job.size = half;
+    EXPECT_EQ(sccl_enqueue_worker(worker, &job, &ticket), sccl_success);
+    job.op = sccl_worker_op_add;
+    job.src = dst;
+    job.value = 5;
+    EXPECT_EQ(sccl_enqueue_worker(worker, &job, &ticket), sccl_success);
+    EXPECT_EQ(ticket, 2u);
+
+    EXPECT_EQ(sccl_wait_worker(worker, ticket), sccl_success);
+    bool done = false;
+    EXPECT_EQ(sccl_query_worker(worker, 0, &done), sccl_success);
+    EXPECT_TRUE(done);
+
+    std::vector<uint32_t> data = read_dst();
+    size_t mismatches = 0;
+    for (uint32_t i = 0; i < WORKER_TEST_COUNT; ++i) {
+        uint32_t expected = i < WORKER_TEST_COUNT / 2 ? i + 5 : 7;
+        mismatches += data[i] != expected;
+    }
+    EXPECT_EQ(mismatches, 0u);
+
+    sccl_worker_stats_t stats;
+    EXPECT_EQ(sccl_get_worker_stats(worker, &stats), sccl_success);
+    EXPECT_GE(stats.launch_count, 1u);
+
+    sccl_destroy_worker(worker);
+}
+
+TEST_F(worker_test, watchdog_relaunches_kernel)
+{
+    /* short lifetime and small ring, so jobs span many launches and
+     * producers wait for free slots */
+    sccl_worker_config_t config = {};
+    config.capacity = 4;
+    config.lifetime_ns = 100000;
+    if (!create_worker(&config)) {
+        GTEST_SKIP() << "descriptor indexing not supported";
+    }
+
+    const uint64_t job_count = 2000;
+    sccl_worker_job_t job = {};
+    job.op = sccl_worker_op_add;
+    job.src = dst;
+    job.dst = dst;
+    job.size = WORKER_TEST_COUNT * sizeof(uint32_t);
+    job.value = 1;
+    sccl_worker_job_t clear = job;
+    clear.op = sccl_worker_op_fill;
+    clear.value = 0;
+    uint64_t ticket;
+    EXPECT_EQ(sccl_enqueue_worker(worker, &clear, &ticket), sccl_success);
+    for (uint64_t i = 0; i < job_count; ++i) {
+        EXPECT_EQ(sccl_enqueue_worker(worker, &job, &ticket), sccl_success);
+    }
+    EXPECT_EQ(sccl_wait_worker(worker, ticket), sccl_success);
+
+    std::vector<uint32_t> data = read_dst();
+    size_t mismatches = 0;
+    for (uint32_t i = 0; i < WORKER_TEST_COUNT; ++i) {
+        mismatches += data[i] != job_count;
+    }
+    EXPECT_EQ(mismatches, 0u);
+
+    sccl_worker_stats_t stats;
+    EXPECT_EQ(sccl_get_worker_stats(worker, &stats), sccl_success);
+    EXPECT_GT(stats.launch_count, 1u);
+    EXPECT_GT(stats.watchdog_stop_count, 0u);
+
+    sccl_destroy_worker(worker);
+}
+
+TEST_F(worker_test, invalid_jobs)
+{
+    if (!create_worker(NULL)) {
+        GTEST_SKIP() << "descriptor indexing not supported";
+    }
+
+    sccl_worker_job_t job = {};
+    job.op = sccl_worker_op_copy;
+    job.src = src;
+    job.dst = dst;
+    job.size = WORKER_TEST_COUNT * sizeof(uint32_t);
+    uint64_t ticket;
+
+    sccl_worker_job_t invalid = job;
+    invalid.size += sizeof(uint32_t);
+    EXPECT_EQ(sccl_enqueue_worker(worker, &invalid, &ticket),
+              sccl_invalid_argument);
+    invalid = job;
+    invalid.dst_offset = 2;
+    EXPECT_EQ(sccl_enqueue_worker(worker, &invalid, &ticket),
+              sccl_invalid_argument);
+    invalid = job;
+    invalid.src = SCCL_NULL;
+    EXPECT_EQ(sccl_enqueue_worker(worker, &invalid, &ticket),
+              sccl_invalid_argument);
+    invalid = job;
+    invalid.op = static_cast<sccl_worker_op_t>(3);
+    EXPECT_EQ(sccl_enqueue_worker(worker, &invalid, &ticket),
+              sccl_invalid_argument);
+
+    /* no job was enqueued */
+    bool done;
+    EXPECT_EQ(sccl_query_worker(worker, 0, &done), sccl_invalid_argument);
+
+    sccl_destroy_worker(worker);
+}